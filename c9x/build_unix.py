@@ -7,15 +7,24 @@ LD = "cc" if os.getenv("LD") is None else str(os.getenv("LD"))
 CFLAGS = (
     "-O1 -g -w --std=c9x -m32" if os.getenv("CFLAGS") is None else str(os.getenv("CFLAGS"))
 )
-LDFLAGS = "-lm -lSDL2 -g -m32" if os.getenv("LDFLAGS") is None else str(os.getenv("LDFLAGS"))
-
-
 GAMENAME = "QUAKE" if os.getenv("GAMENAME") is None else str(os.getenv("GAMENAME"))
 
 SYS_BACKEND = (
     "SDL" if os.getenv("SYS_BACKEND") is None else str(os.getenv("SYS_BACKEND"))
 )
 
+# SYS_BACKEND=DEDICATED builds a server only binary: no client, sound,
+# input or renderer, and no SDL
+DEDICATED = SYS_BACKEND.upper() == "DEDICATED"
+
+LDFLAGS = (
+    ("-lm -lpthread -g -m32" if DEDICATED else "-lm -lSDL2 -g -m32")
+    if os.getenv("LDFLAGS") is None
+    else str(os.getenv("LDFLAGS"))
+)
+
+TARGET = f"{GAMENAME.lower()}-c9x-ded" if DEDICATED else f"{GAMENAME.lower()}-c9x"
+
 ENGINEVER = "Q1" if os.getenv("ENGINEVER") is None else str(os.getenv("ENGINEVER"))
 R_BACKEND = "SOFT" if os.getenv("R_BACKEND") is None else str(os.getenv("R_BACKEND"))
 
@@ -40,30 +49,49 @@ CFlags = [
     "-DGAME_HARD_LINKED",
 ]
 
+if DEDICATED:
+    CFlags.append("-DDEDICATED_ONLY")
+
+# client side files that live in qcommon; sys/dedicated/cl_null.c stubs them
+ClientOnly = {
+    "Q1": ["chase.c", "draw.c", "menu.c", "sbar.c", "screen.c", "view.c"],
+    "Q2": [],
+}
+
 LDFlags = [LDFLAGS]
 
 CFiles: list[str] = []
 
 for file in os.listdir(f"{ENGINEVER.lower()}src/qcommon"):
     if file.endswith(".c"):
+        if DEDICATED and file in ClientOnly.get(ENGINEVER, []):
+            continue
         CFiles.append(os.path.join(f"{ENGINEVER.lower()}src/qcommon", file))
-for file in os.listdir(f"{ENGINEVER.lower()}src/client"):
-    if file.endswith(".c"):
-        CFiles.append(os.path.join(f"{ENGINEVER.lower()}src/client", file))
+if not DEDICATED:
+    for file in os.listdir(f"{ENGINEVER.lower()}src/client"):
+        if file.endswith(".c"):
+            CFiles.append(os.path.join(f"{ENGINEVER.lower()}src/client", file))
 for file in os.listdir(f"{ENGINEVER.lower()}src/server"):
     if file.endswith(".c"):
         CFiles.append(os.path.join(f"{ENGINEVER.lower()}src/server", file))
-for file in os.listdir(f"game/{GAMENAME.lower()}"):
-    if file.endswith(".c"):
-        CFiles.append(os.path.join(f"game/{GAMENAME.lower()}", file))
+# quake 1 game code is progs.dat, so there may be no game directory
+if os.path.isdir(f"game/{GAMENAME.lower()}"):
+    for file in os.listdir(f"game/{GAMENAME.lower()}"):
+        if file.endswith(".c"):
+            CFiles.append(os.path.join(f"game/{GAMENAME.lower()}", file))
 for file in os.listdir(f"sys/{SYS_BACKEND.lower()}"):
     if file.endswith(".c"):
         CFiles.append(os.path.join(f"sys/{SYS_BACKEND.lower()}", file))
-for file in os.listdir(f"{ENGINEVER.lower()}render/ref_{R_BACKEND.lower()}"):
-    if file.endswith(".c"):
-        CFiles.append(
-            os.path.join(f"{ENGINEVER.lower()}render/ref_{R_BACKEND.lower()}", file)
-        )
+if DEDICATED:
+    # the quake 2 network and hunk code has no SDL in it
+    CFiles.append("sys/sdl/net_linux.c")
+    CFiles.append("sys/sdl/q_shlinux.c")
+else:
+    for file in os.listdir(f"{ENGINEVER.lower()}render/ref_{R_BACKEND.lower()}"):
+        if file.endswith(".c"):
+            CFiles.append(
+                os.path.join(f"{ENGINEVER.lower()}render/ref_{R_BACKEND.lower()}", file)
+            )
 
 OFiles: list[str] = []
 
@@ -89,7 +117,7 @@ def compile_c(c_file):
 def link():
     if (
         os.system(
-            f"{LD} {' '.join(OFiles)} -o {GAMENAME.lower()}-c9x {' '.join(LDFlags)} "
+            f"{LD} {' '.join(OFiles)} -o {TARGET} {' '.join(LDFlags)} "
         )
         != 0
     ):
@@ -109,8 +137,8 @@ def clean():
     for file in OFiles:
         if os.path.exists(file):
             os.remove(file)
-    if os.path.exists(f"{GAMENAME.lower()}-c9x"):
-        os.remove(f"{GAMENAME.lower()}-c9x")
+    if os.path.exists(TARGET):
+        os.remove(TARGET)
 
 
 if args.clean:
@@ -381,6 +381,15 @@ void CL_SendMove (usercmd_t *cmd)
 	MSG_WriteByte (&buf, cmd->lightlevel);
 #endif
 
+//
+// tell the server which entity frame to delta from
+//
+	if (cl.ackframe)
+	{
+		MSG_WriteByte (&buf, clc_ackframe);
+		MSG_WriteLong (&buf, cl.ackframe);
+	}
+
 //
 // deliver the message
 //
@@ -64,7 +64,8 @@ char *svc_strings[] =
 	"svc_finale",			// [string] music [string] text
 	"svc_cdtrack",			// [byte] track [byte] looptrack
 	"svc_sellscreen",
-	"svc_cutscene"
+	"svc_cutscene",
+	"svc_packetentities"
 };
 
 //=============================================================================
@@ -313,53 +314,72 @@ void CL_ParseServerInfo (void)
 	Hunk_Check ();		// make sure nothing is hurt
 	
 	noclip_anglehack = false;		// noclip is turned off at start	
+
+// ask for the protocol extensions we understand, ahead of prespawn
+// servers that don't know the command just ignore it
+	MSG_WriteByte (&cls.message, clc_stringcmd);
+	MSG_WriteString (&cls.message, va("protocolext %i", PEXT_DELTAENTITIES));
 }
 
 
 /*
 ==================
-CL_ParseUpdate
+CL_ReadEntityDelta
 
-Parse an entity update message from the server
+Reads the fields flagged in bits, the rest are copied from from
+==================
+*/
+static void CL_ReadEntityDelta (int bits, entity_state_t *from, entity_state_t *to)
+{
+	*to = *from;
+
+	if (bits & U_MODEL)
+	{
+		to->modelindex = MSG_ReadByte ();
+		if (to->modelindex >= MAX_MODELS)
+			Host_Error ("CL_ParseModel: bad modnum");
+	}
+	if (bits & U_FRAME)
+		to->frame = MSG_ReadByte ();
+	if (bits & U_COLORMAP)
+		to->colormap = MSG_ReadByte();
+	if (bits & U_SKIN)
+		to->skin = MSG_ReadByte();
+	if (bits & U_EFFECTS)
+		to->effects = MSG_ReadByte();
+
+	if (bits & U_ORIGIN1)
+		to->origin[0] = MSG_ReadCoord ();
+	if (bits & U_ANGLE1)
+		to->angles[0] = MSG_ReadAngle();
+	if (bits & U_ORIGIN2)
+		to->origin[1] = MSG_ReadCoord ();
+	if (bits & U_ANGLE2)
+		to->angles[1] = MSG_ReadAngle();
+	if (bits & U_ORIGIN3)
+		to->origin[2] = MSG_ReadCoord ();
+	if (bits & U_ANGLE3)
+		to->angles[2] = MSG_ReadAngle();
+}
+
+/*
+==================
+CL_UpdateEntity
+
+Moves entity num to state for this message.
 If an entities model or origin changes from frame to frame, it must be
 relinked.  Other attributes can change without relinking.
 ==================
 */
-int	bitcounts[16];
-
-void CL_ParseUpdate (int bits)
+static void CL_UpdateEntity (int num, entity_state_t *state, qboolean nolerp)
 {
 	int			i;
 	model_t		*model;
-	int			modnum;
 	qboolean	forcelink;
 	entity_t	*ent;
-	int			num;
-	int			skin;
-
-	if (cls.signon == SIGNONS - 1)
-	{	// first update is the final signon stage
-		cls.signon = SIGNONS;
-		CL_SignonReply ();
-	}
-
-	if (bits & U_MOREBITS)
-	{
-		i = MSG_ReadByte ();
-		bits |= (i<<8);
-	}
-
-	if (bits & U_LONGENTITY)	
-		num = MSG_ReadShort ();
-	else
-		num = MSG_ReadByte ();
 
 	ent = CL_EntityNum (num);
 
-for (i=0 ; i<16 ; i++)
-if (bits&(1<<i))
-	bitcounts[i]++;
-
 	if (ent->msgtime != cl.mtime[1])
 		forcelink = true;	// no previous frame to lerp from
 	else
@@ -367,16 +387,7 @@ if (bits&(1<<i))
 
 	ent->msgtime = cl.mtime[0];
 	
-	if (bits & U_MODEL)
-	{
-		modnum = MSG_ReadByte ();
-		if (modnum >= MAX_MODELS)
-			Host_Error ("CL_ParseModel: bad modnum");
-	}
-	else
-		modnum = ent->baseline.modelindex;
-		
-	model = cl.model_precache[modnum];
+	model = cl.model_precache[state->modelindex];
 	if (model != ent->model)
 	{
 		ent->model = model;
@@ -397,15 +408,9 @@ if (bits&(1<<i))
 #endif
 	}
 	
-	if (bits & U_FRAME)
-		ent->frame = MSG_ReadByte ();
-	else
-		ent->frame = ent->baseline.frame;
+	ent->frame = state->frame;
 
-	if (bits & U_COLORMAP)
-		i = MSG_ReadByte();
-	else
-		i = ent->baseline.colormap;
+	i = state->colormap;
 	if (!i)
 		ent->colormap = vid.colormap;
 	else
@@ -416,61 +421,25 @@ if (bits&(1<<i))
 	}
 
 #ifdef GLQUAKE
-	if (bits & U_SKIN)
-		skin = MSG_ReadByte();
-	else
-		skin = ent->baseline.skin;
-	if (skin != ent->skinnum) {
-		ent->skinnum = skin;
+	if (state->skin != ent->skinnum) {
+		ent->skinnum = state->skin;
 		if (num > 0 && num <= cl.maxclients)
 			R_TranslatePlayerSkin (num - 1);
 	}
-
 #else
-
-	if (bits & U_SKIN)
-		ent->skinnum = MSG_ReadByte();
-	else
-		ent->skinnum = ent->baseline.skin;
+	ent->skinnum = state->skin;
 #endif
 
-	if (bits & U_EFFECTS)
-		ent->effects = MSG_ReadByte();
-	else
-		ent->effects = ent->baseline.effects;
+	ent->effects = state->effects;
 
 // shift the known values for interpolation
 	VectorCopy (ent->msg_origins[0], ent->msg_origins[1]);
 	VectorCopy (ent->msg_angles[0], ent->msg_angles[1]);
 
-	if (bits & U_ORIGIN1)
-		ent->msg_origins[0][0] = MSG_ReadCoord ();
-	else
-		ent->msg_origins[0][0] = ent->baseline.origin[0];
-	if (bits & U_ANGLE1)
-		ent->msg_angles[0][0] = MSG_ReadAngle();
-	else
-		ent->msg_angles[0][0] = ent->baseline.angles[0];
+	VectorCopy (state->origin, ent->msg_origins[0]);
+	VectorCopy (state->angles, ent->msg_angles[0]);
 
-	if (bits & U_ORIGIN2)
-		ent->msg_origins[0][1] = MSG_ReadCoord ();
-	else
-		ent->msg_origins[0][1] = ent->baseline.origin[1];
-	if (bits & U_ANGLE2)
-		ent->msg_angles[0][1] = MSG_ReadAngle();
-	else
-		ent->msg_angles[0][1] = ent->baseline.angles[1];
-
-	if (bits & U_ORIGIN3)
-		ent->msg_origins[0][2] = MSG_ReadCoord ();
-	else
-		ent->msg_origins[0][2] = ent->baseline.origin[2];
-	if (bits & U_ANGLE3)
-		ent->msg_angles[0][2] = MSG_ReadAngle();
-	else
-		ent->msg_angles[0][2] = ent->baseline.angles[2];
-
-	if ( bits & U_NOLERP )
+	if ( nolerp )
 		ent->forcelink = true;
 
 	if ( forcelink )
@@ -483,6 +452,160 @@ if (bits&(1<<i))
 	}
 }
 
+/*
+==================
+CL_ParseUpdate
+
+Parse an entity update message from the server
+==================
+*/
+int	bitcounts[16];
+
+void CL_ParseUpdate (int bits)
+{
+	int			i;
+	int			num;
+	entity_t	*ent;
+	entity_state_t	state;
+
+	if (cls.signon == SIGNONS - 1)
+	{	// first update is the final signon stage
+		cls.signon = SIGNONS;
+		CL_SignonReply ();
+	}
+
+	if (bits & U_MOREBITS)
+	{
+		i = MSG_ReadByte ();
+		bits |= (i<<8);
+	}
+
+	if (bits & U_LONGENTITY)	
+		num = MSG_ReadShort ();
+	else
+		num = MSG_ReadByte ();
+
+	ent = CL_EntityNum (num);
+
+for (i=0 ; i<16 ; i++)
+if (bits&(1<<i))
+	bitcounts[i]++;
+
+	CL_ReadEntityDelta (bits, &ent->baseline, &state);
+	CL_UpdateEntity (num, &state, (bits & U_NOLERP) != 0);
+}
+
+/*
+==================
+CL_ParsePacketEntities
+
+Rebuilds the full list of entities the server thinks we can see from the
+frame it deltad against plus the changes in this message.  Entities left
+out of the message are unchanged, U_REMOVE drops them from the list.
+==================
+*/
+void CL_ParsePacketEntities (void)
+{
+	int				i;
+	int				bits;
+	int				num;
+	int				framenum, delta;
+	int				oldindex;
+	cl_frame_t		*frame, *oldframe;
+	entity_state_t	*from;
+	entity_state_t	state;
+	qboolean		nolerp[MAX_PACKET_ENTITIES];
+
+	if (cls.signon == SIGNONS - 1)
+	{	// first update is the final signon stage
+		cls.signon = SIGNONS;
+		CL_SignonReply ();
+	}
+
+	framenum = MSG_ReadLong ();
+	delta = MSG_ReadByte ();
+
+	frame = &cl_frames[framenum & UPDATE_MASK];
+	frame->framenum = framenum;
+	frame->valid = true;
+	frame->num_entities = 0;
+
+	oldframe = NULL;
+	if (delta)
+	{
+		oldframe = &cl_frames[(framenum - delta) & UPDATE_MASK];
+		if (delta >= UPDATE_BACKUP || !oldframe->valid || oldframe->framenum != framenum - delta)
+		{	// still have to read it all to get to the rest of the message
+			Con_DPrintf ("CL_ParsePacketEntities: delta from invalid frame\n");
+			frame->valid = false;
+			oldframe = NULL;
+		}
+	}
+
+	oldindex = 0;
+	while (1)
+	{
+		bits = MSG_ReadByte ();
+		if (msg_badread)
+			Host_Error ("CL_ParsePacketEntities: end of message");
+		if (!bits)
+			break;
+
+		if (bits & U_MOREBITS)
+			bits |= MSG_ReadByte () << 8;
+		if (bits & U_LONGENTITY)
+			num = MSG_ReadShort ();
+		else
+			num = MSG_ReadByte ();
+		if (num < 1 || num >= MAX_EDICTS)
+			Host_Error ("CL_ParsePacketEntities: bad entity number %i", num);
+
+	// everything below num is unchanged
+		for ( ; oldframe && oldindex < oldframe->num_entities ; oldindex++)
+		{
+			if (oldframe->entities[oldindex].number >= num)
+				break;
+			if (frame->num_entities == MAX_PACKET_ENTITIES)
+				Host_Error ("CL_ParsePacketEntities: too many entities");
+			nolerp[frame->num_entities] = false;
+			frame->entities[frame->num_entities++] = oldframe->entities[oldindex];
+		}
+
+		if (oldframe && oldindex < oldframe->num_entities
+		&& oldframe->entities[oldindex].number == num)
+			from = &oldframe->entities[oldindex++];
+		else
+			from = &cl_entities[num].baseline;
+
+		if (bits & U_REMOVE)
+			continue;
+
+		CL_ReadEntityDelta (bits, from, &state);
+		state.number = num;
+
+		if (frame->num_entities == MAX_PACKET_ENTITIES)
+			Host_Error ("CL_ParsePacketEntities: too many entities");
+		nolerp[frame->num_entities] = (bits & U_NOLERP) != 0;
+		frame->entities[frame->num_entities++] = state;
+	}
+
+	for ( ; oldframe && oldindex < oldframe->num_entities ; oldindex++)
+	{
+		if (frame->num_entities == MAX_PACKET_ENTITIES)
+			Host_Error ("CL_ParsePacketEntities: too many entities");
+		nolerp[frame->num_entities] = false;
+		frame->entities[frame->num_entities++] = oldframe->entities[oldindex];
+	}
+
+	if (!frame->valid)
+		return;
+
+	for (i=0 ; i<frame->num_entities ; i++)
+		CL_UpdateEntity (frame->entities[i].number, &frame->entities[i], nolerp[i]);
+
+	cl.ackframe = framenum;
+}
+
 /*
 ==================
 CL_ParseBaseline
@@ -954,6 +1077,10 @@ void CL_ParseServerMessage (void)
 			SCR_CenterPrint (MSG_ReadString ());			
 			break;
 
+		case svc_packetentities:
+			CL_ParsePacketEntities ();
+			break;
+
 		case svc_sellscreen:
 			Cmd_ExecuteString ("help", src_command);
 			break;
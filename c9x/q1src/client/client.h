@@ -232,8 +232,18 @@ typedef struct
 // architectually ugly but it works
 	int			light_level;
 #endif
+
+	int			ackframe;		// last valid svc_packetentities frame
 } client_state_t;
 
+typedef struct
+{
+	int			framenum;
+	qboolean	valid;			// false if deltad from a frame we don't have
+	int			num_entities;
+	entity_state_t	entities[MAX_PACKET_ENTITIES];	// sorted by number
+} cl_frame_t;
+
 
 //
 // cvars
@@ -277,6 +287,7 @@ extern	client_state_t	cl;
 // FIXME, allocate dynamically
 extern	efrag_t			cl_efrags[MAX_EFRAGS];
 extern	entity_t		cl_entities[MAX_EDICTS];
+extern	cl_frame_t		cl_frames[UPDATE_BACKUP];
 extern	entity_t		cl_static_entities[MAX_STATIC_ENTITIES];
 extern	lightstyle_t	cl_lightstyle[MAX_LIGHTSTYLES];
 extern	dlight_t		cl_dlights[MAX_DLIGHTS];
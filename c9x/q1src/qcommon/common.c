@@ -1049,6 +1049,7 @@ void COM_CheckRegistered (void)
 
 
 void COM_Path_f (void);
+void COM_FSStats_f (void);
 
 
 /*
@@ -1153,6 +1154,7 @@ void COM_Init (char *basedir)
 	Cvar_RegisterVariable (&registered);
 	Cvar_RegisterVariable (&cmdline);
 	Cmd_AddCommand ("path", COM_Path_f);
+	Cmd_AddCommand ("fsstats", COM_FSStats_f);
 
 	COM_InitFilesystem ();
 	COM_CheckRegistered ();
@@ -1207,10 +1209,12 @@ int     com_filesize;
 // in memory
 //
 
-typedef struct
+typedef struct packfile_s
 {
 	char    name[MAX_QPATH];
 	int             filepos, filelen;
+	struct packfile_s	*hashnext;	// in com_packhash
+	struct pack_s	*pack;
 } packfile_t;
 
 typedef struct pack_s
@@ -1219,6 +1223,9 @@ typedef struct pack_s
 	int             handle;
 	int             numfiles;
 	packfile_t      *files;
+	int				order;		// place in the search path
+	byte			*mapped;	// the whole pak, read only, unless -nommap
+	int				maplen;
 } pack_t;
 
 //
@@ -1251,6 +1258,107 @@ typedef struct searchpath_s
 
 searchpath_t    *com_searchpaths;
 
+/*
+The files of every pak in the search path are hashed on their lower cased
+names, with the chains in search path order, so the first match is the
+one that overrides the rest.  Directories are not indexed, as files can
+come and go there, but a lookup only has to check the ones ahead of the
+pak that has the file.
+*/
+#define	PACK_HASHSIZE	4096
+
+packfile_t		*com_packhash[PACK_HASHSIZE];
+
+int				com_fileofs;	// where COM_FindFile's file starts in its handle
+
+static struct
+{
+	int		lookups;
+	int		pakhits, dirhits, misses;
+	int		dirprobes;			// directories checked for a file
+	double	time;
+	int		reads;
+	double	bytesread;			// copied out of files
+	int		views;
+	double	bytesviewed;		// handed out in place from mapped paks
+	int		indexed;
+} com_fsstats;
+
+/*
+============
+COM_HashFileName
+============
+*/
+static int COM_HashFileName (char *name)
+{
+	unsigned	hash;
+	int			c;
+
+	hash = 0;
+	while (*name)
+	{
+		c = *name++;
+		if (c >= 'A' && c <= 'Z')
+			c += 'a' - 'A';
+		hash = hash * 31 + c;
+	}
+	return (hash ^ (hash >> 16)) & (PACK_HASHSIZE-1);
+}
+
+/*
+============
+COM_BuildPackIndex
+
+Rebuilds the index after the search path changes
+============
+*/
+void COM_BuildPackIndex (void)
+{
+	searchpath_t	*search, *list[256];
+	pack_t			*pak;
+	packfile_t		*pf;
+	int				i, j, n, h;
+
+	memset (com_packhash, 0, sizeof(com_packhash));
+
+	for (n = 0, search = com_searchpaths ; search && n < 256 ; search = search->next)
+		list[n++] = search;
+
+	com_fsstats.indexed = 0;
+	for (i = n-1 ; i >= 0 ; i--)
+	{	// lowest priority first, so the chains end up in search order
+		pak = list[i]->pack;
+		if (!pak)
+			continue;
+		pak->order = i;
+		for (j = 0, pf = pak->files ; j < pak->numfiles ; j++, pf++)
+		{
+			h = COM_HashFileName (pf->name);
+			pf->hashnext = com_packhash[h];
+			com_packhash[h] = pf;
+			com_fsstats.indexed++;
+		}
+	}
+}
+
+/*
+============
+COM_FindPackFile
+
+The highest priority pak entry for a name, ignoring the first skip search
+paths
+============
+*/
+static packfile_t *COM_FindPackFile (char *name, int skip)
+{
+	packfile_t	*pf;
+
+	for (pf = com_packhash[COM_HashFileName (name)] ; pf ; pf = pf->hashnext)
+		if (pf->pack->order >= skip && !Q_strcasecmp (pf->name, name))
+			return pf;
+	return NULL;
+}
+
 /*
 ============
 COM_Path_f
@@ -1273,6 +1381,47 @@ void COM_Path_f (void)
 	}
 }
 
+/*
+============
+COM_FSStats_f
+
+fsstats [clear]
+============
+*/
+void COM_FSStats_f (void)
+{
+	int			i, used, longest, len;
+	packfile_t	*pf;
+
+	if (Cmd_Argc () > 1 && !Q_strcmp (Cmd_Argv (1), "clear"))
+	{
+		i = com_fsstats.indexed;
+		memset (&com_fsstats, 0, sizeof(com_fsstats));
+		com_fsstats.indexed = i;
+		return;
+	}
+
+	used = longest = 0;
+	for (i = 0 ; i < PACK_HASHSIZE ; i++)
+	{
+		len = 0;
+		for (pf = com_packhash[i] ; pf ; pf = pf->hashnext)
+			len++;
+		if (len)
+			used++;
+		if (len > longest)
+			longest = len;
+	}
+
+	Con_Printf ("%i pak files indexed, %i of %i chains used, longest %i\n", com_fsstats.indexed, used, PACK_HASHSIZE, longest);
+	Con_Printf ("%i lookups: %i in paks, %i in directories, %i missed\n",
+		com_fsstats.lookups, com_fsstats.pakhits, com_fsstats.dirhits, com_fsstats.misses);
+	Con_Printf ("%i directory probes, %.3f ms looking, %.1f us a lookup\n", com_fsstats.dirprobes,
+		com_fsstats.time * 1000, com_fsstats.lookups ? com_fsstats.time * 1000000 / com_fsstats.lookups : 0);
+	Con_Printf ("%i reads copied %.0f KB, %i views of %.0f KB\n", com_fsstats.reads, com_fsstats.bytesread / 1024,
+		com_fsstats.views, com_fsstats.bytesviewed / 1024);
+}
+
 /*
 ============
 COM_WriteFile
@@ -1361,7 +1510,7 @@ void COM_CopyFile (char *netpath, char *cachepath)
 COM_FindFile
 
 Finds the file in the search path.
-Sets com_filesize and one of handle or file
+Sets com_filesize, com_fileofs and one of handle or file
 ===========
 */
 int COM_FindFile (char *filename, int *handle, FILE **file)
@@ -1370,8 +1519,10 @@ int COM_FindFile (char *filename, int *handle, FILE **file)
 	char            netpath[MAX_OSPATH];
 	char            cachepath[MAX_OSPATH];
 	pack_t          *pak;
-	int                     i;
+	packfile_t      *pf;
+	int                     i, skip;
 	int                     findtime, cachetime;
+	double          start;
 
 	char realpath[200];
 	strcpy(realpath, CONTENT_SEARCH_DIR);
@@ -1381,42 +1532,54 @@ int COM_FindFile (char *filename, int *handle, FILE **file)
 		Sys_Error ("COM_FindFile: both handle and file set");
 	if (!file && !handle)
 		Sys_Error ("COM_FindFile: neither handle or file set");
+
+	start = Sys_FloatTime ();
+	com_fsstats.lookups++;
+	com_fileofs = 0;
 		
 //
 // search through the path, one element at a time
 //
 	search = com_searchpaths;
+	skip = 0;
 	if (proghack)
 	{	// gross hack to use quake 1 progs with quake 2 maps
 		if (!strcmp(realpath, "progs.dat"))
+		{
 			search = search->next;
+			skip = 1;
+		}
 	}
 
+	pf = COM_FindPackFile (realpath, skip);
+
 	for ( ; search ; search = search->next)
 	{
 	// is the element a pak file?
 		if (search->pack)
 		{
-		// look through all the pak file elements
+		// only the pak the index found it in has it
 			pak = search->pack;
-			for (i=0 ; i<pak->numfiles ; i++)
-				if (!strcmp (pak->files[i].name, realpath))
-				{       // found it!
-					Sys_Printf ("PackFile: %s : %s\n",pak->filename, realpath);
-					if (handle)
-					{
-						*handle = pak->handle;
-						Sys_FileSeek (pak->handle, pak->files[i].filepos);
-					}
-					else
-					{       // open a new file on the pakfile
-						*file = fopen (pak->filename, "rb");
-						if (*file)
-							fseek (*file, pak->files[i].filepos, SEEK_SET);
-					}
-					com_filesize = pak->files[i].filelen;
-					return com_filesize;
-				}
+			if (!pf || pf->pack != pak)
+				continue;
+
+			Sys_Printf ("PackFile: %s : %s\n",pak->filename, realpath);
+			if (handle)
+			{
+				*handle = pak->handle;
+				Sys_FileSeek (pak->handle, pf->filepos);
+			}
+			else
+			{       // open a new file on the pakfile
+				*file = fopen (pak->filename, "rb");
+				if (*file)
+					fseek (*file, pf->filepos, SEEK_SET);
+			}
+			com_filesize = pf->filelen;
+			com_fileofs = pf->filepos;
+			com_fsstats.pakhits++;
+			com_fsstats.time += Sys_FloatTime () - start;
+			return com_filesize;
 		}
 		else
 		{               
@@ -1429,6 +1592,7 @@ int COM_FindFile (char *filename, int *handle, FILE **file)
 			
 			sprintf (netpath, "%s/%s",search->filename, realpath);
 			
+			com_fsstats.dirprobes++;
 			findtime = Sys_FileTime (netpath);
 			if (findtime == -1)
 				continue;
@@ -1463,6 +1627,8 @@ int COM_FindFile (char *filename, int *handle, FILE **file)
 				Sys_FileClose (i);
 				*file = fopen (netpath, "rb");
 			}
+			com_fsstats.dirhits++;
+			com_fsstats.time += Sys_FloatTime () - start;
 			return com_filesize;
 		}
 		
@@ -1475,6 +1641,8 @@ int COM_FindFile (char *filename, int *handle, FILE **file)
 	else
 		*file = NULL;
 	com_filesize = -1;
+	com_fsstats.misses++;
+	com_fsstats.time += Sys_FloatTime () - start;
 	return -1;
 }
 
@@ -1485,7 +1653,8 @@ COM_OpenFile
 
 filename never has a leading slash, but may contain directory walks
 returns a handle and a length
-it may actually be inside a pak file
+it may actually be inside a pak file, starting at com_fileofs, so read it
+with Sys_FileReadAt as other files may share the handle
 ===========
 */
 int COM_OpenFile (char *filename, int *handle)
@@ -1536,19 +1705,40 @@ Allways appends a 0 byte.
 cache_user_t *loadcache;
 byte    *loadbuf;
 int             loadsize;
+qboolean        loadview;
 byte *COM_LoadFile (char *path, int usehunk)
 {
 	int             h;
 	byte    *buf;
 	char    base[32];
-	int             len;
+	int             len, ofs;
+	searchpath_t    *s;
+	qboolean        view;
 
 	buf = NULL;     // quiet compiler warning
+	view = loadview;
+	loadview = false;
 
 // look for it in the filesystem or pack files
 	len = COM_OpenFile (path, &h);
 	if (h == -1)
 		return NULL;
+	ofs = com_fileofs;
+
+// a file in a mapped pak can be used where it is
+	if (view)
+	{
+		for (s = com_searchpaths ; s ; s = s->next)
+			if (s->pack && s->pack->handle == h)
+				break;
+		if (s && s->pack->mapped && ofs >= 0 && ofs + len <= s->pack->maplen)
+		{
+			COM_CloseFile (h);
+			com_fsstats.views++;
+			com_fsstats.bytesviewed += len;
+			return s->pack->mapped + ofs;
+		}
+	}
 	
 // extract the filename base name for hunk tag
 	COM_FileBase (path, base);
@@ -1577,10 +1767,13 @@ byte *COM_LoadFile (char *path, int usehunk)
 	((byte *)buf)[len] = 0;
 
 	Draw_BeginDisc ();
-	Sys_FileRead (h, buf, len);                     
+	Sys_FileReadAt (h, ofs, buf, len);
 	COM_CloseFile (h);
 	Draw_EndDisc ();
 
+	com_fsstats.reads++;
+	com_fsstats.bytesread += len;
+
 	return buf;
 }
 
@@ -1612,6 +1805,25 @@ byte *COM_LoadStackFile (char *path, void *buffer, int bufsize)
 	return buf;
 }
 
+/*
+The View functions return a pointer straight into the mapping of the pak
+holding the file, with no copy, and only load the file like their Load
+counterparts when it isn't in a mapped pak.  A view is read only and is
+not 0 terminated, so only loaders that parse their file without writing
+to it can use them.
+*/
+byte *COM_ViewHunkFile (char *path)
+{
+	loadview = true;
+	return COM_LoadFile (path, 1);
+}
+
+byte *COM_ViewStackFile (char *path, void *buffer, int bufsize)
+{
+	loadview = true;
+	return COM_LoadStackFile (path, buffer, bufsize);
+}
+
 /*
 =================
 COM_LoadPackFile
@@ -1629,11 +1841,11 @@ pack_t *COM_LoadPackFile (char *packfile)
 	packfile_t              *newfiles;
 	int                             numpackfiles;
 	pack_t                  *pack;
-	int                             packhandle;
+	int                             packhandle, packlen;
 	dpackfile_t             info[MAX_FILES_IN_PACK];
 	unsigned short          crc;
 
-	if (Sys_FileOpenRead (packfile, &packhandle) == -1)
+	if ((packlen = Sys_FileOpenRead (packfile, &packhandle)) == -1)
 	{
 //              Con_Printf ("Couldn't open %s\n", packfile);
 		return NULL;
@@ -1678,6 +1890,14 @@ pack_t *COM_LoadPackFile (char *packfile)
 	pack->handle = packhandle;
 	pack->numfiles = numpackfiles;
 	pack->files = newfiles;
+	for (i=0 ; i<numpackfiles ; i++)
+		newfiles[i].pack = pack;
+	if (!COM_CheckParm ("-nommap"))
+	{
+		pack->mapped = Sys_FileMap (packhandle, packlen);
+		if (pack->mapped)
+			pack->maplen = packlen;
+	}
 	
 	Con_Printf ("Added packfile %s (%i files)\n", packfile, numpackfiles);
 	return pack;
@@ -1724,6 +1944,8 @@ void COM_AddGameDirectory (char *dir)
 		com_searchpaths = search;               
 	}
 
+	COM_BuildPackIndex ();
+
 //
 // add the contents of the parms.txt file to the end of the command line
 //
@@ -1824,6 +2046,7 @@ void COM_InitFilesystem (void)
 			search->next = com_searchpaths;
 			com_searchpaths = search;
 		}
+		COM_BuildPackIndex ();
 	}
 
 	if (COM_CheckParm ("-proghack"))
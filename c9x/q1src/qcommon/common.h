@@ -163,6 +163,7 @@ char	*va(char *format, ...);
 //============================================================================
 
 extern int com_filesize;
+extern int com_fileofs;
 struct cache_user_s;
 
 extern	char	com_gamedir[MAX_OSPATH];
@@ -176,6 +177,9 @@ byte *COM_LoadStackFile (char *path, void *buffer, int bufsize);
 byte *COM_LoadTempFile (char *path);
 byte *COM_LoadHunkFile (char *path);
 void COM_LoadCacheFile (char *path, struct cache_user_s *cu);
+byte *COM_ViewHunkFile (char *path);
+byte *COM_ViewStackFile (char *path, void *buffer, int bufsize);
+// read only, in place in a mapped pak when possible
 
 
 extern	struct cvar_s	registered;
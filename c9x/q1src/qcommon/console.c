@@ -373,16 +373,39 @@ Handles cursor positioning, line wrapping, etc
 ================
 */
 #define	MAXPRINTMSG	4096
+
+// prints made on the server thread wait here for the main thread, as the
+// client may be drawing the console meanwhile.  Only touched with the host
+// lock held
+#define	CON_THREADQUEUE	16384
+static char	con_threadqueue[CON_THREADQUEUE];
+static int	con_threadqueued;
+static int	con_threaddropped;
+
 // FIXME: make a buffer size safe vsprintf?
 void Con_Printf (char *fmt, ...)
 {
 	va_list		argptr;
 	char		msg[MAXPRINTMSG];
 	static qboolean	inupdate;
+	int			len;
 	
 	va_start (argptr,fmt);
 	vsprintf (msg,fmt,argptr);
 	va_end (argptr);
+
+	if (host_serverthread)
+	{
+		len = Q_strlen (msg);
+		if (con_threadqueued + len >= CON_THREADQUEUE)
+		{
+			con_threaddropped++;
+			return;
+		}
+		Q_memcpy (con_threadqueue + con_threadqueued, msg, len + 1);
+		con_threadqueued += len;
+		return;
+	}
 	
 // also echo to debugging console
 	Sys_Printf ("%s", msg);	// also echo to debugging console
@@ -414,6 +437,38 @@ void Con_Printf (char *fmt, ...)
 	}
 }
 
+/*
+================
+Con_FlushThreadPrints
+
+Prints what the server thread has queued up since the last call
+================
+*/
+void Con_FlushThreadPrints (void)
+{
+	char	*s, c;
+	int		i, len;
+
+	for (i=0 ; i<con_threadqueued ; i+=len)
+	{
+		s = con_threadqueue + i;
+		len = con_threadqueued - i;
+		if (len > MAXPRINTMSG - 1)
+			len = MAXPRINTMSG - 1;
+		c = s[len];
+		s[len] = 0;
+		Con_Printf ("%s", s);
+		s[len] = c;
+	}
+	con_threadqueued = 0;
+
+	if (con_threaddropped)
+	{
+		Con_Printf ("%i server thread prints dropped\n", con_threaddropped);
+		con_threaddropped = 0;
+	}
+}
+
 /*
 ================
 Con_DPrintf
@@ -37,7 +37,7 @@ quakeparms_t host_parms;
 
 qboolean	host_initialized;		// true if into command execution
 
-double		host_frametime;
+THREADLOCAL	double	host_frametime;
 double		host_time;
 double		realtime;				// without any filtering or bounding
 double		oldrealtime;			// last frame run
@@ -51,6 +51,12 @@ client_t	*host_client;			// current client
 
 jmp_buf 	host_abortserver;
 
+THREADLOCAL	qboolean	host_serverthread;		// set on the server thread
+static jmp_buf	host_abortthread;
+static char		host_threaderror[1024];	// raised again on the main thread
+
+void Host_TickStats_f (void);
+
 byte		*host_basepal;
 byte		*host_colormap;
 
@@ -59,6 +65,7 @@ cvar_t	host_speeds = {"host_speeds","0"};			// set for running times
 
 cvar_t	sys_ticrate = {"sys_ticrate","0.05"};
 cvar_t	serverprofile = {"serverprofile","0"};
+cvar_t	sv_threaded = {"sv_threaded","0"};			// tick a listen server on its own thread
 
 cvar_t	fraglimit = {"fraglimit","0",false,true};
 cvar_t	timelimit = {"timelimit","0",false,true};
@@ -123,6 +130,14 @@ void Host_Error (char *error, ...)
 	va_list		argptr;
 	char		string[1024];
 	static	qboolean inerror = false;
+
+	if (host_serverthread)
+	{	// the client may be drawing, so leave the shutdown to the main thread
+		va_start (argptr,error);
+		vsnprintf (host_threaderror,sizeof(host_threaderror),error,argptr);
+		va_end (argptr);
+		longjmp (host_abortthread, 1);
+	}
 	
 	if (inerror)
 		Sys_Error ("Host_Error: recursively entered");
@@ -161,6 +176,15 @@ void	Host_FindMaxClients (void)
 	svs.maxclients = 1;
 		
 	i = COM_CheckParm ("-dedicated");
+#ifdef DEDICATED_ONLY
+	// there is no client to fall back to
+	if (!i)
+	{
+		cls.state = ca_dedicated;
+		svs.maxclients = 8;
+	}
+	else
+#endif
 	if (i)
 	{
 		cls.state = ca_dedicated;
@@ -193,6 +217,8 @@ void	Host_FindMaxClients (void)
 	if (svs.maxclientslimit < 4)
 		svs.maxclientslimit = 4;
 	svs.clients = Hunk_AllocName (svs.maxclientslimit*sizeof(client_t), "clients");
+	svs.num_client_entities = svs.maxclientslimit*UPDATE_BACKUP*64;
+	svs.client_entities = Hunk_AllocName (svs.num_client_entities*sizeof(entity_state_t), "clent");
 
 	if (svs.maxclients > 1)
 		Cvar_SetValue ("deathmatch", 1.0);
@@ -215,6 +241,8 @@ void Host_InitLocal (void)
 
 	Cvar_RegisterVariable (&sys_ticrate);
 	Cvar_RegisterVariable (&serverprofile);
+	Cvar_RegisterVariable (&sv_threaded);
+	Cmd_AddCommand ("tickstats", Host_TickStats_f);
 
 	Cvar_RegisterVariable (&fraglimit);
 	Cvar_RegisterVariable (&timelimit);
@@ -623,6 +651,180 @@ void Host_ServerFrame (void)
 #endif
 
 
+/*
+==============================================================================
+
+SERVER THREAD
+
+With sv_threaded set, a listen server ticks on a thread of its own every
+sys_ticrate seconds instead of once per client frame, so a slow render
+frame no longer holds up the simulation.  The two threads share the host
+state under one lock, which the main thread only lets go of while it
+draws and mixes sound, as those touch nothing but client state.  The local
+client still talks to the server through the loopback driver, which is
+only ever used with the lock held.
+
+The server thread has its own host_frametime, so the tick never changes
+the one the client is drawing with, and host_serverthread is only ever
+set there, so a Host_Error on the main thread still shuts down the main
+thread.  Its prints are queued for the main thread, which shows them
+with the lock held at the start of its next frame.
+
+==============================================================================
+*/
+
+static qboolean	host_threadstarted;
+static qboolean	host_locked;			// the main thread holds the lock
+
+// tick timing since the last tickstats
+static int		tick_count, tick_late;
+static double	tick_sum, tick_sumsq, tick_min, tick_max;
+static double	tick_waitsum, tick_waitmax, tick_runsum, tick_runmax;
+
+static qboolean Host_ServerThreaded (void)
+{
+	return host_threadstarted && sv_threaded.value && cls.state != ca_dedicated;
+}
+
+static void Host_LockMain (void)
+{
+	if (host_threadstarted && !host_locked)
+	{
+		Sys_LockHost ();
+		host_locked = true;
+	}
+}
+
+static void Host_UnlockMain (void)
+{
+	if (host_locked)
+	{
+		host_locked = false;
+		Sys_UnlockHost ();
+	}
+}
+
+/*
+==================
+Host_ThreadTick
+
+Runs one server frame of tic seconds.  Called with the lock held.
+==================
+*/
+static void Host_ThreadTick (double tic)
+{
+	host_frametime = tic;
+	if (!setjmp (host_abortthread))
+		Host_ServerFrame ();
+}
+
+static void Host_ServerThread (void)
+{
+	double	tic, next, now, start, last;
+
+	host_serverthread = true;
+	last = 0;
+	next = Sys_FloatTime ();
+	while (1)
+	{
+		tic = sys_ticrate.value;
+		if (tic < 0.001)
+			tic = 0.001;
+		next += tic;
+		while ((now = Sys_FloatTime ()) < next)
+			Sys_Sleep ();
+		if (now - next > tic)
+			next = now;		// too far behind, drop the missed ticks
+
+		Sys_LockHost ();
+		start = Sys_FloatTime ();
+		if (Host_ServerThreaded () && sv.active && !host_threaderror[0])
+		{
+			if (last)
+			{
+				tick_count++;
+				tick_sum += start - last;
+				tick_sumsq += (start - last) * (start - last);
+				if (tick_count == 1 || start - last < tick_min)
+					tick_min = start - last;
+				if (start - last > tick_max)
+					tick_max = start - last;
+				if (start - last > tic * 1.5)
+					tick_late++;
+				tick_waitsum += start - now;
+				if (start - now > tick_waitmax)
+					tick_waitmax = start - now;
+			}
+			last = start;
+
+			Host_ThreadTick (tic);
+
+			now = Sys_FloatTime ();
+			tick_runsum += now - start;
+			if (now - start > tick_runmax)
+				tick_runmax = now - start;
+		}
+		else
+			last = 0;
+		Sys_UnlockHost ();
+	}
+}
+
+/*
+==================
+Host_StartServerThread
+==================
+*/
+static void Host_StartServerThread (void)
+{
+	if (!Sys_StartThread (Host_ServerThread))
+	{
+		Con_Printf ("No threads on this platform, sv_threaded turned off\n");
+		Cvar_SetValue ("sv_threaded", 0);
+		return;
+	}
+	host_threadstarted = true;
+}
+
+/*
+==================
+Host_TickStats_f
+
+Prints how evenly the server thread has been ticking since the last call.
+The interval is from one tick's start to the next, the wait is how long
+each tick waited for the main thread to let go of the lock.
+==================
+*/
+void Host_TickStats_f (void)
+{
+	double	mean, dev;
+
+	if (!Host_ServerThreaded ())
+	{
+		Con_Printf ("the server is not threaded\n");
+		return;
+	}
+	if (!tick_count)
+	{
+		Con_Printf ("no ticks yet\n");
+		return;
+	}
+
+	mean = tick_sum / tick_count;
+	dev = tick_sumsq / tick_count - mean * mean;
+	dev = dev > 0 ? sqrt (dev) : 0;
+
+	Con_Printf ("%i ticks at %.1f ms, %i late\n", tick_count, sys_ticrate.value * 1000, tick_late);
+	Con_Printf ("interval: %.2f avg %.2f dev %.2f min %.2f max ms\n", mean * 1000, dev * 1000, tick_min * 1000, tick_max * 1000);
+	Con_Printf ("lock wait: %.2f avg %.2f max ms\n", tick_waitsum / tick_count * 1000, tick_waitmax * 1000);
+	Con_Printf ("tick: %.2f avg %.2f max ms\n", tick_runsum / tick_count * 1000, tick_runmax * 1000);
+
+	tick_count = tick_late = 0;
+	tick_sum = tick_sumsq = tick_min = tick_max = 0;
+	tick_waitsum = tick_waitmax = tick_runsum = tick_runmax = 0;
+}
+
+
 /*
 ==================
 Host_Frame
@@ -638,14 +840,39 @@ void _Host_Frame (float time)
 	int			pass1, pass2, pass3;
 
 	if (setjmp (host_abortserver) )
+	{
+		Host_UnlockMain ();
 		return;			// something bad happened, or the server disconnected
+	}
+
+	if (sv_threaded.value && !host_threadstarted && cls.state != ca_dedicated)
+		Host_StartServerThread ();
+	Host_LockMain ();
 
 // keep the random time dependent
 	rand ();
 	
 // decide the simulation time
 	if (!Host_FilterTime (time))
+	{
+		if (host_locked)
+		{	// give the server thread a chance at the lock
+			Host_UnlockMain ();
+			Sys_Sleep ();
+		}
 		return;			// don't run too fast, or packets will flood out
+	}
+
+	Con_FlushThreadPrints ();
+
+	if (host_threaderror[0])
+	{
+		char	error[1024];
+
+		Q_strcpy (error, host_threaderror);
+		host_threaderror[0] = 0;
+		Host_Error ("%s", error);
+	}
 		
 // get new key events
 	Sys_SendKeyEvents ();
@@ -671,7 +898,7 @@ void _Host_Frame (float time)
 // check for commands typed to the host
 	Host_GetConsoleCommands ();
 	
-	if (sv.active)
+	if (sv.active && !Host_ServerThreaded ())
 		Host_ServerFrame ();
 
 //-------------------
@@ -693,6 +920,9 @@ void _Host_Frame (float time)
 		CL_ReadFromServer ();
 	}
 
+// the server can tick while the client draws
+	Host_UnlockMain ();
+
 // update video
 	if (host_speeds.value)
 		time1 = Sys_FloatTime ();
@@ -713,6 +943,8 @@ void _Host_Frame (float time)
 	
 	//CDAudio_Update();
 
+	Host_LockMain ();
+
 	if (host_speeds.value)
 	{
 		pass1 = (time1 - time3)*1000;
@@ -724,6 +956,7 @@ void _Host_Frame (float time)
 	}
 	
 	host_framecount++;
+	Host_UnlockMain ();
 }
 
 void Host_Frame (float time)
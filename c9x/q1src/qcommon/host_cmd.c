@@ -81,7 +81,10 @@ void Host_Status_f (void)
 	if (ipxAvailable)
 		print ("ipx:     %s\n", my_ipx_address);
 	print ("map:     %s\n", sv.name);
-	print ("players: %i active (%i max)\n\n", net_activeconnections, svs.maxclients);
+	print ("players: %i active (%i max)\n", net_activeconnections, svs.maxclients);
+	if (fatpvs_lookups)
+		print ("fatpvs:  %i%% of %i cached\n", (int)(100.0*fatpvs_hits/fatpvs_lookups), fatpvs_lookups);
+	print ("\n");
 	for (j=0, client = svs.clients ; j<svs.maxclients ; j++, client++)
 	{
 		if (!client->active)
@@ -457,6 +460,425 @@ void Host_SavegameComment (char *text)
 }
 
 
+/*
+===============================================================================
+
+BINARY SNAPSHOTS
+
+The whole savegame is assembled in one high hunk block and written with a
+single fwrite.  Loading reads the body back in one fread and fixes up the
+string and entity references in place, instead of going through
+PR_UglyValueString and ED_ParseEdict for every field.
+===============================================================================
+*/
+
+#define	SNAP_SKIP		0		// not restored
+#define	SNAP_RAW		1
+#define	SNAP_STRING		2
+#define	SNAP_ENTITY		3
+
+static int	snapshot_mark;
+
+/*
+===============
+Host_SnapshotError
+
+Drops the load buffer before the longjmp so it isn't left on the high hunk
+===============
+*/
+static void Host_SnapshotError (char *error)
+{
+	Hunk_FreeToHighMark (snapshot_mark);
+	Host_Error ("Host_Loadgame: %s", error);
+}
+
+/*
+===============
+Host_SnapshotKinds
+
+Classifies every entity field word, and the global words a savegame
+restores.  Globals follow ED_WriteGlobals: saved strings, floats and
+entities only.
+===============
+*/
+static void Host_SnapshotKinds (byte *fieldkinds, byte *globalkinds)
+{
+	int		i, type;
+	ddef_t	*def;
+
+	memset (fieldkinds, SNAP_RAW, progs->entityfields);
+	for (i=0 ; i<progs->numfielddefs ; i++)
+	{
+		def = &pr_fielddefs[i];
+		if (def->ofs >= progs->entityfields)
+			continue;
+		type = def->type & ~DEF_SAVEGLOBAL;
+		if (type == ev_string)
+			fieldkinds[def->ofs] = SNAP_STRING;
+		else if (type == ev_entity)
+			fieldkinds[def->ofs] = SNAP_ENTITY;
+	}
+
+	memset (globalkinds, SNAP_SKIP, progs->numglobals);
+	for (i=0 ; i<progs->numglobaldefs ; i++)
+	{
+		def = &pr_globaldefs[i];
+		if (!(def->type & DEF_SAVEGLOBAL) || def->ofs >= progs->numglobals)
+			continue;
+		type = def->type & ~DEF_SAVEGLOBAL;
+		if (type == ev_string)
+			globalkinds[def->ofs] = SNAP_STRING;
+		else if (type == ev_entity)
+			globalkinds[def->ofs] = SNAP_ENTITY;
+		else if (type == ev_float)
+			globalkinds[def->ofs] = SNAP_RAW;
+	}
+}
+
+/*
+===============
+Host_SnapshotWords
+
+Copies count words for writing, turning entity references into edict
+numbers.  Strings outside the progs are appended at *strings and replaced
+by their index; with out NULL they are only measured.  Returns the bytes of
+string text.
+===============
+*/
+static int Host_SnapshotWords (byte *kinds, int *in, int *out, int count, char **strings, int *numstrings)
+{
+	int		i, len, size;
+	char	*s;
+
+	size = 0;
+	for (i=0 ; i<count ; i++)
+	{
+		if (out)
+			out[i] = in[i];
+		if (kinds[i] == SNAP_STRING && in[i] < 0)
+		{
+			s = PR_GetString (in[i]);
+			len = strlen (s) + 1;
+			size += len;
+			if (out)
+			{
+				memcpy (*strings, s, len);
+				*strings += len;
+				out[i] = -1 - (*numstrings)++;
+			}
+		}
+		else if (kinds[i] == SNAP_ENTITY && out)
+			out[i] = in[i] / pr_edict_size;
+	}
+	return size;
+}
+
+/*
+===============
+Host_RestoreWords
+
+The reverse of Host_SnapshotWords for the words kinds says to restore
+===============
+*/
+static void Host_RestoreWords (byte *kinds, int *in, int *out, int count, int *strnums, int numstrings)
+{
+	int		i, v;
+
+	for (i=0 ; i<count ; i++)
+	{
+		v = in[i];
+		switch (kinds[i])
+		{
+		case SNAP_SKIP:
+			continue;
+		case SNAP_STRING:
+			if (v < 0)
+			{
+				if (-1 - v >= numstrings)
+					Host_SnapshotError ("bad string in savegame");
+				v = strnums[-1 - v];
+			}
+			else if (v >= progs->numstrings)
+				Host_SnapshotError ("bad string in savegame");
+			break;
+		case SNAP_ENTITY:
+			if (v < 0 || v >= sv.max_edicts)
+				Host_SnapshotError ("bad entity in savegame");
+			v = EDICT_TO_PROG(EDICT_NUM(v));
+			break;
+		}
+		out[i] = v;
+	}
+}
+
+/*
+===============
+Host_SaveSnapshot
+
+===============
+*/
+static void Host_SaveSnapshot (char *name)
+{
+	snapshot_t	*snap;
+	byte		*buf, *fieldkinds, *globalkinds;
+	int			i, mark, size, strsize, recsize;
+	int			*rec;
+	char		*strings, *style;
+	edict_t		*ent;
+	double		start;
+	FILE		*f;
+
+	Con_Printf ("Saving game to %s...\n", name);
+	start = Sys_FloatTime ();
+
+	mark = Hunk_HighMark ();
+	fieldkinds = Hunk_HighAllocName (progs->entityfields + progs->numglobals, "snapshot");
+	globalkinds = fieldkinds + progs->entityfields;
+	Host_SnapshotKinds (fieldkinds, globalkinds);
+
+// size it up
+	strsize = 0;
+	for (i=0 ; i<MAX_LIGHTSTYLES ; i++)
+		strsize += strlen (sv.lightstyles[i] ? sv.lightstyles[i] : "m") + 1;
+	strsize += Host_SnapshotWords (globalkinds, (int *)pr_globals, NULL, progs->numglobals, NULL, NULL);
+	for (i=0 ; i<sv.num_edicts ; i++)
+	{
+		ent = EDICT_NUM(i);
+		if (!ent->free)
+			strsize += Host_SnapshotWords (fieldkinds, (int *)&ent->v, NULL, progs->entityfields, NULL, NULL);
+	}
+	recsize = 1 + progs->entityfields;
+	size = sizeof(snapshot_t) + progs->numglobals*4 + sv.num_edicts*recsize*4 + strsize;
+
+	buf = Hunk_HighAllocName (size, "snapshot");
+	snap = (snapshot_t *)buf;
+	snap->ident = SNAPSHOT_IDENT;
+	snap->version = SNAPSHOT_VERSION;
+	Host_SavegameComment (snap->comment);
+	Q_strncpy (snap->mapname, sv.name, sizeof(snap->mapname)-1);
+	snap->crc = pr_crc;
+	snap->entityfields = progs->entityfields;
+	snap->numglobals = progs->numglobals;
+	snap->num_edicts = sv.num_edicts;
+	snap->skill = current_skill;
+	snap->time = sv.time;
+	for (i=0 ; i<NUM_SPAWN_PARMS ; i++)
+		snap->spawn_parms[i] = svs.clients->spawn_parms[i];
+	snap->ofs_globals = sizeof(snapshot_t);
+	snap->ofs_edicts = snap->ofs_globals + progs->numglobals*4;
+	snap->ofs_lightstyles = snap->ofs_edicts + sv.num_edicts*recsize*4;
+	snap->filelen = size;
+
+	strings = (char *)buf + snap->ofs_lightstyles;
+	for (i=0 ; i<MAX_LIGHTSTYLES ; i++)
+	{
+		style = sv.lightstyles[i] ? sv.lightstyles[i] : "m";
+		strcpy (strings, style);
+		strings += strlen (style) + 1;
+	}
+
+	snap->ofs_strings = strings - (char *)buf;
+	snap->numstrings = 0;
+	Host_SnapshotWords (globalkinds, (int *)pr_globals, (int *)(buf + snap->ofs_globals),
+		progs->numglobals, &strings, &snap->numstrings);
+	rec = (int *)(buf + snap->ofs_edicts);
+	for (i=0 ; i<sv.num_edicts ; i++, rec += recsize)
+	{
+		ent = EDICT_NUM(i);
+		rec[0] = ent->free;
+		if (!ent->free)
+			Host_SnapshotWords (fieldkinds, (int *)&ent->v, rec + 1, progs->entityfields, &strings, &snap->numstrings);
+	}
+
+	f = fopen (name, "wb");
+	if (!f)
+	{
+		Hunk_FreeToHighMark (mark);
+		Con_Printf ("ERROR: couldn't open.\n");
+		return;
+	}
+	i = fwrite (buf, 1, size, f);
+	fclose (f);
+	Hunk_FreeToHighMark (mark);
+	if (i != size)
+	{
+		Con_Printf ("ERROR: couldn't write.\n");
+		return;
+	}
+	Con_Printf ("done: %i bytes in %.1f ms.\n", size, (Sys_FloatTime() - start) * 1000);
+}
+
+/*
+===============
+Host_LoadSnapshot
+
+Called with the header already read from f, which it closes
+===============
+*/
+static void Host_LoadSnapshot (FILE *f, snapshot_t *header)
+{
+	snapshot_t	snap;
+	byte		*buf, *fieldkinds, *globalkinds;
+	int			i, len, recsize, oldnum;
+	int			*rec, *strnums;
+	char		*s, *end, *p;
+	edict_t		*ent;
+	double		start, spawned;
+
+	snap = *header;
+	if (snap.ident != SNAPSHOT_IDENT)
+	{
+		fclose (f);
+		Con_Printf ("Savegame was written with the other byte order\n");
+		return;
+	}
+	if (snap.version != SNAPSHOT_VERSION)
+	{
+		fclose (f);
+		Con_Printf ("Savegame is version %i, not %i\n", snap.version, SNAPSHOT_VERSION);
+		return;
+	}
+	snap.mapname[sizeof(snap.mapname)-1] = 0;
+
+	start = Sys_FloatTime ();
+	current_skill = snap.skill;
+	Cvar_SetValue ("skill", (float)current_skill);
+
+#ifdef QUAKE2
+	Cvar_SetValue ("deathmatch", 0);
+	Cvar_SetValue ("coop", 0);
+	Cvar_SetValue ("teamplay", 0);
+#endif
+
+	CL_Disconnect_f ();
+	
+#ifdef QUAKE2
+	SV_SpawnServer (snap.mapname, NULL);
+#else
+	SV_SpawnServer (snap.mapname);
+#endif
+	if (!sv.active)
+	{
+		fclose (f);
+		Con_Printf ("Couldn't load map\n");
+		return;
+	}
+	sv.paused = true;		// pause until all clients connect
+	sv.loadgame = true;
+	spawned = Sys_FloatTime ();
+
+	recsize = 1 + snap.entityfields;
+	if (snap.crc != pr_crc || snap.entityfields != progs->entityfields
+	|| snap.numglobals != progs->numglobals)
+	{
+		fclose (f);
+		Host_Error ("Host_Loadgame: savegame was written by different progs");
+	}
+	if (snap.num_edicts < 1 || snap.num_edicts > sv.max_edicts
+	|| snap.ofs_globals < (int)sizeof(snap) || snap.ofs_globals + snap.numglobals*4 > snap.filelen
+	|| snap.ofs_edicts < (int)sizeof(snap) || snap.ofs_edicts + snap.num_edicts*recsize*4 > snap.filelen
+	|| snap.ofs_lightstyles < (int)sizeof(snap) || snap.ofs_lightstyles > snap.filelen
+	|| snap.ofs_strings < (int)sizeof(snap) || snap.ofs_strings > snap.filelen
+	|| snap.numstrings < 0 || snap.numstrings > snap.filelen)
+	{
+		fclose (f);
+		Host_Error ("Host_Loadgame: bad savegame header");
+	}
+
+	snapshot_mark = Hunk_HighMark ();
+	strnums = Hunk_HighAllocName (snap.numstrings*4 + 4, "snapshot");
+	fieldkinds = Hunk_HighAllocName (progs->entityfields + progs->numglobals, "snapshot");
+	globalkinds = fieldkinds + progs->entityfields;
+	Host_SnapshotKinds (fieldkinds, globalkinds);
+
+	buf = Hunk_HighAllocName (snap.filelen + 1, "snapshot");
+	end = (char *)buf + snap.filelen;	// the extra byte stays 0
+	len = snap.filelen - sizeof(snap);
+	i = fread (buf + sizeof(snap), 1, len, f);
+	fclose (f);
+	if (i != len)
+		Host_SnapshotError ("savegame is truncated");
+
+// load the light styles
+	s = (char *)buf + snap.ofs_lightstyles;
+	for (i=0 ; i<MAX_LIGHTSTYLES ; i++)
+	{
+		len = strlen (s);
+		if (s + len >= end)
+			Host_SnapshotError ("bad savegame lightstyles");
+		sv.lightstyles[i] = Hunk_Alloc (len+1);
+		strcpy (sv.lightstyles[i], s);
+		s += len + 1;
+	}
+
+// copy out the strings and fix up the references to them
+	s = (char *)buf + snap.ofs_strings;
+	for (i=0 ; i<snap.numstrings ; i++)
+	{
+		len = strlen (s);
+		if (s + len >= end)
+			Host_SnapshotError ("bad savegame strings");
+		strnums[i] = PR_AllocString (len+1, &p);
+		memcpy (p, s, len+1);
+		s += len + 1;
+	}
+
+	Host_RestoreWords (globalkinds, (int *)(buf + snap.ofs_globals), (int *)pr_globals,
+		progs->numglobals, strnums, snap.numstrings);
+
+	rec = (int *)(buf + snap.ofs_edicts);
+	for (i=0 ; i<snap.num_edicts ; i++, rec += recsize)
+	{
+		ent = EDICT_NUM(i);
+		if (rec[0])
+		{
+			SV_UnlinkEdict (ent);
+			memset (&ent->v, 0, progs->entityfields * 4);
+			ent->free = true;
+		}
+		else
+		{
+			Host_RestoreWords (fieldkinds, rec + 1, (int *)&ent->v, progs->entityfields, strnums, snap.numstrings);
+			ent->free = false;
+		}
+		SV_MarkEdictMoved (ent);
+		PR_FindIndexChanged (ent, -1);
+
+	// link it into the bsp tree
+		if (!ent->free)
+			SV_LinkEdict (ent, false);
+	}
+
+// anything the map spawned past the saved edicts goes away
+	oldnum = sv.num_edicts;
+	sv.num_edicts = snap.num_edicts;
+	for (i=snap.num_edicts ; i<oldnum ; i++)
+	{
+		ent = EDICT_NUM(i);
+		if (!ent->free)
+			ED_Free (ent);
+	}
+	sv.time = snap.time;
+
+// the strings the map spawned with are mostly overwritten now
+	PR_CollectStrings ();
+
+	Hunk_FreeToHighMark (snapshot_mark);
+
+	for (i=0 ; i<NUM_SPAWN_PARMS ; i++)
+		svs.clients->spawn_parms[i] = snap.spawn_parms[i];
+
+	Con_Printf ("done: %i bytes in %.1f ms (map load %.1f ms).\n", snap.filelen,
+		(Sys_FloatTime() - spawned) * 1000, (spawned - start) * 1000);
+
+	if (cls.state != ca_dedicated)
+	{
+		CL_EstablishConnection ("local");
+		Host_Reconnect_f ();
+	}
+}
+
+
 /*
 ===============
 Host_Savegame_f
@@ -466,8 +888,9 @@ void Host_Savegame_f (void)
 {
 	char	name[256];
 	FILE	*f;
-	int		i;
+	int		i, size;
 	char	comment[SAVEGAME_COMMENT_LENGTH+1];
+	double	start;
 
 	if (cmd_source != src_command)
 		return;
@@ -490,9 +913,9 @@ void Host_Savegame_f (void)
 		return;
 	}
 
-	if (Cmd_Argc() != 2)
+	if (Cmd_Argc() != 2 && (Cmd_Argc() != 3 || Q_strcasecmp(Cmd_Argv(2), "text")))
 	{
-		Con_Printf ("save <savename> : save a game\n");
+		Con_Printf ("save <savename> [text] : save a game\n");
 		return;
 	}
 
@@ -513,8 +936,15 @@ void Host_Savegame_f (void)
 
 	sprintf (name, "%s/%s", com_gamedir, Cmd_Argv(1));
 	COM_DefaultExtension (name, ".sav");
-	
+
+	if (Cmd_Argc() == 2)
+	{
+		Host_SaveSnapshot (name);
+		return;
+	}
+
 	Con_Printf ("Saving game to %s...\n", name);
+	start = Sys_FloatTime ();
 	f = fopen (name, "w");
 	if (!f)
 	{
@@ -548,8 +978,9 @@ void Host_Savegame_f (void)
 		ED_Write (f, EDICT_NUM(i));
 		fflush (f);
 	}
+	size = ftell (f);
 	fclose (f);
-	Con_Printf ("done.\n");
+	Con_Printf ("done: %i bytes in %.1f ms.\n", size, (Sys_FloatTime() - start) * 1000);
 }
 
 
@@ -570,6 +1001,8 @@ void Host_Loadgame_f (void)
 	int		entnum;
 	int		version;
 	float			spawn_parms[NUM_SPAWN_PARMS];
+	snapshot_t	snap;
+	double	loadstart;
 
 	if (cmd_source != src_command)
 		return;
@@ -590,12 +1023,28 @@ void Host_Loadgame_f (void)
 //	SCR_BeginLoadingPlaque ();
 
 	Con_Printf ("Loading game from %s...\n", name);
+	f = fopen (name, "rb");
+	if (!f)
+	{
+		Con_Printf ("ERROR: couldn't open.\n");
+		return;
+	}
+	if (fread (&snap, 1, sizeof(snap), f) == sizeof(snap)
+	&& (snap.ident == SNAPSHOT_IDENT || snap.ident == SNAPSHOT_IDENT_SWAPPED))
+	{
+		Host_LoadSnapshot (f, &snap);
+		return;
+	}
+
+// an old text savegame
+	fclose (f);
 	f = fopen (name, "r");
 	if (!f)
 	{
 		Con_Printf ("ERROR: couldn't open.\n");
 		return;
 	}
+	loadstart = Sys_FloatTime ();
 
 	fscanf (f, "%i\n", &version);
 	if (version != SAVEGAME_VERSION)
@@ -694,7 +1143,9 @@ void Host_Loadgame_f (void)
 	sv.num_edicts = entnum;
 	sv.time = time;
 
+	i = ftell (f);
 	fclose (f);
+	Con_Printf ("done: %i bytes in %.1f ms.\n", i, (Sys_FloatTime() - loadstart) * 1000);
 
 	for (i=0 ; i<NUM_SPAWN_PARMS ; i++)
 		svs.clients->spawn_parms[i] = spawn_parms[i];
@@ -937,6 +1388,7 @@ void Host_Name_f (void)
 			Con_Printf ("%s renamed to %s\n", host_client->name, newName);
 	Q_strcpy (host_client->name, newName);
 	host_client->edict->v.netname = PR_SetEngineString(host_client->name);
+	ED_FieldStored (host_client->edict, ED_FIELD(netname));
 	
 // send notification to all clients
 	
@@ -1271,6 +1723,34 @@ void Host_PreSpawn_f (void)
 	host_client->sendsignon = true;
 }
 
+/*
+==================
+Host_ProtocolExt_f
+
+The client lists the PEXT_* extensions it understands after each
+svc_serverinfo, the server keeps the ones it is willing to use.
+==================
+*/
+void Host_ProtocolExt_f (void)
+{
+	int		ext;
+	extern	cvar_t	sv_deltaentities;
+
+	if (cmd_source == src_command)
+	{
+		Con_Printf ("protocolext is not valid from the console\n");
+		return;
+	}
+
+	if (Cmd_Argc () != 2)
+		return;
+
+	ext = Q_atoi (Cmd_Argv(1));
+	if (!sv_deltaentities.value)
+		ext &= ~PEXT_DELTAENTITIES;
+	host_client->protocolext = ext & PEXT_DELTAENTITIES;
+}
+
 /*
 ==================
 Host_Spawn_f
@@ -1309,6 +1789,8 @@ void Host_Spawn_f (void)
 		ent->v.colormap = NUM_FOR_EDICT(ent);
 		ent->v.team = (host_client->colors & 15) + 1;
 		ent->v.netname = PR_SetEngineString(host_client->name);
+		SV_MarkEdictMoved (ent);
+		PR_FindIndexChanged (ent, -1);
 
 		// copy spawn parms out of the client_t
 
@@ -1906,6 +2388,7 @@ void Host_InitCommands (void)
 	Cmd_AddCommand ("spawn", Host_Spawn_f);
 	Cmd_AddCommand ("begin", Host_Begin_f);
 	Cmd_AddCommand ("prespawn", Host_PreSpawn_f);
+	Cmd_AddCommand ("protocolext", Host_ProtocolExt_f);
 	Cmd_AddCommand ("kick", Host_Kick_f);
 	Cmd_AddCommand ("ping", Host_Ping_f);
 	Cmd_AddCommand ("load", Host_Loadgame_f);
@@ -449,18 +449,28 @@ void M_ScanSaves (void)
 	char	name[MAX_OSPATH];
 	FILE	*f;
 	int		version;
+	snapshot_t	snap;
 
 	for (i=0 ; i<MAX_SAVEGAMES ; i++)
 	{
 		strcpy (m_filenames[i], "--- UNUSED SLOT ---");
 		loadable[i] = false;
 		sprintf (name, "%s/s%i.sav", com_gamedir, i);
-		f = fopen (name, "r");
+		f = fopen (name, "rb");
 		if (!f)
 			continue;
-		fscanf (f, "%i\n", &version);
-		fscanf (f, "%79s\n", name);
-		strncpy (m_filenames[i], name, sizeof(m_filenames[i])-1);
+		if (fread (&snap, 1, sizeof(snap), f) == sizeof(snap) && snap.ident == SNAPSHOT_IDENT)
+		{
+			snap.comment[SAVEGAME_COMMENT_LENGTH] = 0;
+			strcpy (m_filenames[i], snap.comment);
+		}
+		else
+		{	// a text savegame
+			rewind (f);
+			fscanf (f, "%i\n", &version);
+			fscanf (f, "%79s\n", name);
+			strncpy (m_filenames[i], name, sizeof(m_filenames[i])-1);
+		}
 
 	// change _ back to space
 		for (j=0 ; j<SAVEGAME_COMMENT_LENGTH ; j++)
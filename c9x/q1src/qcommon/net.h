@@ -148,6 +148,14 @@ typedef struct qsocket_s
 
 } qsocket_t;
 
+// one datagram for the landrivers' ReadMany and WriteMany
+typedef struct
+{
+	int					length;
+	struct qsockaddr	addr;
+	byte				data[NET_DATAGRAMSIZE];
+} netpacket_t;
+
 extern qsocket_t	*net_activeSockets;
 extern qsocket_t	*net_freeSockets;
 extern int			net_numsockets;
@@ -175,6 +183,12 @@ typedef struct
 	int			(*AddrCompare) (struct qsockaddr *addr1, struct qsockaddr *addr2);
 	int			(*GetSocketPort) (struct qsockaddr *addr);
 	int			(*SetSocketPort) (struct qsockaddr *addr, int port);
+	int			(*ReadMany) (int socket, netpacket_t *packets, int count);
+	int			(*WriteMany) (int socket, netpacket_t *packets, int count);
+	// optional; move as many packets as the socket will take in one call
+	int			(*Wait) (int socket, int msec);
+	// optional; blocks until socket is readable or msec pass, returns > 0
+	// if it is readable.  A socket of -1 just sleeps
 } net_landriver_t;
 
 #define	MAX_NET_DRIVERS		8
@@ -198,6 +212,8 @@ typedef struct
 	void		(*Close) (qsocket_t *sock);
 	void		(*Shutdown) (void);
 	int			controlSock;
+	void		(*Flush) (void);	// optional; sends anything held back
+	qboolean	(*Sleep) (int msec);	// optional; waits for packets, see NET_Sleep
 } net_driver_t;
 
 extern int			net_numdrivers;
@@ -297,6 +313,14 @@ int			NET_SendUnreliableMessage (struct qsocket_s *sock, sizebuf_t *data);
 int			NET_SendToAll(sizebuf_t *data, int blocktime);
 // This is a reliable *blocking* send to all attached clients.
 
+void		NET_Flush (void);
+// drivers may hold back what the server sends to its clients so it can go
+// out in one system call; the server calls this when it is done sending
+
+qboolean	NET_Sleep (int msec);
+// waits up to msec for packets to arrive, queueing them for the next frame.
+// Returns false if no driver can wait, so the caller has to sleep itself
+
 
 void		NET_Close (struct qsocket_s *sock);
 // if a dead connection is returned by a get or send function, this function
@@ -20,6 +20,8 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "quakedef.h"
 
 #include "net_loop.h"
+#include "net_dgrm.h"
+#include "net_udp.h"
 
 net_driver_t net_drivers[MAX_NET_DRIVERS] =
 {
@@ -39,8 +41,56 @@ net_driver_t net_drivers[MAX_NET_DRIVERS] =
 	Loop_Close,
 	Loop_Shutdown
 	}
+	,
+	{
+	"Datagram",
+	false,
+	Datagram_Init,
+	Datagram_Listen,
+	Datagram_SearchForHosts,
+	Datagram_Connect,
+	Datagram_CheckNewConnections,
+	Datagram_GetMessage,
+	Datagram_SendMessage,
+	Datagram_SendUnreliableMessage,
+	Datagram_CanSendMessage,
+	Datagram_CanSendUnreliableMessage,
+	Datagram_Close,
+	Datagram_Shutdown,
+	0,
+	Datagram_Flush,
+	Datagram_Sleep
+	}
 };
-int net_numdrivers = 1;
+int net_numdrivers = 2;
 
-net_landriver_t	net_landrivers[MAX_NET_DRIVERS];
-int net_numlandrivers = 0;
+net_landriver_t	net_landrivers[MAX_NET_DRIVERS] =
+{
+	{
+	"UDP",
+	false,
+	0,
+	UDP_Init,
+	UDP_Shutdown,
+	UDP_Listen,
+	UDP_OpenSocket,
+	UDP_CloseSocket,
+	UDP_Connect,
+	UDP_CheckNewConnections,
+	UDP_Read,
+	UDP_Write,
+	UDP_Broadcast,
+	UDP_AddrToString,
+	UDP_StringToAddr,
+	UDP_GetSocketAddr,
+	UDP_GetNameFromAddr,
+	UDP_GetAddrFromName,
+	UDP_AddrCompare,
+	UDP_GetSocketPort,
+	UDP_SetSocketPort,
+	UDP_ReadMany,
+	UDP_WriteMany,
+	UDP_Wait
+	}
+};
+int net_numlandrivers = 1;
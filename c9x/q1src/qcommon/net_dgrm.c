@@ -0,0 +1,1632 @@
+/*
+Copyright (C) 1996-1997 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+// net_dgrm.c
+
+#include "quakedef.h"
+#include "net_dgrm.h"
+
+// these two macros are to make the code more readable
+#define sfunc	net_landrivers[sock->landriver]
+#define dfunc	net_landrivers[net_landriverlevel]
+
+static int net_landriverlevel;
+
+/* statistic counters */
+int	packetsSent = 0;
+int	packetsReSent = 0;
+int packetsReceived = 0;
+int receivedDuplicateCount = 0;
+int shortPacketCount = 0;
+int droppedDatagrams;
+
+static int myDriverLevel;
+
+struct
+{
+	unsigned int	length;
+	unsigned int	sequence;
+	byte			data[MAX_DATAGRAM];
+} packetBuffer;
+
+extern int m_return_state;
+extern int m_state;
+extern qboolean m_return_onerror;
+extern char m_return_reason[32];
+
+/*
+===============================================================================
+
+RECEIVE QUEUES
+
+A listening server talks to all of its clients through the accept socket,
+so whatever is read from it is sorted by address into a queue for each
+connection.  One system call picks up the packets for every client, and
+the answers are held back in the same way until NET_Flush.
+
+A client keeps a socket of its own and writes to it immediately, but
+still reads it through its queue.
+
+===============================================================================
+*/
+
+#define	DGRAM_POOLSIZE		256		// packets waiting in all the queues
+#define	DGRAM_QUEUESIZE		32		// packets waiting for one connection
+#define	DGRAM_BATCH			32		// packets moved in one call
+#define	DGRAM_PUMPTIME		0.005	// read again inside a frame after this
+
+typedef struct dgrampacket_s
+{
+	struct dgrampacket_s	*next;
+	int						length;
+	struct qsockaddr		addr;
+	byte					data[NET_DATAGRAMSIZE];
+} dgrampacket_t;
+
+typedef struct
+{
+	qboolean		inuse;
+	qboolean		shared;			// reads and writes go through the accept socket
+	int				socket;
+	dgrampacket_t	*head, *tail;
+	int				count;
+
+	// for the queue that owns the socket
+	int				pumpframe;
+	double			pumptime;
+	qboolean		full;			// stopped with packets still in the kernel
+} dgramqueue_t;
+
+static dgrampacket_t	dgram_pool[DGRAM_POOLSIZE];
+static dgrampacket_t	*dgram_freepackets;
+static dgramqueue_t		*dgram_queues;				// one for each qsocket
+static dgramqueue_t		dgram_control[MAX_NET_DRIVERS];	// requests to the accept sockets
+
+static netpacket_t		dgram_in[DGRAM_BATCH];
+static netpacket_t		dgram_out[DGRAM_BATCH];
+static int				dgram_numout;
+static int				dgram_outlandriver;
+static int				dgram_outsocket;
+
+/* batching counters */
+static int	readCalls, packetsRead;
+static int	writeCalls, packetsWritten;
+static int	queueDrops;
+
+
+static void Datagram_InitQueues (void)
+{
+	int		i;
+
+	dgram_freepackets = NULL;
+	for (i=0 ; i<DGRAM_POOLSIZE ; i++)
+	{
+		dgram_pool[i].next = dgram_freepackets;
+		dgram_freepackets = &dgram_pool[i];
+	}
+
+	dgram_queues = Hunk_AllocName (net_numsockets * sizeof(dgramqueue_t), "dgramq");
+	Q_memset (dgram_control, 0, sizeof(dgram_control));
+}
+
+
+static void Datagram_ClearQueue (dgramqueue_t *q)
+{
+	dgrampacket_t	*p;
+
+	while (q->head)
+	{
+		p = q->head;
+		q->head = p->next;
+		p->next = dgram_freepackets;
+		dgram_freepackets = p;
+	}
+	q->tail = NULL;
+	q->count = 0;
+	q->full = false;
+}
+
+
+static void Datagram_AttachQueue (qsocket_t *sock, qboolean shared)
+{
+	dgramqueue_t	*q;
+	int				i;
+
+	for (i=0, q=dgram_queues ; i<net_numsockets ; i++, q++)
+		if (!q->inuse)
+			break;
+	if (i == net_numsockets)
+		Sys_Error ("Datagram_AttachQueue: no free queues");
+
+	Q_memset (q, 0, sizeof(*q));
+	q->inuse = true;
+	q->shared = shared;
+	q->socket = sock->socket;
+	q->pumpframe = -1;
+	sock->driverdata = q;
+}
+
+
+static void Datagram_DetachQueue (qsocket_t *sock)
+{
+	dgramqueue_t	*q;
+
+	q = sock->driverdata;
+	if (!q)
+		return;
+	Datagram_ClearQueue (q);
+	q->inuse = false;
+	sock->driverdata = NULL;
+}
+
+
+static void Datagram_Enqueue (dgramqueue_t *q, netpacket_t *in)
+{
+	dgrampacket_t	*p;
+
+	if (q->count == DGRAM_QUEUESIZE || !dgram_freepackets)
+	{
+		queueDrops++;
+		return;
+	}
+
+	p = dgram_freepackets;
+	dgram_freepackets = p->next;
+
+	p->next = NULL;
+	p->length = in->length;
+	p->addr = in->addr;
+	Q_memcpy (p->data, in->data, in->length);
+
+	if (q->tail)
+		q->tail->next = p;
+	else
+		q->head = p;
+	q->tail = p;
+	q->count++;
+}
+
+
+static dgrampacket_t *Datagram_Dequeue (dgramqueue_t *q)
+{
+	dgrampacket_t	*p;
+
+	p = q->head;
+	if (!p)
+		return NULL;
+	q->head = p->next;
+	if (!q->head)
+		q->tail = NULL;
+	q->count--;
+	return p;
+}
+
+
+static void Datagram_FreePacket (dgrampacket_t *p)
+{
+	p->next = dgram_freepackets;
+	dgram_freepackets = p;
+}
+
+
+/*
+================
+Datagram_Route
+
+Control packets on an accept socket are requests for the server; anything
+else belongs to the connection with the same address, or to nobody.
+================
+*/
+static void Datagram_Route (int landriver, int socket, netpacket_t *in)
+{
+	qsocket_t		*s;
+	dgramqueue_t	*q;
+	unsigned int	control;
+
+	if (in->length < NET_HEADERSIZE)
+	{
+		shortPacketCount++;
+		return;
+	}
+
+	control = BigLong(*((unsigned int *)in->data));
+	if (control & NETFLAG_CTL)
+	{
+		q = &dgram_control[landriver];
+		if (!q->shared || q->socket != socket)
+			return;
+		Datagram_Enqueue (q, in);
+		return;
+	}
+
+	for (s = net_activeSockets; s; s = s->next)
+	{
+		if (s->driver != myDriverLevel || s->landriver != landriver || s->socket != socket)
+			continue;
+		if (!s->driverdata)
+			continue;
+		if (net_landrivers[landriver].AddrCompare (&in->addr, &s->addr) == 0)
+			break;
+	}
+	if (!s)
+		return;
+
+	Datagram_Enqueue (s->driverdata, in);
+}
+
+
+/*
+================
+Datagram_Pump
+
+Reads everything that is waiting on a socket into the queues.  state is
+the queue that owns the socket and remembers when it was last read.
+Returns -1 if the socket has failed.
+================
+*/
+static int Datagram_Pump (int landriver, int socket, dgramqueue_t *state)
+{
+	net_landriver_t	*drv;
+	int				i, n;
+	qboolean		batched;
+
+	drv = &net_landrivers[landriver];
+	state->pumpframe = host_framecount;
+	state->pumptime = net_time;
+	state->full = false;
+
+	while (1)
+	{
+		// leave the rest in the kernel until the queues drain
+		if (!dgram_freepackets)
+		{
+			state->full = true;
+			return 0;
+		}
+
+		n = -1;
+		batched = false;
+		if (drv->ReadMany)
+		{
+			n = drv->ReadMany (socket, dgram_in, DGRAM_BATCH);
+			batched = (n != -1);
+		}
+		if (n == -1)
+		{
+			n = drv->Read (socket, dgram_in[0].data, sizeof(dgram_in[0].data), &dgram_in[0].addr);
+			if (n == -1)
+				return -1;
+			if (n > 0)
+			{
+				dgram_in[0].length = n;
+				n = 1;
+			}
+		}
+		readCalls++;
+
+		for (i=0 ; i<n ; i++)
+			Datagram_Route (landriver, socket, &dgram_in[i]);
+		packetsRead += n;
+
+		if (n == 0 || (batched && n < DGRAM_BATCH))
+			return 0;
+	}
+}
+
+
+/*
+================
+Datagram_NextPacket
+
+The first connection to come up empty in a frame reads the socket for
+everyone; the rest only read again if that read was cut short or a
+blocking loop has kept the frame going for a while.
+================
+*/
+static dgrampacket_t *Datagram_NextPacket (qsocket_t *sock, qboolean *error)
+{
+	dgramqueue_t	*q;
+	dgramqueue_t	*state;
+
+	q = sock->driverdata;
+	if (!q->head)
+	{
+		state = q->shared ? &dgram_control[sock->landriver] : q;
+		if (state->full || state->pumpframe != host_framecount || net_time - state->pumptime > DGRAM_PUMPTIME)
+		{
+			if (Datagram_Pump (sock->landriver, sock->socket, state) == -1)
+			{
+				*error = true;
+				return NULL;
+			}
+		}
+	}
+
+	return Datagram_Dequeue (q);
+}
+
+
+/*
+================
+Datagram_Write
+
+Packets for connections on the accept socket wait in one batch until
+Datagram_Flush; a client's own socket is written right away.
+================
+*/
+static int Datagram_Write (qsocket_t *sock, byte *data, int length)
+{
+	dgramqueue_t	*q;
+	netpacket_t		*p;
+
+	q = sock->driverdata;
+	if (!q->shared || !sfunc.WriteMany)
+	{
+		writeCalls++;
+		packetsWritten++;
+		return sfunc.Write (sock->socket, data, length, &sock->addr);
+	}
+
+	if (dgram_numout && (dgram_outlandriver != sock->landriver || dgram_outsocket != sock->socket))
+		Datagram_Flush ();
+
+	p = &dgram_out[dgram_numout++];
+	p->length = length;
+	p->addr = sock->addr;
+	Q_memcpy (p->data, data, length);
+	dgram_outlandriver = sock->landriver;
+	dgram_outsocket = sock->socket;
+
+	if (dgram_numout == DGRAM_BATCH)
+		Datagram_Flush ();
+
+	return length;
+}
+
+
+void Datagram_Flush (void)
+{
+	net_landriver_t	*drv;
+	int				i, sent;
+
+	if (!dgram_numout)
+		return;
+
+	drv = &net_landrivers[dgram_outlandriver];
+	sent = drv->WriteMany (dgram_outsocket, dgram_out, dgram_numout);
+	if (sent == -1)
+	{
+		for (i=0 ; i<dgram_numout ; i++)
+			drv->Write (dgram_outsocket, dgram_out[i].data, dgram_out[i].length, &dgram_out[i].addr);
+		writeCalls += dgram_numout;
+	}
+	else
+		writeCalls++;
+	packetsWritten += dgram_numout;
+
+	dgram_numout = 0;
+}
+
+
+/*
+================
+Datagram_Sleep
+
+Waits on the accept socket, which carries every connected client, and
+pumps whatever arrives into the queues so the next frame finds it there.
+Once the pool is full it just sleeps out the rest of the time.
+================
+*/
+qboolean Datagram_Sleep (int msec)
+{
+	net_landriver_t	*drv;
+	dgramqueue_t	*q;
+	double			end;
+	int				i, socket;
+
+	for (i=0 ; i<net_numlandrivers ; i++)
+		if (net_landrivers[i].initialized && net_landrivers[i].Wait)
+			break;
+	if (i == net_numlandrivers)
+		return false;
+	drv = &net_landrivers[i];
+	q = &dgram_control[i];
+
+	end = Sys_FloatTime () + msec / 1000.0;
+	while (1)
+	{
+		socket = drv->CheckNewConnections ();
+		if (socket != -1 && (q->full || !q->shared || q->socket != socket))
+			socket = -1;	// nowhere to put it, or not set up until the next frame
+
+		if (drv->Wait (socket, msec) <= 0 || socket == -1)
+			return true;
+
+		if (Datagram_Pump (i, socket, q) == -1)
+			return true;	// the frame will find out
+		q->pumpframe = -1;	// still read again at the start of the frame
+
+		msec = (int)((end - Sys_FloatTime ()) * 1000);
+		if (msec <= 0)
+			return true;
+	}
+}
+
+//=============================================================================
+
+int Datagram_SendMessage (qsocket_t *sock, sizebuf_t *data)
+{
+	unsigned int	packetLen;
+	unsigned int	dataLen;
+	unsigned int	eom;
+
+#ifdef DEBUG
+	if (data->cursize == 0)
+		Sys_Error("Datagram_SendMessage: zero length message\n");
+
+	if (data->cursize > NET_MAXMESSAGE)
+		Sys_Error("Datagram_SendMessage: message too big %u\n", data->cursize);
+
+	if (sock->canSend == false)
+		Sys_Error("SendMessage: called with canSend == false\n");
+#endif
+
+	Q_memcpy(sock->sendMessage, data->data, data->cursize);
+	sock->sendMessageLength = data->cursize;
+
+	if (data->cursize <= MAX_DATAGRAM)
+	{
+		dataLen = data->cursize;
+		eom = NETFLAG_EOM;
+	}
+	else
+	{
+		dataLen = MAX_DATAGRAM;
+		eom = 0;
+	}
+	packetLen = NET_HEADERSIZE + dataLen;
+
+	packetBuffer.length = BigLong(packetLen | (NETFLAG_DATA | eom));
+	packetBuffer.sequence = BigLong(sock->sendSequence++);
+	Q_memcpy (packetBuffer.data, sock->sendMessage, dataLen);
+
+	sock->canSend = false;
+
+	if (Datagram_Write (sock, (byte *)&packetBuffer, packetLen) == -1)
+		return -1;
+
+	sock->lastSendTime = net_time;
+	packetsSent++;
+	return 1;
+}
+
+
+static int SendMessageNext (qsocket_t *sock)
+{
+	unsigned int	packetLen;
+	unsigned int	dataLen;
+	unsigned int	eom;
+
+	if (sock->sendMessageLength <= MAX_DATAGRAM)
+	{
+		dataLen = sock->sendMessageLength;
+		eom = NETFLAG_EOM;
+	}
+	else
+	{
+		dataLen = MAX_DATAGRAM;
+		eom = 0;
+	}
+	packetLen = NET_HEADERSIZE + dataLen;
+
+	packetBuffer.length = BigLong(packetLen | (NETFLAG_DATA | eom));
+	packetBuffer.sequence = BigLong(sock->sendSequence++);
+	Q_memcpy (packetBuffer.data, sock->sendMessage, dataLen);
+
+	sock->sendNext = false;
+
+	if (Datagram_Write (sock, (byte *)&packetBuffer, packetLen) == -1)
+		return -1;
+
+	sock->lastSendTime = net_time;
+	packetsSent++;
+	return 1;
+}
+
+
+static int ReSendMessage (qsocket_t *sock)
+{
+	unsigned int	packetLen;
+	unsigned int	dataLen;
+	unsigned int	eom;
+
+	if (sock->sendMessageLength <= MAX_DATAGRAM)
+	{
+		dataLen = sock->sendMessageLength;
+		eom = NETFLAG_EOM;
+	}
+	else
+	{
+		dataLen = MAX_DATAGRAM;
+		eom = 0;
+	}
+	packetLen = NET_HEADERSIZE + dataLen;
+
+	packetBuffer.length = BigLong(packetLen | (NETFLAG_DATA | eom));
+	packetBuffer.sequence = BigLong(sock->sendSequence - 1);
+	Q_memcpy (packetBuffer.data, sock->sendMessage, dataLen);
+
+	sock->sendNext = false;
+
+	if (Datagram_Write (sock, (byte *)&packetBuffer, packetLen) == -1)
+		return -1;
+
+	sock->lastSendTime = net_time;
+	packetsReSent++;
+	return 1;
+}
+
+
+qboolean Datagram_CanSendMessage (qsocket_t *sock)
+{
+	if (sock->sendNext)
+		SendMessageNext (sock);
+
+	return sock->canSend;
+}
+
+
+qboolean Datagram_CanSendUnreliableMessage (qsocket_t *sock)
+{
+	return true;
+}
+
+
+int Datagram_SendUnreliableMessage (qsocket_t *sock, sizebuf_t *data)
+{
+	int 	packetLen;
+
+#ifdef DEBUG
+	if (data->cursize == 0)
+		Sys_Error("Datagram_SendUnreliableMessage: zero length message\n");
+
+	if (data->cursize > MAX_DATAGRAM)
+		Sys_Error("Datagram_SendUnreliableMessage: message too big %u\n", data->cursize);
+#endif
+
+	packetLen = NET_HEADERSIZE + data->cursize;
+
+	packetBuffer.length = BigLong(packetLen | NETFLAG_UNRELIABLE);
+	packetBuffer.sequence = BigLong(sock->unreliableSendSequence++);
+	Q_memcpy (packetBuffer.data, data->data, data->cursize);
+
+	if (Datagram_Write (sock, (byte *)&packetBuffer, packetLen) == -1)
+		return -1;
+
+	packetsSent++;
+	return 1;
+}
+
+
+int	Datagram_GetMessage (qsocket_t *sock)
+{
+	unsigned int	length;
+	unsigned int	flags;
+	int				ret = 0;
+	unsigned int	sequence;
+	unsigned int	count;
+	dgrampacket_t	*p;
+	qboolean		error;
+
+	if (!sock->canSend)
+		if ((net_time - sock->lastSendTime) > 1.0)
+			ReSendMessage (sock);
+
+	error = false;
+	while(1)
+	{
+		p = Datagram_NextPacket (sock, &error);
+		if (error)
+		{
+			Con_Printf("Read error\n");
+			return -1;
+		}
+		if (!p)
+			break;
+
+		length = BigLong(*((unsigned int *)p->data));
+		flags = length & (~NETFLAG_LENGTH_MASK);
+		length &= NETFLAG_LENGTH_MASK;
+
+		if (length < NET_HEADERSIZE || length > p->length)
+		{
+			shortPacketCount++;
+			Datagram_FreePacket (p);
+			continue;
+		}
+
+		Q_memcpy (&packetBuffer, p->data, length);
+		Datagram_FreePacket (p);
+
+		if (flags & NETFLAG_CTL)
+			continue;
+
+		sequence = BigLong(packetBuffer.sequence);
+		packetsReceived++;
+
+		if (flags & NETFLAG_UNRELIABLE)
+		{
+			if (sequence < sock->unreliableReceiveSequence)
+			{
+				Con_DPrintf("Got a stale datagram\n");
+				continue;
+			}
+			if (sequence != sock->unreliableReceiveSequence)
+			{
+				count = sequence - sock->unreliableReceiveSequence;
+				droppedDatagrams += count;
+				Con_DPrintf("Dropped %u datagram(s)\n", count);
+			}
+			sock->unreliableReceiveSequence = sequence + 1;
+
+			length -= NET_HEADERSIZE;
+
+			SZ_Clear (&net_message);
+			SZ_Write (&net_message, packetBuffer.data, length);
+
+			ret = 2;
+			break;
+		}
+
+		if (flags & NETFLAG_ACK)
+		{
+			if (sequence != (sock->sendSequence - 1))
+			{
+				Con_DPrintf("Stale ACK received\n");
+				continue;
+			}
+			if (sequence == sock->ackSequence)
+			{
+				sock->ackSequence++;
+				if (sock->ackSequence != sock->sendSequence)
+					Con_DPrintf("ack sequencing error\n");
+			}
+			else
+			{
+				Con_DPrintf("Duplicate ACK received\n");
+				continue;
+			}
+			sock->sendMessageLength -= MAX_DATAGRAM;
+			if (sock->sendMessageLength > 0)
+			{
+				Q_memcpy(sock->sendMessage, sock->sendMessage+MAX_DATAGRAM, sock->sendMessageLength);
+				sock->sendNext = true;
+			}
+			else
+			{
+				sock->sendMessageLength = 0;
+				sock->canSend = true;
+			}
+			continue;
+		}
+
+		if (flags & NETFLAG_DATA)
+		{
+			packetBuffer.length = BigLong(NET_HEADERSIZE | NETFLAG_ACK);
+			packetBuffer.sequence = BigLong(sequence);
+			Datagram_Write (sock, (byte *)&packetBuffer, NET_HEADERSIZE);
+
+			if (sequence != sock->receiveSequence)
+			{
+				receivedDuplicateCount++;
+				continue;
+			}
+			sock->receiveSequence++;
+
+			length -= NET_HEADERSIZE;
+
+			if (sock->receiveMessageLength + length > NET_MAXMESSAGE)
+			{
+				Con_Printf("Datagram_GetMessage: message from %s too long\n", sock->address);
+				return -1;
+			}
+
+			if (flags & NETFLAG_EOM)
+			{
+				SZ_Clear(&net_message);
+				SZ_Write(&net_message, sock->receiveMessage, sock->receiveMessageLength);
+				SZ_Write(&net_message, packetBuffer.data, length);
+				sock->receiveMessageLength = 0;
+
+				ret = 1;
+				break;
+			}
+
+			Q_memcpy(sock->receiveMessage + sock->receiveMessageLength, packetBuffer.data, length);
+			sock->receiveMessageLength += length;
+			continue;
+		}
+	}
+
+	if (sock->sendNext)
+		SendMessageNext (sock);
+
+	return ret;
+}
+
+
+void PrintStats(qsocket_t *s)
+{
+	Con_Printf("canSend = %4u   \n", s->canSend);
+	Con_Printf("sendSeq = %4u   ", s->sendSequence);
+	Con_Printf("recvSeq = %4u   \n", s->receiveSequence);
+	Con_Printf("\n");
+}
+
+static void NET_Stats_f (void)
+{
+	qsocket_t	*s;
+
+	if (Cmd_Argc () == 1)
+	{
+		Con_Printf("unreliable messages sent   = %i\n", unreliableMessagesSent);
+		Con_Printf("unreliable messages recv   = %i\n", unreliableMessagesReceived);
+		Con_Printf("reliable messages sent     = %i\n", messagesSent);
+		Con_Printf("reliable messages received = %i\n", messagesReceived);
+		Con_Printf("packetsSent                = %i\n", packetsSent);
+		Con_Printf("packetsReSent              = %i\n", packetsReSent);
+		Con_Printf("packetsReceived            = %i\n", packetsReceived);
+		Con_Printf("receivedDuplicateCount     = %i\n", receivedDuplicateCount);
+		Con_Printf("shortPacketCount           = %i\n", shortPacketCount);
+		Con_Printf("droppedDatagrams           = %i\n", droppedDatagrams);
+		Con_Printf("read calls                 = %i (%i packets)\n", readCalls, packetsRead);
+		Con_Printf("write calls                = %i (%i packets)\n", writeCalls, packetsWritten);
+		Con_Printf("queue drops                = %i\n", queueDrops);
+	}
+	else if (Q_strcmp(Cmd_Argv(1), "*") == 0)
+	{
+		for (s = net_activeSockets; s; s = s->next)
+			PrintStats(s);
+		for (s = net_freeSockets; s; s = s->next)
+			PrintStats(s);
+	}
+	else
+	{
+		for (s = net_activeSockets; s; s = s->next)
+			if (Q_strcasecmp(Cmd_Argv(1), s->address) == 0)
+				break;
+		if (s == NULL)
+			for (s = net_freeSockets; s; s = s->next)
+				if (Q_strcasecmp(Cmd_Argv(1), s->address) == 0)
+					break;
+		if (s == NULL)
+			return;
+		PrintStats(s);
+	}
+}
+
+
+/*
+================
+Datagram_Bench_f
+
+udpbench [clients] [rounds]
+
+Runs a server socket on 127.0.0.1 down the same path a listening server
+takes: a qsocket for each client shares the server socket, and every
+packet is read with NET_GetMessage and answered with
+NET_SendUnreliableMessage and NET_Flush.  The clients are plain sockets
+standing in for other machines; each round every one of them sends one
+unreliable datagram and takes its echo.  The server side is timed with
+the lan driver's batch calls switched off and then on.
+================
+*/
+#define	DGRAM_MAXBENCH	64
+
+static void Datagram_Bench_f (void)
+{
+	net_landriver_t	*drv;
+	dgramqueue_t	savedcontrol, *control;
+	qsocket_t		*socks[DGRAM_MAXBENCH];
+	int				clients, rounds, batched;
+	int				server, client[DGRAM_MAXBENCH];
+	byte			answered[DGRAM_MAXBENCH];
+	struct qsockaddr	serveraddr, addr;
+	int				(*readmany) (int socket, netpacket_t *packets, int count);
+	int				(*writemany) (int socket, netpacket_t *packets, int count);
+	int				i, r, lan, level, ret, got, moved, lost;
+	int				reads, writes;
+	double			start, servertime, deadline;
+
+	for (lan=0 ; lan<net_numlandrivers ; lan++)
+		if (net_landrivers[lan].initialized)
+			break;
+	if (lan == net_numlandrivers)
+	{
+		Con_Printf ("udpbench: no lan driver\n");
+		return;
+	}
+	drv = &net_landrivers[lan];
+
+	clients = 32;
+	rounds = 1000;
+	if (Cmd_Argc () > 1)
+		clients = Q_atoi (Cmd_Argv (1));
+	if (Cmd_Argc () > 2)
+		rounds = Q_atoi (Cmd_Argv (2));
+	if (clients < 1)
+		clients = 1;
+	if (clients > DGRAM_MAXBENCH)
+		clients = DGRAM_MAXBENCH;
+	if (rounds < 1)
+		rounds = 1;
+
+	if ((server = drv->OpenSocket (0)) == -1)
+	{
+		Con_Printf ("udpbench: unable to open server socket\n");
+		return;
+	}
+	drv->GetSocketAddr (server, &serveraddr);
+	drv->StringToAddr (va("127.0.0.1:%i", drv->GetSocketPort (&serveraddr)), &serveraddr);
+
+	// the server's connections, one for each client socket
+	Datagram_Flush ();
+	level = net_driverlevel;
+	net_driverlevel = myDriverLevel;
+	for (i=0 ; i<clients ; i++)
+	{
+		if ((client[i] = drv->OpenSocket (0)) == -1)
+			break;
+		if ((socks[i] = NET_NewQSocket ()) == NULL)
+		{
+			drv->CloseSocket (client[i]);
+			break;
+		}
+		drv->GetSocketAddr (client[i], &addr);
+		drv->StringToAddr (va("127.0.0.1:%i", drv->GetSocketPort (&addr)), &addr);
+		socks[i]->socket = server;
+		socks[i]->landriver = lan;
+		socks[i]->addr = addr;
+		Q_strcpy (socks[i]->address, drv->AddrToString (&addr));
+		Datagram_AttachQueue (socks[i], true);
+	}
+	net_driverlevel = level;
+	if (i < clients)
+	{
+		Con_Printf ("udpbench: only room for %i clients\n", i);
+		clients = i;
+	}
+
+	// the bench socket stands in for the accept socket until it's done
+	control = &dgram_control[lan];
+	savedcontrol = *control;
+	Q_memset (control, 0, sizeof(*control));
+	control->shared = true;
+	control->socket = server;
+
+	readmany = drv->ReadMany;
+	writemany = drv->WriteMany;
+
+	for (batched=0 ; batched<2 && clients ; batched++)
+	{
+		if (batched && !readmany)
+		{
+			Con_Printf ("udpbench: no batch calls in the %s driver\n", drv->name);
+			break;
+		}
+		drv->ReadMany = batched ? readmany : NULL;
+		drv->WriteMany = batched ? writemany : NULL;
+
+		reads = readCalls;
+		writes = writeCalls;
+		servertime = 0;
+		moved = 0;
+		lost = 0;
+		for (r=0 ; r<rounds ; r++)
+		{
+			packetBuffer.length = BigLong((NET_HEADERSIZE + 32) | NETFLAG_UNRELIABLE);
+			packetBuffer.sequence = BigLong(batched*rounds + r);
+			Q_memset (packetBuffer.data, 0xa5, 32);
+			for (i=0 ; i<clients ; i++)
+				drv->Write (client[i], (byte *)&packetBuffer, NET_HEADERSIZE + 32, &serveraddr);
+
+			// a new frame: the first connection reads for everyone
+			Q_memset (answered, 0, clients);
+			control->pumpframe = -1;
+			got = 0;
+			start = Sys_FloatTime ();
+			deadline = start + 0.5;
+			while (got < clients && Sys_FloatTime () < deadline)
+			{
+				for (i=0 ; i<clients ; i++)
+				{
+					if (answered[i])
+						continue;
+					ret = NET_GetMessage (socks[i]);
+					if (ret == 2)
+					{
+						NET_SendUnreliableMessage (socks[i], &net_message);
+						answered[i] = 1;
+						got++;
+					}
+				}
+			}
+			NET_Flush ();
+			servertime += Sys_FloatTime () - start;
+			moved += got * 2;
+			lost += clients - got;
+
+			// every client takes its echo
+			for (i=0 ; i<clients ; i++)
+			{
+				deadline = Sys_FloatTime () + 0.1;
+				while (drv->Read (client[i], (byte *)&packetBuffer, sizeof(packetBuffer), &addr) <= 0)
+					if (Sys_FloatTime () > deadline)
+						break;
+			}
+		}
+
+		Con_Printf ("%-10s %i packets in %.3f s, %.0f packets/s, %i reads, %i writes",
+			batched ? "batched" : "unbatched", moved, servertime, servertime > 0 ? moved / servertime : 0,
+			readCalls - reads, writeCalls - writes);
+		if (lost)
+			Con_Printf (", %i lost", lost);
+		Con_Printf ("\n");
+	}
+
+	drv->ReadMany = readmany;
+	drv->WriteMany = writemany;
+
+	for (i=0 ; i<clients ; i++)
+	{
+		NET_Close (socks[i]);
+		drv->CloseSocket (client[i]);
+	}
+	Datagram_ClearQueue (control);
+	*control = savedcontrol;
+	drv->CloseSocket (server);
+}
+
+
+int Datagram_Init (void)
+{
+	int i;
+	int csock;
+
+	myDriverLevel = net_driverlevel;
+	Cmd_AddCommand ("net_stats", NET_Stats_f);
+	Cmd_AddCommand ("udpbench", Datagram_Bench_f);
+
+	if (COM_CheckParm("-nolan"))
+		return -1;
+
+	Datagram_InitQueues ();
+
+	for (i = 0; i < net_numlandrivers; i++)
+		{
+		csock = net_landrivers[i].Init ();
+		if (csock == -1)
+			continue;
+		net_landrivers[i].initialized = true;
+		net_landrivers[i].controlSock = csock;
+		}
+
+	return 0;
+}
+
+
+void Datagram_Shutdown (void)
+{
+	int i;
+
+	Datagram_Flush ();
+
+//
+// shutdown the lan drivers
+//
+	for (i = 0; i < net_numlandrivers; i++)
+	{
+		if (net_landrivers[i].initialized)
+		{
+			net_landrivers[i].Shutdown ();
+			net_landrivers[i].initialized = false;
+		}
+	}
+}
+
+
+void Datagram_Close (qsocket_t *sock)
+{
+	dgramqueue_t	*q;
+
+	// anything held back for this client goes out before it is forgotten
+	Datagram_Flush ();
+
+	q = sock->driverdata;
+	if (!q || !q->shared)
+		sfunc.CloseSocket(sock->socket);
+	Datagram_DetachQueue (sock);
+}
+
+
+void Datagram_Listen (qboolean state)
+{
+	int i;
+
+	Datagram_Flush ();
+
+	for (i = 0; i < net_numlandrivers; i++)
+	{
+		if (!net_landrivers[i].initialized)
+			continue;
+		net_landrivers[i].Listen (state);
+		Datagram_ClearQueue (&dgram_control[i]);
+		dgram_control[i].shared = false;
+	}
+}
+
+
+static qsocket_t *_Datagram_CheckNewConnections (void)
+{
+	struct qsockaddr clientaddr;
+	struct qsockaddr newaddr;
+	int			acceptsock;
+	int			len;
+	int			command;
+	int			control;
+	int			ret;
+	qsocket_t	*sock;
+	qsocket_t	*s;
+	dgramqueue_t	*q;
+	dgrampacket_t	*p;
+
+	acceptsock = dfunc.CheckNewConnections();
+	if (acceptsock == -1)
+		return NULL;
+
+	q = &dgram_control[net_landriverlevel];
+	if (!q->shared || q->socket != acceptsock)
+	{
+		Datagram_ClearQueue (q);
+		q->shared = true;
+		q->socket = acceptsock;
+		q->pumpframe = -1;
+	}
+
+	// read for every connection at the start of the frame
+	if (q->full || q->pumpframe != host_framecount || net_time - q->pumptime > DGRAM_PUMPTIME)
+		Datagram_Pump (net_landriverlevel, acceptsock, q);
+
+	while ((p = Datagram_Dequeue (q)) != NULL)
+	{
+		SZ_Clear(&net_message);
+		len = p->length;
+		if (len > net_message.maxsize)
+			len = net_message.maxsize;
+		clientaddr = p->addr;
+		SZ_Write (&net_message, p->data, len);
+		Datagram_FreePacket (p);
+
+		if (len < sizeof(int))
+			continue;
+
+		MSG_BeginReading ();
+		control = BigLong(*((int *)net_message.data));
+		MSG_ReadLong();
+		if (control == -1)
+			continue;
+		if ((control & (~NETFLAG_LENGTH_MASK)) !=  NETFLAG_CTL)
+			continue;
+		if ((control & NETFLAG_LENGTH_MASK) != len)
+			continue;
+
+		command = MSG_ReadByte();
+		if (command == CCREQ_SERVER_INFO)
+		{
+			if (Q_strcmp(MSG_ReadString(), "QUAKE") != 0)
+				continue;
+
+			SZ_Clear(&net_message);
+			// save space for the header, filled in later
+			MSG_WriteLong(&net_message, 0);
+			MSG_WriteByte(&net_message, CCREP_SERVER_INFO);
+			dfunc.GetSocketAddr(acceptsock, &newaddr);
+			MSG_WriteString(&net_message, dfunc.AddrToString(&newaddr));
+			MSG_WriteString(&net_message, hostname.string);
+			MSG_WriteString(&net_message, sv.name);
+			MSG_WriteByte(&net_message, net_activeconnections);
+			MSG_WriteByte(&net_message, svs.maxclients);
+			MSG_WriteByte(&net_message, NET_PROTOCOL_VERSION);
+			*((int *)net_message.data) = BigLong(NETFLAG_CTL | (net_message.cursize & NETFLAG_LENGTH_MASK));
+			dfunc.Write (acceptsock, net_message.data, net_message.cursize, &clientaddr);
+			SZ_Clear(&net_message);
+			continue;
+		}
+
+		if (command == CCREQ_PLAYER_INFO)
+		{
+			int			playerNumber;
+			int			activeNumber;
+			int			clientNumber;
+			client_t	*client;
+
+			playerNumber = MSG_ReadByte();
+			activeNumber = -1;
+			for (clientNumber = 0, client = svs.clients; clientNumber < svs.maxclients; clientNumber++, client++)
+			{
+				if (client->active)
+				{
+					activeNumber++;
+					if (activeNumber == playerNumber)
+						break;
+				}
+			}
+			if (clientNumber == svs.maxclients)
+				continue;
+
+			SZ_Clear(&net_message);
+			// save space for the header, filled in later
+			MSG_WriteLong(&net_message, 0);
+			MSG_WriteByte(&net_message, CCREP_PLAYER_INFO);
+			MSG_WriteByte(&net_message, playerNumber);
+			MSG_WriteString(&net_message, client->name);
+			MSG_WriteLong(&net_message, client->colors);
+			MSG_WriteLong(&net_message, (int)client->edict->v.frags);
+			MSG_WriteLong(&net_message, (int)(net_time - client->netconnection->connecttime));
+			MSG_WriteString(&net_message, client->netconnection->address);
+			*((int *)net_message.data) = BigLong(NETFLAG_CTL | (net_message.cursize & NETFLAG_LENGTH_MASK));
+			dfunc.Write (acceptsock, net_message.data, net_message.cursize, &clientaddr);
+			SZ_Clear(&net_message);
+			continue;
+		}
+
+		if (command == CCREQ_RULE_INFO)
+		{
+			char	*prevCvarName;
+			cvar_t	*var;
+
+			// find the search start location
+			prevCvarName = MSG_ReadString();
+			if (*prevCvarName)
+			{
+				var = Cvar_FindVar (prevCvarName);
+				if (!var)
+					continue;
+				var = var->next;
+			}
+			else
+				var = cvar_vars;
+
+			// search for the next server cvar
+			while (var)
+			{
+				if (var->server)
+					break;
+				var = var->next;
+			}
+
+			// send the response
+
+			SZ_Clear(&net_message);
+			// save space for the header, filled in later
+			MSG_WriteLong(&net_message, 0);
+			MSG_WriteByte(&net_message, CCREP_RULE_INFO);
+			if (var)
+			{
+				MSG_WriteString(&net_message, var->name);
+				MSG_WriteString(&net_message, var->string);
+			}
+			*((int *)net_message.data) = BigLong(NETFLAG_CTL | (net_message.cursize & NETFLAG_LENGTH_MASK));
+			dfunc.Write (acceptsock, net_message.data, net_message.cursize, &clientaddr);
+			SZ_Clear(&net_message);
+			continue;
+		}
+
+		if (command != CCREQ_CONNECT)
+			continue;
+
+		if (Q_strcmp(MSG_ReadString(), "QUAKE") != 0)
+			continue;
+
+		if (MSG_ReadByte() != NET_PROTOCOL_VERSION)
+		{
+			SZ_Clear(&net_message);
+			// save space for the header, filled in later
+			MSG_WriteLong(&net_message, 0);
+			MSG_WriteByte(&net_message, CCREP_REJECT);
+			MSG_WriteString(&net_message, "Incompatible version.\n");
+			*((int *)net_message.data) = BigLong(NETFLAG_CTL | (net_message.cursize & NETFLAG_LENGTH_MASK));
+			dfunc.Write (acceptsock, net_message.data, net_message.cursize, &clientaddr);
+			SZ_Clear(&net_message);
+			continue;
+		}
+
+		// see if this guy is already connected; every connection shares the
+		// accept socket, so only the exact address and port is the same client
+		for (s = net_activeSockets; s; s = s->next)
+		{
+			if (s->driver != net_driverlevel || s->landriver != net_landriverlevel)
+				continue;
+			ret = dfunc.AddrCompare(&clientaddr, &s->addr);
+			if (ret == 0)
+				break;
+		}
+		if (s)
+		{
+			// is this a duplicate connection reqeust?
+			if (net_time - s->connecttime < 2.0)
+			{
+				// yes, so send a duplicate reply
+				SZ_Clear(&net_message);
+				// save space for the header, filled in later
+				MSG_WriteLong(&net_message, 0);
+				MSG_WriteByte(&net_message, CCREP_ACCEPT);
+				dfunc.GetSocketAddr(s->socket, &newaddr);
+				MSG_WriteLong(&net_message, dfunc.GetSocketPort(&newaddr));
+				*((int *)net_message.data) = BigLong(NETFLAG_CTL | (net_message.cursize & NETFLAG_LENGTH_MASK));
+				dfunc.Write (acceptsock, net_message.data, net_message.cursize, &clientaddr);
+				SZ_Clear(&net_message);
+				continue;
+			}
+			// it's somebody coming back in from a crash/disconnect
+			// so close the old qsocket and let their retry get them back in
+			NET_Close(s);
+			continue;
+		}
+
+		// allocate a QSocket
+		sock = NET_NewQSocket ();
+		if (sock == NULL)
+		{
+			// no room; try to let him know
+			SZ_Clear(&net_message);
+			// save space for the header, filled in later
+			MSG_WriteLong(&net_message, 0);
+			MSG_WriteByte(&net_message, CCREP_REJECT);
+			MSG_WriteString(&net_message, "Server is full.\n");
+			*((int *)net_message.data) = BigLong(NETFLAG_CTL | (net_message.cursize & NETFLAG_LENGTH_MASK));
+			dfunc.Write (acceptsock, net_message.data, net_message.cursize, &clientaddr);
+			SZ_Clear(&net_message);
+			continue;
+		}
+
+		// everything is allocated, just fill in the details
+		sock->socket = acceptsock;
+		sock->landriver = net_landriverlevel;
+		sock->addr = clientaddr;
+		Q_strcpy(sock->address, dfunc.AddrToString(&clientaddr));
+		Datagram_AttachQueue (sock, true);
+
+		// send him back the info about the server connection he has been allocated
+		SZ_Clear(&net_message);
+		// save space for the header, filled in later
+		MSG_WriteLong(&net_message, 0);
+		MSG_WriteByte(&net_message, CCREP_ACCEPT);
+		dfunc.GetSocketAddr(acceptsock, &newaddr);
+		MSG_WriteLong(&net_message, dfunc.GetSocketPort(&newaddr));
+		*((int *)net_message.data) = BigLong(NETFLAG_CTL | (net_message.cursize & NETFLAG_LENGTH_MASK));
+		dfunc.Write (acceptsock, net_message.data, net_message.cursize, &clientaddr);
+		SZ_Clear(&net_message);
+
+		return sock;
+	}
+
+	return NULL;
+}
+
+qsocket_t *Datagram_CheckNewConnections (void)
+{
+	qsocket_t *ret = NULL;
+
+	for (net_landriverlevel = 0; net_landriverlevel < net_numlandrivers; net_landriverlevel++)
+		if (net_landrivers[net_landriverlevel].initialized)
+			if ((ret = _Datagram_CheckNewConnections ()) != NULL)
+				break;
+	return ret;
+}
+
+
+static void _Datagram_SearchForHosts (qboolean xmit)
+{
+	int		ret;
+	int		n;
+	int		i;
+	struct qsockaddr readaddr;
+	struct qsockaddr myaddr;
+	int		control;
+
+	dfunc.GetSocketAddr (dfunc.controlSock, &myaddr);
+	if (xmit)
+	{
+		SZ_Clear(&net_message);
+		// save space for the header, filled in later
+		MSG_WriteLong(&net_message, 0);
+		MSG_WriteByte(&net_message, CCREQ_SERVER_INFO);
+		MSG_WriteString(&net_message, "QUAKE");
+		MSG_WriteByte(&net_message, NET_PROTOCOL_VERSION);
+		*((int *)net_message.data) = BigLong(NETFLAG_CTL | (net_message.cursize & NETFLAG_LENGTH_MASK));
+		dfunc.Broadcast(dfunc.controlSock, net_message.data, net_message.cursize);
+		SZ_Clear(&net_message);
+	}
+
+	while ((ret = dfunc.Read (dfunc.controlSock, net_message.data, net_message.maxsize, &readaddr)) > 0)
+	{
+		if (ret < sizeof(int))
+			continue;
+		net_message.cursize = ret;
+
+		// don't answer our own query
+		if (dfunc.AddrCompare(&readaddr, &myaddr) >= 0)
+			continue;
+
+		// is the cache full?
+		if (hostCacheCount == HOSTCACHESIZE)
+			continue;
+
+		MSG_BeginReading ();
+		control = BigLong(*((int *)net_message.data));
+		MSG_ReadLong();
+		if (control == -1)
+			continue;
+		if ((control & (~NETFLAG_LENGTH_MASK)) !=  NETFLAG_CTL)
+			continue;
+		if ((control & NETFLAG_LENGTH_MASK) != ret)
+			continue;
+
+		if (MSG_ReadByte() != CCREP_SERVER_INFO)
+			continue;
+
+		dfunc.GetAddrFromName(MSG_ReadString(), &readaddr);
+		// search the cache for this server
+		for (n = 0; n < hostCacheCount; n++)
+			if (dfunc.AddrCompare(&readaddr, &hostcache[n].addr) == 0)
+				break;
+
+		// is it already there?
+		if (n < hostCacheCount)
+			continue;
+
+		// add it
+		hostCacheCount++;
+		Q_strncpy(hostcache[n].name, MSG_ReadString(), sizeof(hostcache[n].name) - 1);
+		hostcache[n].name[sizeof(hostcache[n].name) - 1] = 0;
+		Q_strncpy(hostcache[n].map, MSG_ReadString(), sizeof(hostcache[n].map) - 1);
+		hostcache[n].map[sizeof(hostcache[n].map) - 1] = 0;
+		hostcache[n].users = MSG_ReadByte();
+		hostcache[n].maxusers = MSG_ReadByte();
+		if (MSG_ReadByte() != NET_PROTOCOL_VERSION)
+		{
+			Q_strcpy(hostcache[n].cname, hostcache[n].name);
+			hostcache[n].cname[14] = 0;
+			Q_strcpy(hostcache[n].name, "*");
+			Q_strcat(hostcache[n].name, hostcache[n].cname);
+		}
+		Q_memcpy(&hostcache[n].addr, &readaddr, sizeof(struct qsockaddr));
+		hostcache[n].driver = net_driverlevel;
+		hostcache[n].ldriver = net_landriverlevel;
+		Q_strncpy(hostcache[n].cname, dfunc.AddrToString(&readaddr), sizeof(hostcache[n].cname) - 1);
+		hostcache[n].cname[sizeof(hostcache[n].cname) - 1] = 0;
+
+		// check for a name conflict
+		for (i = 0; i < hostCacheCount; i++)
+		{
+			if (i == n)
+				continue;
+			if (Q_strcasecmp (hostcache[n].name, hostcache[i].name) == 0)
+			{
+				i = Q_strlen(hostcache[n].name);
+				if (i < 15 && hostcache[n].name[i-1] > '8')
+				{
+					hostcache[n].name[i] = '0';
+					hostcache[n].name[i+1] = 0;
+				}
+				else
+					hostcache[n].name[i-1]++;
+				i = -1;
+			}
+		}
+	}
+}
+
+void Datagram_SearchForHosts (qboolean xmit)
+{
+	for (net_landriverlevel = 0; net_landriverlevel < net_numlandrivers; net_landriverlevel++)
+	{
+		if (hostCacheCount == HOSTCACHESIZE)
+			break;
+		if (net_landrivers[net_landriverlevel].initialized)
+			_Datagram_SearchForHosts (xmit);
+	}
+}
+
+
+static qsocket_t *_Datagram_Connect (char *host)
+{
+	struct qsockaddr sendaddr;
+	struct qsockaddr readaddr;
+	qsocket_t	*sock;
+	int			newsock;
+	int			ret;
+	int			reps;
+	double		start_time;
+	int			control;
+	char		*reason;
+
+	// see if we can resolve the host name
+	if (dfunc.GetAddrFromName(host, &sendaddr) == -1)
+		return NULL;
+
+	newsock = dfunc.OpenSocket (0);
+	if (newsock == -1)
+		return NULL;
+
+	sock = NET_NewQSocket ();
+	if (sock == NULL)
+		goto ErrorReturn2;
+	sock->socket = newsock;
+	sock->landriver = net_landriverlevel;
+	Datagram_AttachQueue (sock, false);
+
+	// connect to the host
+	if (dfunc.Connect (newsock, &sendaddr) == -1)
+		goto ErrorReturn;
+
+	// send the connection request
+	Con_Printf("trying...\n"); SCR_UpdateScreen ();
+	start_time = net_time;
+
+	for (reps = 0; reps < 3; reps++)
+	{
+		SZ_Clear(&net_message);
+		// save space for the header, filled in later
+		MSG_WriteLong(&net_message, 0);
+		MSG_WriteByte(&net_message, CCREQ_CONNECT);
+		MSG_WriteString(&net_message, "QUAKE");
+		MSG_WriteByte(&net_message, NET_PROTOCOL_VERSION);
+		*((int *)net_message.data) = BigLong(NETFLAG_CTL | (net_message.cursize & NETFLAG_LENGTH_MASK));
+		dfunc.Write (newsock, net_message.data, net_message.cursize, &sendaddr);
+		SZ_Clear(&net_message);
+		do
+		{
+			ret = dfunc.Read (newsock, net_message.data, net_message.maxsize, &readaddr);
+			// if we got something, validate it
+			if (ret > 0)
+			{
+				// is it from the right place?
+				if (sfunc.AddrCompare(&readaddr, &sendaddr) != 0)
+				{
+					ret = 0;
+					continue;
+				}
+
+				if (ret < sizeof(int))
+				{
+					ret = 0;
+					continue;
+				}
+
+				net_message.cursize = ret;
+				MSG_BeginReading ();
+
+				control = BigLong(*((int *)net_message.data));
+				MSG_ReadLong();
+				if (control == -1)
+				{
+					ret = 0;
+					continue;
+				}
+				if ((control & (~NETFLAG_LENGTH_MASK)) !=  NETFLAG_CTL)
+				{
+					ret = 0;
+					continue;
+				}
+				if ((control & NETFLAG_LENGTH_MASK) != ret)
+				{
+					ret = 0;
+					continue;
+				}
+			}
+		}
+		while (ret == 0 && (SetNetTime() - start_time) < 2.5);
+		if (ret)
+			break;
+		Con_Printf("still trying...\n"); SCR_UpdateScreen ();
+		start_time = SetNetTime();
+	}
+
+	if (ret == 0)
+	{
+		reason = "No Response";
+		Con_Printf("%s\n", reason);
+		Q_strcpy(m_return_reason, reason);
+		goto ErrorReturn;
+	}
+
+	if (ret == -1)
+	{
+		reason = "Network Error";
+		Con_Printf("%s\n", reason);
+		Q_strcpy(m_return_reason, reason);
+		goto ErrorReturn;
+	}
+
+	ret = MSG_ReadByte();
+	if (ret == CCREP_REJECT)
+	{
+		reason = MSG_ReadString();
+		Con_Printf("%s", reason);
+		Q_strncpy(m_return_reason, reason, 31);
+		m_return_reason[31] = 0;
+		goto ErrorReturn;
+	}
+
+	if (ret == CCREP_ACCEPT)
+	{
+		Q_memcpy(&sock->addr, &sendaddr, sizeof(struct qsockaddr));
+		dfunc.SetSocketPort (&sock->addr, MSG_ReadLong());
+	}
+	else
+	{
+		reason = "Bad Response";
+		Con_Printf("%s\n", reason);
+		Q_strcpy(m_return_reason, reason);
+		goto ErrorReturn;
+	}
+
+	dfunc.GetNameFromAddr (&sendaddr, sock->address);
+
+	Con_Printf ("Connection accepted\n");
+	sock->lastMessageTime = SetNetTime();
+
+	// switch the connection to the specified address
+	if (dfunc.Connect (newsock, &sock->addr) == -1)
+	{
+		reason = "Connect to Game failed";
+		Con_Printf("%s\n", reason);
+		Q_strcpy(m_return_reason, reason);
+		goto ErrorReturn;
+	}
+
+	m_return_onerror = false;
+	return sock;
+
+ErrorReturn:
+	Datagram_DetachQueue (sock);
+	NET_FreeQSocket(sock);
+ErrorReturn2:
+	dfunc.CloseSocket(newsock);
+	if (m_return_onerror)
+	{
+		key_dest = key_menu;
+		m_state = m_return_state;
+		m_return_onerror = false;
+	}
+	return NULL;
+}
+
+qsocket_t *Datagram_Connect (char *host)
+{
+	qsocket_t *ret = NULL;
+
+	for (net_landriverlevel = 0; net_landriverlevel < net_numlandrivers; net_landriverlevel++)
+		if (net_landrivers[net_landriverlevel].initialized)
+			if ((ret = _Datagram_Connect (host)) != NULL)
+				break;
+	return ret;
+}
@@ -751,6 +751,8 @@ int NET_SendToAll(sizebuf_t *data, int blocktime)
 		}
 	}
 
+	NET_Flush ();
+
 	start = Sys_FloatTime();
 	while (count)
 	{
@@ -786,6 +788,7 @@ int NET_SendToAll(sizebuf_t *data, int blocktime)
 				continue;
 			}
 		}
+		NET_Flush ();
 		if ((Sys_FloatTime() - start) > blocktime)
 			break;
 	}
@@ -793,6 +796,44 @@ int NET_SendToAll(sizebuf_t *data, int blocktime)
 }
 
 
+/*
+==================
+NET_Flush
+==================
+*/
+void NET_Flush (void)
+{
+	for (net_driverlevel=0 ; net_driverlevel<net_numdrivers; net_driverlevel++)
+	{
+		if (net_drivers[net_driverlevel].initialized == false)
+			continue;
+		if (dfunc.Flush)
+			dfunc.Flush ();
+	}
+}
+
+
+/*
+==================
+NET_Sleep
+
+A dedicated server calls this between tics instead of spinning.  The first
+driver that can wait does it for everyone.
+==================
+*/
+qboolean NET_Sleep (int msec)
+{
+	for (net_driverlevel=0 ; net_driverlevel<net_numdrivers; net_driverlevel++)
+	{
+		if (net_drivers[net_driverlevel].initialized == false)
+			continue;
+		if (dfunc.Sleep && dfunc.Sleep (msec))
+			return true;
+	}
+	return false;
+}
+
+
 //=============================================================================
 
 /*
@@ -0,0 +1,547 @@
+/*
+Copyright (C) 1996-1997 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+// net_udp.c
+
+#define _GNU_SOURCE		// recvmmsg and sendmmsg
+
+#include "quakedef.h"
+
+#include <sys/types.h>
+#include <sys/param.h>
+#include <sys/socket.h>
+#include <sys/ioctl.h>
+#include <sys/uio.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include "net_udp.h"
+
+extern cvar_t hostname;
+
+static int net_acceptsocket = -1;		// socket for fielding new connections
+static int net_controlsocket;
+static int net_broadcastsocket = 0;
+static struct qsockaddr broadcastaddr;
+
+static unsigned long myAddr;
+
+#define	UDP_MAXBATCH	64
+
+//=============================================================================
+
+int UDP_Init (void)
+{
+	struct hostent *local;
+	char	buff[MAXHOSTNAMELEN];
+	struct qsockaddr addr;
+	char *colon;
+
+	if (COM_CheckParm ("-noudp"))
+		return -1;
+
+	// determine my name & address
+	gethostname(buff, MAXHOSTNAMELEN);
+	local = gethostbyname(buff);
+	if (local)
+		myAddr = *(int *)local->h_addr_list[0];
+	else
+		myAddr = htonl(INADDR_LOOPBACK);
+
+	// if the quake hostname isn't set, set it to the machine name
+	if (Q_strcmp(hostname.string, "UNNAMED") == 0)
+	{
+		buff[15] = 0;
+		Cvar_Set ("hostname", buff);
+	}
+
+	if ((net_controlsocket = UDP_OpenSocket (0)) == -1)
+	{
+		Con_Printf("UDP_Init: Unable to open control socket\n");
+		return -1;
+	}
+
+	((struct sockaddr_in *)&broadcastaddr)->sin_family = AF_INET;
+	((struct sockaddr_in *)&broadcastaddr)->sin_addr.s_addr = INADDR_BROADCAST;
+	((struct sockaddr_in *)&broadcastaddr)->sin_port = htons(net_hostport);
+
+	UDP_GetSocketAddr (net_controlsocket, &addr);
+	Q_strcpy(my_tcpip_address,  UDP_AddrToString (&addr));
+	colon = Q_strrchr (my_tcpip_address, ':');
+	if (colon)
+		*colon = 0;
+
+	Con_Printf("UDP Initialized\n");
+	tcpipAvailable = true;
+
+	return net_controlsocket;
+}
+
+//=============================================================================
+
+void UDP_Shutdown (void)
+{
+	UDP_Listen (false);
+	UDP_CloseSocket (net_controlsocket);
+}
+
+//=============================================================================
+
+void UDP_Listen (qboolean state)
+{
+	// enable listening
+	if (state)
+	{
+		if (net_acceptsocket != -1)
+			return;
+		if ((net_acceptsocket = UDP_OpenSocket (net_hostport)) == -1)
+			Sys_Error ("UDP_Listen: Unable to open accept socket\n");
+		return;
+	}
+
+	// disable listening
+	if (net_acceptsocket == -1)
+		return;
+	UDP_CloseSocket (net_acceptsocket);
+	net_acceptsocket = -1;
+}
+
+//=============================================================================
+
+int UDP_OpenSocket (int port)
+{
+	int newsocket;
+	struct sockaddr_in address;
+	int _true = 1;
+
+	if ((newsocket = socket (PF_INET, SOCK_DGRAM, IPPROTO_UDP)) == -1)
+		return -1;
+
+	if (ioctl (newsocket, FIONBIO, (char *)&_true) == -1)
+		goto ErrorReturn;
+
+	Q_memset (&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = INADDR_ANY;
+	address.sin_port = htons(port);
+	if( bind (newsocket, (void *)&address, sizeof(address)) == -1)
+		goto ErrorReturn;
+
+	return newsocket;
+
+ErrorReturn:
+	close (newsocket);
+	return -1;
+}
+
+//=============================================================================
+
+int UDP_CloseSocket (int socket)
+{
+	if (socket == net_broadcastsocket)
+		net_broadcastsocket = 0;
+	return close (socket);
+}
+
+
+//=============================================================================
+/*
+============
+PartialIPAddress
+
+this lets you type only as much of the net address as required, using
+the local network components to fill in the rest
+============
+*/
+static int PartialIPAddress (char *in, struct qsockaddr *hostaddr)
+{
+	char buff[256];
+	char *b;
+	int addr;
+	int num;
+	int mask;
+	int run;
+	int port;
+
+	if (Q_strlen (in) > sizeof(buff) - 2)
+		return -1;
+
+	buff[0] = '.';
+	b = buff;
+	Q_strcpy(buff+1, in);
+	if (buff[1] == '.')
+		b++;
+
+	addr = 0;
+	mask=-1;
+	while (*b == '.')
+	{
+		b++;
+		num = 0;
+		run = 0;
+		while (!( *b < '0' || *b > '9'))
+		{
+		  num = num*10 + *b++ - '0';
+		  if (++run > 3)
+		  	return -1;
+		}
+		if ((*b < '0' || *b > '9') && *b != '.' && *b != ':' && *b != 0)
+			return -1;
+		if (num < 0 || num > 255)
+			return -1;
+		mask<<=8;
+		addr = (addr<<8) + num;
+	}
+
+	if (*b++ == ':')
+		port = Q_atoi(b);
+	else
+		port = net_hostport;
+
+	hostaddr->sa_family = AF_INET;
+	((struct sockaddr_in *)hostaddr)->sin_port = htons((short)port);
+	((struct sockaddr_in *)hostaddr)->sin_addr.s_addr = (myAddr & htonl(mask)) | htonl(addr);
+
+	return 0;
+}
+//=============================================================================
+
+int UDP_Connect (int socket, struct qsockaddr *addr)
+{
+	return 0;
+}
+
+//=============================================================================
+
+/*
+============
+UDP_CheckNewConnections
+
+The datagram driver drains the accept socket with a single non-blocking
+batch read, so there is nothing to gain from asking the kernel how much
+is queued first; any time we are listening the socket is worth reading.
+============
+*/
+int UDP_CheckNewConnections (void)
+{
+	return net_acceptsocket;
+}
+
+//=============================================================================
+
+int UDP_Read (int socket, byte *buf, int len, struct qsockaddr *addr)
+{
+	socklen_t addrlen = sizeof (struct qsockaddr);
+	int ret;
+
+	ret = recvfrom (socket, buf, len, 0, (struct sockaddr *)addr, &addrlen);
+	if (ret == -1 && (errno == EWOULDBLOCK || errno == ECONNREFUSED))
+		return 0;
+	return ret;
+}
+
+//=============================================================================
+
+static int UDP_MakeSocketBroadcastCapable (int socket)
+{
+	int				i = 1;
+
+	// make this socket broadcast capable
+	if (setsockopt(socket, SOL_SOCKET, SO_BROADCAST, (char *)&i, sizeof(i)) < 0)
+		return -1;
+	net_broadcastsocket = socket;
+
+	return 0;
+}
+
+//=============================================================================
+
+int UDP_Broadcast (int socket, byte *buf, int len)
+{
+	int ret;
+
+	if (socket != net_broadcastsocket)
+	{
+		if (net_broadcastsocket != 0)
+			Sys_Error("Attempted to use multiple broadcasts sockets\n");
+		ret = UDP_MakeSocketBroadcastCapable (socket);
+		if (ret == -1)
+		{
+			Con_Printf("Unable to make socket broadcast capable\n");
+			return ret;
+		}
+	}
+
+	return UDP_Write (socket, buf, len, &broadcastaddr);
+}
+
+//=============================================================================
+
+int UDP_Write (int socket, byte *buf, int len, struct qsockaddr *addr)
+{
+	int ret;
+
+	ret = sendto (socket, buf, len, 0, (struct sockaddr *)addr, sizeof(struct qsockaddr));
+	if (ret == -1 && errno == EWOULDBLOCK)
+		return 0;
+	return ret;
+}
+
+//=============================================================================
+
+/*
+============
+UDP_ReadMany
+
+Takes everything that is already queued on the socket, up to count
+packets, in one system call.  Returns the number of packets read, 0 if
+there was nothing, or -1 if the batch call is not available.
+============
+*/
+int UDP_ReadMany (int socket, netpacket_t *packets, int count)
+{
+#ifdef __linux__
+	struct mmsghdr	msgs[UDP_MAXBATCH];
+	struct iovec	iovs[UDP_MAXBATCH];
+	int				i, ret;
+
+	if (count > UDP_MAXBATCH)
+		count = UDP_MAXBATCH;
+
+	Q_memset (msgs, 0, count * sizeof(msgs[0]));
+	for (i=0 ; i<count ; i++)
+	{
+		iovs[i].iov_base = packets[i].data;
+		iovs[i].iov_len = sizeof(packets[i].data);
+		msgs[i].msg_hdr.msg_name = &packets[i].addr;
+		msgs[i].msg_hdr.msg_namelen = sizeof(struct qsockaddr);
+		msgs[i].msg_hdr.msg_iov = &iovs[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	ret = recvmmsg (socket, msgs, count, MSG_DONTWAIT, NULL);
+	if (ret == -1)
+	{
+		if (errno == EWOULDBLOCK || errno == ECONNREFUSED || errno == EINTR)
+			return 0;
+		return -1;
+	}
+
+	for (i=0 ; i<ret ; i++)
+		packets[i].length = msgs[i].msg_len;
+	return ret;
+#else
+	return -1;
+#endif
+}
+
+//=============================================================================
+
+/*
+============
+UDP_WriteMany
+
+Sends count packets, each to its own address, in as few system calls as
+the kernel allows.  A packet the kernel refuses is dropped like any other
+lost datagram.  Returns the number of packets sent, or -1 if the batch
+call is not available.
+============
+*/
+int UDP_WriteMany (int socket, netpacket_t *packets, int count)
+{
+#ifdef __linux__
+	struct mmsghdr	msgs[UDP_MAXBATCH];
+	struct iovec	iovs[UDP_MAXBATCH];
+	int				i, n, ret, done, sent;
+
+	sent = 0;
+	for (done=0 ; done<count ; done+=n)
+	{
+		n = count - done;
+		if (n > UDP_MAXBATCH)
+			n = UDP_MAXBATCH;
+
+		Q_memset (msgs, 0, n * sizeof(msgs[0]));
+		for (i=0 ; i<n ; i++)
+		{
+			iovs[i].iov_base = packets[done+i].data;
+			iovs[i].iov_len = packets[done+i].length;
+			msgs[i].msg_hdr.msg_name = &packets[done+i].addr;
+			msgs[i].msg_hdr.msg_namelen = sizeof(struct qsockaddr);
+			msgs[i].msg_hdr.msg_iov = &iovs[i];
+			msgs[i].msg_hdr.msg_iovlen = 1;
+		}
+
+		for (i=0 ; i<n ; )
+		{
+			ret = sendmmsg (socket, msgs + i, n - i, 0);
+			if (ret == -1)
+			{
+				if (errno == EWOULDBLOCK)
+					return sent;	// the socket is full, the rest are lost
+				if (errno == ENOSYS)
+					return sent ? sent : -1;
+				i++;				// skip the one that failed
+				continue;
+			}
+			i += ret;
+			sent += ret;
+		}
+	}
+
+	return sent;
+#else
+	return -1;
+#endif
+}
+
+//=============================================================================
+
+int UDP_Wait (int socket, int msec)
+{
+	fd_set			fdset;
+	struct timeval	timeout;
+
+	FD_ZERO (&fdset);
+	if (socket != -1)
+		FD_SET (socket, &fdset);
+	timeout.tv_sec = msec / 1000;
+	timeout.tv_usec = (msec % 1000) * 1000;
+
+	return select (socket + 1, socket != -1 ? &fdset : NULL, NULL, NULL, &timeout);
+}
+
+//=============================================================================
+
+char *UDP_AddrToString (struct qsockaddr *addr)
+{
+	static char buffer[22];
+	int haddr;
+
+	haddr = ntohl(((struct sockaddr_in *)addr)->sin_addr.s_addr);
+	sprintf(buffer, "%d.%d.%d.%d:%d", (haddr >> 24) & 0xff, (haddr >> 16) & 0xff, (haddr >> 8) & 0xff, haddr & 0xff, ntohs(((struct sockaddr_in *)addr)->sin_port));
+	return buffer;
+}
+
+//=============================================================================
+
+int UDP_StringToAddr (char *string, struct qsockaddr *addr)
+{
+	int ha1, ha2, ha3, ha4, hp;
+	int ipaddr;
+
+	ha1 = ha2 = ha3 = ha4 = hp = 0;
+	sscanf(string, "%d.%d.%d.%d:%d", &ha1, &ha2, &ha3, &ha4, &hp);
+	ipaddr = (ha1 << 24) | (ha2 << 16) | (ha3 << 8) | ha4;
+
+	addr->sa_family = AF_INET;
+	((struct sockaddr_in *)addr)->sin_addr.s_addr = htonl(ipaddr);
+	((struct sockaddr_in *)addr)->sin_port = htons(hp);
+	return 0;
+}
+
+//=============================================================================
+
+int UDP_GetSocketAddr (int socket, struct qsockaddr *addr)
+{
+	socklen_t addrlen = sizeof(struct qsockaddr);
+	unsigned int a;
+
+	Q_memset(addr, 0, sizeof(struct qsockaddr));
+	getsockname(socket, (struct sockaddr *)addr, &addrlen);
+	a = ((struct sockaddr_in *)addr)->sin_addr.s_addr;
+	if (a == 0 || a == inet_addr("127.0.0.1"))
+		((struct sockaddr_in *)addr)->sin_addr.s_addr = myAddr;
+
+	return 0;
+}
+
+//=============================================================================
+
+int UDP_GetNameFromAddr (struct qsockaddr *addr, char *name)
+{
+	struct hostent *hostentry;
+
+	hostentry = gethostbyaddr ((char *)&((struct sockaddr_in *)addr)->sin_addr, sizeof(struct in_addr), AF_INET);
+	if (hostentry)
+	{
+		Q_strncpy (name, (char *)hostentry->h_name, NET_NAMELEN - 1);
+		name[NET_NAMELEN - 1] = 0;
+		return 0;
+	}
+
+	Q_strcpy (name, UDP_AddrToString (addr));
+	return 0;
+}
+
+//=============================================================================
+
+int UDP_GetAddrFromName(char *name, struct qsockaddr *addr)
+{
+	struct hostent *hostentry;
+
+	if (name[0] >= '0' && name[0] <= '9')
+		return PartialIPAddress (name, addr);
+
+	hostentry = gethostbyname (name);
+	if (!hostentry)
+		return -1;
+
+	addr->sa_family = AF_INET;
+	((struct sockaddr_in *)addr)->sin_port = htons(net_hostport);
+	((struct sockaddr_in *)addr)->sin_addr.s_addr = *(int *)hostentry->h_addr_list[0];
+
+	return 0;
+}
+
+//=============================================================================
+
+int UDP_AddrCompare (struct qsockaddr *addr1, struct qsockaddr *addr2)
+{
+	if (addr1->sa_family != addr2->sa_family)
+		return -1;
+
+	if (((struct sockaddr_in *)addr1)->sin_addr.s_addr != ((struct sockaddr_in *)addr2)->sin_addr.s_addr)
+		return -1;
+
+	if (((struct sockaddr_in *)addr1)->sin_port != ((struct sockaddr_in *)addr2)->sin_port)
+		return 1;
+
+	return 0;
+}
+
+//=============================================================================
+
+int UDP_GetSocketPort (struct qsockaddr *addr)
+{
+	return ntohs(((struct sockaddr_in *)addr)->sin_port);
+}
+
+
+int UDP_SetSocketPort (struct qsockaddr *addr, int port)
+{
+	((struct sockaddr_in *)addr)->sin_port = htons(port);
+	return 0;
+}
+
+//=============================================================================
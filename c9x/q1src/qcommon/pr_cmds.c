@@ -251,6 +251,7 @@ void PF_setmodel (void)
 		
 
 	e->v.model = PR_SetEngineString(*check);
+	ED_FieldStored (e, ED_FIELD(model));
 	e->v.modelindex = i; //SV_ModelIndex (m);
 
 	mod = sv.models[ (int)e->v.modelindex];  // Mod_ForName (m, true);
@@ -606,6 +607,22 @@ if the tryents flag is set.
 traceline (vector1, vector2, tryents)
 =================
 */
+static void PF_SetTraceGlobals (trace_t *trace)
+{
+	pr_global_struct->trace_allsolid = trace->allsolid;
+	pr_global_struct->trace_startsolid = trace->startsolid;
+	pr_global_struct->trace_fraction = trace->fraction;
+	pr_global_struct->trace_inwater = trace->inwater;
+	pr_global_struct->trace_inopen = trace->inopen;
+	VectorCopy (trace->endpos, pr_global_struct->trace_endpos);
+	VectorCopy (trace->plane.normal, pr_global_struct->trace_plane_normal);
+	pr_global_struct->trace_plane_dist =  trace->plane.dist;	
+	if (trace->ent)
+		pr_global_struct->trace_ent = EDICT_TO_PROG(trace->ent);
+	else
+		pr_global_struct->trace_ent = EDICT_TO_PROG(sv.edicts);
+}
+
 void PF_traceline (void)
 {
 	float	*v1, *v2;
@@ -620,18 +637,82 @@ void PF_traceline (void)
 
 	trace = SV_Move (v1, vec3_origin, vec3_origin, v2, nomonsters, ent);
 
-	pr_global_struct->trace_allsolid = trace.allsolid;
-	pr_global_struct->trace_startsolid = trace.startsolid;
-	pr_global_struct->trace_fraction = trace.fraction;
-	pr_global_struct->trace_inwater = trace.inwater;
-	pr_global_struct->trace_inopen = trace.inopen;
-	VectorCopy (trace.endpos, pr_global_struct->trace_endpos);
-	VectorCopy (trace.plane.normal, pr_global_struct->trace_plane_normal);
-	pr_global_struct->trace_plane_dist =  trace.plane.dist;	
-	if (trace.ent)
-		pr_global_struct->trace_ent = EDICT_TO_PROG(trace.ent);
-	else
-		pr_global_struct->trace_ent = EDICT_TO_PROG(sv.edicts);
+	PF_SetTraceGlobals (&trace);
+}
+
+/*
+=================
+PF_tracebatch_add
+
+Queues a line for tracebatch and returns its number.  A batch that has
+been traced is started over.
+
+float(vector v1, vector v2) tracebatch_add = #79;
+=================
+*/
+static vec3_t	pr_batchstarts[MAX_BATCH_TRACES];
+static vec3_t	pr_batchends[MAX_BATCH_TRACES];
+static trace_t	pr_batchtraces[MAX_BATCH_TRACES];
+static int		pr_batchcount;
+static qboolean	pr_batchdone;
+
+void PF_tracebatch_add (void)
+{
+	if (pr_batchdone)
+	{
+		pr_batchcount = 0;
+		pr_batchdone = false;
+	}
+	if (pr_batchcount == MAX_BATCH_TRACES)
+		PR_RunError ("tracebatch_add: more than %i lines", MAX_BATCH_TRACES);
+
+	VectorCopy (G_VECTOR(OFS_PARM0), pr_batchstarts[pr_batchcount]);
+	VectorCopy (G_VECTOR(OFS_PARM1), pr_batchends[pr_batchcount]);
+	G_FLOAT(OFS_RETURN) = pr_batchcount++;
+}
+
+/*
+=================
+PF_tracebatch
+
+Traces every queued line as traceline would, and returns how many there
+were.  The results are read back with tracebatch_result.
+
+float(float nomonsters, entity forent) tracebatch = #80;
+=================
+*/
+void PF_tracebatch (void)
+{
+	int		nomonsters;
+	edict_t	*ent;
+
+	nomonsters = G_FLOAT(OFS_PARM0);
+	ent = G_EDICT(OFS_PARM1);
+
+	if (!pr_batchdone)
+		SV_MoveBatch (pr_batchcount, pr_batchstarts, vec3_origin, vec3_origin, pr_batchends, nomonsters, ent, pr_batchtraces);
+	pr_batchdone = true;
+	G_FLOAT(OFS_RETURN) = pr_batchcount;
+}
+
+/*
+=================
+PF_tracebatch_result
+
+Sets the trace_* globals from line num of the last tracebatch
+
+void(float num) tracebatch_result = #81;
+=================
+*/
+void PF_tracebatch_result (void)
+{
+	int		num;
+
+	num = G_FLOAT(OFS_PARM0);
+	if (!pr_batchdone || num < 0 || num >= pr_batchcount)
+		PR_RunError ("tracebatch_result: no line %i", num);
+
+	PF_SetTraceGlobals (&pr_batchtraces[num]);
 }
 
 
@@ -727,7 +808,7 @@ int PF_newcheckclient (int check)
 // get the PVS for the entity
 	VectorAdd (ent->v.origin, ent->v.view_ofs, org);
 	leaf = Mod_PointInLeaf (org, sv.worldmodel);
-	pvs = Mod_LeafPVS (leaf, sv.worldmodel);
+	pvs = SV_LeafPVS (leaf);
 	memcpy (checkpvs, pvs, (sv.worldmodel->numleafs+7)>>3 );
 
 	return i;
@@ -877,35 +958,72 @@ Returns a chain of entities that have origins within a spherical area
 findradius (origin, radius)
 =================
 */
+static qboolean PF_InRadius (edict_t *ent, float *org, float rad)
+{
+	vec3_t	eorg;
+	int		j;
+
+	if (ent->free)
+		return false;
+	if (ent->v.solid == SOLID_NOT)
+		return false;
+	for (j=0 ; j<3 ; j++)
+		eorg[j] = org[j] - (ent->v.origin[j] + (ent->v.mins[j] + ent->v.maxs[j])*0.5);			
+	if (Length(eorg) > rad)
+		return false;
+	return true;
+}
+
 void PF_findradius (void)
 {
 	edict_t	*ent, *chain;
 	float	rad;
 	float	*org;
-	vec3_t	eorg;
-	int		i, j;
+	int		i, e, count;
+	edict_t	*list[MAX_EDICTS];
 
 	chain = (edict_t *)sv.edicts;
 	
 	org = G_VECTOR(OFS_PARM0);
 	rad = G_FLOAT(OFS_PARM1);
 
-	ent = NEXT_EDICT(sv.edicts);
-	for (i=1 ; i<sv.num_edicts ; i++, ent = NEXT_EDICT(ent))
+	if (pr_findindex.value)
+		count = SV_RadiusEdicts (org, rad, list);
+	else
 	{
-		if (ent->free)
-			continue;
-		if (ent->v.solid == SOLID_NOT)
+		count = 0;
+		for (i=1 ; i<sv.num_edicts ; i++)
+			list[count++] = EDICT_NUM(i);
+	}
+
+	for (i=0 ; i<count ; i++)
+	{
+		ent = list[i];
+		e = NUM_FOR_EDICT(ent);
+		if (e < 1 || e >= sv.num_edicts)
 			continue;
-		for (j=0 ; j<3 ; j++)
-			eorg[j] = org[j] - (ent->v.origin[j] + (ent->v.mins[j] + ent->v.maxs[j])*0.5);			
-		if (Length(eorg) > rad)
+		if (!PF_InRadius (ent, org, rad))
 			continue;
 			
 		ent->v.chain = EDICT_TO_PROG(chain);
 		chain = ent;
 	}
 
+	if (pr_findindex.value == 2)
+	{	// walk the chain against a full scan
+		ent = chain;
+		for (e=sv.num_edicts-1 ; e>0 ; e--)
+		{
+			if (!PF_InRadius (EDICT_NUM(e), org, rad))
+				continue;
+			if (ent != EDICT_NUM(e))
+				break;
+			ent = PROG_TO_EDICT(ent->v.chain);
+		}
+		if (e || ent != sv.edicts)
+			Con_Printf ("findradius: index disagrees with scan at edict %i\n", e);
+	}
+
 	RETURN_EDICT(chain);
 }
 
@@ -920,18 +1038,17 @@ void PF_dprint (void)
 	Con_DPrintf ("%s",PF_VarString(0));
 }
 
-char	pr_string_temp[128];
-
 void PF_ftos (void)
 {
 	float	v;
+	char	*s;
+
 	v = G_FLOAT(OFS_PARM0);
-	
+	G_INT(OFS_RETURN) = PR_TempString (&s);
 	if (v == (int)v)
-		sprintf (pr_string_temp, "%d",(int)v);
+		sprintf (s, "%d",(int)v);
 	else
-		sprintf (pr_string_temp, "%5.1f",v);
-	G_INT(OFS_RETURN) = PR_SetEngineString(pr_string_temp);
+		sprintf (s, "%5.1f",v);
 }
 
 void PF_fabs (void)
@@ -943,15 +1060,19 @@ void PF_fabs (void)
 
 void PF_vtos (void)
 {
-	sprintf (pr_string_temp, "'%5.1f %5.1f %5.1f'", G_VECTOR(OFS_PARM0)[0], G_VECTOR(OFS_PARM0)[1], G_VECTOR(OFS_PARM0)[2]);
-	G_INT(OFS_RETURN) = PR_SetEngineString(pr_string_temp);
+	char	*s;
+
+	G_INT(OFS_RETURN) = PR_TempString (&s);
+	sprintf (s, "'%5.1f %5.1f %5.1f'", G_VECTOR(OFS_PARM0)[0], G_VECTOR(OFS_PARM0)[1], G_VECTOR(OFS_PARM0)[2]);
 }
 
 #ifdef QUAKE2
 void PF_etos (void)
 {
-	sprintf (pr_string_temp, "entity %i", G_EDICTNUM(OFS_PARM0));
-	G_INT(OFS_RETURN) = pr_string_temp - pr_strings;
+	char	*s;
+
+	G_INT(OFS_RETURN) = PR_TempString (&s);
+	sprintf (s, "entity %i", G_EDICTNUM(OFS_PARM0));
 }
 #endif
 
@@ -971,13 +1092,248 @@ void PF_Remove (void)
 }
 
 
+/*
+===============================================================================
+
+FIELD VALUE INDEXES
+
+The first find() on a string field hashes every live edict by that field's
+value.  Stores to the field and edict reuse put an edict on the index's
+dirty list, and dirty edicts are compared directly until there are enough
+of them to make a rebuild worthwhile.  Engine strings can be rewritten
+without a store, so edicts holding one are left dirty for good.
+===============================================================================
+*/
+
+cvar_t	pr_findindex = {"pr_findindex", "1"};	// 2 = check every result with a full scan
+
+#define	MAX_FIND_INDEXES	8
+#define	FIND_HASH_SIZE		256		// must be a power of two
+#define	FIND_MAX_DIRTY		32		// stores tolerated before a rebuild
+
+typedef struct
+{
+	int			field;				// entity field word
+	qboolean	usable;				// false if the field isn't a string
+	qboolean	built;
+	int			serial;				// pr_stringserial when built
+	short		heads[FIND_HASH_SIZE];	// first edict number, 0 = empty
+	short		next[MAX_EDICTS];		// chains run in ascending edict order
+	byte		dirty[MAX_EDICTS];
+	short		dirtylist[MAX_EDICTS];
+	int			numdirty;
+	int			numvolatile;		// edicts left dirty by the last build
+} findindex_t;
+
+static findindex_t	pr_findindexes[MAX_FIND_INDEXES];
+static int			pr_numfindindexes;
+
+ddef_t *ED_FieldAtOfs (int ofs);
+
+/*
+=============
+PR_ClearFindIndexes
+
+Called when new progs are loaded
+=============
+*/
+void PR_ClearFindIndexes (void)
+{
+	pr_numfindindexes = 0;
+}
+
+/*
+=============
+PR_FindIndexChanged
+
+=============
+*/
+void PR_FindIndexChanged (edict_t *ed, int field)
+{
+	findindex_t	*fi;
+	int			i, e;
+
+	e = NUM_FOR_EDICT(ed);
+	for (i=0, fi=pr_findindexes ; i<pr_numfindindexes ; i++, fi++)
+	{
+		if (field != -1 && field != fi->field)
+			continue;
+		if (!fi->built || fi->dirty[e])
+			continue;
+		fi->dirty[e] = true;
+		fi->dirtylist[fi->numdirty++] = e;
+	}
+}
+
+/*
+=============
+PR_BuildFindIndex
+
+=============
+*/
+static void PR_BuildFindIndex (findindex_t *fi)
+{
+	int		e, h, num;
+	edict_t	*ed;
+
+	memset (fi->heads, 0, sizeof(fi->heads));
+	memset (fi->dirty, 0, sizeof(fi->dirty));
+	fi->numdirty = 0;
+
+	for (e=sv.num_edicts-1 ; e>0 ; e--)
+	{
+		ed = EDICT_NUM(e);
+		if (ed->free)
+			continue;		// ED_Alloc will mark it dirty
+		num = ((int *)&ed->v)[fi->field];
+		if (!PR_IsConstantString (num))
+		{
+			fi->dirty[e] = true;
+			fi->dirtylist[fi->numdirty++] = e;
+			continue;
+		}
+		h = PR_HashName (PR_GetString(num)) & (FIND_HASH_SIZE-1);
+		fi->next[e] = fi->heads[h];
+		fi->heads[h] = e;
+	}
+
+	fi->numvolatile = fi->numdirty;
+	fi->serial = pr_stringserial;
+	fi->built = true;
+}
+
+/*
+=============
+PR_GetFindIndex
+
+Returns an up to date index for field, or NULL if find has to scan
+=============
+*/
+static findindex_t *PR_GetFindIndex (int field)
+{
+	findindex_t	*fi;
+	ddef_t		*def;
+	int			i;
+
+	for (i=0, fi=pr_findindexes ; i<pr_numfindindexes ; i++, fi++)
+		if (fi->field == field)
+			break;
+
+	if (i == pr_numfindindexes)
+	{
+		if (i == MAX_FIND_INDEXES || field < 0 || field >= progs->entityfields)
+			return NULL;
+		pr_numfindindexes++;
+		fi->field = field;
+		fi->built = false;
+		def = ED_FieldAtOfs (field);
+		fi->usable = def && (def->type & ~DEF_SAVEGLOBAL) == ev_string;
+		if (fi->usable)
+			pr_fieldflags[field] |= FIELD_INDEXED;
+	}
+
+	if (!fi->usable)
+		return NULL;
+	if (!fi->built || fi->serial != pr_stringserial
+	|| fi->numdirty > fi->numvolatile + FIND_MAX_DIRTY)
+		PR_BuildFindIndex (fi);
+	return fi;
+}
+
+/*
+=============
+PR_FindNext
+
+Returns the lowest numbered edict above start whose field matches s, or 0.
+Dirty edicts are only compared below the best indexed match, so a bad
+string makes the same edicts error as a full scan would.
+=============
+*/
+static int PR_FindNext (findindex_t *fi, int start, char *s)
+{
+	int		e, best, i;
+	edict_t	*ed;
+	char	*t;
+
+	best = sv.num_edicts;
+	for (e = fi->heads[PR_HashName (s) & (FIND_HASH_SIZE-1)] ; e ; e = fi->next[e])
+	{
+		if (e <= start || fi->dirty[e])
+			continue;
+		if (e >= best)
+			break;
+		ed = EDICT_NUM(e);
+		if (ed->free)
+			continue;
+		if (!strcmp(E_STRING(ed,fi->field), s))
+		{
+			best = e;
+			break;
+		}
+	}
+
+	for (i=0 ; i<fi->numdirty ; i++)
+	{
+		e = fi->dirtylist[i];
+		if (e <= start || e >= best)
+			continue;
+		ed = EDICT_NUM(e);
+		if (ed->free)
+			continue;
+		t = E_STRING(ed,fi->field);
+		if (t && !strcmp(t,s))
+			best = e;
+	}
+
+	return best < sv.num_edicts ? best : 0;
+}
+
+/*
+=============
+PF_FindScan
+
+The original linear search, also used to check the indexes
+=============
+*/
+static int PF_FindScan (int e, int f, char *s)
+{
+	edict_t	*ed;
+	char	*t;
+
+	for (e++ ; e < sv.num_edicts ; e++)
+	{
+		ed = EDICT_NUM(e);
+		if (ed->free)
+			continue;
+		t = E_STRING(ed,f);
+		if (!t)
+			continue;
+		if (!strcmp(t,s))
+			return e;
+	}
+	return 0;
+}
+
+static int PF_FindNextEdict (int e, int f, char *s)
+{
+	findindex_t	*fi;
+	int			n;
+
+	if (!pr_findindex.value || !(fi = PR_GetFindIndex (f)))
+		return PF_FindScan (e, f, s);
+	n = PR_FindNext (fi, e, s);
+	if (pr_findindex.value == 2 && n != PF_FindScan (e, f, s))
+		Con_Printf ("find: index returned edict %i, scan %i\n", n, PF_FindScan (e, f, s));
+	return n;
+}
+
 // entity (entity start, .string field, string match) find = #5;
 void PF_Find (void)
 #ifdef QUAKE2
 {
 	int		e;	
 	int		f;
-	char	*s, *t;
+	char	*s;
 	edict_t	*ed;
 	edict_t	*first;
 	edict_t	*second;
@@ -990,23 +1346,15 @@ void PF_Find (void)
 	if (!s)
 		PR_RunError ("PF_Find: bad search string");
 		
-	for (e++ ; e < sv.num_edicts ; e++)
+	while ((e = PF_FindNextEdict (e, f, s)) != 0)
 	{
 		ed = EDICT_NUM(e);
-		if (ed->free)
-			continue;
-		t = E_STRING(ed,f);
-		if (!t)
-			continue;
-		if (!strcmp(t,s))
-		{
-			if (first == (edict_t *)sv.edicts)
-				first = ed;
-			else if (second == (edict_t *)sv.edicts)
-				second = ed;
-			ed->v.chain = EDICT_TO_PROG(last);
-			last = ed;
-		}
+		if (first == (edict_t *)sv.edicts)
+			first = ed;
+		else if (second == (edict_t *)sv.edicts)
+			second = ed;
+		ed->v.chain = EDICT_TO_PROG(last);
+		last = ed;
 	}
 
 	if (first != last)
@@ -1025,31 +1373,15 @@ void PF_Find (void)
 {
 	int		e;	
 	int		f;
-	char	*s, *t;
-	edict_t	*ed;
+	char	*s;
 
 	e = G_EDICTNUM(OFS_PARM0);
 	f = G_INT(OFS_PARM1);
 	s = G_STRING(OFS_PARM2);
 	if (!s)
 		PR_RunError ("PF_Find: bad search string");
-		
-	for (e++ ; e < sv.num_edicts ; e++)
-	{
-		ed = EDICT_NUM(e);
-		if (ed->free)
-			continue;
-		t = E_STRING(ed,f);
-		if (!t)
-			continue;
-		if (!strcmp(t,s))
-		{
-			RETURN_EDICT(ed);
-			return;
-		}
-	}
 
-	RETURN_EDICT(sv.edicts);
+	RETURN_EDICT(EDICT_NUM(PF_FindNextEdict (e, f, s)));
 }
 #endif
 
@@ -1330,11 +1662,17 @@ vector aim(entity, missilespeed)
 =============
 */
 cvar_t	sv_aim = {"sv_aim", "0.93"};
+static edict_t	*pr_aimcheck[MAX_EDICTS];
+static vec3_t	pr_aimstarts[MAX_EDICTS];
+static vec3_t	pr_aimends[MAX_EDICTS];
+static float	pr_aimdists[MAX_EDICTS];
+static trace_t	pr_aimtraces[MAX_EDICTS];
+
 void PF_aim (void)
 {
 	edict_t	*ent, *check, *bestent;
 	vec3_t	start, dir, end, bestdir;
-	int		i, j;
+	int		i, j, numcheck;
 	trace_t	tr;
 	float	dist, bestdist;
 	float	speed;
@@ -1362,6 +1700,8 @@ void PF_aim (void)
 	bestdist = sv_aim.value;
 	bestent = NULL;
 	
+// trace to everything within sv_aim in one batch
+	numcheck = 0;
 	check = NEXT_EDICT(sv.edicts);
 	for (i=1 ; i<sv.num_edicts ; i++, check = NEXT_EDICT(check) )
 	{
@@ -1379,11 +1719,23 @@ void PF_aim (void)
 		dist = DotProduct (dir, pr_global_struct->v_forward);
 		if (dist < bestdist)
 			continue;	// to far to turn
-		tr = SV_Move (start, vec3_origin, vec3_origin, end, false, ent);
-		if (tr.ent == check)
+		pr_aimcheck[numcheck] = check;
+		pr_aimdists[numcheck] = dist;
+		VectorCopy (start, pr_aimstarts[numcheck]);
+		VectorCopy (end, pr_aimends[numcheck]);
+		numcheck++;
+	}
+	SV_MoveBatch (numcheck, pr_aimstarts, vec3_origin, vec3_origin, pr_aimends, false, ent, pr_aimtraces);
+
+// the best one that can be shot at
+	for (i=0 ; i<numcheck ; i++)
+	{
+		if (pr_aimdists[i] < bestdist)
+			continue;
+		if (pr_aimtraces[i].ent == pr_aimcheck[i])
 		{	// can shoot at this one
-			bestdist = dist;
-			bestent = check;
+			bestdist = pr_aimdists[i];
+			bestent = pr_aimcheck[i];
 		}
 	}
 	
@@ -1647,10 +1999,15 @@ void PF_changelevel (void)
 	s1 = G_STRING(OFS_PARM0);
 	s2 = G_STRING(OFS_PARM1);
 
+	// no va (), the client may be using its buffer on the main thread
 	if ((int)pr_global_struct->serverflags & (SFL_NEW_UNIT | SFL_NEW_EPISODE))
-		Cbuf_AddText (va("changelevel %s %s\n",s1, s2));
+		Cbuf_AddText ("changelevel ");
 	else
-		Cbuf_AddText (va("changelevel2 %s %s\n",s1, s2));
+		Cbuf_AddText ("changelevel2 ");
+	Cbuf_AddText (s1);
+	Cbuf_AddText (" ");
+	Cbuf_AddText (s2);
+	Cbuf_AddText ("\n");
 #else
 	char	*s;
 
@@ -1660,7 +2017,10 @@ void PF_changelevel (void)
 	svs.changelevel_issued = true;
 	
 	s = G_STRING(OFS_PARM0);
-	Cbuf_AddText (va("changelevel %s\n",s));
+	// no va (), the client may be using its buffer on the main thread
+	Cbuf_AddText ("changelevel ");
+	Cbuf_AddText (s);
+	Cbuf_AddText ("\n");
 #endif
 }
 
@@ -1926,7 +2286,11 @@ PF_precache_model,
 PF_precache_sound,		// precache_sound2 is different only for qcc
 PF_precache_file,
 
-PF_setspawnparms
+PF_setspawnparms,
+
+PF_tracebatch_add,	// float(vector v1, vector v2) tracebatch_add = #79;
+PF_tracebatch,	// float(float nomonsters, entity forent) tracebatch = #80;
+PF_tracebatch_result	// void(float num) tracebatch_result = #81;
 };
 
 builtin_t *pr_builtins = pr_builtin;
@@ -31,7 +31,7 @@ int				pr_edict_size;	// in bytes
 char		*pr_strings;	// no one should access this. not static
 				// only for two stupid sv_main.c uses.
 static int		pr_stringssize;
-static char		**pr_knownstrings;
+static struct knownstring_s	*pr_knownstrings;
 static int		pr_maxknownstrings;
 static int		pr_numknownstrings;
  ddef_t		*pr_fielddefs;
@@ -39,9 +39,15 @@ static int		pr_numknownstrings;
 
 unsigned short		pr_crc;
 
+byte		*pr_fieldflags;		// FIELD_* bits for each entity field word
+int			pr_stringserial;	// bumped whenever a string number may change meaning
+
 int		type_size[8] = {1,sizeof(string_t)/4,1,3,1,1,sizeof(func_t)/4,sizeof(void *)/4};
 
 ddef_t *ED_FieldAtOfs (int ofs);
+static void PR_ClearStrings (void);
+static void ED_ReleaseStrings (edict_t *ed);
+static void ED_ReplaceString (string_t *d, string_t num);
 qboolean	ED_ParseEpair (void *base, ddef_t *key, char *s);
 
 cvar_t	nomonsters = {"nomonsters", "0"};
@@ -57,14 +63,26 @@ cvar_t	saved3 = {"saved3", "0", true};
 cvar_t	saved4 = {"saved4", "0", true};
 
 #define	MAX_FIELD_LEN	64
-#define GEFV_CACHESIZE	2
+#define GEFV_CACHESIZE	64		// must be a power of two
 
 typedef struct {
-	ddef_t	*pcache;
+	ddef_t	*pcache;		// NULL if the progs don't have the field
 	char	field[MAX_FIELD_LEN];
 } gefv_cache;
 
-static gefv_cache	gefvCache[GEFV_CACHESIZE] = {{NULL, ""}, {NULL, ""}};
+static gefv_cache	gefvCache[GEFV_CACHESIZE];
+
+// name lookups into pr_fielddefs, pr_globaldefs and pr_functions
+typedef struct
+{
+	int		mask;
+	int		*heads;		// first entry of each bucket, -1 if empty
+	int		*chain;		// next entry with the same hash, in index order
+} prhash_t;
+
+static prhash_t	pr_fieldhash;
+static prhash_t	pr_globalhash;
+static prhash_t	pr_functionhash;
 
 /*
 =================
@@ -75,8 +93,11 @@ Sets everything to NULL
 */
 void ED_ClearEdict (edict_t *e)
 {
+	ED_ReleaseStrings (e);
 	memset (&e->v, 0, progs->entityfields * 4);
 	e->free = false;
+	SV_MarkEdictMoved (e);
+	PR_FindIndexChanged (e, -1);
 }
 
 /*
@@ -140,10 +161,29 @@ void ED_Free (edict_t *ed)
 	VectorCopy (vec3_origin, ed->v.angles);
 	ed->v.nextthink = -1;
 	ed->v.solid = 0;
+	PR_FindIndexChanged (ed, -1);
 	
 	ed->freetime = sv.time;
 }
 
+/*
+=================
+ED_FieldStored
+
+Called whenever progs take the address of an entity field that has
+FIELD_* bits set, and by the engine when it writes such a field itself.
+=================
+*/
+void ED_FieldStored (edict_t *ed, int field)
+{
+	if (pr_fieldflags[field] & FIELD_SPATIAL)
+		SV_MarkEdictMoved (ed);
+	if (pr_fieldflags[field] & FIELD_INDEXED)
+		PR_FindIndexChanged (ed, field);
+	if (pr_fieldflags[field] & FIELD_CLIP)
+		SV_EdictChanged (ed);
+}
+
 //===========================================================================
 
 /*
@@ -184,6 +224,71 @@ ddef_t *ED_FieldAtOfs (int ofs)
 	return NULL;
 }
 
+/*
+============
+PR_HashName
+============
+*/
+unsigned PR_HashName (char *name)
+{
+	unsigned	h;
+
+	for (h = 0 ; *name ; name++)
+		h = h * 31 + *(unsigned char *)name;
+	return h;
+}
+
+/*
+============
+PR_BuildHash
+
+names points at the s_name member of the first of count entries that are
+stride bytes apart
+============
+*/
+static void PR_BuildHash (prhash_t *hash, int *names, int count, int stride)
+{
+	int		i, h, size;
+
+	for (size = 64 ; size < count*2 ; size <<= 1)
+		;
+	hash->mask = size - 1;
+	hash->heads = Hunk_AllocName (size * sizeof(int), "prhash");
+	hash->chain = Hunk_AllocName ((count ? count : 1) * sizeof(int), "prhash");
+	for (i=0 ; i<size ; i++)
+		hash->heads[i] = -1;
+
+// insert backwards so each chain ends up in index order and the first
+// match is the same one a linear scan would have found
+	for (i=count-1 ; i>=0 ; i--)
+	{
+		h = PR_HashName (PR_GetString(*(int *)((byte *)names + i*stride))) & hash->mask;
+		hash->chain[i] = hash->heads[h];
+		hash->heads[h] = i;
+	}
+}
+
+/*
+============
+PR_FindHashed
+
+Returns the index of the entry called name, or -1
+============
+*/
+static int PR_FindHashed (prhash_t *hash, int *names, int stride, char *name)
+{
+	int		i;
+
+	if (!hash->heads)
+		return -1;
+	for (i = hash->heads[PR_HashName(name) & hash->mask] ; i != -1 ; i = hash->chain[i])
+	{
+		if (!strcmp(PR_GetString(*(int *)((byte *)names + i*stride)), name))
+			return i;
+	}
+	return -1;
+}
+
 /*
 ============
 ED_FindField
@@ -191,16 +296,10 @@ ED_FindField
 */
 ddef_t *ED_FindField (char *name)
 {
-	ddef_t		*def;
 	int			i;
-	
-	for (i=0 ; i<progs->numfielddefs ; i++)
-	{
-		def = &pr_fielddefs[i];
-		if (!strcmp(PR_GetString(def->s_name),name)) 
-			return def;
-	}
-	return NULL;
+
+	i = PR_FindHashed (&pr_fieldhash, &pr_fielddefs->s_name, sizeof(ddef_t), name);
+	return i == -1 ? NULL : &pr_fielddefs[i];
 }
 
 
@@ -211,16 +310,10 @@ ED_FindGlobal
 */
 ddef_t *ED_FindGlobal (char *name)
 {
-	ddef_t		*def;
 	int			i;
-	
-	for (i=0 ; i<progs->numglobaldefs ; i++)
-	{
-		def = &pr_globaldefs[i];
-		if (!strcmp(PR_GetString(def->s_name),name)) 
-			return def;
-	}
-	return NULL;
+
+	i = PR_FindHashed (&pr_globalhash, &pr_globaldefs->s_name, sizeof(ddef_t), name);
+	return i == -1 ? NULL : &pr_globaldefs[i];
 }
 
 
@@ -231,44 +324,39 @@ ED_FindFunction
 */
 dfunction_t *ED_FindFunction (char *name)
 {
-	dfunction_t		*func;
-	int				i;
-	
-	for (i=0 ; i<progs->numfunctions ; i++)
-	{
-		func = &pr_functions[i];
-		if (!strcmp(PR_GetString(func->s_name),name) )
-			return func;
-	}
-	return NULL;
+	int			i;
+
+	i = PR_FindHashed (&pr_functionhash, &pr_functions->s_name, sizeof(dfunction_t), name);
+	return i == -1 ? NULL : &pr_functions[i];
 }
 
 
+/*
+============
+GetEdictFieldValue
+
+Engine lookups of optional fields, cached by name so the same handful of
+names resolve without touching the field hash after the first time
+============
+*/
 eval_t *GetEdictFieldValue(edict_t *ed, char *field)
 {
-	ddef_t			*def = NULL;
-	int				i;
-	static int		rep = 0;
+	ddef_t			*def;
+	gefv_cache		*cache;
 
-	for (i=0 ; i<GEFV_CACHESIZE ; i++)
+	cache = &gefvCache[PR_HashName(field) & (GEFV_CACHESIZE-1)];
+	if (!strcmp(field, cache->field))
+		def = cache->pcache;
+	else
 	{
-		if (!strcmp(field, gefvCache[i].field))
+		def = ED_FindField (field);
+		if (strlen(field) < MAX_FIELD_LEN)
 		{
-			def = gefvCache[i].pcache;
-			goto Done;
+			cache->pcache = def;
+			strcpy (cache->field, field);
 		}
 	}
 
-	def = ED_FindField (field);
-
-	if (strlen(field) < MAX_FIELD_LEN)
-	{
-		gefvCache[rep].pcache = def;
-		strcpy (gefvCache[rep].field, field);
-		rep ^= 1;
-	}
-
-Done:
 	if (!def)
 		return NULL;
 
@@ -603,6 +691,7 @@ void ED_Count (void)
 	Con_Printf ("view      :%3i\n", models);
 	Con_Printf ("touch     :%3i\n", solid);
 	Con_Printf ("step      :%3i\n", step);
+	PR_StringStats ();
 
 }
 
@@ -746,7 +835,7 @@ qboolean	ED_ParseEpair (void *base, ddef_t *key, char *s)
 	switch (key->type & ~DEF_SAVEGLOBAL)
 	{
 	case ev_string:
-		*(string_t *)d = ED_NewString (s);
+		ED_ReplaceString ((string_t *)d, ED_NewString (s));
 		break;
 		
 	case ev_float:
@@ -890,6 +979,9 @@ sprintf (com_token, "0 %s 0", temp);
 	if (!init)
 		ent->free = true;
 
+	SV_MarkEdictMoved (ent);
+	PR_FindIndexChanged (ent, -1);
+
 	return data;
 }
 
@@ -1021,12 +1113,8 @@ void PR_LoadProgs (void)
 
 	if (progs->ofs_strings + progs->numstrings >= com_filesize)
 		Host_Error ("progs.dat strings go past end of file\n");
-	pr_numknownstrings = 0;
-	pr_maxknownstrings = 0;
 	pr_stringssize = progs->numstrings;
-	if (pr_knownstrings)
-		Z_Free (pr_knownstrings);
-	pr_knownstrings = NULL;
+	PR_ClearStrings ();
 	PR_SetEngineString("");	// initialize the strings
 	pr_globaldefs = (ddef_t *)((byte *)progs + progs->ofs_globaldefs);
 	pr_fielddefs = (ddef_t *)((byte *)progs + progs->ofs_fielddefs);
@@ -1073,6 +1161,10 @@ void PR_LoadProgs (void)
 
 	for (i=0 ; i<progs->numglobals ; i++)
 		((int *)pr_globals)[i] = LittleLong (((int *)pr_globals)[i]);
+
+	PR_BuildHash (&pr_fieldhash, &pr_fielddefs->s_name, progs->numfielddefs, sizeof(ddef_t));
+	PR_BuildHash (&pr_globalhash, &pr_globaldefs->s_name, progs->numglobaldefs, sizeof(ddef_t));
+	PR_BuildHash (&pr_functionhash, &pr_functions->s_name, progs->numfunctions, sizeof(dfunction_t));
 	
 	pr_edict_size = progs->entityfields * 4 + sizeof(edict_t) - sizeof(entvars_t);
 	// round off to next highest whole word address (esp for Alpha)
@@ -1080,6 +1172,35 @@ void PR_LoadProgs (void)
 	// properly aligned
 	pr_edict_size += sizeof(void *) - 1;
 	pr_edict_size &= ~(sizeof(void *) - 1);
+
+	pr_fieldflags = Hunk_AllocName (progs->entityfields, "fieldflg");
+	for (i=0 ; i<3 ; i++)
+	{
+		pr_fieldflags[ED_FIELD(origin) + i] |= FIELD_SPATIAL;
+		pr_fieldflags[ED_FIELD(mins) + i] |= FIELD_SPATIAL;
+		pr_fieldflags[ED_FIELD(maxs) + i] |= FIELD_SPATIAL;
+	}
+	pr_fieldflags[ED_FIELD(solid)] |= FIELD_SPATIAL;
+	for (i=0 ; i<3 ; i++)
+	{
+		pr_fieldflags[ED_FIELD(size) + i] |= FIELD_CLIP;
+		pr_fieldflags[ED_FIELD(absmin) + i] |= FIELD_CLIP;
+		pr_fieldflags[ED_FIELD(absmax) + i] |= FIELD_CLIP;
+#ifdef QUAKE2
+		pr_fieldflags[ED_FIELD(angles) + i] |= FIELD_CLIP;
+#endif
+	}
+	pr_fieldflags[ED_FIELD(owner)] |= FIELD_CLIP;
+	pr_fieldflags[ED_FIELD(flags)] |= FIELD_CLIP;
+	pr_fieldflags[ED_FIELD(modelindex)] |= FIELD_CLIP;
+	pr_fieldflags[ED_FIELD(movetype)] |= FIELD_CLIP;
+	for (i=0 ; i<progs->numfielddefs ; i++)
+		if ((pr_fielddefs[i].type & ~DEF_SAVEGLOBAL) == ev_string)
+			pr_fieldflags[pr_fielddefs[i].ofs] |= FIELD_STRING;
+	PR_ClearFindIndexes ();
+
+	pr_verified = PR_VerifyProgs ();
+	PR_TranslateProgs ();
 }
 
 
@@ -1094,6 +1215,14 @@ void PR_Init (void)
 	Cmd_AddCommand ("edicts", ED_PrintEdicts);
 	Cmd_AddCommand ("edictcount", ED_Count);
 	Cmd_AddCommand ("profile", PR_Profile_f);
+	Cmd_AddCommand ("profile_start", PR_ProfileStart_f);
+	Cmd_AddCommand ("profile_stop", PR_ProfileStop_f);
+	Cmd_AddCommand ("profile_reset", PR_ProfileReset_f);
+	Cmd_AddCommand ("profile_dump", PR_ProfileDump_f);
+	Cvar_RegisterVariable (&pr_threaded);
+	Cvar_RegisterVariable (&pr_checked);
+	Cvar_RegisterVariable (&pr_peephole);
+	Cvar_RegisterVariable (&pr_findindex);
 	Cvar_RegisterVariable (&nomonsters);
 	Cvar_RegisterVariable (&gamecfg);
 	Cvar_RegisterVariable (&scratch1);
@@ -1128,13 +1257,136 @@ int NUM_FOR_EDICT(edict_t *e)
 	return b;
 }
 
-#define	PR_STRING_ALLOCSLOTS	256
+/*
+==============================================================================
+
+					ENGINE STRINGS
+
+Strings that don't live in the progs string table are handed to QuakeC as
+negative numbers indexing pr_knownstrings.  Every slot is also chained into
+a hash keyed on the string's address, so registering a pointer that the
+progs have already seen doesn't have to walk the whole table.  Released
+slots go onto a free list threaded through the same links.
+
+The slots live on the hunk with the progs.  Running out moves them to a
+block twice the size; the old one is only given back with the rest of the
+level, which keeps them out of the zone.
+==============================================================================
+*/
+
+#define	PR_STRING_SLOTS			2048	// to start with, at progs load
+#define	PR_STRING_HASHSIZE		1024	// must be a power of two
+
+#define	PR_TEMPSTRINGS			16		// ftos/vtos results that stay valid at once
+#define	PR_TEMPSTRINGLEN		128
+
+// PR_AllocString storage comes from the hunk in power of two sizes, and freed
+// strings go on a list for their size to be handed out again.  The zone is
+// far too small for a map's worth of entity strings
+#define	PR_STRING_MINSIZE		16
+#define	PR_STRING_SIZES			16		// up to 512k
+
+typedef struct knownstring_s
+{
+	char	*string;
+	int		next;		// hash chain or free list link
+	byte	alloced;	// size + 1 of the PR_AllocString storage, 0 if not one
+	byte	unused;		// marked for PR_SweepStrings
+} knownstring_t;
+
+static char		*pr_freestrings[PR_STRING_SIZES];	// linked through their first bytes
+static int		pr_knownhash[PR_STRING_HASHSIZE];	// first slot + 1, 0 = empty
+static int		pr_freeknownstrings;				// first free slot + 1, 0 = none
+
+static char		pr_tempstrings[PR_TEMPSTRINGS][PR_TEMPSTRINGLEN];
+static int		pr_tempstringnum;	// next buffer to hand out
+static int		pr_tempstringgen;	// number of times the ring has wrapped
+
+static struct
+{
+	int		lookups;		// PR_SetEngineString calls outside pr_strings
+	int		found;			// ... that matched an existing slot
+	int		allocs;			// PR_AllocString calls
+	int		allocbytes;
+	int		frees;
+	int		reused;			// slots taken from the free list
+	int		recycled;		// PR_AllocString storage taken from pr_freestrings
+	int		sweeps;			// PR_SweepStrings passes
+	int		temps;			// temp strings handed out
+} pr_stringstats;
+
+static void PR_AllocStringSlots (int count)
+{
+	knownstring_t	*slots;
+
+	Con_DPrintf("PR_AllocStringSlots: %i slots\n", count);
+	slots = (knownstring_t *)Hunk_AllocName (count * sizeof(knownstring_t), "prstring");
+	if (pr_numknownstrings)
+		memcpy (slots, pr_knownstrings, pr_numknownstrings * sizeof(knownstring_t));
+	pr_knownstrings = slots;
+	pr_maxknownstrings = count;
+}
+
+static int PR_HashPointer (const char *s)
+{
+	unsigned	h;
+
+	h = (unsigned)(size_t)s ^ (unsigned)((size_t)s >> 16);
+	return (h * 2654435761u >> 16) & (PR_STRING_HASHSIZE-1);
+}
+
+/*
+================
+PR_ClearStrings
+
+Forgets every engine string; called when new progs are loaded
+================
+*/
+static void PR_ClearStrings (void)
+{
+	pr_numknownstrings = 0;
+	PR_AllocStringSlots (PR_STRING_SLOTS);
+	memset (pr_freestrings, 0, sizeof(pr_freestrings));	// they went with the hunk
+	pr_stringserial++;
+	pr_freeknownstrings = 0;
+	memset (pr_knownhash, 0, sizeof(pr_knownhash));
+	memset (&pr_stringstats, 0, sizeof(pr_stringstats));
+	pr_tempstringnum = 0;
+	pr_tempstringgen = 0;
+}
+
+/*
+================
+PR_NewStringSlot
 
-static void PR_AllocStringSlots (void)
+Returns an unused slot holding s, hashed by address
+================
+*/
+static int PR_NewStringSlot (char *s)
 {
-	pr_maxknownstrings += PR_STRING_ALLOCSLOTS;
-	Con_DPrintf("PR_AllocStringSlots: realloc'ing for slots\n", pr_maxknownstrings);
-	pr_knownstrings = (char **) Z_Realloc (pr_knownstrings, pr_maxknownstrings * sizeof(char *));
+	int		i, h;
+
+	if (pr_freeknownstrings)
+	{
+		i = pr_freeknownstrings - 1;
+		pr_freeknownstrings = pr_knownstrings[i].next;
+		pr_stringstats.reused++;
+	}
+	else
+	{
+		i = pr_numknownstrings;
+		if (i >= pr_maxknownstrings)
+			PR_AllocStringSlots (pr_maxknownstrings * 2);
+		pr_numknownstrings++;
+	}
+
+	h = PR_HashPointer (s);
+	pr_knownstrings[i].string = s;
+	pr_knownstrings[i].alloced = 0;
+	pr_knownstrings[i].unused = false;
+	pr_knownstrings[i].next = pr_knownhash[h];
+	pr_knownhash[h] = i + 1;
+	return i;
 }
 
 char *PR_GetString (int num)
@@ -1143,12 +1395,12 @@ char *PR_GetString (int num)
 		return pr_strings + num;
 	else if (num < 0 && num >= -pr_numknownstrings)
 	{
-		if (!pr_knownstrings[-1 - num])
+		if (!pr_knownstrings[-1 - num].string)
 		{
 			Host_Error ("PR_GetString: attempt to get a non-existant string %d\n", num);
 			return "";
 		}
-		return pr_knownstrings[-1 - num];
+		return pr_knownstrings[-1 - num].string;
 	}
 	else
 	{
@@ -1170,49 +1422,318 @@ int PR_SetEngineString (char *s)
 	if (s >= pr_strings && s <= pr_strings + pr_stringssize - 2)
 		return (int)(s - pr_strings);
 #endif
-	for (i = 0; i < pr_numknownstrings; i++)
+	pr_stringstats.lookups++;
+	for (i = pr_knownhash[PR_HashPointer (s)] ; i ; i = pr_knownstrings[i - 1].next)
 	{
-		if (pr_knownstrings[i] == s)
-			return -1 - i;
+		if (pr_knownstrings[i - 1].string == s)
+		{
+			pr_stringstats.found++;
+			return -i;
+		}
 	}
 	// new unknown engine string
 	//Con_DPrintf ("PR_SetEngineString: new engine string %p\n", s);
-#if 0
-	for (i = 0; i < pr_numknownstrings; i++)
-	{
-		if (!pr_knownstrings[i])
-			break;
-	}
-#endif
-//	if (i >= pr_numknownstrings)
-//	{
-		if (i >= pr_maxknownstrings)
-			PR_AllocStringSlots();
-		pr_numknownstrings++;
-//	}
-	pr_knownstrings[i] = s;
-	return -1 - i;
+	return -1 - PR_NewStringSlot (s);
 }
 
 int PR_AllocString (int size, char **ptr)
 {
-	int		i;
+	int		i, c;
+	char	*s;
 
 	if (!size)
 		return 0;
-	for (i = 0; i < pr_numknownstrings; i++)
+	for (c = 0 ; (PR_STRING_MINSIZE << c) < size ; c++)
+		if (c == PR_STRING_SIZES - 1)
+			Host_Error ("PR_AllocString: %i bytes is too long\n", size);
+
+	s = pr_freestrings[c];
+	if (s)
 	{
-		if (!pr_knownstrings[i])
-			break;
+		pr_freestrings[c] = *(char **)s;
+		memset (s, 0, PR_STRING_MINSIZE << c);
+		pr_stringstats.recycled++;
 	}
-//	if (i >= pr_numknownstrings)
-//	{
-		if (i >= pr_maxknownstrings)
-			PR_AllocStringSlots();
-		pr_numknownstrings++;
-//	}
-	pr_knownstrings[i] = (char *)Hunk_AllocName(size, "string");
+	else
+		s = (char *)Hunk_AllocName (PR_STRING_MINSIZE << c, "string");
+
+	i = PR_NewStringSlot (s);
+	pr_knownstrings[i].alloced = c + 1;
+	pr_stringstats.allocs++;
+	pr_stringstats.allocbytes += size;
 	if (ptr)
-		*ptr = pr_knownstrings[i];
+		*ptr = pr_knownstrings[i].string;
 	return -1 - i;
 }
+
+/*
+================
+PR_FreeString
+
+Releases an engine string slot for reuse.  The storage of a PR_AllocString
+string goes back to the pool, other memory belongs to whoever registered it.
+The caller has to know nothing refers to num any more; PR_SweepStrings
+checks that first.
+================
+*/
+void PR_FreeString (int num)
+{
+	int		i, c, *link;
+
+	if (num >= 0)
+		return;		// progs strings are never freed
+	i = -1 - num;
+	if (i >= pr_numknownstrings || !pr_knownstrings[i].string)
+		Host_Error ("PR_FreeString: invalid string %d\n", num);
+
+	for (link = &pr_knownhash[PR_HashPointer (pr_knownstrings[i].string)] ; *link ; link = &pr_knownstrings[*link - 1].next)
+	{
+		if (*link == i + 1)
+		{
+			*link = pr_knownstrings[i].next;
+			break;
+		}
+	}
+	if (pr_knownstrings[i].alloced)
+	{
+		c = pr_knownstrings[i].alloced - 1;
+		*(char **)pr_knownstrings[i].string = pr_freestrings[c];
+		pr_freestrings[c] = pr_knownstrings[i].string;
+		pr_knownstrings[i].alloced = 0;
+	}
+	pr_knownstrings[i].string = NULL;
+	pr_knownstrings[i].next = pr_freeknownstrings;
+	pr_freeknownstrings = i + 1;
+	pr_stringstats.frees++;
+	pr_stringserial++;
+}
+
+/*
+================
+PR_KeepString
+
+Takes num off the candidates if it is one
+================
+*/
+static void PR_KeepString (int num)
+{
+	if (num < 0 && -1 - num < pr_numknownstrings)
+		pr_knownstrings[-1 - num].unused = false;
+}
+
+/*
+================
+PR_KeepPointer
+
+Takes the string at s off the candidates if it is one
+================
+*/
+static void PR_KeepPointer (char *s)
+{
+	int		i;
+
+	if (!s)
+		return;
+	for (i = pr_knownhash[PR_HashPointer (s)] ; i ; i = pr_knownstrings[i - 1].next)
+		if (pr_knownstrings[i - 1].string == s)
+			pr_knownstrings[i - 1].unused = false;
+}
+
+/*
+================
+PR_MarkString
+
+Makes num a candidate for PR_SweepStrings if it is a PR_AllocString string
+================
+*/
+static qboolean PR_MarkString (int num)
+{
+	num = -1 - num;
+	if (num < 0 || num >= pr_numknownstrings || !pr_knownstrings[num].alloced)
+		return false;
+	pr_knownstrings[num].unused = true;
+	return true;
+}
+
+/*
+================
+PR_SweepStrings
+
+Frees the marked strings that nothing but skip refers to.  QuakeC copies
+string numbers about freely, so every global, the locals saved by running
+functions, every other edict's fields and the precache and lightstyle names
+the server keeps pointers to are all looked at first, and anything that
+could be a reference keeps its string.
+================
+*/
+static void PR_SweepStrings (edict_t *skip)
+{
+	int		i, j, *v;
+	edict_t	*ed;
+
+	pr_stringstats.sweeps++;
+
+	v = (int *)pr_globals;
+	for (i=0 ; i<progs->numglobals ; i++)
+		PR_KeepString (v[i]);
+	for (i=0 ; i<localstack_used ; i++)
+		PR_KeepString (localstack[i]);
+	for (j=0 ; j<sv.num_edicts ; j++)
+	{
+		ed = EDICT_NUM(j);
+		if (ed == skip)
+			continue;
+		v = (int *)&ed->v;
+		for (i=0 ; i<progs->entityfields ; i++)
+			PR_KeepString (v[i]);
+	}
+	for (i=0 ; i<MAX_MODELS ; i++)
+		PR_KeepPointer (sv.model_precache[i]);
+	for (i=0 ; i<MAX_SOUNDS ; i++)
+		PR_KeepPointer (sv.sound_precache[i]);
+	for (i=0 ; i<MAX_LIGHTSTYLES ; i++)
+		PR_KeepPointer (sv.lightstyles[i]);
+
+	for (i=0 ; i<pr_numknownstrings ; i++)
+	{
+		if (!pr_knownstrings[i].unused)
+			continue;
+		pr_knownstrings[i].unused = false;
+		PR_FreeString (-1 - i);
+	}
+}
+
+/*
+================
+ED_ReleaseStrings
+
+Frees the strings of an edict's fields that nothing else refers to.  Called
+as the edict is cleared for reuse rather than as it is freed, as QuakeC
+often still reads the fields of an edict it has just removed.
+================
+*/
+static void ED_ReleaseStrings (edict_t *ed)
+{
+	int			i, *v;
+	qboolean	marked;
+
+	v = (int *)&ed->v;
+	marked = false;
+	for (i=0 ; i<progs->entityfields ; i++)
+		if ((pr_fieldflags[i] & FIELD_STRING) && v[i] < 0 && PR_MarkString (v[i]))
+			marked = true;
+	if (marked)
+		PR_SweepStrings (ed);
+}
+
+/*
+================
+ED_ReplaceString
+
+Stores num in a string field or global, freeing what was there if nothing
+else refers to it
+================
+*/
+static void ED_ReplaceString (string_t *d, string_t num)
+{
+	string_t	old;
+
+	old = *d;
+	*d = num;
+	if (old < 0 && old != num && PR_MarkString (old))
+		PR_SweepStrings (NULL);
+}
+
+/*
+================
+PR_CollectStrings
+================
+*/
+void PR_CollectStrings (void)
+{
+	int			i;
+	qboolean	marked;
+
+	marked = false;
+	for (i=0 ; i<pr_numknownstrings ; i++)
+		if (PR_MarkString (-1 - i))
+			marked = true;
+	if (marked)
+		PR_SweepStrings (NULL);
+}
+
+/*
+================
+PR_IsConstantString
+
+True if num names text that can't change while the progs are loaded: the
+progs string table or a PR_AllocString copy.  Engine strings point at
+buffers their owners may rewrite, and bad numbers are never constant.
+================
+*/
+qboolean PR_IsConstantString (int num)
+{
+	if (num >= 0)
+		return num < pr_stringssize;
+	num = -1 - num;
+	return num < pr_numknownstrings && pr_knownstrings[num].string && pr_knownstrings[num].alloced;
+}
+
+/*
+================
+PR_TempString
+
+Hands out the next buffer of a small ring for builtins like ftos and vtos
+that return freshly formatted text.  The buffers are static, so their slots
+are registered once and stay valid; a result is only overwritten after
+PR_TEMPSTRINGS more temp strings have been made.
+================
+*/
+int PR_TempString (char **ptr)
+{
+	char	*s;
+
+	s = pr_tempstrings[pr_tempstringnum];
+	if (++pr_tempstringnum == PR_TEMPSTRINGS)
+	{
+		pr_tempstringnum = 0;
+		pr_tempstringgen++;
+	}
+	pr_stringstats.temps++;
+	*ptr = s;
+	return PR_SetEngineString (s);
+}
+
+/*
+================
+PR_StringStats
+
+Prints engine string table usage, for edictcount
+================
+*/
+void PR_StringStats (void)
+{
+	int		i, used, chains, longest, len, j;
+
+	used = chains = longest = 0;
+	for (i=0 ; i<pr_numknownstrings ; i++)
+		if (pr_knownstrings[i].string)
+			used++;
+	for (i=0 ; i<PR_STRING_HASHSIZE ; i++)
+	{
+		if (!pr_knownhash[i])
+			continue;
+		chains++;
+		for (len = 0, j = pr_knownhash[i] ; j ; j = pr_knownstrings[j - 1].next)
+			len++;
+		if (len > longest)
+			longest = len;
+	}
+
+	Con_Printf ("strings   :%3i slots, %i in use, %i hash chains (longest %i)\n", pr_numknownstrings, used, chains, longest);
+	Con_Printf ("lookups   :%3i, %i found, %i new\n", pr_stringstats.lookups, pr_stringstats.found, pr_stringstats.lookups - pr_stringstats.found);
+	Con_Printf ("allocated :%3i strings, %i bytes\n", pr_stringstats.allocs, pr_stringstats.allocbytes);
+	Con_Printf ("freed     :%3i slots, %i reused, %i strings recycled, %i sweeps\n", pr_stringstats.frees,
+		pr_stringstats.reused, pr_stringstats.recycled, pr_stringstats.sweeps);
+	Con_Printf ("temp      :%3i strings, generation %i\n", pr_stringstats.temps, pr_tempstringgen);
+}
@@ -47,6 +47,19 @@ int			pr_xstatement;
 
 int		pr_argc;
 
+cvar_t	pr_threaded = {"pr_threaded", "1"};	// 0 = classic switch interpreter
+
+cvar_t	pr_peephole = {"pr_peephole", "1"};	// fuse statement pairs at load
+
+prinstr_t	*pr_code;			// pre-decoded copy of pr_statements
+int			pr_numcode;
+int			*pr_codemap;
+
+// progs are taking the address of an entity field to store through it
+#define	FIELD_STORE(ed,field)	\
+	if ((unsigned)(field) < (unsigned)progs->entityfields && pr_fieldflags[field])	\
+		ED_FieldStored (ed, field)
+
 char *pr_opnames[] =
 {
 "DONE",
@@ -217,6 +230,7 @@ void PR_StackTrace (void)
 ============
 PR_Profile_f
 
+Counts are statements on the checked path and calls on the fast one
 ============
 */
 void PR_Profile_f (void)
@@ -226,6 +240,9 @@ void PR_Profile_f (void)
 	int			num;
 	int			i;
 	
+	if (pr_threaded.value && pr_code && pr_verified && !pr_checked.value)
+		Con_Printf ("counting calls; pr_checked 1 counts statements, profile_start times them\n");
+
 	num = 0;	
 	do
 	{
@@ -251,6 +268,392 @@ void PR_Profile_f (void)
 }
 
 
+/*
+============================================================================
+
+HIERARCHICAL PROFILER
+
+While profile_start is in effect every QuakeC function and builtin call
+is timed with Sys_FloatTime and recorded in a calling context tree: one
+node per distinct call path, so self and inclusive time, caller/callee
+edges and full stacks for flame graphs can all be recovered from it.
+When it is off the only cost is a test of pr_profiling on function entry,
+exit and builtin calls.
+============================================================================
+*/
+
+#define	MAX_PROF_NODES		8192
+#define	PROF_HASH_SIZE		4096	// must be a power of two
+
+typedef struct
+{
+	int		func;			// index into pr_functions, -1 for the overflow node
+	int		parent;			// node index, -1 for a root
+	int		hashnext;
+	int		calls;
+	double	total;			// inclusive time
+	double	self;
+} prprofnode_t;
+
+typedef struct
+{
+	int		node;
+	double	start;
+	double	child;			// time spent in callees
+} prprofframe_t;
+
+static qboolean	pr_profiling;
+
+static prprofnode_t		pr_profnodes[MAX_PROF_NODES];
+static int				pr_numprofnodes;
+static int				pr_profhash[PROF_HASH_SIZE];
+static prprofframe_t	pr_profstack[MAX_STACK_DEPTH+2];
+static int				pr_profdepth;
+static double			pr_profstart;		// when the current run began
+static double			pr_proftime;		// wall clock time of earlier runs
+static unsigned short	pr_profcrc;			// progs the nodes refer to
+
+/*
+============
+PR_ProfileClear
+============
+*/
+static void PR_ProfileClear (void)
+{
+	int		i;
+
+	for (i=0 ; i<PROF_HASH_SIZE ; i++)
+		pr_profhash[i] = -1;
+
+// node 0 collects everything that didn't fit
+	memset (&pr_profnodes[0], 0, sizeof(pr_profnodes[0]));
+	pr_profnodes[0].func = -1;
+	pr_profnodes[0].parent = -1;
+	pr_numprofnodes = 1;
+
+	pr_profdepth = 0;
+	pr_proftime = 0;
+	pr_profstart = Sys_FloatTime ();
+	pr_profcrc = pr_crc;
+}
+
+/*
+============
+PR_ProfileNode
+
+Finds or creates the node for func called from parent
+============
+*/
+static int PR_ProfileNode (int parent, int func)
+{
+	int				h, n;
+	prprofnode_t	*node;
+
+	h = (parent * 31 + func) & (PROF_HASH_SIZE-1);
+	for (n = pr_profhash[h] ; n != -1 ; n = pr_profnodes[n].hashnext)
+	{
+		node = &pr_profnodes[n];
+		if (node->func == func && node->parent == parent)
+			return n;
+	}
+
+	if (pr_numprofnodes == MAX_PROF_NODES)
+		return 0;
+
+	n = pr_numprofnodes++;
+	node = &pr_profnodes[n];
+	memset (node, 0, sizeof(*node));
+	node->func = func;
+	node->parent = parent;
+	node->hashnext = pr_profhash[h];
+	pr_profhash[h] = n;
+	return n;
+}
+
+/*
+============
+PR_ProfileEnter
+============
+*/
+static void PR_ProfileEnter (int func)
+{
+	prprofframe_t	*frame;
+	int				parent;
+
+	if (pr_profdepth >= MAX_STACK_DEPTH+2)
+		return;
+
+	parent = pr_profdepth ? pr_profstack[pr_profdepth-1].node : -1;
+	frame = &pr_profstack[pr_profdepth++];
+	frame->node = PR_ProfileNode (parent, func);
+	frame->child = 0;
+	pr_profnodes[frame->node].calls++;
+	frame->start = Sys_FloatTime ();
+}
+
+/*
+============
+PR_ProfileLeave
+============
+*/
+static void PR_ProfileLeave (void)
+{
+	prprofframe_t	*frame;
+	prprofnode_t	*node;
+	double			elapsed;
+
+	if (pr_profdepth <= 0)
+		return;
+
+	frame = &pr_profstack[--pr_profdepth];
+	elapsed = Sys_FloatTime () - frame->start;
+	node = &pr_profnodes[frame->node];
+	node->total += elapsed;
+	node->self += elapsed - frame->child;
+	if (pr_profdepth)
+		pr_profstack[pr_profdepth-1].child += elapsed;
+}
+
+/*
+============
+PR_ProfileFuncName
+============
+*/
+static char *PR_ProfileFuncName (int func)
+{
+	if (func < 0 || !progs || func >= progs->numfunctions)
+		return "(truncated)";
+	return PR_GetString(pr_functions[func].s_name);
+}
+
+/*
+============
+PR_ProfileStart_f
+============
+*/
+void PR_ProfileStart_f (void)
+{
+	if (pr_profiling)
+	{
+		Con_Printf ("QuakeC profiler already running\n");
+		return;
+	}
+	if (pr_numprofnodes <= 1 || pr_profcrc != pr_crc)
+		PR_ProfileClear ();
+	pr_profdepth = 0;
+	pr_profstart = Sys_FloatTime ();
+	pr_profiling = true;
+	Con_Printf ("QuakeC profiler started\n");
+}
+
+/*
+============
+PR_ProfileStop_f
+============
+*/
+void PR_ProfileStop_f (void)
+{
+	if (!pr_profiling)
+	{
+		Con_Printf ("QuakeC profiler not running\n");
+		return;
+	}
+	pr_profiling = false;
+	pr_proftime += Sys_FloatTime () - pr_profstart;
+	Con_Printf ("QuakeC profiler stopped after %.1f seconds\n", pr_proftime);
+}
+
+/*
+============
+PR_ProfileReset_f
+============
+*/
+void PR_ProfileReset_f (void)
+{
+	PR_ProfileClear ();
+	Con_Printf ("QuakeC profiler reset\n");
+}
+
+typedef struct
+{
+	int		calls;
+	double	self;
+	double	total;		// not counting recursive calls twice
+} prproffunc_t;
+
+/*
+============
+PR_ProfileGather
+
+Sums the call tree per function into a temp array
+============
+*/
+static prproffunc_t *PR_ProfileGather (void)
+{
+	prproffunc_t	*funcs;
+	prprofnode_t	*node;
+	int				i, p;
+
+	funcs = Hunk_TempAlloc (progs->numfunctions * sizeof(*funcs));
+	memset (funcs, 0, progs->numfunctions * sizeof(*funcs));
+
+	for (i=1, node=pr_profnodes+1 ; i<pr_numprofnodes ; i++, node++)
+	{
+		if (node->func >= progs->numfunctions)
+			continue;
+		funcs[node->func].calls += node->calls;
+		funcs[node->func].self += node->self;
+
+	// only the outermost activation counts toward inclusive time
+		for (p = node->parent ; p != -1 ; p = pr_profnodes[p].parent)
+			if (pr_profnodes[p].func == node->func)
+				break;
+		if (p == -1)
+			funcs[node->func].total += node->total;
+	}
+	return funcs;
+}
+
+/*
+============
+PR_ProfileWriteStack
+
+Writes the semicolon separated call path of a node
+============
+*/
+static void PR_ProfileWriteStack (FILE *f, int n)
+{
+	if (pr_profnodes[n].parent != -1)
+	{
+		PR_ProfileWriteStack (f, pr_profnodes[n].parent);
+		fprintf (f, ";");
+	}
+	fprintf (f, "%s", PR_ProfileFuncName (pr_profnodes[n].func));
+}
+
+/*
+============
+PR_ProfileDump_f
+
+profile_dump				top functions to the console
+profile_dump <file>			csv of functions and call edges
+profile_dump <file> folded	folded stacks for flamegraph tools
+============
+*/
+void PR_ProfileDump_f (void)
+{
+	prproffunc_t	*funcs, *best;
+	prprofnode_t	*node;
+	char			name[MAX_OSPATH];
+	double			elapsed;
+	FILE			*f;
+	int				i, j, num;
+
+	if (!progs || pr_profcrc != pr_crc || pr_numprofnodes <= 1)
+	{
+		Con_Printf ("No QuakeC profile data\n");
+		return;
+	}
+
+	elapsed = pr_proftime;
+	if (pr_profiling)
+		elapsed += Sys_FloatTime () - pr_profstart;
+
+	funcs = PR_ProfileGather ();
+
+	if (Cmd_Argc() < 2)
+	{
+		Con_Printf ("%.1f seconds profiled, %i call paths\n", elapsed, pr_numprofnodes - 1);
+		Con_Printf ("   incl ms    self ms    calls function\n");
+		for (num=0 ; num<20 ; num++)
+		{
+			best = NULL;
+			for (i=0 ; i<progs->numfunctions ; i++)
+				if (funcs[i].calls && (!best || funcs[i].total > best->total))
+					best = &funcs[i];
+			if (!best)
+				break;
+			Con_Printf ("%10.2f %10.2f %8i %s%s\n", best->total*1000, best->self*1000,
+				best->calls, PR_ProfileFuncName (best - funcs),
+				pr_functions[best - funcs].first_statement < 0 ? " (builtin)" : "");
+			best->calls = 0;
+		}
+		return;
+	}
+
+	if (strstr(Cmd_Argv(1), ".."))
+	{
+		Con_Printf ("Relative pathnames are not allowed.\n");
+		return;
+	}
+	snprintf (name, sizeof(name), "%s/%s", com_gamedir, Cmd_Argv(1));
+	f = fopen (name, "w");
+	if (!f)
+	{
+		Con_Printf ("ERROR: couldn't open %s.\n", name);
+		return;
+	}
+
+	if (Cmd_Argc() > 2 && !Q_strcasecmp(Cmd_Argv(2), "folded"))
+	{	// one line per call path, weighted by self time in microseconds
+		for (i=0, node=pr_profnodes ; i<pr_numprofnodes ; i++, node++)
+		{
+			num = (int)(node->self * 1000000 + 0.5);
+			if (num <= 0)
+				continue;
+			PR_ProfileWriteStack (f, i);
+			fprintf (f, " %i\n", num);
+		}
+	}
+	else
+	{
+		fprintf (f, "function,file,builtin,calls,self_ms,inclusive_ms\n");
+		for (i=0 ; i<progs->numfunctions ; i++)
+		{
+			if (!funcs[i].calls)
+				continue;
+			fprintf (f, "%s,%s,%i,%i,%.3f,%.3f\n", PR_ProfileFuncName (i),
+				PR_GetString(pr_functions[i].s_file), pr_functions[i].first_statement < 0,
+				funcs[i].calls, funcs[i].self*1000, funcs[i].total*1000);
+		}
+
+	// call edges, summed over every path that has the same caller and callee
+		fprintf (f, "\ncaller,callee,calls,inclusive_ms\n");
+		for (i=1, node=pr_profnodes+1 ; i<pr_numprofnodes ; i++, node++)
+		{
+			prprofnode_t	*other;
+			int				calls;
+			double			total;
+
+			if (node->parent == -1 || node->calls < 0)
+				continue;
+			calls = 0;
+			total = 0;
+			for (j=i, other=node ; j<pr_numprofnodes ; j++, other++)
+			{
+				if (other->func != node->func || other->parent == -1 || other->calls < 0)
+					continue;
+				if (pr_profnodes[other->parent].func != pr_profnodes[node->parent].func)
+					continue;
+				calls += other->calls;
+				total += other->total;
+				if (other != node)
+					other->calls = -1 - other->calls;	// mark as printed
+			}
+			fprintf (f, "%s,%s,%i,%.3f\n", PR_ProfileFuncName (pr_profnodes[node->parent].func),
+				PR_ProfileFuncName (node->func), calls, total*1000);
+		}
+	// unmark
+		for (i=1, node=pr_profnodes+1 ; i<pr_numprofnodes ; i++, node++)
+			if (node->calls < 0)
+				node->calls = -1 - node->calls;
+	}
+
+	fclose (f);
+	Con_Printf ("Wrote %s\n", name);
+}
+
+
 /*
 ============
 PR_RunError
@@ -272,6 +675,7 @@ void PR_RunError (char *error, ...)
 	Con_Printf ("%s\n", string);
 	
 	pr_depth = 0;		// dump the stack so host_error can shutdown functions
+	pr_profdepth = 0;
 
 	Host_Error ("Program error");
 }
@@ -322,6 +726,14 @@ int PR_EnterFunction (dfunction_t *f)
 	}
 
 	pr_xfunction = f;
+
+	if (pr_profiling)
+	{
+		if (pr_depth == 1)
+			pr_profdepth = 0;	// top level call, forget anything an error left behind
+		PR_ProfileEnter (f - pr_functions);
+	}
+
 	return f->first_statement - 1;	// offset the s++
 }
 
@@ -337,6 +749,9 @@ int PR_LeaveFunction (void)
 	if (pr_depth <= 0)
 		Sys_Error ("prog stack underflow");
 
+	if (pr_profiling)
+		PR_ProfileLeave ();
+
 // restore locals from the stack
 	c = pr_xfunction->locals;
 	localstack_used -= c;
@@ -353,6 +768,990 @@ int PR_LeaveFunction (void)
 }
 
 
+/*
+============================================================================
+
+VERIFIER
+
+Run once at load.  A progs that passes has every statement operand inside
+pr_globals, every branch landing inside the function it was taken from,
+no function falling off its end, and its field definitions and the field
+operands of every load and address inside the entity.  With that known
+the threaded interpreter can run without the runaway, profile and trace
+bookkeeping on every instruction; pr_checked 1 keeps it for development.
+============================================================================
+*/
+
+qboolean	pr_verified;
+
+cvar_t	pr_checked = {"pr_checked", "0"};	// 1 = per-statement runaway/profile/trace checks
+
+#define	MAX_VERIFY_REPORTS	8
+
+// words read or written through operands a, b and c, 0 if unused
+static byte	pr_opwidths[OP_BITOR+1][3] =
+{
+	{3,0,0},											// DONE
+	{1,1,1}, {3,3,1}, {1,3,3}, {3,1,3},					// MUL_F MUL_V MUL_FV MUL_VF
+	{1,1,1},											// DIV_F
+	{1,1,1}, {3,3,3},									// ADD_F ADD_V
+	{1,1,1}, {3,3,3},									// SUB_F SUB_V
+	{1,1,1}, {3,3,1}, {1,1,1}, {1,1,1}, {1,1,1},		// EQ_*
+	{1,1,1}, {3,3,1}, {1,1,1}, {1,1,1}, {1,1,1},		// NE_*
+	{1,1,1}, {1,1,1}, {1,1,1}, {1,1,1},					// LE GE LT GT
+	{1,1,1}, {1,1,3}, {1,1,1}, {1,1,1}, {1,1,1}, {1,1,1},	// LOAD_*
+	{1,1,1},											// ADDRESS
+	{1,1,0}, {3,3,0}, {1,1,0}, {1,1,0}, {1,1,0}, {1,1,0},	// STORE_*
+	{1,1,0}, {3,1,0}, {1,1,0}, {1,1,0}, {1,1,0}, {1,1,0},	// STOREP_*
+	{3,0,0},											// RETURN
+	{1,0,1}, {3,0,1}, {1,0,1}, {1,0,1}, {1,0,1},		// NOT_*
+	{1,0,0}, {1,0,0},									// IF IFNOT, b is the branch
+	{1,0,0}, {1,0,0}, {1,0,0}, {1,0,0}, {1,0,0},		// CALL0-4
+	{1,0,0}, {1,0,0}, {1,0,0}, {1,0,0},					// CALL5-8
+	{1,1,0},											// STATE
+	{0,0,0},											// GOTO, a is the branch
+	{1,1,1}, {1,1,1},									// AND OR
+	{1,1,1}, {1,1,1}									// BITAND BITOR
+};
+
+static int	pr_verifyerrors;
+
+/*
+====================
+PR_VerifyError
+====================
+*/
+static void PR_VerifyError (char *fmt, ...)
+{
+	va_list		argptr;
+	char		string[1024];
+
+	if (pr_verifyerrors++ >= MAX_VERIFY_REPORTS)
+		return;
+	va_start (argptr,fmt);
+	vsprintf (string,fmt,argptr);
+	va_end (argptr);
+	Con_Printf ("progs.dat: %s\n", string);
+}
+
+/*
+====================
+PR_VerifyProgs
+
+Returns true if the progs can run on the unchecked path
+====================
+*/
+qboolean PR_VerifyProgs (void)
+{
+	int				i, j, n, first, end, target;
+	int				numstatements, numglobals, mark;
+	short			*ops;
+	dstatement_t	*st;
+	dfunction_t		*f;
+	ddef_t			*def;
+	byte			*starts, *written;
+
+	pr_verifyerrors = 0;
+	numstatements = progs->numstatements;
+	numglobals = progs->numglobals;
+
+	if (numglobals < OFS_PARM7 + 3)
+		PR_VerifyError ("only %i globals", numglobals);
+	if (progs->entityfields < (int)(sizeof(entvars_t)/4))
+		PR_VerifyError ("only %i entity fields", progs->entityfields);
+
+	mark = Hunk_HighMark ();
+	starts = Hunk_HighAllocName (numstatements + 1 + numglobals, "verify");
+	starts[0] = 1;		// anything before the first function
+
+	for (i=0, f=pr_functions ; i<progs->numfunctions ; i++, f++)
+	{
+		if (f->first_statement < 0)
+			continue;		// builtins are checked when they're called
+		if (f->first_statement >= numstatements)
+		{
+			PR_VerifyError ("function %i starts past the last statement", i);
+			continue;
+		}
+		starts[f->first_statement] = 1;
+		if (f->parm_start < 0 || f->locals < 0 || f->parm_start + f->locals > numglobals)
+			PR_VerifyError ("function %i locals out of range", i);
+		if (f->numparms < 0 || f->numparms > MAX_PARMS)
+		{
+			PR_VerifyError ("function %i has %i parms", i, f->numparms);
+			continue;
+		}
+		for (j=n=0 ; j<f->numparms ; j++)
+		{
+			if (f->parm_size[j] > 3)
+				PR_VerifyError ("function %i parm %i is %i words", i, j, f->parm_size[j]);
+			n += f->parm_size[j];
+		}
+		if (f->parm_start + n > numglobals)
+			PR_VerifyError ("function %i parms out of range", i);
+	}
+
+	first = end = 0;
+	for (i=0, st=pr_statements ; i<numstatements ; i++, st++)
+	{
+	// find the extent of the function this statement is in
+		if (starts[i])
+		{
+			first = i;
+			for (end=i+1 ; end<numstatements && !starts[end] ; end++)
+				;
+		}
+
+		if (st->op > OP_BITOR)
+		{
+			PR_VerifyError ("statement %i has bad opcode %i", i, st->op);
+			continue;
+		}
+
+		ops = &st->a;
+		for (j=0 ; j<3 ; j++)
+		{
+			n = pr_opwidths[st->op][j];
+			if (n && (unsigned short)ops[j] + n > numglobals)
+				PR_VerifyError ("statement %i (%s) operand %i out of range", i, pr_opnames[st->op], (unsigned short)ops[j]);
+		}
+
+		if (st->op == OP_GOTO)
+			target = i + st->a;
+		else if (st->op == OP_IF || st->op == OP_IFNOT)
+			target = i + st->b;
+		else
+			target = -1;
+		if (target != -1 && (target < first || target >= end))
+			PR_VerifyError ("statement %i branches out of its function", i);
+
+		if (i+1 == end && st->op != OP_DONE && st->op != OP_RETURN && st->op != OP_GOTO)
+			PR_VerifyError ("statement %i falls off the end of its function", i);
+	}
+
+// field operands are read straight off the edict, so they have to be
+// constants that nothing writes, pointing inside it
+	written = starts + numstatements + 1;
+	for (i=0 ; i<RESERVED_OFS && i<numglobals ; i++)
+		written[i] = 1;		// return value and parms
+	for (i=0, f=pr_functions ; i<progs->numfunctions ; i++, f++)
+		for (j=f->parm_start ; j>=0 && j<f->parm_start + f->locals && j<numglobals ; j++)
+			written[j] = 1;
+	for (i=0, st=pr_statements ; i<numstatements ; i++, st++)
+	{
+		if (st->op > OP_BITOR)
+			continue;
+		if (st->op >= OP_STORE_F && st->op <= OP_STORE_FNC)
+			j = 1;
+		else
+			j = 2;
+		n = pr_opwidths[st->op][j];
+		for (target=(unsigned short)(&st->a)[j] ; n-- > 0 && target < numglobals ; target++)
+			written[target] = 1;
+	}
+	for (i=0, st=pr_statements ; i<numstatements ; i++, st++)
+	{
+		if (st->op < OP_LOAD_F || st->op > OP_ADDRESS)
+			continue;
+		target = (unsigned short)st->b;
+		if (target >= numglobals)
+			continue;		// already reported
+		n = (st->op == OP_LOAD_V) ? 3 : 1;
+		if (written[target])
+			PR_VerifyError ("statement %i (%s) field operand %i isn't a constant", i, pr_opnames[st->op], target);
+		else if ((unsigned)((int *)pr_globals)[target] + n > (unsigned)progs->entityfields)
+			PR_VerifyError ("statement %i (%s) field %i out of range", i, pr_opnames[st->op], ((int *)pr_globals)[target]);
+	}
+
+	Hunk_FreeToHighMark (mark);
+
+	for (i=0, def=pr_fielddefs ; i<progs->numfielddefs ; i++, def++)
+	{
+		n = ((def->type & ~DEF_SAVEGLOBAL) == ev_vector) ? 3 : 1;
+		if (def->ofs + n > progs->entityfields)
+			PR_VerifyError ("field %s out of range", PR_GetString(def->s_name));
+	}
+	for (i=0, def=pr_globaldefs ; i<progs->numglobaldefs ; i++, def++)
+	{
+		n = ((def->type & ~DEF_SAVEGLOBAL) == ev_vector) ? 3 : 1;
+		if (def->ofs + n > numglobals)
+		{
+			PR_VerifyError ("global %s out of range", PR_GetString(def->s_name));
+			continue;
+		}
+		if ((def->type & ~DEF_SAVEGLOBAL) == ev_field
+		&& (unsigned)((int *)pr_globals)[def->ofs] >= (unsigned)progs->entityfields)
+			PR_VerifyError ("field global %s out of range", PR_GetString(def->s_name));
+	}
+
+	if (pr_verifyerrors)
+	{
+		Con_Printf ("progs.dat: %i verify errors, using the checked interpreter\n", pr_verifyerrors);
+		return false;
+	}
+	Con_DPrintf ("progs.dat verified\n");
+	return true;
+}
+
+
+/*
+============================================================================
+
+THREADED INTERPRETER
+
+At load time every dstatement_t is translated into a prinstr_t with the
+global operands already resolved to pointers and branch offsets turned
+into absolute instruction numbers.  Common statement pairs emitted by qcc
+are fused into a single superinstruction; pr_codemap translates statement
+numbers (function entry points, saved return statements) into the
+compacted stream, and each instruction remembers the statements it came
+from so errors and traces still point at the right place.  With gcc the stream is run with
+direct threading (each instruction carries the address of its handler),
+otherwise with a switch over the pre-decoded opcodes.
+
+The bookkeeping done by the switch loop (runaway, profile, pr_xstatement,
+pr_trace) is kept on the checked path so both interpreters behave
+identically.  A verified progs runs without it unless pr_checked is set:
+pr_xstatement is only updated where a call or an error can look at it,
+runaway counts backward branches instead of instructions, and profile
+counts calls instead of statements.
+============================================================================
+*/
+
+#if defined(__GNUC__)
+#define	PR_COMPUTED_GOTO
+#endif
+
+#define	PR_CODE_FAST		1
+#define	PR_CODE_CHECKED		2
+
+static int	pr_code_threaded;	// PR_CODE_* the handlers are filled in for, 0 if none
+
+/*
+====================
+PR_FuseStatements
+
+Returns the superinstruction that does the work of st and the statement
+following it, or 0 if the pair can't be fused.  The temporary written by
+the first statement is still stored, so globals end up exactly as the
+unfused statements would leave them.
+====================
+*/
+static int PR_FuseStatements (dstatement_t *st)
+{
+	dstatement_t	*next;
+
+	next = st + 1;
+	switch (st->op)
+	{
+	case OP_ADDRESS:
+		if (next->b != st->c)
+			return 0;
+		if (next->op == OP_STOREP_V)
+			return PRI_ADDRESS_STOREP_V;
+		if (next->op >= OP_STOREP_F && next->op <= OP_STOREP_FNC)
+			return PRI_ADDRESS_STOREP;
+		return 0;
+
+	case OP_LOAD_V:
+		if (next->op == OP_STORE_V && next->a == st->c)
+			return PRI_LOAD_STORE_V;
+		return 0;
+
+	case OP_LOAD_F:
+	case OP_LOAD_S:
+	case OP_LOAD_ENT:
+	case OP_LOAD_FLD:
+	case OP_LOAD_FNC:
+		if (next->op != OP_STORE_V && next->op >= OP_STORE_F && next->op <= OP_STORE_FNC
+		&& next->a == st->c)
+			return PRI_LOAD_STORE;
+		return 0;
+
+	case OP_ADD_F:
+	case OP_SUB_F:
+	case OP_MUL_F:
+		if (next->op != OP_STORE_F || next->a != st->c)
+			return 0;
+		if (st->op == OP_ADD_F)
+			return PRI_ADD_F_STORE;
+		if (st->op == OP_SUB_F)
+			return PRI_SUB_F_STORE;
+		return PRI_MUL_F_STORE;
+	}
+
+	if (next->a != st->c)
+		return 0;
+
+	if (next->op == OP_IFNOT)
+	{
+		switch (st->op)
+		{
+		case OP_EQ_F:	return PRI_EQ_F_IFNOT;
+		case OP_NE_F:	return PRI_NE_F_IFNOT;
+		case OP_LT:		return PRI_LT_IFNOT;
+		case OP_GT:		return PRI_GT_IFNOT;
+		case OP_LE:		return PRI_LE_IFNOT;
+		case OP_GE:		return PRI_GE_IFNOT;
+		case OP_EQ_E:	return PRI_EQ_E_IFNOT;
+		case OP_NE_E:	return PRI_NE_E_IFNOT;
+		case OP_NOT_F:	return PRI_NOT_F_IFNOT;
+		case OP_NOT_ENT:	return PRI_NOT_ENT_IFNOT;
+		}
+	}
+	else if (next->op == OP_IF && st->op == OP_NOT_F)
+		return PRI_NOT_F_IF;
+
+	return 0;
+}
+
+/*
+====================
+PR_TranslateProgs
+
+Builds pr_code from pr_statements.  Called from PR_LoadProgs after the
+statements have been byte swapped.
+====================
+*/
+void PR_TranslateProgs (void)
+{
+	int				i, fused, numfused;
+	int				numstatements;
+	dstatement_t	*st;
+	prinstr_t		*in;
+
+	numstatements = progs->numstatements;
+	pr_code = Hunk_AllocName (numstatements * sizeof(prinstr_t), "prcode");
+	pr_codemap = Hunk_AllocName (numstatements * sizeof(int), "prcode");
+	pr_code_threaded = 0;
+
+// a statement that is jumped to or called can't be the second half of
+// a superinstruction, so flag them in pr_codemap before it gets filled
+	if (pr_peephole.value)
+	{
+		for (i=0, st=pr_statements ; i<numstatements ; i++, st++)
+		{
+			if (st->op == OP_GOTO)
+				fused = i + st->a;
+			else if (st->op == OP_IF || st->op == OP_IFNOT)
+				fused = i + st->b;
+			else
+				continue;
+			if (fused >= 0 && fused < numstatements)
+				pr_codemap[fused] = 1;
+		}
+		for (i=0 ; i<progs->numfunctions ; i++)
+		{
+			fused = pr_functions[i].first_statement;
+			if (fused >= 0 && fused < numstatements)
+				pr_codemap[fused] = 1;
+		}
+	}
+
+	numfused = 0;
+	for (i=0, in=pr_code ; i<numstatements ; in++)
+	{
+		st = &pr_statements[i];
+		fused = 0;
+		if (pr_peephole.value && i+1 < numstatements && !pr_codemap[i+1])
+			fused = PR_FuseStatements (st);
+
+		in->handler = NULL;
+		in->stmt = i;
+		in->jump = -1;
+		in->d = NULL;
+		pr_codemap[i] = in - pr_code;
+
+		if (fused)
+		{
+			pr_codemap[i+1] = in - pr_code;
+			in->op = fused;
+			in->len = 2;
+			in->a = (eval_t *)&pr_globals[(unsigned short)st->a];
+			in->b = (eval_t *)&pr_globals[(unsigned short)st->b];
+			in->c = (eval_t *)&pr_globals[(unsigned short)st->c];
+			if (fused >= PRI_EQ_F_IFNOT)
+				in->jump = i + 1 + st[1].b;
+			else if (fused <= PRI_ADDRESS_STOREP_V)
+				in->d = (eval_t *)&pr_globals[(unsigned short)st[1].a];
+			else
+				in->d = (eval_t *)&pr_globals[(unsigned short)st[1].b];
+			numfused++;
+			i += 2;
+			continue;
+		}
+
+		in->op = st->op;
+		in->len = 1;
+		switch (st->op)
+		{
+		case OP_GOTO:
+			in->jump = i + st->a;
+			in->a = in->b = in->c = NULL;
+			break;
+		case OP_IF:
+		case OP_IFNOT:
+			in->jump = i + st->b;
+			in->a = (eval_t *)&pr_globals[(unsigned short)st->a];
+			in->b = in->c = NULL;
+			break;
+		default:
+			in->a = (eval_t *)&pr_globals[(unsigned short)st->a];
+			in->b = (eval_t *)&pr_globals[(unsigned short)st->b];
+			in->c = (eval_t *)&pr_globals[(unsigned short)st->c];
+			break;
+		}
+
+		if ((unsigned)in->op > OP_BITOR)
+			in->op = PRI_BAD;
+		i++;
+	}
+	pr_numcode = in - pr_code;
+
+// now that every statement has a home, point the branches at instructions
+	for (i=0, in=pr_code ; i<pr_numcode ; i++, in++)
+	{
+		if (in->jump == -1)
+			continue;
+		if (in->jump < 0 || in->jump >= numstatements)
+		{	// leave it for PR_RunError if it's ever reached
+			in->op = PRI_BAD;
+			in->jump = -1;
+			continue;
+		}
+		in->jump = pr_codemap[in->jump];
+	}
+
+	Con_DPrintf ("%i statements, %i instructions (%i fused)\n", numstatements, pr_numcode, numfused);
+}
+
+/*
+====================
+PR_PrintInstruction
+
+pr_trace output for one instruction of the threaded interpreter
+====================
+*/
+static void PR_PrintInstruction (prinstr_t *in)
+{
+	int		i;
+
+	for (i=0 ; i<in->len ; i++)
+		PR_PrintStatement (pr_statements + in->stmt + i);
+}
+
+/*
+====================
+PR_ExecuteThreaded
+
+Runs f from the pre-decoded instruction stream until the stack unwinds
+back to the depth it was entered at.
+====================
+*/
+static void PR_ExecuteThreaded (dfunction_t *f)
+{
+	prinstr_t	*ip;
+	eval_t		*a, *ptr;
+	dfunction_t	*newf;
+	edict_t		*ed;
+	int			runaway;
+	int			exitdepth;
+	int			i;
+	qboolean	checked;
+#ifdef PR_COMPUTED_GOTO
+	static void	*optable[PRI_NUMOPS] =
+	{
+		&&lbl_OP_DONE,
+		&&lbl_OP_MUL_F, &&lbl_OP_MUL_V, &&lbl_OP_MUL_FV, &&lbl_OP_MUL_VF,
+		&&lbl_OP_DIV_F,
+		&&lbl_OP_ADD_F, &&lbl_OP_ADD_V,
+		&&lbl_OP_SUB_F, &&lbl_OP_SUB_V,
+		&&lbl_OP_EQ_F, &&lbl_OP_EQ_V, &&lbl_OP_EQ_S, &&lbl_OP_EQ_E, &&lbl_OP_EQ_FNC,
+		&&lbl_OP_NE_F, &&lbl_OP_NE_V, &&lbl_OP_NE_S, &&lbl_OP_NE_E, &&lbl_OP_NE_FNC,
+		&&lbl_OP_LE, &&lbl_OP_GE, &&lbl_OP_LT, &&lbl_OP_GT,
+		&&lbl_OP_LOAD_F, &&lbl_OP_LOAD_V, &&lbl_OP_LOAD_S, &&lbl_OP_LOAD_ENT, &&lbl_OP_LOAD_FLD, &&lbl_OP_LOAD_FNC,
+		&&lbl_OP_ADDRESS,
+		&&lbl_OP_STORE_F, &&lbl_OP_STORE_V, &&lbl_OP_STORE_S, &&lbl_OP_STORE_ENT, &&lbl_OP_STORE_FLD, &&lbl_OP_STORE_FNC,
+		&&lbl_OP_STOREP_F, &&lbl_OP_STOREP_V, &&lbl_OP_STOREP_S, &&lbl_OP_STOREP_ENT, &&lbl_OP_STOREP_FLD, &&lbl_OP_STOREP_FNC,
+		&&lbl_OP_RETURN,
+		&&lbl_OP_NOT_F, &&lbl_OP_NOT_V, &&lbl_OP_NOT_S, &&lbl_OP_NOT_ENT, &&lbl_OP_NOT_FNC,
+		&&lbl_OP_IF, &&lbl_OP_IFNOT,
+		&&lbl_OP_CALL0, &&lbl_OP_CALL1, &&lbl_OP_CALL2, &&lbl_OP_CALL3, &&lbl_OP_CALL4,
+		&&lbl_OP_CALL5, &&lbl_OP_CALL6, &&lbl_OP_CALL7, &&lbl_OP_CALL8,
+		&&lbl_OP_STATE,
+		&&lbl_OP_GOTO,
+		&&lbl_OP_AND, &&lbl_OP_OR,
+		&&lbl_OP_BITAND, &&lbl_OP_BITOR,
+		&&lbl_PRI_BAD,
+		&&lbl_PRI_ADDRESS_STOREP, &&lbl_PRI_ADDRESS_STOREP_V,
+		&&lbl_PRI_LOAD_STORE, &&lbl_PRI_LOAD_STORE_V,
+		&&lbl_PRI_ADD_F_STORE, &&lbl_PRI_SUB_F_STORE, &&lbl_PRI_MUL_F_STORE,
+		&&lbl_PRI_EQ_F_IFNOT, &&lbl_PRI_NE_F_IFNOT,
+		&&lbl_PRI_LT_IFNOT, &&lbl_PRI_GT_IFNOT, &&lbl_PRI_LE_IFNOT, &&lbl_PRI_GE_IFNOT,
+		&&lbl_PRI_EQ_E_IFNOT, &&lbl_PRI_NE_E_IFNOT,
+		&&lbl_PRI_NOT_F_IF, &&lbl_PRI_NOT_F_IFNOT, &&lbl_PRI_NOT_ENT_IFNOT
+	};
+
+// checked instructions all go through lbl_checked on their way to the
+// opcode, unchecked ones straight to it.  The handlers are shared by every
+// activation, so this is redone whenever another one may have changed them
+#define	THREAD_CODE												\
+	if (pr_code_threaded != (checked ? PR_CODE_CHECKED : PR_CODE_FAST))	\
+	{															\
+		for (i=0 ; i<pr_numcode ; i++)							\
+			pr_code[i].handler = checked ? &&lbl_checked : optable[pr_code[i].op];	\
+		pr_code_threaded = checked ? PR_CODE_CHECKED : PR_CODE_FAST;	\
+	}
+
+#define	CASE(op)	lbl_##op:
+#define	DISPATCH	goto *ip->handler
+#else
+#define	THREAD_CODE
+#define	CASE(op)	case op:
+#define	DISPATCH	continue
+#endif
+
+#define	BOOKKEEP									\
+	if ((runaway -= ip->len) <= 0)					\
+		PR_RunError ("runaway loop error");			\
+	pr_xfunction->profile += ip->len;				\
+	pr_xstatement = ip->stmt;						\
+	if (pr_trace)									\
+		PR_PrintInstruction (ip)
+#define	RUNERROR	pr_xstatement = ip->stmt, PR_RunError
+#define	NEXT		ip++; DISPATCH
+#define	JUMP(n)		ip = pr_code + (n); DISPATCH
+// unchecked code only pays for runaway on loops
+#define	BRANCH(n)											\
+	if (!checked && (n) <= ip - pr_code && --runaway <= 0)	\
+		RUNERROR ("runaway loop error");					\
+	JUMP(n)
+
+	checked = !pr_verified || pr_checked.value;
+	THREAD_CODE;
+
+	runaway = 100000;
+
+// make a stack frame
+	exitdepth = pr_depth;
+	ip = pr_code + pr_codemap[PR_EnterFunction (f) + 1];
+	if (!checked)
+		f->profile++;	// fast code counts calls, not statements
+
+#ifdef PR_COMPUTED_GOTO
+	DISPATCH;
+
+lbl_checked:
+	BOOKKEEP;
+	goto *optable[ip->op];
+#else
+while (1)
+{
+	if (checked)
+	{
+		BOOKKEEP;
+	}
+	switch (ip->op)
+	{
+#endif
+
+	CASE(OP_ADD_F)
+		ip->c->_float = ip->a->_float + ip->b->_float;
+		NEXT;
+	CASE(OP_ADD_V)
+		ip->c->vector[0] = ip->a->vector[0] + ip->b->vector[0];
+		ip->c->vector[1] = ip->a->vector[1] + ip->b->vector[1];
+		ip->c->vector[2] = ip->a->vector[2] + ip->b->vector[2];
+		NEXT;
+
+	CASE(OP_SUB_F)
+		ip->c->_float = ip->a->_float - ip->b->_float;
+		NEXT;
+	CASE(OP_SUB_V)
+		ip->c->vector[0] = ip->a->vector[0] - ip->b->vector[0];
+		ip->c->vector[1] = ip->a->vector[1] - ip->b->vector[1];
+		ip->c->vector[2] = ip->a->vector[2] - ip->b->vector[2];
+		NEXT;
+
+	CASE(OP_MUL_F)
+		ip->c->_float = ip->a->_float * ip->b->_float;
+		NEXT;
+	CASE(OP_MUL_V)
+		ip->c->_float = ip->a->vector[0]*ip->b->vector[0]
+				+ ip->a->vector[1]*ip->b->vector[1]
+				+ ip->a->vector[2]*ip->b->vector[2];
+		NEXT;
+	CASE(OP_MUL_FV)
+		ip->c->vector[0] = ip->a->_float * ip->b->vector[0];
+		ip->c->vector[1] = ip->a->_float * ip->b->vector[1];
+		ip->c->vector[2] = ip->a->_float * ip->b->vector[2];
+		NEXT;
+	CASE(OP_MUL_VF)
+		ip->c->vector[0] = ip->b->_float * ip->a->vector[0];
+		ip->c->vector[1] = ip->b->_float * ip->a->vector[1];
+		ip->c->vector[2] = ip->b->_float * ip->a->vector[2];
+		NEXT;
+
+	CASE(OP_DIV_F)
+		ip->c->_float = ip->a->_float / ip->b->_float;
+		NEXT;
+
+	CASE(OP_BITAND)
+		ip->c->_float = (int)ip->a->_float & (int)ip->b->_float;
+		NEXT;
+	CASE(OP_BITOR)
+		ip->c->_float = (int)ip->a->_float | (int)ip->b->_float;
+		NEXT;
+
+	CASE(OP_GE)
+		ip->c->_float = ip->a->_float >= ip->b->_float;
+		NEXT;
+	CASE(OP_LE)
+		ip->c->_float = ip->a->_float <= ip->b->_float;
+		NEXT;
+	CASE(OP_GT)
+		ip->c->_float = ip->a->_float > ip->b->_float;
+		NEXT;
+	CASE(OP_LT)
+		ip->c->_float = ip->a->_float < ip->b->_float;
+		NEXT;
+	CASE(OP_AND)
+		ip->c->_float = ip->a->_float && ip->b->_float;
+		NEXT;
+	CASE(OP_OR)
+		ip->c->_float = ip->a->_float || ip->b->_float;
+		NEXT;
+
+	CASE(OP_NOT_F)
+		ip->c->_float = !ip->a->_float;
+		NEXT;
+	CASE(OP_NOT_V)
+		ip->c->_float = !ip->a->vector[0] && !ip->a->vector[1] && !ip->a->vector[2];
+		NEXT;
+	CASE(OP_NOT_S)
+		ip->c->_float = !ip->a->string || !*PR_GetString(ip->a->string);
+		NEXT;
+	CASE(OP_NOT_FNC)
+		ip->c->_float = !ip->a->function;
+		NEXT;
+	CASE(OP_NOT_ENT)
+		ip->c->_float = (PROG_TO_EDICT(ip->a->edict) == sv.edicts);
+		NEXT;
+
+	CASE(OP_EQ_F)
+		ip->c->_float = ip->a->_float == ip->b->_float;
+		NEXT;
+	CASE(OP_EQ_V)
+		ip->c->_float = (ip->a->vector[0] == ip->b->vector[0]) &&
+					(ip->a->vector[1] == ip->b->vector[1]) &&
+					(ip->a->vector[2] == ip->b->vector[2]);
+		NEXT;
+	CASE(OP_EQ_S)
+		ip->c->_float = !strcmp(pr_strings+ip->a->string,pr_strings+ip->b->string);
+		NEXT;
+	CASE(OP_EQ_E)
+		ip->c->_float = ip->a->_int == ip->b->_int;
+		NEXT;
+	CASE(OP_EQ_FNC)
+		ip->c->_float = ip->a->function == ip->b->function;
+		NEXT;
+
+	CASE(OP_NE_F)
+		ip->c->_float = ip->a->_float != ip->b->_float;
+		NEXT;
+	CASE(OP_NE_V)
+		ip->c->_float = (ip->a->vector[0] != ip->b->vector[0]) ||
+					(ip->a->vector[1] != ip->b->vector[1]) ||
+					(ip->a->vector[2] != ip->b->vector[2]);
+		NEXT;
+	CASE(OP_NE_S)
+		ip->c->_float = strcmp(pr_strings+ip->a->string,pr_strings+ip->b->string);
+		NEXT;
+	CASE(OP_NE_E)
+		ip->c->_float = ip->a->_int != ip->b->_int;
+		NEXT;
+	CASE(OP_NE_FNC)
+		ip->c->_float = ip->a->function != ip->b->function;
+		NEXT;
+
+//==================
+	CASE(OP_STORE_F)
+	CASE(OP_STORE_ENT)
+	CASE(OP_STORE_FLD)		// integers
+	CASE(OP_STORE_S)
+	CASE(OP_STORE_FNC)		// pointers
+		ip->b->_int = ip->a->_int;
+		NEXT;
+	CASE(OP_STORE_V)
+		ip->b->vector[0] = ip->a->vector[0];
+		ip->b->vector[1] = ip->a->vector[1];
+		ip->b->vector[2] = ip->a->vector[2];
+		NEXT;
+
+	CASE(OP_STOREP_F)
+	CASE(OP_STOREP_ENT)
+	CASE(OP_STOREP_FLD)		// integers
+	CASE(OP_STOREP_S)
+	CASE(OP_STOREP_FNC)		// pointers
+		ptr = (eval_t *)((byte *)sv.edicts + ip->b->_int);
+		ptr->_int = ip->a->_int;
+		NEXT;
+	CASE(OP_STOREP_V)
+		ptr = (eval_t *)((byte *)sv.edicts + ip->b->_int);
+		ptr->vector[0] = ip->a->vector[0];
+		ptr->vector[1] = ip->a->vector[1];
+		ptr->vector[2] = ip->a->vector[2];
+		NEXT;
+
+	CASE(OP_ADDRESS)
+		ed = PROG_TO_EDICT(ip->a->edict);
+#ifdef PARANOID
+		NUM_FOR_EDICT(ed);		// make sure it's in range
+#endif
+		if (ed == (edict_t *)sv.edicts && sv.state == ss_active)
+			RUNERROR ("assignment to world entity");
+		FIELD_STORE (ed, ip->b->_int);
+		ip->c->_int = (byte *)((int *)&ed->v + ip->b->_int) - (byte *)sv.edicts;
+		NEXT;
+
+	CASE(OP_LOAD_F)
+	CASE(OP_LOAD_FLD)
+	CASE(OP_LOAD_ENT)
+	CASE(OP_LOAD_S)
+	CASE(OP_LOAD_FNC)
+		ed = PROG_TO_EDICT(ip->a->edict);
+#ifdef PARANOID
+		NUM_FOR_EDICT(ed);		// make sure it's in range
+#endif
+		a = (eval_t *)((int *)&ed->v + ip->b->_int);
+		ip->c->_int = a->_int;
+		NEXT;
+
+	CASE(OP_LOAD_V)
+		ed = PROG_TO_EDICT(ip->a->edict);
+#ifdef PARANOID
+		NUM_FOR_EDICT(ed);		// make sure it's in range
+#endif
+		a = (eval_t *)((int *)&ed->v + ip->b->_int);
+		ip->c->vector[0] = a->vector[0];
+		ip->c->vector[1] = a->vector[1];
+		ip->c->vector[2] = a->vector[2];
+		NEXT;
+
+//==================
+
+	CASE(OP_IFNOT)
+		if (!ip->a->_int)
+		{
+			BRANCH(ip->jump);
+		}
+		NEXT;
+
+	CASE(OP_IF)
+		if (ip->a->_int)
+		{
+			BRANCH(ip->jump);
+		}
+		NEXT;
+
+	CASE(OP_GOTO)
+		BRANCH(ip->jump);
+
+	CASE(OP_CALL0)
+	CASE(OP_CALL1)
+	CASE(OP_CALL2)
+	CASE(OP_CALL3)
+	CASE(OP_CALL4)
+	CASE(OP_CALL5)
+	CASE(OP_CALL6)
+	CASE(OP_CALL7)
+	CASE(OP_CALL8)
+		pr_argc = ip->op - OP_CALL0;
+		pr_xstatement = ip->stmt;
+		if (!ip->a->function)
+			PR_RunError ("NULL function");
+
+		newf = &pr_functions[ip->a->function];
+
+		if (newf->first_statement < 0)
+		{	// negative statements are built in functions
+			i = -newf->first_statement;
+			if (i >= pr_numbuiltins)
+				PR_RunError ("Bad builtin call number");
+			if (pr_profiling)
+			{
+				PR_ProfileEnter (newf - pr_functions);
+				pr_builtins[i] ();
+				PR_ProfileLeave ();
+			}
+			else
+				pr_builtins[i] ();
+		// traceon carries on down the checked path so it shows, and a
+		// progs call from the builtin may have threaded the code for its
+		// own path, so put this one's back
+			if (pr_trace)
+				checked = true;
+			THREAD_CODE;
+			NEXT;
+		}
+
+		if (!checked)
+			newf->profile++;
+		JUMP(pr_codemap[PR_EnterFunction (newf) + 1]);
+
+	CASE(OP_DONE)
+	CASE(OP_RETURN)
+		pr_globals[OFS_RETURN] = ip->a->vector[0];
+		pr_globals[OFS_RETURN+1] = ip->a->vector[1];
+		pr_globals[OFS_RETURN+2] = ip->a->vector[2];
+
+		i = PR_LeaveFunction ();
+		if (pr_depth == exitdepth)
+			return;		// all done
+		JUMP(pr_codemap[i] + 1);
+
+	CASE(OP_STATE)
+		ed = PROG_TO_EDICT(pr_global_struct->self);
+#ifdef FPS_20
+		ed->v.nextthink = pr_global_struct->time + 0.05;
+#else
+		ed->v.nextthink = pr_global_struct->time + 0.1;
+#endif
+		if (ip->a->_float != ed->v.frame)
+		{
+			ed->v.frame = ip->a->_float;
+		}
+		ed->v.think = ip->b->function;
+		NEXT;
+
+//==================
+// superinstructions
+
+	CASE(PRI_ADDRESS_STOREP)
+		ed = PROG_TO_EDICT(ip->a->edict);
+#ifdef PARANOID
+		NUM_FOR_EDICT(ed);		// make sure it's in range
+#endif
+		if (ed == (edict_t *)sv.edicts && sv.state == ss_active)
+			RUNERROR ("assignment to world entity");
+		FIELD_STORE (ed, ip->b->_int);
+		ip->c->_int = (byte *)((int *)&ed->v + ip->b->_int) - (byte *)sv.edicts;
+		ptr = (eval_t *)((byte *)sv.edicts + ip->c->_int);
+		ptr->_int = ip->d->_int;
+		NEXT;
+	CASE(PRI_ADDRESS_STOREP_V)
+		ed = PROG_TO_EDICT(ip->a->edict);
+#ifdef PARANOID
+		NUM_FOR_EDICT(ed);		// make sure it's in range
+#endif
+		if (ed == (edict_t *)sv.edicts && sv.state == ss_active)
+			RUNERROR ("assignment to world entity");
+		FIELD_STORE (ed, ip->b->_int);
+		ip->c->_int = (byte *)((int *)&ed->v + ip->b->_int) - (byte *)sv.edicts;
+		ptr = (eval_t *)((byte *)sv.edicts + ip->c->_int);
+		ptr->vector[0] = ip->d->vector[0];
+		ptr->vector[1] = ip->d->vector[1];
+		ptr->vector[2] = ip->d->vector[2];
+		NEXT;
+
+	CASE(PRI_LOAD_STORE)
+		ed = PROG_TO_EDICT(ip->a->edict);
+#ifdef PARANOID
+		NUM_FOR_EDICT(ed);		// make sure it's in range
+#endif
+		a = (eval_t *)((int *)&ed->v + ip->b->_int);
+		ip->c->_int = a->_int;
+		ip->d->_int = ip->c->_int;
+		NEXT;
+	CASE(PRI_LOAD_STORE_V)
+		ed = PROG_TO_EDICT(ip->a->edict);
+#ifdef PARANOID
+		NUM_FOR_EDICT(ed);		// make sure it's in range
+#endif
+		a = (eval_t *)((int *)&ed->v + ip->b->_int);
+		ip->c->vector[0] = a->vector[0];
+		ip->c->vector[1] = a->vector[1];
+		ip->c->vector[2] = a->vector[2];
+		ip->d->vector[0] = ip->c->vector[0];
+		ip->d->vector[1] = ip->c->vector[1];
+		ip->d->vector[2] = ip->c->vector[2];
+		NEXT;
+
+	CASE(PRI_ADD_F_STORE)
+		ip->c->_float = ip->a->_float + ip->b->_float;
+		ip->d->_int = ip->c->_int;
+		NEXT;
+	CASE(PRI_SUB_F_STORE)
+		ip->c->_float = ip->a->_float - ip->b->_float;
+		ip->d->_int = ip->c->_int;
+		NEXT;
+	CASE(PRI_MUL_F_STORE)
+		ip->c->_float = ip->a->_float * ip->b->_float;
+		ip->d->_int = ip->c->_int;
+		NEXT;
+
+#define	TEST_BRANCH(test)	\
+		ip->c->_float = test;	\
+		if (!ip->c->_int)		\
+		{						\
+			BRANCH(ip->jump);	\
+		}						\
+		NEXT
+
+	CASE(PRI_EQ_F_IFNOT)
+		TEST_BRANCH(ip->a->_float == ip->b->_float);
+	CASE(PRI_NE_F_IFNOT)
+		TEST_BRANCH(ip->a->_float != ip->b->_float);
+	CASE(PRI_LT_IFNOT)
+		TEST_BRANCH(ip->a->_float < ip->b->_float);
+	CASE(PRI_GT_IFNOT)
+		TEST_BRANCH(ip->a->_float > ip->b->_float);
+	CASE(PRI_LE_IFNOT)
+		TEST_BRANCH(ip->a->_float <= ip->b->_float);
+	CASE(PRI_GE_IFNOT)
+		TEST_BRANCH(ip->a->_float >= ip->b->_float);
+	CASE(PRI_EQ_E_IFNOT)
+		TEST_BRANCH(ip->a->_int == ip->b->_int);
+	CASE(PRI_NE_E_IFNOT)
+		TEST_BRANCH(ip->a->_int != ip->b->_int);
+	CASE(PRI_NOT_F_IFNOT)
+		TEST_BRANCH(!ip->a->_float);
+	CASE(PRI_NOT_ENT_IFNOT)
+		TEST_BRANCH(PROG_TO_EDICT(ip->a->edict) == sv.edicts);
+	CASE(PRI_NOT_F_IF)
+		ip->c->_float = !ip->a->_float;
+		if (ip->c->_int)
+		{
+			BRANCH(ip->jump);
+		}
+		NEXT;
+
+#undef	TEST_BRANCH
+
+//==================
+
+#ifdef PR_COMPUTED_GOTO
+	CASE(PRI_BAD)
+#else
+	default:
+#endif
+		RUNERROR ("Bad opcode %i", pr_statements[ip->stmt].op);
+
+#ifndef PR_COMPUTED_GOTO
+	}
+}
+#endif
+
+#undef	THREAD_CODE
+#undef	CASE
+#undef	DISPATCH
+#undef	BOOKKEEP
+#undef	RUNERROR
+#undef	NEXT
+#undef	JUMP
+#undef	BRANCH
+}
+
 /*
 ====================
 PR_ExecuteProgram
@@ -379,6 +1778,13 @@ void PR_ExecuteProgram (func_t fnum)
 	
 	f = &pr_functions[fnum];
 
+	if (pr_threaded.value && pr_code)
+	{
+		pr_trace = false;
+		PR_ExecuteThreaded (f);
+		return;
+	}
+
 	runaway = 100000;
 	pr_trace = false;
 
@@ -565,6 +1971,7 @@ while (1)
 #endif
 		if (ed == (edict_t *)sv.edicts && sv.state == ss_active)
 			PR_RunError ("assignment to world entity");
+		FIELD_STORE (ed, b->_int);
 		c->_int = (byte *)((int *)&ed->v + b->_int) - (byte *)sv.edicts;
 		break;
 		
@@ -628,6 +2035,13 @@ while (1)
 			i = -newf->first_statement;
 			if (i >= pr_numbuiltins)
 				PR_RunError ("Bad builtin call number");
+			if (pr_profiling)
+			{
+				PR_ProfileEnter (newf - pr_functions);
+				pr_builtins[i] ();
+				PR_ProfileLeave ();
+				break;
+			}
 			pr_builtins[i] ();
 			break;
 		}
@@ -61,21 +61,107 @@ extern	float			*pr_globals;			// same as pr_global_struct
 
 extern	int				pr_edict_size;	// in bytes
 
+extern	byte			*pr_fieldflags;	// FIELD_* bits for each entity field word
+extern	int				pr_stringserial;
+
+extern	int				localstack[];		// locals saved by the functions on the stack
+extern	int				localstack_used;
+
+#define	FIELD_SPATIAL	1		// origin, mins, maxs or solid
+#define	FIELD_INDEXED	2		// searched by find()
+#define	FIELD_CLIP		4		// read by traces (owner, flags, size, absmin...)
+#define	FIELD_STRING	8		// a string field
+
+#define	ED_FIELD(f)		((int)((size_t)&((entvars_t *)0)->f / 4))	// entvars_t word offset
+
+//============================================================================
+
+// pre-decoded statements for the threaded interpreter
+enum {
+	PRI_BAD = OP_BITOR+1,	// anything the translator didn't recognize
+
+// superinstructions, each replacing two statements
+	PRI_ADDRESS_STOREP,		// ADDRESS + STOREP_F/S/ENT/FLD/FNC
+	PRI_ADDRESS_STOREP_V,	// ADDRESS + STOREP_V
+	PRI_LOAD_STORE,			// LOAD_F/S/ENT/FLD/FNC + STORE_F/S/ENT/FLD/FNC
+	PRI_LOAD_STORE_V,		// LOAD_V + STORE_V
+	PRI_ADD_F_STORE,		// ADD_F + STORE_F
+	PRI_SUB_F_STORE,		// SUB_F + STORE_F
+	PRI_MUL_F_STORE,		// MUL_F + STORE_F
+	PRI_EQ_F_IFNOT,			// compare + IFNOT
+	PRI_NE_F_IFNOT,
+	PRI_LT_IFNOT,
+	PRI_GT_IFNOT,
+	PRI_LE_IFNOT,
+	PRI_GE_IFNOT,
+	PRI_EQ_E_IFNOT,
+	PRI_NE_E_IFNOT,
+	PRI_NOT_F_IF,
+	PRI_NOT_F_IFNOT,
+	PRI_NOT_ENT_IFNOT,
+
+	PRI_NUMOPS
+};
+
+typedef struct prinstr_s
+{
+	void		*handler;		// label of the opcode in PR_ExecuteThreaded
+	int			op;
+	int			jump;			// absolute branch target, -1 if none
+	int			stmt;			// first pr_statements index covered
+	int			len;			// number of statements covered
+	eval_t		*a, *b, *c;		// operands resolved into pr_globals
+	eval_t		*d;				// second statement's extra operand
+} prinstr_t;
+
+extern	prinstr_t		*pr_code;
+extern	int				pr_numcode;
+extern	int				*pr_codemap;	// pr_statements index -> pr_code index
+
+extern	cvar_t			pr_threaded;
+extern	cvar_t			pr_peephole;
+extern	cvar_t			pr_checked;
+extern	qboolean		pr_verified;	// progs passed PR_VerifyProgs
+extern	cvar_t			pr_findindex;
+
 //============================================================================
 
 void PR_Init (void);
 
 void PR_ExecuteProgram (func_t fnum);
 void PR_LoadProgs (void);
+void PR_TranslateProgs (void);
+qboolean PR_VerifyProgs (void);
 
 void PR_Profile_f (void);
+void PR_ProfileStart_f (void);
+void PR_ProfileStop_f (void);
+void PR_ProfileReset_f (void);
+void PR_ProfileDump_f (void);
 
 char *PR_GetString (int num);
 int PR_SetEngineString (char *s);
 int PR_AllocString (int bufferlength, char **ptr);
+// returns the number of a new string of its own, kept until it is freed or
+// new progs are loaded
+void PR_FreeString (int num);
+// releases the slot, and the storage of a PR_AllocString string
+int PR_TempString (char **ptr);
+// returns the number of a scratch string that stays valid for a few more calls
+void PR_CollectStrings (void);
+// frees every PR_AllocString string that nothing refers to any more
+qboolean PR_IsConstantString (int num);
+void PR_StringStats (void);
+unsigned PR_HashName (char *name);
+
+void PR_ClearFindIndexes (void);
+void PR_FindIndexChanged (edict_t *ed, int field);
+// puts an edict on the dirty list of the find() index for field, or of
+// every index if field is -1
 
 edict_t *ED_Alloc (void);
 void ED_Free (edict_t *ed);
+void ED_FieldStored (edict_t *ed, int field);
 
 string_t ED_NewString (const char *string);
 // returns a copy of the string allocated from the server's string heap
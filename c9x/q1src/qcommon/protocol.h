@@ -39,6 +39,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #define	U_SKIN		(1<<12)
 #define	U_EFFECTS	(1<<13)
 #define	U_LONGENTITY	(1<<14)
+#define	U_REMOVE		(1<<15)		// svc_packetentities only, no data follows
 
 
 #define	SU_VIEWHEIGHT	(1<<0)
@@ -130,6 +131,9 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #define svc_cutscene		34
 
+#define	svc_packetentities	35		// [long] frame [byte] frames back to delta from, 0 = baselines
+									// <update bits + entity number + data>...[byte] 0
+
 //
 // client to server
 //
@@ -138,6 +142,20 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #define	clc_disconnect	2
 #define	clc_move		3			// [usercmd_t]
 #define	clc_stringcmd	4		// [string] message
+#define	clc_ackframe	5		// [long] last svc_packetentities frame received
+
+
+//
+// protocol extensions, asked for by the client with a "protocolext <bits>"
+// command after every svc_serverinfo
+//
+#define	PEXT_DELTAENTITIES	(1<<0)	// svc_packetentities and clc_ackframe
+
+#define	UPDATE_BACKUP	16	// copies of entity lists to keep buffered
+							// must be power of two
+#define	UPDATE_MASK		(UPDATE_BACKUP-1)
+
+#define	MAX_PACKET_ENTITIES	256	// entities in one svc_packetentities frame
 
 
 //
@@ -220,6 +220,7 @@ void	VID_UnlockBuffer (void);
 
 typedef struct
 {
+	int		number;			// edict index, only used in delta frames
 	vec3_t	origin;
 	vec3_t	angles;
 	int		modelindex;
@@ -297,13 +298,21 @@ extern	cvar_t		sys_ticrate;
 extern	cvar_t		sys_nostdout;
 extern	cvar_t		developer;
 
+// the server thread keeps its own copy of these
+#ifdef _MSC_VER
+#define	THREADLOCAL	__declspec(thread)
+#else
+#define	THREADLOCAL	__thread
+#endif
+
 extern	qboolean	host_initialized;		// true if into command execution
-extern	double		host_frametime;
+extern	THREADLOCAL	double		host_frametime;
 extern	byte		*host_basepal;
 extern	byte		*host_colormap;
 extern	int			host_framecount;	// incremented every frame, never reset
 extern	double		realtime;			// not bounded in any way, changed at
 										// start of every frame, never reset
+extern	THREADLOCAL	qboolean	host_serverthread;	// set on the server thread
 
 void Host_ClearMemory (void);
 void Host_ServerFrame (void);
@@ -32,6 +32,12 @@ int Sys_FileOpenWrite (char *path);
 void Sys_FileClose (int handle);
 void Sys_FileSeek (int handle, int position);
 int Sys_FileRead (int handle, void *dest, int count);
+int Sys_FileReadAt (int handle, int position, void *dest, int count);
+// reads without moving the handle's own position, so any number of readers
+// can share one open file
+byte *Sys_FileMap (int handle, int length);
+// maps the first length bytes of the file read only, or returns NULL if it
+// can't; the mapping lasts as long as the program
 int Sys_FileWrite (int handle, void *data, int count);
 int	Sys_FileTime (char *path);
 void Sys_mkdir (char *path);
@@ -69,3 +75,31 @@ void Sys_LowFPPrecision (void);
 void Sys_HighFPPrecision (void);
 void Sys_SetFPCW (void);
 
+
+//
+// worker threads
+//
+#define	MAX_WORKERS	15
+
+int Sys_NumWorkers (void);
+// how many threads besides the main one Sys_RunJobs spreads work over,
+// 0 if the platform has none
+
+void Sys_RunJobs (int count, void (*job) (int index, int thread));
+// calls job for every index from 0 to count-1 and returns once they have
+// all finished.  thread is 0 on the calling thread and 1..Sys_NumWorkers ()
+// on the others, so a job can keep scratch space per thread.
+// the jobs must not call anything that isn't safe to run concurrently
+
+qboolean Sys_StartThread (void (*func) (void));
+// runs func on a thread of its own, for the threaded server.  Returns
+// false if the platform has no threads
+
+void Sys_LockHost (void);
+void Sys_UnlockHost (void);
+// the lock the main thread and the server thread share the host state under
+
+void Sys_LockMem (void);
+void Sys_UnlockMem (void);
+// guards the memory owner table, which the main thread also updates from
+// the cache while it draws without the host lock
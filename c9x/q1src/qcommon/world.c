@@ -30,6 +30,8 @@ line of sight checks trace->crosscontent, but bullets don't
 */
 
 
+#define	MAX_SPECTOUCHED	16		// edicts a speculated move can look at
+
 typedef struct
 {
 	vec3_t		boxmins, boxmaxs;// enclose the test object along entire move
@@ -39,11 +41,18 @@ typedef struct
 	trace_t		trace;
 	int			type;
 	edict_t		*passedict;
+	int			thread;			// whose box hull to use
+	short		*touched;		// if set, edicts that passed the box test
+	int			numtouched;		// go here, until there are too many
 } moveclip_t;
 
 
 int SV_HullPointContents (hull_t *hull, int num, vec3_t p);
 
+static	int		sv_numspeculated;
+static	int		sv_tracefaults[1+MAX_WORKERS];	// errors a worker left for the main thread
+static qboolean SV_SpeculatedMove (vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int type, edict_t *passedict, trace_t *trace);
+
 /*
 ===============================================================================
 
@@ -53,9 +62,14 @@ HULL BOXES
 */
 
 
-static	hull_t		box_hull;
-static	dclipnode_t	box_clipnodes[6];
-static	mplane_t	box_planes[6];
+typedef struct
+{
+	hull_t		hull;
+	dclipnode_t	clipnodes[6];
+	mplane_t	planes[6];
+} boxhull_t;
+
+static	boxhull_t	box_hulls[1+MAX_WORKERS];	// one for each thread that traces
 
 /*
 ===================
@@ -67,30 +81,34 @@ can just be stored out and get a proper hull_t structure.
 */
 void SV_InitBoxHull (void)
 {
-	int		i;
+	int		i, t;
 	int		side;
+	boxhull_t	*box;
 
-	box_hull.clipnodes = box_clipnodes;
-	box_hull.planes = box_planes;
-	box_hull.firstclipnode = 0;
-	box_hull.lastclipnode = 5;
-
-	for (i=0 ; i<6 ; i++)
+	for (t=0 ; t<=MAX_WORKERS ; t++)
 	{
-		box_clipnodes[i].planenum = i;
-		
-		side = i&1;
-		
-		box_clipnodes[i].children[side] = CONTENTS_EMPTY;
-		if (i != 5)
-			box_clipnodes[i].children[side^1] = i + 1;
-		else
-			box_clipnodes[i].children[side^1] = CONTENTS_SOLID;
-		
-		box_planes[i].type = i>>1;
-		box_planes[i].normal[i>>1] = 1;
+		box = &box_hulls[t];
+		box->hull.clipnodes = box->clipnodes;
+		box->hull.planes = box->planes;
+		box->hull.firstclipnode = 0;
+		box->hull.lastclipnode = 5;
+
+		for (i=0 ; i<6 ; i++)
+		{
+			box->clipnodes[i].planenum = i;
+			
+			side = i&1;
+			
+			box->clipnodes[i].children[side] = CONTENTS_EMPTY;
+			if (i != 5)
+				box->clipnodes[i].children[side^1] = i + 1;
+			else
+				box->clipnodes[i].children[side^1] = CONTENTS_SOLID;
+			
+			box->planes[i].type = i>>1;
+			box->planes[i].normal[i>>1] = 1;
+		}
 	}
-	
 }
 
 
@@ -100,18 +118,22 @@ SV_HullForBox
 
 To keep everything totally uniform, bounding boxes are turned into small
 BSP trees instead of being compared directly.
+Each thread has its own box hull.
 ===================
 */
-hull_t	*SV_HullForBox (vec3_t mins, vec3_t maxs)
+hull_t	*SV_HullForBox (vec3_t mins, vec3_t maxs, int thread)
 {
-	box_planes[0].dist = maxs[0];
-	box_planes[1].dist = mins[0];
-	box_planes[2].dist = maxs[1];
-	box_planes[3].dist = mins[1];
-	box_planes[4].dist = maxs[2];
-	box_planes[5].dist = mins[2];
+	mplane_t	*planes;
 
-	return &box_hull;
+	planes = box_hulls[thread].planes;
+	planes[0].dist = maxs[0];
+	planes[1].dist = mins[0];
+	planes[2].dist = maxs[1];
+	planes[3].dist = mins[1];
+	planes[4].dist = maxs[2];
+	planes[5].dist = mins[2];
+
+	return &box_hulls[thread].hull;
 }
 
 
@@ -126,7 +148,7 @@ Offset is filled in to contain the adjustment that must be added to the
 testing object's origin to get a point to use with the returned hull.
 ================
 */
-hull_t *SV_HullForEntity (edict_t *ent, vec3_t mins, vec3_t maxs, vec3_t offset)
+hull_t *SV_HullForEntity (edict_t *ent, vec3_t mins, vec3_t maxs, vec3_t offset, int thread)
 {
 	model_t		*model;
 	vec3_t		size;
@@ -161,7 +183,7 @@ hull_t *SV_HullForEntity (edict_t *ent, vec3_t mins, vec3_t maxs, vec3_t offset)
 
 		VectorSubtract (ent->v.mins, maxs, hullmins);
 		VectorSubtract (ent->v.maxs, mins, hullmaxs);
-		hull = SV_HullForBox (hullmins, hullmaxs);
+		hull = SV_HullForBox (hullmins, hullmaxs, thread);
 		
 		VectorCopy (ent->v.origin, offset);
 	}
@@ -193,6 +215,41 @@ typedef struct areanode_s
 static	areanode_t	sv_areanodes[AREA_NODES];
 static	int			sv_numareanodes;
 
+// edicts whose origin, size or solid may have changed since SV_LinkEdict
+// last placed them; the area nodes can't be trusted to find these
+static	short		sv_moved[MAX_EDICTS];
+static	short		sv_movedslot[MAX_EDICTS];	// index in sv_moved + 1, 0 = not moved
+static	int			sv_nummoved;
+
+// with sv_areatree set at map load the area nodes are left empty and
+// linked edicts go in the bounding box trees below instead
+#define	AREA_SOLID		0
+#define	AREA_TRIGGER	1
+
+#define	AREA_MAXBOXES	(MAX_EDICTS*2)
+#define	AREA_MARGIN		8		// slack around every leaf box
+#define	AREA_PREDICT	0.1		// seconds of velocity a leaf box also covers
+#define	AREA_HUGE		1e30	// leaf box for an edict with a broken abs box
+
+typedef struct
+{
+	vec3_t	mins, maxs;
+	int		parent;			// next free box when not in use
+	int		children[2];	// -1 on leaves
+	int		ent;			// edict number on leaves
+	int		height;			// 0 on leaves
+} areabox_t;
+
+cvar_t	sv_areatree = {"sv_areatree", "0"};	// 1 = bounding box trees from the next map
+
+static	qboolean	sv_usetree;
+static	areabox_t	sv_areaboxes[AREA_MAXBOXES];
+static	int			sv_freeareabox;
+static	int			sv_arearoot[2];				// AREA_SOLID, AREA_TRIGGER
+static	int			sv_entareabox[MAX_EDICTS];	// leaf, -1 = none
+static	byte		sv_entareatree[MAX_EDICTS];	// which root the leaf is under
+static	link_t		sv_treeedicts[2];			// ent->area hangs off these
+
 /*
 ===============
 SV_CreateAreaNode
@@ -238,6 +295,38 @@ areanode_t *SV_CreateAreaNode (int depth, vec3_t mins, vec3_t maxs)
 	return anode;
 }
 
+/*
+===============
+SV_ClearArea
+
+Empties the area nodes and the bounding box trees
+===============
+*/
+static void SV_ClearArea (void)
+{
+	int		i;
+
+	memset (sv_areanodes, 0, sizeof(sv_areanodes));
+	sv_numareanodes = 0;
+	SV_CreateAreaNode (0, sv.worldmodel->mins, sv.worldmodel->maxs);
+
+	for (i=0 ; i<AREA_MAXBOXES ; i++)
+	{
+		sv_areaboxes[i].parent = i+1;
+		sv_areaboxes[i].height = -1;
+	}
+	sv_areaboxes[AREA_MAXBOXES-1].parent = -1;
+	sv_freeareabox = 0;
+
+	for (i=0 ; i<2 ; i++)
+	{
+		sv_arearoot[i] = -1;
+		ClearLink (&sv_treeedicts[i]);
+	}
+	for (i=0 ; i<MAX_EDICTS ; i++)
+		sv_entareabox[i] = -1;
+}
+
 /*
 ===============
 SV_ClearWorld
@@ -248,9 +337,53 @@ void SV_ClearWorld (void)
 {
 	SV_InitBoxHull ();
 	
-	memset (sv_areanodes, 0, sizeof(sv_areanodes));
-	sv_numareanodes = 0;
-	SV_CreateAreaNode (0, sv.worldmodel->mins, sv.worldmodel->maxs);
+	sv_usetree = sv_areatree.value != 0;
+	SV_ClearArea ();
+
+	memset (sv_movedslot, 0, sizeof(sv_movedslot));
+	sv_nummoved = 0;
+
+	SV_EndSpeculation ();
+}
+
+
+/*
+===============
+SV_MarkEdictMoved
+
+===============
+*/
+void SV_MarkEdictMoved (edict_t *ent)
+{
+	int		e;
+
+	SV_EdictChanged (ent);
+	e = NUM_FOR_EDICT(ent);
+	if (!e)
+		return;		// the world is never searched
+	if (sv_movedslot[e])
+		return;
+	sv_moved[sv_nummoved] = e;
+	sv_movedslot[e] = ++sv_nummoved;
+}
+
+/*
+===============
+SV_ClearEdictMoved
+
+===============
+*/
+static void SV_ClearEdictMoved (int e)
+{
+	int		slot, last;
+
+	slot = sv_movedslot[e];
+	if (!slot)
+		return;
+	last = sv_moved[--sv_nummoved];
+	sv_moved[slot - 1] = last;
+	sv_movedslot[last] = slot;
+	sv_movedslot[e] = 0;
 }
 
 
@@ -266,672 +399,2233 @@ void SV_UnlinkEdict (edict_t *ent)
 		return;		// not linked in anywhere
 	RemoveLink (&ent->area);
 	ent->area.prev = ent->area.next = NULL;
+	SV_MarkEdictMoved (ent);
 }
 
 
 /*
-====================
-SV_TouchLinks
-====================
-*/
-void SV_TouchLinks ( edict_t *ent, areanode_t *node )
-{
-	link_t		*l, *next;
-	edict_t		*touch;
-	int			old_self, old_other;
+===============================================================================
 
-// touch linked edicts
-	for (l = node->trigger_edicts.next ; l != &node->trigger_edicts ; l = next)
-	{
-		next = l->next;
-		touch = EDICT_FROM_AREA(l);
-		if (touch == ent)
-			continue;
-		if (!touch->v.touch || touch->v.solid != SOLID_TRIGGER)
-			continue;
-		if (ent->v.absmin[0] > touch->v.absmax[0]
-		|| ent->v.absmin[1] > touch->v.absmax[1]
-		|| ent->v.absmin[2] > touch->v.absmax[2]
-		|| ent->v.absmax[0] < touch->v.absmin[0]
-		|| ent->v.absmax[1] < touch->v.absmin[1]
-		|| ent->v.absmax[2] < touch->v.absmin[2] )
-			continue;
-		old_self = pr_global_struct->self;
-		old_other = pr_global_struct->other;
+AREA TREES
 
-		pr_global_struct->self = EDICT_TO_PROG(touch);
-		pr_global_struct->other = EDICT_TO_PROG(ent);
-		pr_global_struct->time = sv.time;
-		PR_ExecuteProgram (touch->v.touch);
+Each linked edict gets a leaf box: its abs box with AREA_MARGIN of slack,
+stretched AREA_PREDICT seconds along its velocity.  As long as a relink
+stays inside that box the tree is left alone, so most moves cost nothing
+here.  A leaf that has to move is pulled out and reinserted next to the
+sibling that grows the tree's surface area the least, and the boxes above
+it are refit and rotated back into balance on the way up.
 
-		pr_global_struct->self = old_self;
-		pr_global_struct->other = old_other;
-	}
-	
-// recurse down both sides
-	if (node->axis == -1)
-		return;
-	
-	if ( ent->v.absmax[node->axis] > node->dist )
-		SV_TouchLinks ( ent, node->children[0] );
-	if ( ent->v.absmin[node->axis] < node->dist )
-		SV_TouchLinks ( ent, node->children[1] );
+The box code from SV_AllocAreaBox through SV_LinkAreaBox is the same as
+in q2src/server/sv_world.c, apart from how the edict fields are reached,
+how errors are raised and what a leaf is stretched along.  A fix to one
+belongs in the other.
+
+===============================================================================
+*/
+
+/*
+===============
+SV_AllocAreaBox
+
+===============
+*/
+static int SV_AllocAreaBox (void)
+{
+	int			b;
+	areabox_t	*box;
+
+	b = sv_freeareabox;
+	if (b == -1)
+		Sys_Error ("SV_AllocAreaBox: no free boxes");
+	box = &sv_areaboxes[b];
+	sv_freeareabox = box->parent;
+
+	box->parent = -1;
+	box->children[0] = box->children[1] = -1;
+	box->ent = 0;
+	box->height = 0;
+	return b;
 }
 
+/*
+===============
+SV_FreeAreaBox
+
+===============
+*/
+static void SV_FreeAreaBox (int b)
+{
+	sv_areaboxes[b].parent = sv_freeareabox;
+	sv_areaboxes[b].height = -1;
+	sv_freeareabox = b;
+}
 
 /*
 ===============
-SV_FindTouchedLeafs
+SV_AreaBoxCost
 
+Half the surface area of a box, in double so the huge boxes can't overflow
 ===============
 */
-void SV_FindTouchedLeafs (edict_t *ent, mnode_t *node)
+static double SV_AreaBoxCost (vec3_t mins, vec3_t maxs)
 {
-	mplane_t	*splitplane;
-	mleaf_t		*leaf;
-	int			sides;
-	int			leafnum;
+	double	x, y, z;
 
-	if (node->contents == CONTENTS_SOLID)
-		return;
-	
-// add an efrag if the node is a leaf
+	x = maxs[0] - mins[0];
+	y = maxs[1] - mins[1];
+	z = maxs[2] - mins[2];
+	return x*y + y*z + z*x;
+}
 
-	if ( node->contents < 0)
-	{
-		if (ent->num_leafs == MAX_ENT_LEAFS)
-			return;
+/*
+===============
+SV_UnionAreaBoxes
 
-		leaf = (mleaf_t *)node;
-		leafnum = leaf - sv.worldmodel->leafs - 1;
+===============
+*/
+static void SV_UnionAreaBoxes (areabox_t *a, areabox_t *b, vec3_t mins, vec3_t maxs)
+{
+	int		i;
 
-		ent->leafnums[ent->num_leafs] = leafnum;
-		ent->num_leafs++;			
-		return;
+	for (i=0 ; i<3 ; i++)
+	{
+		mins[i] = a->mins[i] < b->mins[i] ? a->mins[i] : b->mins[i];
+		maxs[i] = a->maxs[i] > b->maxs[i] ? a->maxs[i] : b->maxs[i];
 	}
-	
-// NODE_MIXED
-
-	splitplane = node->plane;
-	sides = BOX_ON_PLANE_SIDE(ent->v.absmin, ent->v.absmax, splitplane);
-	
-// recurse down the contacted sides
-	if (sides & 1)
-		SV_FindTouchedLeafs (ent, node->children[0]);
-		
-	if (sides & 2)
-		SV_FindTouchedLeafs (ent, node->children[1]);
 }
 
 /*
 ===============
-SV_LinkEdict
+SV_RefitAreaBox
 
+Sets an inner box's bounds and height from its children
 ===============
 */
-void SV_LinkEdict (edict_t *ent, qboolean touch_triggers)
+static void SV_RefitAreaBox (int b)
 {
-	areanode_t	*node;
+	areabox_t	*box, *c0, *c1;
 
-	if (ent->area.prev)
-		SV_UnlinkEdict (ent);	// unlink from old position
-		
-	if (ent == sv.edicts)
-		return;		// don't add the world
+	box = &sv_areaboxes[b];
+	c0 = &sv_areaboxes[box->children[0]];
+	c1 = &sv_areaboxes[box->children[1]];
+	SV_UnionAreaBoxes (c0, c1, box->mins, box->maxs);
+	box->height = 1 + (c0->height > c1->height ? c0->height : c1->height);
+}
 
-	if (ent->free)
-		return;
+/*
+===============
+SV_BalanceAreaBox
 
-// set the abs box
+If one child of b is more than one level taller than the other, lifts it
+into b's place and returns it, otherwise returns b
+===============
+*/
+static int SV_BalanceAreaBox (int tree, int b)
+{
+	areabox_t	*box, *up, *p;
+	int			side, u, tall, shrt;
 
-#ifdef QUAKE2
-	if (ent->v.solid == SOLID_BSP && 
-	(ent->v.angles[0] || ent->v.angles[1] || ent->v.angles[2]) )
-	{	// expand for rotation
-		float		max, v;
-		int			i;
+	box = &sv_areaboxes[b];
+	if (box->height < 2)
+		return b;
 
-		max = 0;
-		for (i=0 ; i<3 ; i++)
-		{
-			v =fabs( ent->v.mins[i]);
-			if (v > max)
-				max = v;
-			v =fabs( ent->v.maxs[i]);
-			if (v > max)
-				max = v;
-		}
-		for (i=0 ; i<3 ; i++)
-		{
-			ent->v.absmin[i] = ent->v.origin[i] - max;
-			ent->v.absmax[i] = ent->v.origin[i] + max;
-		}
-	}
+	if (sv_areaboxes[box->children[1]].height - sv_areaboxes[box->children[0]].height > 1)
+		side = 1;
+	else if (sv_areaboxes[box->children[0]].height - sv_areaboxes[box->children[1]].height > 1)
+		side = 0;
 	else
-#endif
+		return b;
+
+	u = box->children[side];
+	up = &sv_areaboxes[u];
+
+// up takes b's place
+	up->parent = box->parent;
+	if (up->parent != -1)
 	{
-		VectorAdd (ent->v.origin, ent->v.mins, ent->v.absmin);	
-		VectorAdd (ent->v.origin, ent->v.maxs, ent->v.absmax);
+		p = &sv_areaboxes[up->parent];
+		p->children[p->children[0] == b ? 0 : 1] = u;
 	}
+	else
+		sv_arearoot[tree] = u;
 
-//
-// to make items easier to pick up and allow them to be grabbed off
-// of shelves, the abs sizes are expanded
-//
-	if ((int)ent->v.flags & FL_ITEM)
+// b keeps the shorter of up's children, up keeps the taller one and b
+	if (sv_areaboxes[up->children[0]].height > sv_areaboxes[up->children[1]].height)
 	{
-		ent->v.absmin[0] -= 15;
-		ent->v.absmin[1] -= 15;
-		ent->v.absmax[0] += 15;
-		ent->v.absmax[1] += 15;
+		tall = up->children[0];
+		shrt = up->children[1];
 	}
 	else
-	{	// because movement is clipped an epsilon away from an actual edge,
-		// we must fully check even when bounding boxes don't quite touch
-		ent->v.absmin[0] -= 1;
-		ent->v.absmin[1] -= 1;
-		ent->v.absmin[2] -= 1;
-		ent->v.absmax[0] += 1;
-		ent->v.absmax[1] += 1;
-		ent->v.absmax[2] += 1;
+	{
+		tall = up->children[1];
+		shrt = up->children[0];
 	}
-	
-// link to PVS leafs
-	ent->num_leafs = 0;
-	if (ent->v.modelindex)
-		SV_FindTouchedLeafs (ent, sv.worldmodel->nodes);
+	box->children[side] = shrt;
+	sv_areaboxes[shrt].parent = b;
+	up->children[0] = b;
+	up->children[1] = tall;
+	box->parent = u;
+
+	SV_RefitAreaBox (b);
+	SV_RefitAreaBox (u);
+	return u;
+}
 
-	if (ent->v.solid == SOLID_NOT)
-		return;
+/*
+===============
+SV_FixAreaBoxes
 
-// find the first node that the ent's box crosses
-	node = sv_areanodes;
-	while (1)
+Refits and rebalances b and everything above it
+===============
+*/
+static void SV_FixAreaBoxes (int tree, int b)
+{
+	while (b != -1)
 	{
-		if (node->axis == -1)
-			break;
-		if (ent->v.absmin[node->axis] > node->dist)
-			node = node->children[0];
-		else if (ent->v.absmax[node->axis] < node->dist)
-			node = node->children[1];
-		else
-			break;		// crosses the node
+		b = SV_BalanceAreaBox (tree, b);
+		SV_RefitAreaBox (b);
+		b = sv_areaboxes[b].parent;
 	}
-	
-// link it in	
-
-	if (ent->v.solid == SOLID_TRIGGER)
-		InsertLinkBefore (&ent->area, &node->trigger_edicts);
-	else
-		InsertLinkBefore (&ent->area, &node->solid_edicts);
-	
-// if touch_triggers, touch all entities at this node and decend for more
-	if (touch_triggers)
-		SV_TouchLinks ( ent, sv_areanodes );
 }
 
-
-
 /*
-===============================================================================
-
-POINT TESTING IN HULLS
+===============
+SV_InsertAreaBox
 
-===============================================================================
+===============
 */
+static void SV_InsertAreaBox (int tree, int leaf)
+{
+	areabox_t	*box, *child, *p;
+	vec3_t		mins, maxs;
+	double		area, cost, inherit, childcost[2];
+	int			b, i, np;
+
+	if (sv_arearoot[tree] == -1)
+	{
+		sv_arearoot[tree] = leaf;
+		sv_areaboxes[leaf].parent = -1;
+		return;
+	}
+
+// walk down to the sibling that costs the least surface area
+	b = sv_arearoot[tree];
+	while (sv_areaboxes[b].children[0] != -1)
+	{
+		box = &sv_areaboxes[b];
+		area = SV_AreaBoxCost (box->mins, box->maxs);
+		SV_UnionAreaBoxes (box, &sv_areaboxes[leaf], mins, maxs);
+		cost = 2 * SV_AreaBoxCost (mins, maxs);
+		inherit = cost - 2 * area;	// what every box below here grows by
+
+		for (i=0 ; i<2 ; i++)
+		{
+			child = &sv_areaboxes[box->children[i]];
+			SV_UnionAreaBoxes (child, &sv_areaboxes[leaf], mins, maxs);
+			childcost[i] = SV_AreaBoxCost (mins, maxs) + inherit;
+			if (child->children[0] != -1)
+				childcost[i] -= SV_AreaBoxCost (child->mins, child->maxs);
+		}
+
+		if (cost < childcost[0] && cost < childcost[1])
+			break;
+		b = box->children[childcost[1] < childcost[0]];
+	}
+
+// pair the leaf up with it under a new box
+	np = SV_AllocAreaBox ();
+	box = &sv_areaboxes[np];
+	box->parent = sv_areaboxes[b].parent;
+	box->children[0] = b;
+	box->children[1] = leaf;
+	SV_RefitAreaBox (np);
+
+	if (box->parent != -1)
+	{
+		p = &sv_areaboxes[box->parent];
+		p->children[p->children[0] == b ? 0 : 1] = np;
+	}
+	else
+		sv_arearoot[tree] = np;
+	sv_areaboxes[b].parent = np;
+	sv_areaboxes[leaf].parent = np;
+
+	SV_FixAreaBoxes (tree, np);
+}
+
+/*
+===============
+SV_RemoveAreaBox
+
+Takes a leaf out of its tree, freeing the box that held it and its sibling
+===============
+*/
+static void SV_RemoveAreaBox (int tree, int leaf)
+{
+	areabox_t	*p, *g;
+	int			parent, sibling;
+
+	if (sv_arearoot[tree] == leaf)
+	{
+		sv_arearoot[tree] = -1;
+		return;
+	}
+
+	parent = sv_areaboxes[leaf].parent;
+	p = &sv_areaboxes[parent];
+	sibling = p->children[p->children[0] == leaf ? 1 : 0];
+
+	if (p->parent != -1)
+	{
+		g = &sv_areaboxes[p->parent];
+		g->children[g->children[0] == parent ? 0 : 1] = sibling;
+		sv_areaboxes[sibling].parent = p->parent;
+		SV_FixAreaBoxes (tree, p->parent);
+	}
+	else
+	{
+		sv_arearoot[tree] = sibling;
+		sv_areaboxes[sibling].parent = -1;
+	}
+	SV_FreeAreaBox (parent);
+}
+
+/*
+===============
+SV_DropAreaBox
+
+Takes edict e out of the trees, if it is in one
+===============
+*/
+static void SV_DropAreaBox (int e)
+{
+	int		leaf;
+
+	leaf = sv_entareabox[e];
+	if (leaf == -1)
+		return;
+	SV_RemoveAreaBox (sv_entareatree[e], leaf);
+	SV_FreeAreaBox (leaf);
+	sv_entareabox[e] = -1;
+}
+
+/*
+===============
+SV_LinkAreaBox
+
+Puts a leaf box for ent in the tree for its solid type, or leaves the one
+it has if that still covers its abs box
+===============
+*/
+static void SV_LinkAreaBox (edict_t *ent)
+{
+	areabox_t	*box;
+	int			e, tree, leaf, i;
+	float		d;
+
+	e = NUM_FOR_EDICT(ent);
+	tree = ent->v.solid == SOLID_TRIGGER ? AREA_TRIGGER : AREA_SOLID;
+
+	leaf = sv_entareabox[e];
+	if (leaf != -1)
+	{
+		box = &sv_areaboxes[leaf];
+		for (i=0 ; i<3 ; i++)
+			if (!(ent->v.absmin[i] >= box->mins[i] && ent->v.absmax[i] <= box->maxs[i]))
+				break;
+		if (i != 3 || sv_entareatree[e] != tree)
+		{
+			SV_DropAreaBox (e);
+			leaf = -1;
+		}
+	}
+
+	if (leaf == -1)
+	{
+		leaf = SV_AllocAreaBox ();
+		box = &sv_areaboxes[leaf];
+		box->ent = e;
+		for (i=0 ; i<3 ; i++)
+		{
+			box->mins[i] = ent->v.absmin[i] - AREA_MARGIN;
+			box->maxs[i] = ent->v.absmax[i] + AREA_MARGIN;
+			d = ent->v.velocity[i] * AREA_PREDICT;
+			if (d < 0)
+				box->mins[i] += d;
+			else
+				box->maxs[i] += d;
+		// a box that isn't all numbers must still be found by everything
+			if (!(box->mins[i] > -AREA_HUGE && box->maxs[i] < AREA_HUGE))
+			{
+				box->mins[i] = -AREA_HUGE;
+				box->maxs[i] = AREA_HUGE;
+			}
+		}
+		SV_InsertAreaBox (tree, leaf);
+		sv_entareabox[e] = leaf;
+		sv_entareatree[e] = tree;
+	}
+
+	InsertLinkBefore (&ent->area, &sv_treeedicts[tree]);
+}
+
+/*
+===============
+SV_AreaTreeEdicts
+
+Fills list with the numbers of the linked edicts in a tree whose leaf
+boxes touch mins/maxs, and returns how many.  The callers do their own
+exact tests, and do them after the walk so anything they run can relink
+edicts freely.
+===============
+*/
+static int SV_AreaTreeEdicts (int tree, vec3_t mins, vec3_t maxs, short *list)
+{
+	int			stack[AREA_MAXBOXES];
+	int			b, i, sp, count;
+	areabox_t	*box, *child;
+
+	if (sv_arearoot[tree] == -1)
+		return 0;
+
+	box = &sv_areaboxes[sv_arearoot[tree]];
+	if (mins[0] > box->maxs[0]
+	|| mins[1] > box->maxs[1]
+	|| mins[2] > box->maxs[2]
+	|| maxs[0] < box->mins[0]
+	|| maxs[1] < box->mins[1]
+	|| maxs[2] < box->mins[2] )
+		return 0;
+
+// only boxes that touch go on the stack
+	count = 0;
+	sp = 0;
+	stack[sp++] = sv_arearoot[tree];
+	while (sp)
+	{
+		box = &sv_areaboxes[stack[--sp]];
+		if (box->children[0] == -1)
+		{
+			if (EDICT_NUM(box->ent)->area.prev)
+				list[count++] = box->ent;
+			continue;
+		}
+
+	// children[0] goes on top so the walk runs left to right
+		for (i=1 ; i>=0 ; i--)
+		{
+			b = box->children[i];
+			child = &sv_areaboxes[b];
+			if (mins[0] > child->maxs[0]
+			|| mins[1] > child->maxs[1]
+			|| mins[2] > child->maxs[2]
+			|| maxs[0] < child->mins[0]
+			|| maxs[1] < child->mins[1]
+			|| maxs[2] < child->mins[2] )
+				continue;
+			stack[sp++] = b;
+		}
+	}
+	return count;
+}
+
+/*
+===============
+SV_LinkArea
+
+Links ent into the area nodes or trees by its abs box
+===============
+*/
+static void SV_LinkArea (edict_t *ent)
+{
+	areanode_t	*node;
+
+	if (sv_usetree)
+	{
+		SV_LinkAreaBox (ent);
+		return;
+	}
+
+// find the first node that the ent's box crosses
+	node = sv_areanodes;
+	while (1)
+	{
+		if (node->axis == -1)
+			break;
+		if (ent->v.absmin[node->axis] > node->dist)
+			node = node->children[0];
+		else if (ent->v.absmax[node->axis] < node->dist)
+			node = node->children[1];
+		else
+			break;		// crosses the node
+	}
+	
+// link it in	
+
+	if (ent->v.solid == SOLID_TRIGGER)
+		InsertLinkBefore (&ent->area, &node->trigger_edicts);
+	else
+		InsertLinkBefore (&ent->area, &node->solid_edicts);
+}
+
+
+/*
+====================
+SV_TouchEdict
+
+Runs touch's touch function if it is a trigger ent is inside
+====================
+*/
+static void SV_TouchEdict (edict_t *ent, edict_t *touch)
+{
+	int			old_self, old_other;
+
+	if (touch == ent)
+		return;
+	if (!touch->v.touch || touch->v.solid != SOLID_TRIGGER)
+		return;
+	if (ent->v.absmin[0] > touch->v.absmax[0]
+	|| ent->v.absmin[1] > touch->v.absmax[1]
+	|| ent->v.absmin[2] > touch->v.absmax[2]
+	|| ent->v.absmax[0] < touch->v.absmin[0]
+	|| ent->v.absmax[1] < touch->v.absmin[1]
+	|| ent->v.absmax[2] < touch->v.absmin[2] )
+		return;
+	old_self = pr_global_struct->self;
+	old_other = pr_global_struct->other;
+
+	pr_global_struct->self = EDICT_TO_PROG(touch);
+	pr_global_struct->other = EDICT_TO_PROG(ent);
+	pr_global_struct->time = sv.time;
+	PR_ExecuteProgram (touch->v.touch);
+
+	pr_global_struct->self = old_self;
+	pr_global_struct->other = old_other;
+}
+
+/*
+====================
+SV_TouchLinks
+====================
+*/
+void SV_TouchLinks ( edict_t *ent, areanode_t *node )
+{
+	link_t		*l, *next;
+
+// touch linked edicts
+	for (l = node->trigger_edicts.next ; l != &node->trigger_edicts ; l = next)
+	{
+		next = l->next;
+		SV_TouchEdict (ent, EDICT_FROM_AREA(l));
+	}
+	
+// recurse down both sides
+	if (node->axis == -1)
+		return;
+	
+	if ( ent->v.absmax[node->axis] > node->dist )
+		SV_TouchLinks ( ent, node->children[0] );
+	if ( ent->v.absmin[node->axis] < node->dist )
+		SV_TouchLinks ( ent, node->children[1] );
+}
+
+
+/*
+====================
+SV_TouchAreaTree
+
+SV_TouchLinks for the trigger tree
+====================
+*/
+static void SV_TouchAreaTree (edict_t *ent)
+{
+	short	list[MAX_EDICTS];
+	int		i, count;
+	edict_t	*touch;
+
+	count = SV_AreaTreeEdicts (AREA_TRIGGER, ent->v.absmin, ent->v.absmax, list);
+	for (i=0 ; i<count ; i++)
+	{
+		touch = EDICT_NUM(list[i]);
+		if (!touch->area.prev)
+			continue;	// removed by an earlier touch
+		SV_TouchEdict (ent, touch);
+	}
+}
+
+
+/*
+===============
+SV_FindTouchedLeafs
+
+===============
+*/
+void SV_FindTouchedLeafs (edict_t *ent, mnode_t *node)
+{
+	mplane_t	*splitplane;
+	mleaf_t		*leaf;
+	int			sides;
+	int			leafnum;
+
+	if (node->contents == CONTENTS_SOLID)
+		return;
+	
+// add an efrag if the node is a leaf
+
+	if ( node->contents < 0)
+	{
+		if (ent->num_leafs == MAX_ENT_LEAFS)
+			return;
+
+		leaf = (mleaf_t *)node;
+		leafnum = leaf - sv.worldmodel->leafs - 1;
+
+		ent->leafnums[ent->num_leafs] = leafnum;
+		ent->num_leafs++;			
+		return;
+	}
+	
+// NODE_MIXED
+
+	splitplane = node->plane;
+	sides = BOX_ON_PLANE_SIDE(ent->v.absmin, ent->v.absmax, splitplane);
+	
+// recurse down the contacted sides
+	if (sides & 1)
+		SV_FindTouchedLeafs (ent, node->children[0]);
+		
+	if (sides & 2)
+		SV_FindTouchedLeafs (ent, node->children[1]);
+}
+
+/*
+===============
+SV_LinkEdict
+
+===============
+*/
+void SV_LinkEdict (edict_t *ent, qboolean touch_triggers)
+{
+	float		center;
+	int			i;
+
+	if (ent->area.prev)
+		SV_UnlinkEdict (ent);	// unlink from old position
+		
+	if (ent == sv.edicts)
+		return;		// don't add the world
+
+	SV_EdictChanged (ent);
+	SV_ClearEdictMoved (NUM_FOR_EDICT(ent));
+
+	if (ent->free)
+	{
+		SV_DropAreaBox (NUM_FOR_EDICT(ent));
+		return;
+	}
+
+// set the abs box
+
+#ifdef QUAKE2
+	if (ent->v.solid == SOLID_BSP && 
+	(ent->v.angles[0] || ent->v.angles[1] || ent->v.angles[2]) )
+	{	// expand for rotation
+		float		max, v;
+		int			i;
+
+		max = 0;
+		for (i=0 ; i<3 ; i++)
+		{
+			v =fabs( ent->v.mins[i]);
+			if (v > max)
+				max = v;
+			v =fabs( ent->v.maxs[i]);
+			if (v > max)
+				max = v;
+		}
+		for (i=0 ; i<3 ; i++)
+		{
+			ent->v.absmin[i] = ent->v.origin[i] - max;
+			ent->v.absmax[i] = ent->v.origin[i] + max;
+		}
+	}
+	else
+#endif
+	{
+		VectorAdd (ent->v.origin, ent->v.mins, ent->v.absmin);	
+		VectorAdd (ent->v.origin, ent->v.maxs, ent->v.absmax);
+	}
+
+//
+// to make items easier to pick up and allow them to be grabbed off
+// of shelves, the abs sizes are expanded
+//
+	if ((int)ent->v.flags & FL_ITEM)
+	{
+		ent->v.absmin[0] -= 15;
+		ent->v.absmin[1] -= 15;
+		ent->v.absmax[0] += 15;
+		ent->v.absmax[1] += 15;
+	}
+	else
+	{	// because movement is clipped an epsilon away from an actual edge,
+		// we must fully check even when bounding boxes don't quite touch
+		ent->v.absmin[0] -= 1;
+		ent->v.absmin[1] -= 1;
+		ent->v.absmin[2] -= 1;
+		ent->v.absmax[0] += 1;
+		ent->v.absmax[1] += 1;
+		ent->v.absmax[2] += 1;
+	}
+	
+// link to PVS leafs
+	ent->num_leafs = 0;
+	if (ent->v.modelindex)
+		SV_FindTouchedLeafs (ent, sv.worldmodel->nodes);
+
+	if (ent->v.solid == SOLID_NOT)
+	{
+		SV_DropAreaBox (NUM_FOR_EDICT(ent));
+		return;
+	}
+
+	SV_LinkArea (ent);
+
+// SV_RadiusEdicts finds edicts by the node their abs box lands in, so one
+// whose box center is outside that box (NaNs, backwards sizes) can only
+// be found through the moved list
+	for (i=0 ; i<3 ; i++)
+	{
+		center = ent->v.origin[i] + (ent->v.mins[i] + ent->v.maxs[i])*0.5;
+		if (!(center >= ent->v.absmin[i] && center <= ent->v.absmax[i]))
+		{
+			SV_MarkEdictMoved (ent);
+			break;
+		}
+	}
+	
+// if touch_triggers, touch all entities at this node and decend for more
+	if (touch_triggers)
+	{
+		if (sv_usetree)
+			SV_TouchAreaTree (ent);
+		else
+			SV_TouchLinks ( ent, sv_areanodes );
+	}
+}
+
+
+/*
+====================
+SV_RadiusEdictsNode
+
+====================
+*/
+static void SV_RadiusEdictsNode (areanode_t *node, double *lo, double *hi, unsigned *bits)
+{
+	link_t		*l;
+	int			e;
+
+	while (1)
+	{
+		for (l = node->solid_edicts.next ; l != &node->solid_edicts ; l = l->next)
+		{
+			e = NUM_FOR_EDICT(EDICT_FROM_AREA(l));
+			bits[e>>5] |= 1u << (e&31);
+		}
+		for (l = node->trigger_edicts.next ; l != &node->trigger_edicts ; l = l->next)
+		{
+			e = NUM_FOR_EDICT(EDICT_FROM_AREA(l));
+			bits[e>>5] |= 1u << (e&31);
+		}
+
+		if (node->axis == -1)
+			return;
+	// children[0] only holds boxes entirely above dist, children[1] below;
+	// the comparisons are written so a NaN bound visits both sides
+		if (!(hi[node->axis] < node->dist))
+		{
+			if (!(lo[node->axis] > node->dist))
+				SV_RadiusEdictsNode (node->children[1], lo, hi, bits);
+			node = node->children[0];
+		}
+		else
+			node = node->children[1];
+	}
+}
+
+/*
+====================
+SV_RadiusEdicts
+
+Fills list in ascending edict order with every edict that could have the
+center of its bounding box within rad of org.  That is everything linked in
+an area node the sphere reaches, plus anything that has moved since it was
+last linked.  The caller still has to test each one.
+====================
+*/
+int SV_RadiusEdicts (vec3_t org, float rad, edict_t **list)
+{
+	unsigned	bits[(MAX_EDICTS+31)/32];
+	double		lo[3], hi[3], pad;
+	int			i, e, count;
+	edict_t		*ent;
+
+	memset (bits, 0, sizeof(bits));
+
+// the box test is done in double with a unit of slack, so rounding in
+// the caller's float distance can't put a match outside it
+	for (i=0 ; i<3 ; i++)
+	{
+		pad = (double)rad + 1 + fabs(org[i]) * (1.0/4096);
+		lo[i] = org[i] - pad;
+		hi[i] = org[i] + pad;
+	}
+	if (sv_usetree)
+	{
+		short	list[MAX_EDICTS];
+		vec3_t	mins, maxs;
+		int		n;
+
+		for (i=0 ; i<3 ; i++)
+		{
+			mins[i] = lo[i];
+			maxs[i] = hi[i];
+		}
+		n = SV_AreaTreeEdicts (AREA_SOLID, mins, maxs, list);
+		n += SV_AreaTreeEdicts (AREA_TRIGGER, mins, maxs, list + n);
+		for (i=0 ; i<n ; i++)
+		{
+			e = list[i];
+			bits[e>>5] |= 1u << (e&31);
+		}
+	}
+	else
+		SV_RadiusEdictsNode (sv_areanodes, lo, hi, bits);
+
+	for (i=0 ; i<sv_nummoved ; )
+	{
+		e = sv_moved[i];
+		ent = EDICT_NUM(e);
+	// nothing but a field store can make these solid again, and that
+	// marks them moved
+		if (ent->free || (!ent->area.prev && ent->v.solid == SOLID_NOT))
+		{
+			SV_ClearEdictMoved (e);
+			continue;
+		}
+		bits[e>>5] |= 1u << (e&31);
+		i++;
+	}
+
+	count = 0;
+	for (i=0 ; i<(MAX_EDICTS+31)/32 ; i++)
+	{
+		unsigned	b;
+
+		for (e = i*32, b = bits[i] ; b ; e++, b >>= 1)
+			if (b & 1)
+				list[count++] = EDICT_NUM(e);
+	}
+	return count;
+}
+
+
+
+/*
+===============================================================================
+
+POINT TESTING IN HULLS
+
+===============================================================================
+*/
+
+#if	!id386
+
+/*
+==================
+SV_HullPointContents
+
+==================
+*/
+int SV_HullPointContents (hull_t *hull, int num, vec3_t p)
+{
+	float		d;
+	dclipnode_t	*node;
+	mplane_t	*plane;
+
+	while (num >= 0)
+	{
+		if (num < hull->firstclipnode || num > hull->lastclipnode)
+			Sys_Error ("SV_HullPointContents: bad node number");
+	
+		node = hull->clipnodes + num;
+		plane = hull->planes + node->planenum;
+		
+		if (plane->type < 3)
+			d = p[plane->type] - plane->dist;
+		else
+			d = DotProduct (plane->normal, p) - plane->dist;
+		if (d < 0)
+			num = node->children[1];
+		else
+			num = node->children[0];
+	}
+	
+	return num;
+}
+
+#endif	// !id386
+
+
+/*
+===============================================================================
+
+POINT CONTENTS GRID
+
+Up to sv_contentsgrid kilobytes of cells laid over the world model when a
+map is spawned.  A cell that is wholly inside leafs of one contents holds
+that contents, so a lookup there is a single load.  Any other cell holds
+the deepest clipnode whose subtree takes in the whole cell, and the lookup
+walks down from there instead of from the top of hull 0.
+
+===============================================================================
+*/
+
+#define	GRID_MINCELL	8		// smallest cell size
+#define	GRID_PAD		0.125	// cells are classified this much larger all round
+#define	GRID_EPSILON	0.01	// plane distances closer than this count as crossing
+
+cvar_t	sv_contentsgrid = {"sv_contentsgrid", "1024"};	// kilobytes, 0 = no grid
+
+static	short	*sv_grid;			// < 0 contents, >= 0 clipnode to start from
+static	vec3_t	sv_gridorg;
+static	float	sv_gridcell, sv_gridscale;
+static	int		sv_gridsize[3];
+static	int		sv_griduniform;		// cells that hold a contents
+static	double	sv_gridtime;		// seconds the last build took
+static	int		sv_gridhits, sv_gridwalks, sv_gridmisses;
+
+/*
+==================
+SV_BoxContents
+
+Returns the contents of every point in mins/maxs if they are all the same,
+or 0.  If start isn't NULL it gets the deepest node below num that the
+whole box falls through.
+==================
+*/
+static int SV_BoxContents (hull_t *hull, int num, vec3_t mins, vec3_t maxs, int *start)
+{
+	dclipnode_t	*node;
+	mplane_t	*plane;
+	double		dmin, dmax, d0, d1;
+	int			i, c0, c1;
+
+	while (num >= 0)
+	{
+		if (num < hull->firstclipnode || num > hull->lastclipnode)
+			Sys_Error ("SV_BoxContents: bad node number");
+
+		node = hull->clipnodes + num;
+		plane = hull->planes + node->planenum;
+
+		dmin = dmax = -plane->dist;
+		for (i=0 ; i<3 ; i++)
+		{
+			d0 = (double)plane->normal[i] * mins[i];
+			d1 = (double)plane->normal[i] * maxs[i];
+			if (d0 < d1)
+			{
+				dmin += d0;
+				dmax += d1;
+			}
+			else
+			{
+				dmin += d1;
+				dmax += d0;
+			}
+		}
+
+		if (dmin > GRID_EPSILON)
+			num = node->children[0];
+		else if (dmax < -GRID_EPSILON)
+			num = node->children[1];
+		else
+			break;
+	}
+
+	if (start)
+		*start = num;
+	if (num < 0)
+		return num;
+
+// the box is on both sides, so both have to agree
+	c0 = SV_BoxContents (hull, node->children[0], mins, maxs, NULL);
+	if (!c0)
+		return 0;
+	c1 = SV_BoxContents (hull, node->children[1], mins, maxs, NULL);
+	return c0 == c1 ? c0 : 0;
+}
+
+/*
+==================
+SV_FillContentsGrid
+
+Classifies the cells from lo up to but not including hi, starting from a
+node that holds all of them
+==================
+*/
+static void SV_FillContentsGrid (hull_t *hull, int num, int *lo, int *hi)
+{
+	vec3_t	mins, maxs;
+	int		mid[3], c, i, x, y, z, axis, start;
+
+	for (i=0 ; i<3 ; i++)
+	{
+		mins[i] = sv_gridorg[i] + lo[i] * sv_gridcell - GRID_PAD;
+		maxs[i] = sv_gridorg[i] + hi[i] * sv_gridcell + GRID_PAD;
+	}
+	c = SV_BoxContents (hull, num, mins, maxs, &start);
+
+	if (c < 0 || (hi[0] - lo[0] == 1 && hi[1] - lo[1] == 1 && hi[2] - lo[2] == 1))
+	{
+		if (c < 0)
+		{
+			start = c;
+			sv_griduniform += (hi[0] - lo[0]) * (hi[1] - lo[1]) * (hi[2] - lo[2]);
+		}
+		for (z=lo[2] ; z<hi[2] ; z++)
+			for (y=lo[1] ; y<hi[1] ; y++)
+				for (x=lo[0] ; x<hi[0] ; x++)
+					sv_grid[(z * sv_gridsize[1] + y) * sv_gridsize[0] + x] = start;
+		return;
+	}
+
+// split the longest side and try again on each half
+	axis = 0;
+	for (i=1 ; i<3 ; i++)
+		if (hi[i] - lo[i] > hi[axis] - lo[axis])
+			axis = i;
+	VectorCopy (hi, mid);
+	mid[axis] = (lo[axis] + hi[axis]) / 2;
+	SV_FillContentsGrid (hull, start, lo, mid);
+	VectorCopy (lo, mid);
+	mid[axis] = (lo[axis] + hi[axis]) / 2;
+	SV_FillContentsGrid (hull, start, mid, hi);
+}
+
+/*
+==================
+SV_BuildContentsGrid
+
+Called by SV_SpawnServer once the world model is loaded.  The cells come
+off the hunk with the rest of the map.
+==================
+*/
+void SV_BuildContentsGrid (void)
+{
+	int		i, lo[3], cells, maxcells;
+	double	time;
+
+	sv_grid = NULL;
+	sv_gridhits = sv_gridwalks = sv_gridmisses = 0;
+
+	maxcells = sv_contentsgrid.value * 1024 / sizeof(*sv_grid);
+	if (maxcells < 1)
+		return;
+
+	time = Sys_FloatTime ();
+
+// the smallest power of two cell that fits
+	for (sv_gridcell = GRID_MINCELL ; ; sv_gridcell *= 2)
+	{
+		cells = 1;
+		for (i=0 ; i<3 ; i++)
+		{
+			sv_gridsize[i] = ceil ((sv.worldmodel->maxs[i] - sv.worldmodel->mins[i]) / sv_gridcell);
+			if (sv_gridsize[i] < 1)
+				sv_gridsize[i] = 1;
+			cells *= sv_gridsize[i];
+		}
+		if (cells <= maxcells)
+			break;
+	}
+	sv_gridscale = 1.0 / sv_gridcell;
+	VectorCopy (sv.worldmodel->mins, sv_gridorg);
+
+	sv_grid = Hunk_AllocName (cells * sizeof(*sv_grid), "contents");
+	sv_griduniform = 0;
+	lo[0] = lo[1] = lo[2] = 0;
+	SV_FillContentsGrid (&sv.worldmodel->hulls[0], sv.worldmodel->hulls[0].firstclipnode, lo, sv_gridsize);
+
+	sv_gridtime = Sys_FloatTime () - time;
+	Con_DPrintf ("contents grid: %ix%ix%i cells of %g, %i%% uniform, built in %.1f ms\n",
+		sv_gridsize[0], sv_gridsize[1], sv_gridsize[2], sv_gridcell,
+		(int)(sv_griduniform * 100.0 / cells), sv_gridtime * 1000);
+}
+
+/*
+==================
+SV_ContentsGrid_f
+
+Reports the grid and how often it has answered since the map started
+==================
+*/
+void SV_ContentsGrid_f (void)
+{
+	int		cells, total;
+
+	if (!sv_grid)
+	{
+		Con_Printf ("No contents grid\n");
+		return;
+	}
+
+	cells = sv_gridsize[0] * sv_gridsize[1] * sv_gridsize[2];
+	total = sv_gridhits + sv_gridwalks + sv_gridmisses;
+	Con_Printf ("%ix%ix%i cells of %g units, %i KB, %i%% uniform, built in %.1f ms\n",
+		sv_gridsize[0], sv_gridsize[1], sv_gridsize[2], sv_gridcell,
+		(int)(cells * sizeof(*sv_grid) / 1024),
+		(int)(sv_griduniform * 100.0 / cells), sv_gridtime * 1000);
+	Con_Printf ("%i lookups: %i answered, %i walked from a cell, %i outside\n",
+		total, sv_gridhits, sv_gridwalks, sv_gridmisses);
+	if (total)
+		Con_Printf ("hit rate %.1f%%\n", sv_gridhits * 100.0 / total);
+}
+
+/*
+==================
+SV_WorldPointContents
+
+SV_HullPointContents on hull 0 of the world, through the grid
+==================
+*/
+static int SV_WorldPointContents (vec3_t p)
+{
+	int		i, cell[3], num;
+	float	f;
+
+	if (sv_grid)
+	{
+		for (i=0 ; i<3 ; i++)
+		{
+			f = (p[i] - sv_gridorg[i]) * sv_gridscale;
+			if (!(f >= 0 && f < sv_gridsize[i]))
+				break;
+			cell[i] = (int)f;
+		}
+		if (i == 3)
+		{
+			num = sv_grid[(cell[2] * sv_gridsize[1] + cell[1]) * sv_gridsize[0] + cell[0]];
+			if (num < 0)
+			{
+				sv_gridhits++;
+				return num;
+			}
+			sv_gridwalks++;
+			return SV_HullPointContents (&sv.worldmodel->hulls[0], num, p);
+		}
+		sv_gridmisses++;
+	}
+
+	return SV_HullPointContents (&sv.worldmodel->hulls[0], 0, p);
+}
+
+
+/*
+==================
+SV_PointContents
+
+==================
+*/
+int SV_PointContents (vec3_t p)
+{
+	int		cont;
+
+	cont = SV_WorldPointContents (p);
+	if (cont <= CONTENTS_CURRENT_0 && cont >= CONTENTS_CURRENT_DOWN)
+		cont = CONTENTS_WATER;
+	return cont;
+}
+
+int SV_TruePointContents (vec3_t p)
+{
+	return SV_WorldPointContents (p);
+}
+
+//===========================================================================
+
+/*
+============
+SV_TestEntityPosition
+
+This could be a lot more efficient...
+============
+*/
+edict_t	*SV_TestEntityPosition (edict_t *ent)
+{
+	trace_t	trace;
+
+	trace = SV_Move (ent->v.origin, ent->v.mins, ent->v.maxs, ent->v.origin, 0, ent);
+	
+	if (trace.startsolid)
+		return sv.edicts;
+		
+	return NULL;
+}
+
+
+/*
+===============================================================================
+
+LINE TESTING IN HULLS
+
+===============================================================================
+*/
+
+// 1/32 epsilon to keep floating point happy
+#define	DIST_EPSILON	(0.03125)
+
+/*
+==================
+SV_HullLeaf
+
+Notes the contents of a leaf a trace passed through
+==================
+*/
+static void SV_HullLeaf (trace_t *trace, int num)
+{
+	if (num != CONTENTS_SOLID)
+	{
+		trace->allsolid = false;
+		if (num == CONTENTS_EMPTY)
+			trace->inopen = true;
+		else
+			trace->inwater = true;
+	}
+	else
+		trace->startsolid = true;
+}
+
+/*
+==================
+SV_RecursiveHullCheck
+
+thread is the Sys_RunJobs thread doing the trace.  Workers can't print or
+error out, so they count the fault in sv_tracefaults instead and leave the
+main thread to find it again when it redoes the trace.
+==================
+*/
+qboolean SV_RecursiveHullCheck (hull_t *hull, int num, float p1f, float p2f, vec3_t p1, vec3_t p2, trace_t *trace, int thread)
+{
+	dclipnode_t	*node;
+	mplane_t	*plane;
+	float		t1, t2;
+	float		frac;
+	int			i;
+	vec3_t		mid;
+	int			side;
+	float		midf;
+
+// check for empty
+	if (num < 0)
+	{
+		SV_HullLeaf (trace, num);
+		return true;		// empty
+	}
+
+	if (num < hull->firstclipnode || num > hull->lastclipnode)
+	{
+		if (!thread)
+			Sys_Error ("SV_RecursiveHullCheck: bad node number");
+		sv_tracefaults[thread]++;
+		return false;
+	}
+
+//
+// find the point distances
+//
+	node = hull->clipnodes + num;
+	plane = hull->planes + node->planenum;
+
+	if (plane->type < 3)
+	{
+		t1 = p1[plane->type] - plane->dist;
+		t2 = p2[plane->type] - plane->dist;
+	}
+	else
+	{
+		t1 = DotProduct (plane->normal, p1) - plane->dist;
+		t2 = DotProduct (plane->normal, p2) - plane->dist;
+	}
+	
+#if 1
+	if (t1 >= 0 && t2 >= 0)
+		return SV_RecursiveHullCheck (hull, node->children[0], p1f, p2f, p1, p2, trace, thread);
+	if (t1 < 0 && t2 < 0)
+		return SV_RecursiveHullCheck (hull, node->children[1], p1f, p2f, p1, p2, trace, thread);
+#else
+	if ( (t1 >= DIST_EPSILON && t2 >= DIST_EPSILON) || (t2 > t1 && t1 >= 0) )
+		return SV_RecursiveHullCheck (hull, node->children[0], p1f, p2f, p1, p2, trace, thread);
+	if ( (t1 <= -DIST_EPSILON && t2 <= -DIST_EPSILON) || (t2 < t1 && t1 <= 0) )
+		return SV_RecursiveHullCheck (hull, node->children[1], p1f, p2f, p1, p2, trace, thread);
+#endif
+
+// put the crosspoint DIST_EPSILON pixels on the near side
+	if (t1 < 0)
+		frac = (t1 + DIST_EPSILON)/(t1-t2);
+	else
+		frac = (t1 - DIST_EPSILON)/(t1-t2);
+	if (frac < 0)
+		frac = 0;
+	if (frac > 1)
+		frac = 1;
+		
+	midf = p1f + (p2f - p1f)*frac;
+	for (i=0 ; i<3 ; i++)
+		mid[i] = p1[i] + frac*(p2[i] - p1[i]);
 
-#if	!id386
+	side = (t1 < 0);
+
+// move up to the node
+	if (!SV_RecursiveHullCheck (hull, node->children[side], p1f, midf, p1, mid, trace, thread) )
+		return false;
+
+#ifdef PARANOID
+	if (SV_HullPointContents (sv_hullmodel, mid, node->children[side])
+	== CONTENTS_SOLID)
+	{
+		if (!thread)
+			Con_Printf ("mid PointInHullSolid\n");
+		return false;
+	}
+#endif
+	
+	if (SV_HullPointContents (hull, node->children[side^1], mid)
+	!= CONTENTS_SOLID)
+// go past the node
+		return SV_RecursiveHullCheck (hull, node->children[side^1], midf, p2f, mid, p2, trace, thread);
+	
+	if (trace->allsolid)
+		return false;		// never got out of the solid area
+		
+//==================
+// the other side of the node is solid, this is the impact point
+//==================
+	if (!side)
+	{
+		VectorCopy (plane->normal, trace->plane.normal);
+		trace->plane.dist = plane->dist;
+	}
+	else
+	{
+		VectorSubtract (vec3_origin, plane->normal, trace->plane.normal);
+		trace->plane.dist = -plane->dist;
+	}
+
+	while (SV_HullPointContents (hull, hull->firstclipnode, mid)
+	== CONTENTS_SOLID)
+	{ // shouldn't really happen, but does occasionally
+		frac -= 0.1;
+		if (frac < 0)
+		{
+			trace->fraction = midf;
+			VectorCopy (mid, trace->endpos);
+			if (!thread)
+				Con_DPrintf ("backup past 0\n");
+			return false;
+		}
+		midf = p1f + (p2f - p1f)*frac;
+		for (i=0 ; i<3 ; i++)
+			mid[i] = p1[i] + frac*(p2[i] - p1[i]);
+	}
+
+	trace->fraction = midf;
+	VectorCopy (mid, trace->endpos);
+
+	return false;
+}
+
+
+/*
+==================
+SV_ClipMoveToEntity
+
+Handles selection or creation of a clipping hull, and offseting (and
+eventually rotation) of the end points
+==================
+*/
+trace_t SV_ClipMoveToEntity (edict_t *ent, vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int thread)
+{
+	trace_t		trace;
+	vec3_t		offset;
+	vec3_t		start_l, end_l;
+	hull_t		*hull;
+
+// fill in a default trace
+	memset (&trace, 0, sizeof(trace_t));
+	trace.fraction = 1;
+	trace.allsolid = true;
+	VectorCopy (end, trace.endpos);
+
+// get the clipping hull
+	hull = SV_HullForEntity (ent, mins, maxs, offset, thread);
+
+	VectorSubtract (start, offset, start_l);
+	VectorSubtract (end, offset, end_l);
+
+#ifdef QUAKE2
+	// rotate start and end into the models frame of reference
+	if (ent->v.solid == SOLID_BSP && 
+	(ent->v.angles[0] || ent->v.angles[1] || ent->v.angles[2]) )
+	{
+		vec3_t	a;
+		vec3_t	forward, right, up;
+		vec3_t	temp;
+
+		AngleVectors (ent->v.angles, forward, right, up);
+
+		VectorCopy (start_l, temp);
+		start_l[0] = DotProduct (temp, forward);
+		start_l[1] = -DotProduct (temp, right);
+		start_l[2] = DotProduct (temp, up);
+
+		VectorCopy (end_l, temp);
+		end_l[0] = DotProduct (temp, forward);
+		end_l[1] = -DotProduct (temp, right);
+		end_l[2] = DotProduct (temp, up);
+	}
+#endif
+
+// trace a line through the apropriate clipping hull
+	SV_RecursiveHullCheck (hull, hull->firstclipnode, 0, 1, start_l, end_l, &trace, thread);
+
+#ifdef QUAKE2
+	// rotate endpos back to world frame of reference
+	if (ent->v.solid == SOLID_BSP && 
+	(ent->v.angles[0] || ent->v.angles[1] || ent->v.angles[2]) )
+	{
+		vec3_t	a;
+		vec3_t	forward, right, up;
+		vec3_t	temp;
+
+		if (trace.fraction != 1)
+		{
+			VectorSubtract (vec3_origin, ent->v.angles, a);
+			AngleVectors (a, forward, right, up);
+
+			VectorCopy (trace.endpos, temp);
+			trace.endpos[0] = DotProduct (temp, forward);
+			trace.endpos[1] = -DotProduct (temp, right);
+			trace.endpos[2] = DotProduct (temp, up);
+
+			VectorCopy (trace.plane.normal, temp);
+			trace.plane.normal[0] = DotProduct (temp, forward);
+			trace.plane.normal[1] = -DotProduct (temp, right);
+			trace.plane.normal[2] = DotProduct (temp, up);
+		}
+	}
+#endif
+
+// fix trace up by the offset
+	if (trace.fraction != 1)
+		VectorAdd (trace.endpos, offset, trace.endpos);
+
+// did we clip the move?
+	if (trace.fraction < 1 || trace.startsolid  )
+		trace.ent = ent;
+
+	return trace;
+}
+
+//===========================================================================
+
+/*
+====================
+SV_ClipToEdict
+
+Clips the move against one solid edict.  Returns false once the move is
+allsolid and nothing else can change it.
+====================
+*/
+static qboolean SV_ClipToEdict (edict_t *touch, moveclip_t *clip)
+{
+	trace_t		trace;
+
+	if (touch->v.solid == SOLID_NOT)
+		return true;
+	if (touch == clip->passedict)
+		return true;
+	if (touch->v.solid == SOLID_TRIGGER)
+		Sys_Error ("Trigger in clipping list");
+
+	if (clip->type == MOVE_NOMONSTERS && touch->v.solid != SOLID_BSP)
+		return true;
+
+	if (clip->boxmins[0] > touch->v.absmax[0]
+	|| clip->boxmins[1] > touch->v.absmax[1]
+	|| clip->boxmins[2] > touch->v.absmax[2]
+	|| clip->boxmaxs[0] < touch->v.absmin[0]
+	|| clip->boxmaxs[1] < touch->v.absmin[1]
+	|| clip->boxmaxs[2] < touch->v.absmin[2] )
+		return true;
+
+	if (clip->touched)
+	{
+		if (clip->numtouched < MAX_SPECTOUCHED)
+			clip->touched[clip->numtouched] = NUM_FOR_EDICT(touch);
+		clip->numtouched++;
+	}
+
+	if (clip->passedict && clip->passedict->v.size[0] && !touch->v.size[0])
+		return true;	// points never interact
+
+// might intersect, so do an exact clip
+	if (clip->trace.allsolid)
+		return false;
+	if (clip->passedict)
+	{
+	 	if (PROG_TO_EDICT(touch->v.owner) == clip->passedict)
+			return true;	// don't clip against own missiles
+		if (PROG_TO_EDICT(clip->passedict->v.owner) == touch)
+			return true;	// don't clip against owner
+	}
+
+	if ((int)touch->v.flags & FL_MONSTER)
+		trace = SV_ClipMoveToEntity (touch, clip->start, clip->mins2, clip->maxs2, clip->end, clip->thread);
+	else
+		trace = SV_ClipMoveToEntity (touch, clip->start, clip->mins, clip->maxs, clip->end, clip->thread);
+	if (trace.allsolid || trace.startsolid ||
+	trace.fraction < clip->trace.fraction)
+	{
+		trace.ent = touch;
+	 	if (clip->trace.startsolid)
+		{
+			clip->trace = trace;
+			clip->trace.startsolid = true;
+		}
+		else
+			clip->trace = trace;
+	}
+	else if (trace.startsolid)
+		clip->trace.startsolid = true;
+
+	return true;
+}
+
+/*
+====================
+SV_ClipToLinks
+
+Mins and maxs enclose the entire area swept by the move
+====================
+*/
+void SV_ClipToLinks ( areanode_t *node, moveclip_t *clip )
+{
+	link_t		*l, *next;
+
+// touch linked edicts
+	for (l = node->solid_edicts.next ; l != &node->solid_edicts ; l = next)
+	{
+		next = l->next;
+		if (!SV_ClipToEdict (EDICT_FROM_AREA(l), clip))
+			return;
+	}
+	
+// recurse down both sides
+	if (node->axis == -1)
+		return;
+
+	if ( clip->boxmaxs[node->axis] > node->dist )
+		SV_ClipToLinks ( node->children[0], clip );
+	if ( clip->boxmins[node->axis] < node->dist )
+		SV_ClipToLinks ( node->children[1], clip );
+}
+
+
+/*
+====================
+SV_ClipToEntities
+
+Clips the move against every solid edict its box reaches.  The tree's
+edicts are clipped in edict order, so which of two equal hits wins never
+depends on how the tree happens to be shaped.
+====================
+*/
+static void SV_ClipToEntities (moveclip_t *clip)
+{
+	short		list[MAX_EDICTS];
+	unsigned	bits[(MAX_EDICTS+31)/32], b;
+	int			i, e, count;
+
+	if (!sv_usetree)
+	{
+		SV_ClipToLinks ( sv_areanodes, clip );
+		return;
+	}
+
+	count = SV_AreaTreeEdicts (AREA_SOLID, clip->boxmins, clip->boxmaxs, list);
+	if (!count)
+		return;
+	memset (bits, 0, sizeof(bits));
+	for (i=0 ; i<count ; i++)
+		bits[list[i]>>5] |= 1u << (list[i]&31);
+
+	for (i=0 ; i<(MAX_EDICTS+31)/32 ; i++)
+		for (e = i*32, b = bits[i] ; b ; e++, b >>= 1)
+			if (b & 1)
+				if (!SV_ClipToEdict (EDICT_NUM(e), clip))
+					return;
+}
+
+
+/*
+==================
+SV_MoveBounds
+==================
+*/
+void SV_MoveBounds (vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, vec3_t boxmins, vec3_t boxmaxs)
+{
+#if 0
+// debug to test against everything
+boxmins[0] = boxmins[1] = boxmins[2] = -9999;
+boxmaxs[0] = boxmaxs[1] = boxmaxs[2] = 9999;
+#else
+	int		i;
+	
+	for (i=0 ; i<3 ; i++)
+	{
+		if (end[i] > start[i])
+		{
+			boxmins[i] = start[i] + mins[i] - 1;
+			boxmaxs[i] = end[i] + maxs[i] + 1;
+		}
+		else
+		{
+			boxmins[i] = end[i] + mins[i] - 1;
+			boxmaxs[i] = start[i] + maxs[i] + 1;
+		}
+	}
+#endif
+}
 
 /*
 ==================
-SV_HullPointContents
+SV_ClipMove
 
+The body of SV_Move.  clip->thread and clip->touched are left as the caller
+set them; clip->trace is the result.
 ==================
 */
-int SV_HullPointContents (hull_t *hull, int num, vec3_t p)
+static void SV_ClipMove (moveclip_t *clip, vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int type, edict_t *passedict)
 {
-	float		d;
-	dclipnode_t	*node;
-	mplane_t	*plane;
+	int			i;
 
-	while (num >= 0)
+// clip to world
+	clip->trace = SV_ClipMoveToEntity ( sv.edicts, start, mins, maxs, end, clip->thread );
+
+	clip->start = start;
+	clip->end = end;
+	clip->mins = mins;
+	clip->maxs = maxs;
+	clip->type = type;
+	clip->passedict = passedict;
+
+	if (type == MOVE_MISSILE)
 	{
-		if (num < hull->firstclipnode || num > hull->lastclipnode)
-			Sys_Error ("SV_HullPointContents: bad node number");
-	
-		node = hull->clipnodes + num;
-		plane = hull->planes + node->planenum;
-		
-		if (plane->type < 3)
-			d = p[plane->type] - plane->dist;
-		else
-			d = DotProduct (plane->normal, p) - plane->dist;
-		if (d < 0)
-			num = node->children[1];
-		else
-			num = node->children[0];
+		for (i=0 ; i<3 ; i++)
+		{
+			clip->mins2[i] = -15;
+			clip->maxs2[i] = 15;
+		}
+	}
+	else
+	{
+		VectorCopy (mins, clip->mins2);
+		VectorCopy (maxs, clip->maxs2);
 	}
 	
-	return num;
-}
-
-#endif	// !id386
+// create the bounding box of the entire move
+	SV_MoveBounds ( start, clip->mins2, clip->maxs2, end, clip->boxmins, clip->boxmaxs );
 
+// clip to entities
+	SV_ClipToEntities (clip);
+}
 
 /*
 ==================
-SV_PointContents
-
+SV_Move
 ==================
 */
-int SV_PointContents (vec3_t p)
+trace_t SV_Move (vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int type, edict_t *passedict)
 {
-	int		cont;
+	moveclip_t	clip;
 
-	cont = SV_HullPointContents (&sv.worldmodel->hulls[0], 0, p);
-	if (cont <= CONTENTS_CURRENT_0 && cont >= CONTENTS_CURRENT_DOWN)
-		cont = CONTENTS_WATER;
-	return cont;
-}
+	if (passedict && sv_numspeculated)
+		if (SV_SpeculatedMove (start, mins, maxs, end, type, passedict, &clip.trace))
+			return clip.trace;
 
-int SV_TruePointContents (vec3_t p)
-{
-	return SV_HullPointContents (&sv.worldmodel->hulls[0], 0, p);
+	memset ( &clip, 0, sizeof ( moveclip_t ) );
+	SV_ClipMove (&clip, start, mins, maxs, end, type, passedict);
+
+	return clip.trace;
 }
 
-//===========================================================================
+
 
 /*
-============
-SV_TestEntityPosition
+===============================================================================
 
-This could be a lot more efficient...
-============
+SPECULATIVE MOVES
+
+SV_Physics guesses the first move each falling or flying edict will make
+this frame and hands them to SV_SpeculateMoves, which traces them all on
+the worker threads before anything else runs.  The frame then runs
+serially as always, and when SV_Move is asked for a move it already has,
+it returns the stored trace instead of doing it again.
+
+That is only allowed when nothing the trace read can have changed.  A
+trace reads the world hull, which never changes, and the fields of the
+solid edicts linked around its box.  Relinks, unlinks, SV_MarkEdictMoved
+and progs stores to a field a trace reads all put the edict on a changed
+list, and a stored trace is thrown away if a changed edict is one it got
+past the box test for, or is linked now with a box that touches the move.
+Every other edict is exactly as it was, so the stored trace is the one a
+trace now would give.
+
+===============================================================================
 */
-edict_t	*SV_TestEntityPosition (edict_t *ent)
+
+typedef struct
 {
-	trace_t	trace;
+	vec3_t		start, mins, maxs, end;
+	int			type;
+	trace_t		trace;
+	vec3_t		boxmins, boxmaxs;
+	short		touched[MAX_SPECTOUCHED];
+	int			numtouched;		// more than MAX_SPECTOUCHED = never use
+	qboolean	valid;
+} spectrace_t;
 
-	trace = SV_Move (ent->v.origin, ent->v.mins, ent->v.maxs, ent->v.origin, 0, ent);
-	
-	if (trace.startsolid)
-		return sv.edicts;
-		
-	return NULL;
-}
+#define	SPEC_JOBSIZE	8		// moves traced by each job
 
+cvar_t	sv_parallelcheck = {"sv_parallelcheck", "0"};	// 1 = trace every hit again and compare
 
-/*
-===============================================================================
+static	spectrace_t	sv_spectraces[MAX_EDICTS];	// by passedict
+static	short		sv_specents[MAX_EDICTS];
+static	short		sv_changed[MAX_EDICTS];
+static	byte		sv_changedflag[MAX_EDICTS];
+static	int			sv_numchanged;
+static	int			sv_specmoves, sv_spechits, sv_specmisses, sv_specmismatches;
+static	double		sv_spectime;
 
-LINE TESTING IN HULLS
+/*
+===============
+SV_EdictChanged
 
-===============================================================================
+===============
 */
+void SV_EdictChanged (edict_t *ent)
+{
+	int		e;
 
-// 1/32 epsilon to keep floating point happy
-#define	DIST_EPSILON	(0.03125)
+	if (!sv_numspeculated)
+		return;
+	e = NUM_FOR_EDICT(ent);
+	if (sv_changedflag[e])
+		return;
+	sv_changedflag[e] = 1;
+	sv_changed[sv_numchanged++] = e;
+}
 
 /*
-==================
-SV_RecursiveHullCheck
+===============
+SV_SpeculateJob
 
-==================
+Traces one run of the guessed moves, on any thread
+===============
 */
-qboolean SV_RecursiveHullCheck (hull_t *hull, int num, float p1f, float p2f, vec3_t p1, vec3_t p2, trace_t *trace)
+static void SV_SpeculateJob (int index, int thread)
 {
-	dclipnode_t	*node;
-	mplane_t	*plane;
-	float		t1, t2;
-	float		frac;
-	int			i;
-	vec3_t		mid;
-	int			side;
-	float		midf;
+	moveclip_t	clip;
+	spectrace_t	*s;
+	int			i, last, faults;
 
-// check for empty
-	if (num < 0)
+	last = (index + 1) * SPEC_JOBSIZE;
+	if (last > sv_numspeculated)
+		last = sv_numspeculated;
+	for (i=index*SPEC_JOBSIZE ; i<last ; i++)
 	{
-		if (num != CONTENTS_SOLID)
-		{
-			trace->allsolid = false;
-			if (num == CONTENTS_EMPTY)
-				trace->inopen = true;
-			else
-				trace->inwater = true;
-		}
-		else
-			trace->startsolid = true;
-		return true;		// empty
+		s = &sv_spectraces[sv_specents[i]];
+
+		memset (&clip, 0, sizeof(clip));
+		clip.thread = thread;
+		clip.touched = s->touched;
+		faults = sv_tracefaults[thread];
+		SV_ClipMove (&clip, s->start, s->mins, s->maxs, s->end, s->type, EDICT_NUM(sv_specents[i]));
+
+		s->trace = clip.trace;
+		s->numtouched = clip.numtouched;
+		VectorCopy (clip.boxmins, s->boxmins);
+		VectorCopy (clip.boxmaxs, s->boxmaxs);
+		s->valid = sv_tracefaults[thread] == faults;	// else SV_Move traces it again
 	}
+}
 
-	if (num < hull->firstclipnode || num > hull->lastclipnode)
-		Sys_Error ("SV_RecursiveHullCheck: bad node number");
+/*
+===============
+SV_SpeculateMoves
 
-//
-// find the point distances
-//
-	node = hull->clipnodes + num;
-	plane = hull->planes + node->planenum;
+===============
+*/
+void SV_SpeculateMoves (int count, edict_t **ents, vec3_t *ends, int *types)
+{
+	spectrace_t	*s;
+	double		time;
+	int			i, e;
 
-	if (plane->type < 3)
-	{
-		t1 = p1[plane->type] - plane->dist;
-		t2 = p2[plane->type] - plane->dist;
-	}
-	else
+	SV_EndSpeculation ();
+	if (count <= 0)
+		return;
+
+	time = Sys_FloatTime ();
+	for (i=0 ; i<count ; i++)
 	{
-		t1 = DotProduct (plane->normal, p1) - plane->dist;
-		t2 = DotProduct (plane->normal, p2) - plane->dist;
+		e = NUM_FOR_EDICT(ents[i]);
+		s = &sv_spectraces[e];
+		VectorCopy (ents[i]->v.origin, s->start);
+		VectorCopy (ents[i]->v.mins, s->mins);
+		VectorCopy (ents[i]->v.maxs, s->maxs);
+		VectorCopy (ends[i], s->end);
+		s->type = types[i];
+		sv_specents[i] = e;
 	}
-	
-#if 1
-	if (t1 >= 0 && t2 >= 0)
-		return SV_RecursiveHullCheck (hull, node->children[0], p1f, p2f, p1, p2, trace);
-	if (t1 < 0 && t2 < 0)
-		return SV_RecursiveHullCheck (hull, node->children[1], p1f, p2f, p1, p2, trace);
-#else
-	if ( (t1 >= DIST_EPSILON && t2 >= DIST_EPSILON) || (t2 > t1 && t1 >= 0) )
-		return SV_RecursiveHullCheck (hull, node->children[0], p1f, p2f, p1, p2, trace);
-	if ( (t1 <= -DIST_EPSILON && t2 <= -DIST_EPSILON) || (t2 < t1 && t1 <= 0) )
-		return SV_RecursiveHullCheck (hull, node->children[1], p1f, p2f, p1, p2, trace);
-#endif
+	sv_numspeculated = count;
 
-// put the crosspoint DIST_EPSILON pixels on the near side
-	if (t1 < 0)
-		frac = (t1 + DIST_EPSILON)/(t1-t2);
-	else
-		frac = (t1 - DIST_EPSILON)/(t1-t2);
-	if (frac < 0)
-		frac = 0;
-	if (frac > 1)
-		frac = 1;
-		
-	midf = p1f + (p2f - p1f)*frac;
-	for (i=0 ; i<3 ; i++)
-		mid[i] = p1[i] + frac*(p2[i] - p1[i]);
+	Sys_RunJobs ((count + SPEC_JOBSIZE - 1) / SPEC_JOBSIZE, SV_SpeculateJob);
 
-	side = (t1 < 0);
+	sv_specmoves += count;
+	sv_spectime += Sys_FloatTime () - time;
+}
 
-// move up to the node
-	if (!SV_RecursiveHullCheck (hull, node->children[side], p1f, midf, p1, mid, trace) )
-		return false;
+/*
+===============
+SV_EndSpeculation
 
-#ifdef PARANOID
-	if (SV_HullPointContents (sv_hullmodel, mid, node->children[side])
-	== CONTENTS_SOLID)
+===============
+*/
+void SV_EndSpeculation (void)
+{
+	int		i;
+
+	for (i=0 ; i<sv_numspeculated ; i++)
+		sv_spectraces[sv_specents[i]].valid = false;
+	sv_numspeculated = 0;
+
+	for (i=0 ; i<sv_numchanged ; i++)
+		sv_changedflag[sv_changed[i]] = 0;
+	sv_numchanged = 0;
+}
+
+/*
+===============
+SV_SpeculatedMove
+
+Fills in trace and returns true if the move was traced ahead of time and
+is still good.
+===============
+*/
+static qboolean SV_SpeculatedMove (vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int type, edict_t *passedict, trace_t *trace)
+{
+	spectrace_t	*s;
+	edict_t		*check;
+	moveclip_t	clip;
+	int			e, i, j;
+
+	e = NUM_FOR_EDICT(passedict);
+	s = &sv_spectraces[e];
+	if (!s->valid || type != s->type
+	|| memcmp (start, s->start, sizeof(vec3_t))
+	|| memcmp (mins, s->mins, sizeof(vec3_t))
+	|| memcmp (maxs, s->maxs, sizeof(vec3_t))
+	|| memcmp (end, s->end, sizeof(vec3_t)) )
+		return false;	// not the move that was guessed
+	s->valid = false;
+
+	if (s->numtouched > MAX_SPECTOUCHED || sv_changedflag[e])
 	{
-		Con_Printf ("mid PointInHullSolid\n");
+		sv_specmisses++;
 		return false;
 	}
-#endif
-	
-	if (SV_HullPointContents (hull, node->children[side^1], mid)
-	!= CONTENTS_SOLID)
-// go past the node
-		return SV_RecursiveHullCheck (hull, node->children[side^1], midf, p2f, mid, p2, trace);
-	
-	if (trace->allsolid)
-		return false;		// never got out of the solid area
-		
-//==================
-// the other side of the node is solid, this is the impact point
-//==================
-	if (!side)
+	for (i=0 ; i<sv_numchanged ; i++)
 	{
-		VectorCopy (plane->normal, trace->plane.normal);
-		trace->plane.dist = plane->dist;
+		for (j=0 ; j<s->numtouched ; j++)
+			if (s->touched[j] == sv_changed[i])
+				break;
+		if (j < s->numtouched)
+			break;
+
+		check = EDICT_NUM(sv_changed[i]);
+		if (!check->area.prev)
+			continue;
+		if (s->boxmins[0] > check->v.absmax[0]
+		|| s->boxmins[1] > check->v.absmax[1]
+		|| s->boxmins[2] > check->v.absmax[2]
+		|| s->boxmaxs[0] < check->v.absmin[0]
+		|| s->boxmaxs[1] < check->v.absmin[1]
+		|| s->boxmaxs[2] < check->v.absmin[2] )
+			continue;
+		break;
 	}
-	else
+	if (i < sv_numchanged)
 	{
-		VectorSubtract (vec3_origin, plane->normal, trace->plane.normal);
-		trace->plane.dist = -plane->dist;
+		sv_specmisses++;
+		return false;
 	}
 
-	while (SV_HullPointContents (hull, hull->firstclipnode, mid)
-	== CONTENTS_SOLID)
-	{ // shouldn't really happen, but does occasionally
-		frac -= 0.1;
-		if (frac < 0)
+	sv_spechits++;
+	*trace = s->trace;
+
+	if (sv_parallelcheck.value)
+	{
+		memset (&clip, 0, sizeof(clip));
+		SV_ClipMove (&clip, start, mins, maxs, end, type, passedict);
+		if (memcmp (&clip.trace, trace, sizeof(trace_t)))
 		{
-			trace->fraction = midf;
-			VectorCopy (mid, trace->endpos);
-			Con_DPrintf ("backup past 0\n");
-			return false;
+			sv_specmismatches++;
+			Con_Printf ("SV_Move: speculated move for edict %i differs\n", e);
+			*trace = clip.trace;
 		}
-		midf = p1f + (p2f - p1f)*frac;
-		for (i=0 ; i<3 ; i++)
-			mid[i] = p1[i] + frac*(p2[i] - p1[i]);
 	}
-
-	trace->fraction = midf;
-	VectorCopy (mid, trace->endpos);
-
-	return false;
+	return true;
 }
 
-
 /*
-==================
-SV_ClipMoveToEntity
+===============
+SV_Speculation_f
 
-Handles selection or creation of a clipping hull, and offseting (and
-eventually rotation) of the end points
-==================
+===============
 */
-trace_t SV_ClipMoveToEntity (edict_t *ent, vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end)
+void SV_Speculation_f (void)
 {
-	trace_t		trace;
-	vec3_t		offset;
-	vec3_t		start_l, end_l;
-	hull_t		*hull;
-
-// fill in a default trace
-	memset (&trace, 0, sizeof(trace_t));
-	trace.fraction = 1;
-	trace.allsolid = true;
-	VectorCopy (end, trace.endpos);
-
-// get the clipping hull
-	hull = SV_HullForEntity (ent, mins, maxs, offset);
-
-	VectorSubtract (start, offset, start_l);
-	VectorSubtract (end, offset, end_l);
+	int		used;
+
+	used = sv_spechits + sv_specmisses;
+	Con_Printf ("%i moves traced ahead on %i threads in %.1f ms\n", sv_specmoves, Sys_NumWorkers () + 1, sv_spectime * 1000);
+	Con_Printf ("%i used: %i hits, %i thrown away", used, sv_spechits, sv_specmisses);
+	if (used)
+		Con_Printf (" (%.1f%% hits)", 100.0 * sv_spechits / used);
+	Con_Printf ("\n");
+	if (sv_parallelcheck.value)
+		Con_Printf ("%i hits differed from a serial trace\n", sv_specmismatches);
+
+	sv_specmoves = sv_spechits = sv_specmisses = sv_specmismatches = 0;
+	sv_spectime = 0;
+}
 
-#ifdef QUAKE2
-	// rotate start and end into the models frame of reference
-	if (ent->v.solid == SOLID_BSP && 
-	(ent->v.angles[0] || ent->v.angles[1] || ent->v.angles[2]) )
-	{
-		vec3_t	a;
-		vec3_t	forward, right, up;
-		vec3_t	temp;
+/*
+===============================================================================
 
-		AngleVectors (ent->v.angles, forward, right, up);
+BATCHED TRACES
 
-		VectorCopy (start_l, temp);
-		start_l[0] = DotProduct (temp, forward);
-		start_l[1] = -DotProduct (temp, right);
-		start_l[2] = DotProduct (temp, up);
+Many traces with the same size and the same passedict, like shotgun
+pellets or the corner probes in SV_CheckBottom, walk the clipnodes of the
+world hull together.  At every node the plane distances of all the rays
+are found at once and the rays that stay on one side are passed down as
+a group; a ray that crosses the plane gets the full SV_RecursiveHullCheck
+from that node, which is exactly where the single trace would have
+started splitting.  Entities are not shared: each move goes through
+SV_ClipToEntities with its own box, so the area nodes and every entity
+hull are walked once per move.  The traces come out the same as calling
+SV_Move for each one.
 
-		VectorCopy (end_l, temp);
-		end_l[0] = DotProduct (temp, forward);
-		end_l[1] = -DotProduct (temp, right);
-		end_l[2] = DotProduct (temp, up);
-	}
+The distances are done four at a time with SSE only when the compiler
+targets it (x86-64, or -msse and up on x86).  The default -m32 build
+doesn't, and uses the scalar loop.
+
+===============================================================================
+*/
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define	BATCH_SSE
+#include <xmmintrin.h>
 #endif
 
-// trace a line through the apropriate clipping hull
-	SV_RecursiveHullCheck (hull, hull->firstclipnode, 0, 1, start_l, end_l, &trace);
+typedef struct
+{
+	hull_t		*hull;
+	trace_t		*traces[MAX_BATCH_TRACES];
+	float		p1[3][MAX_BATCH_TRACES+3];	// start points, padded for whole vectors
+	float		p2[3][MAX_BATCH_TRACES+3];
+} hullbatch_t;
 
-#ifdef QUAKE2
-	// rotate endpos back to world frame of reference
-	if (ent->v.solid == SOLID_BSP && 
-	(ent->v.angles[0] || ent->v.angles[1] || ent->v.angles[2]) )
-	{
-		vec3_t	a;
-		vec3_t	forward, right, up;
-		vec3_t	temp;
 
-		if (trace.fraction != 1)
-		{
-			VectorSubtract (vec3_origin, ent->v.angles, a);
-			AngleVectors (a, forward, right, up);
+/*
+==================
+SV_BatchSides
 
-			VectorCopy (trace.endpos, temp);
-			trace.endpos[0] = DotProduct (temp, forward);
-			trace.endpos[1] = -DotProduct (temp, right);
-			trace.endpos[2] = DotProduct (temp, up);
+Sets side[] to 0 for rays entirely in front of the plane, 1 for rays
+entirely behind it and 2 for rays that cross it.  The distances are the
+same float expressions SV_RecursiveHullCheck uses.
+==================
+*/
+static void SV_BatchSides (hullbatch_t *b, mplane_t *plane, int lo, int hi, byte *side)
+{
+	int		i, j, front, back;
+#ifdef BATCH_SSE
+	__m128	t1, t2, d, n0, n1, n2, zero;
 
-			VectorCopy (trace.plane.normal, temp);
-			trace.plane.normal[0] = DotProduct (temp, forward);
-			trace.plane.normal[1] = -DotProduct (temp, right);
-			trace.plane.normal[2] = DotProduct (temp, up);
+	d = _mm_set1_ps (plane->dist);
+	zero = _mm_setzero_ps ();
+	n0 = _mm_set1_ps (plane->normal[0]);
+	n1 = _mm_set1_ps (plane->normal[1]);
+	n2 = _mm_set1_ps (plane->normal[2]);
+
+	for (i=lo ; i<hi ; i+=4)
+	{
+		if (plane->type < 3)
+		{
+			t1 = _mm_sub_ps (_mm_loadu_ps (&b->p1[plane->type][i]), d);
+			t2 = _mm_sub_ps (_mm_loadu_ps (&b->p2[plane->type][i]), d);
+		}
+		else
+		{
+			t1 = _mm_add_ps (_mm_mul_ps (n0, _mm_loadu_ps (&b->p1[0][i])), _mm_mul_ps (n1, _mm_loadu_ps (&b->p1[1][i])));
+			t1 = _mm_sub_ps (_mm_add_ps (t1, _mm_mul_ps (n2, _mm_loadu_ps (&b->p1[2][i]))), d);
+			t2 = _mm_add_ps (_mm_mul_ps (n0, _mm_loadu_ps (&b->p2[0][i])), _mm_mul_ps (n1, _mm_loadu_ps (&b->p2[1][i])));
+			t2 = _mm_sub_ps (_mm_add_ps (t2, _mm_mul_ps (n2, _mm_loadu_ps (&b->p2[2][i]))), d);
 		}
+		front = _mm_movemask_ps (_mm_and_ps (_mm_cmpge_ps (t1, zero), _mm_cmpge_ps (t2, zero)));
+		back = _mm_movemask_ps (_mm_and_ps (_mm_cmplt_ps (t1, zero), _mm_cmplt_ps (t2, zero)));
+		for (j=0 ; j<4 && i+j<hi ; j++)
+			side[i+j-lo] = (front & (1<<j)) ? 0 : (back & (1<<j)) ? 1 : 2;
 	}
-#endif
-
-// fix trace up by the offset
-	if (trace.fraction != 1)
-		VectorAdd (trace.endpos, offset, trace.endpos);
-
-// did we clip the move?
-	if (trace.fraction < 1 || trace.startsolid  )
-		trace.ent = ent;
+#else
+	float	t1, t2;
 
-	return trace;
+	for (i=lo ; i<hi ; i++)
+	{
+		if (plane->type < 3)
+		{
+			t1 = b->p1[plane->type][i] - plane->dist;
+			t2 = b->p2[plane->type][i] - plane->dist;
+		}
+		else
+		{
+			t1 = plane->normal[0]*b->p1[0][i] + plane->normal[1]*b->p1[1][i] + plane->normal[2]*b->p1[2][i] - plane->dist;
+			t2 = plane->normal[0]*b->p2[0][i] + plane->normal[1]*b->p2[1][i] + plane->normal[2]*b->p2[2][i] - plane->dist;
+		}
+		front = t1 >= 0 && t2 >= 0;
+		back = t1 < 0 && t2 < 0;
+		side[i-lo] = front ? 0 : back ? 1 : 2;
+	}
+#endif
 }
 
-//===========================================================================
+/*
+==================
+SV_BatchSwapRays
+==================
+*/
+static void SV_BatchSwapRays (hullbatch_t *b, int i, int j)
+{
+	int		k;
+	float	f;
+	trace_t	*t;
+
+	t = b->traces[i];
+	b->traces[i] = b->traces[j];
+	b->traces[j] = t;
+	for (k=0 ; k<3 ; k++)
+	{
+		f = b->p1[k][i];
+		b->p1[k][i] = b->p1[k][j];
+		b->p1[k][j] = f;
+		f = b->p2[k][i];
+		b->p2[k][i] = b->p2[k][j];
+		b->p2[k][j] = f;
+	}
+}
 
 /*
-====================
-SV_ClipToLinks
+==================
+SV_BatchHullCheck
 
-Mins and maxs enclose the entire area swept by the move
-====================
+Traces rays lo through hi-1 of the batch from node num
+==================
 */
-void SV_ClipToLinks ( areanode_t *node, moveclip_t *clip )
+static void SV_BatchHullCheck (hullbatch_t *b, int num, int lo, int hi)
 {
-	link_t		*l, *next;
-	edict_t		*touch;
-	trace_t		trace;
+	hull_t		*hull;
+	dclipnode_t	*node;
+	int			i, j, k, mid;
+	byte		side[MAX_BATCH_TRACES];
+	vec3_t		p1, p2;
 
-// touch linked edicts
-	for (l = node->solid_edicts.next ; l != &node->solid_edicts ; l = next)
+	hull = b->hull;
+	while (lo < hi)
 	{
-		next = l->next;
-		touch = EDICT_FROM_AREA(l);
-		if (touch->v.solid == SOLID_NOT)
-			continue;
-		if (touch == clip->passedict)
-			continue;
-		if (touch->v.solid == SOLID_TRIGGER)
-			Sys_Error ("Trigger in clipping list");
+		if (num < 0)
+		{
+			for (i=lo ; i<hi ; i++)
+				SV_HullLeaf (b->traces[i], num);
+			return;
+		}
 
-		if (clip->type == MOVE_NOMONSTERS && touch->v.solid != SOLID_BSP)
-			continue;
+		if (hi - lo == 1)
+		{	// nothing left to share the walk with
+			for (k=0 ; k<3 ; k++)
+			{
+				p1[k] = b->p1[k][lo];
+				p2[k] = b->p2[k][lo];
+			}
+			SV_RecursiveHullCheck (hull, num, 0, 1, p1, p2, b->traces[lo], 0);
+			return;
+		}
 
-		if (clip->boxmins[0] > touch->v.absmax[0]
-		|| clip->boxmins[1] > touch->v.absmax[1]
-		|| clip->boxmins[2] > touch->v.absmax[2]
-		|| clip->boxmaxs[0] < touch->v.absmin[0]
-		|| clip->boxmaxs[1] < touch->v.absmin[1]
-		|| clip->boxmaxs[2] < touch->v.absmin[2] )
-			continue;
+		if (num < hull->firstclipnode || num > hull->lastclipnode)
+			Sys_Error ("SV_BatchHullCheck: bad node number");
 
-		if (clip->passedict && clip->passedict->v.size[0] && !touch->v.size[0])
-			continue;	// points never interact
+		node = hull->clipnodes + num;
+		SV_BatchSides (b, hull->planes + node->planenum, lo, hi, side);
 
-	// might intersect, so do an exact clip
-		if (clip->trace.allsolid)
-			return;
-		if (clip->passedict)
+	// rays that cross the plane are finished one at a time, the rest
+	// are packed down to the front of the range
+		for (i=j=lo ; i<hi ; i++)
+		{
+			if (side[i-lo] == 2)
+			{
+				for (k=0 ; k<3 ; k++)
+				{
+					p1[k] = b->p1[k][i];
+					p2[k] = b->p2[k][i];
+				}
+				SV_RecursiveHullCheck (hull, num, 0, 1, p1, p2, b->traces[i], 0);
+				continue;
+			}
+			if (j != i)
+			{
+				SV_BatchSwapRays (b, i, j);
+				side[j-lo] = side[i-lo];
+			}
+			j++;
+		}
+		hi = j;
+
+	// front side rays first
+		i = lo;
+		j = hi - 1;
+		while (1)
 		{
-		 	if (PROG_TO_EDICT(touch->v.owner) == clip->passedict)
-				continue;	// don't clip against own missiles
-			if (PROG_TO_EDICT(clip->passedict->v.owner) == touch)
-				continue;	// don't clip against owner
+			while (i <= j && side[i-lo] == 0)
+				i++;
+			while (i <= j && side[j-lo] == 1)
+				j--;
+			if (i >= j)
+				break;
+			SV_BatchSwapRays (b, i, j);
+			side[i-lo] = 0;
+			side[j-lo] = 1;
 		}
+		mid = i;
 
-		if ((int)touch->v.flags & FL_MONSTER)
-			trace = SV_ClipMoveToEntity (touch, clip->start, clip->mins2, clip->maxs2, clip->end);
+		if (mid == hi)
+			num = node->children[0];
+		else if (mid == lo)
+			num = node->children[1];
 		else
-			trace = SV_ClipMoveToEntity (touch, clip->start, clip->mins, clip->maxs, clip->end);
-		if (trace.allsolid || trace.startsolid ||
-		trace.fraction < clip->trace.fraction)
 		{
-			trace.ent = touch;
-		 	if (clip->trace.startsolid)
-			{
-				clip->trace = trace;
-				clip->trace.startsolid = true;
-			}
-			else
-				clip->trace = trace;
+			SV_BatchHullCheck (b, node->children[0], lo, mid);
+			num = node->children[1];
+			lo = mid;
 		}
-		else if (trace.startsolid)
-			clip->trace.startsolid = true;
 	}
-	
-// recurse down both sides
-	if (node->axis == -1)
-		return;
-
-	if ( clip->boxmaxs[node->axis] > node->dist )
-		SV_ClipToLinks ( node->children[0], clip );
-	if ( clip->boxmins[node->axis] < node->dist )
-		SV_ClipToLinks ( node->children[1], clip );
 }
 
-
 /*
 ==================
-SV_MoveBounds
+SV_ClipMoveToEntityBatch
+
+SV_ClipMoveToEntity for the rays listed in rays[]
 ==================
 */
-void SV_MoveBounds (vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, vec3_t boxmins, vec3_t boxmaxs)
+static void SV_ClipMoveToEntityBatch (edict_t *ent, vec3_t mins, vec3_t maxs,
+	int count, int *rays, vec3_t *starts, vec3_t *ends, trace_t *traces)
 {
-#if 0
-// debug to test against everything
-boxmins[0] = boxmins[1] = boxmins[2] = -9999;
-boxmaxs[0] = boxmaxs[1] = boxmaxs[2] = 9999;
-#else
-	int		i;
-	
-	for (i=0 ; i<3 ; i++)
+	static hullbatch_t	b;
+	vec3_t		offset;
+	trace_t		*trace;
+	int			i, k, r;
+
+#ifdef QUAKE2
+	if (ent->v.solid == SOLID_BSP && 
+	(ent->v.angles[0] || ent->v.angles[1] || ent->v.angles[2]) )
+	{	// rotated models take the long way
+		for (i=0 ; i<count ; i++)
+			traces[rays[i]] = SV_ClipMoveToEntity (ent, starts[rays[i]], mins, maxs, ends[rays[i]], 0);
+		return;
+	}
+#endif
+
+	b.hull = SV_HullForEntity (ent, mins, maxs, offset, 0);
+
+	for (i=0 ; i<count ; i++)
 	{
-		if (end[i] > start[i])
-		{
-			boxmins[i] = start[i] + mins[i] - 1;
-			boxmaxs[i] = end[i] + maxs[i] + 1;
-		}
-		else
+		r = rays[i];
+		trace = &traces[r];
+		memset (trace, 0, sizeof(trace_t));
+		trace->fraction = 1;
+		trace->allsolid = true;
+		VectorCopy (ends[r], trace->endpos);
+
+		b.traces[i] = trace;
+		for (k=0 ; k<3 ; k++)
 		{
-			boxmins[i] = end[i] + mins[i] - 1;
-			boxmaxs[i] = start[i] + maxs[i] + 1;
+			b.p1[k][i] = starts[r][k] - offset[k];
+			b.p2[k][i] = ends[r][k] - offset[k];
 		}
 	}
-#endif
+
+	SV_BatchHullCheck (&b, b.hull->firstclipnode, 0, count);
+
+	for (i=0 ; i<count ; i++)
+	{
+		trace = &traces[rays[i]];
+		if (trace->fraction != 1)
+			VectorAdd (trace->endpos, offset, trace->endpos);
+		if (trace->fraction < 1 || trace->startsolid)
+			trace->ent = ent;
+	}
 }
 
 /*
 ==================
-SV_Move
+SV_MoveBatch
+
+count traces of a mins/maxs box from starts[i] to ends[i]; traces[i] gets
+what SV_Move would have returned for each
 ==================
 */
-trace_t SV_Move (vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int type, edict_t *passedict)
+void SV_MoveBatch (int count, vec3_t *starts, vec3_t mins, vec3_t maxs, vec3_t *ends, int type, edict_t *passedict, trace_t *traces)
 {
 	moveclip_t	clip;
-	int			i;
-
-	memset ( &clip, 0, sizeof ( moveclip_t ) );
+	vec3_t		boxmins[MAX_BATCH_TRACES], boxmaxs[MAX_BATCH_TRACES];
+	int			rays[MAX_BATCH_TRACES];
+	int			i, j;
+	double		volume, unionvolume;
 
-// clip to world
-	clip.trace = SV_ClipMoveToEntity ( sv.edicts, start, mins, maxs, end );
+	for ( ; count > MAX_BATCH_TRACES ; count -= MAX_BATCH_TRACES)
+	{
+		SV_MoveBatch (MAX_BATCH_TRACES, starts, mins, maxs, ends, type, passedict, traces);
+		starts += MAX_BATCH_TRACES;
+		ends += MAX_BATCH_TRACES;
+		traces += MAX_BATCH_TRACES;
+	}
+	if (count <= 0)
+		return;
 
-	clip.start = start;
-	clip.end = end;
+	memset ( &clip, 0, sizeof ( moveclip_t ) );
 	clip.mins = mins;
 	clip.maxs = maxs;
 	clip.type = type;
@@ -950,13 +2644,210 @@ trace_t SV_Move (vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int type, e
 		VectorCopy (mins, clip.mins2);
 		VectorCopy (maxs, clip.maxs2);
 	}
-	
-// create the bounding box of the entire move
-	SV_MoveBounds ( start, clip.mins2, clip.maxs2, end, clip.boxmins, clip.boxmaxs );
 
-// clip to entities
-	SV_ClipToLinks ( sv_areanodes, &clip );
+// the bounding box of each move, and of all of them
+	volume = 0;
+	for (i=0 ; i<count ; i++)
+	{
+		SV_MoveBounds (starts[i], clip.mins2, clip.maxs2, ends[i], boxmins[i], boxmaxs[i]);
+		for (j=0 ; j<3 ; j++)
+		{
+			if (!i || boxmins[i][j] < clip.boxmins[j])
+				clip.boxmins[j] = boxmins[i][j];
+			if (!i || boxmaxs[i][j] > clip.boxmaxs[j])
+				clip.boxmaxs[j] = boxmaxs[i][j];
+		}
+		volume += (double)(boxmaxs[i][0] - boxmins[i][0]) * (boxmaxs[i][1] - boxmins[i][1]) * (boxmaxs[i][2] - boxmins[i][2]);
+	}
+	unionvolume = (double)(clip.boxmaxs[0] - clip.boxmins[0]) * (clip.boxmaxs[1] - clip.boxmins[1]) * (clip.boxmaxs[2] - clip.boxmins[2]);
 
-	return clip.trace;
+// moves that go off in all directions split apart near the top of the
+// tree and gain nothing from sharing the walk
+	if (unionvolume > volume * 4)
+	{
+		for (i=0 ; i<count ; i++)
+			traces[i] = SV_Move (starts[i], mins, maxs, ends[i], type, passedict);
+		return;
+	}
+
+// clip to world
+	for (i=0 ; i<count ; i++)
+		rays[i] = i;
+	SV_ClipMoveToEntityBatch (sv.edicts, mins, maxs, count, rays, starts, ends, traces);
+
+// clip to entities; each move only looks at what its own box touches
+	for (i=0 ; i<count ; i++)
+	{
+		clip.trace = traces[i];
+		clip.start = starts[i];
+		clip.end = ends[i];
+		VectorCopy (boxmins[i], clip.boxmins);
+		VectorCopy (boxmaxs[i], clip.boxmaxs);
+		SV_ClipToEntities (&clip);
+		traces[i] = clip.trace;
+	}
 }
 
+/*
+===============================================================================
+
+TRACE BENCHMARK
+
+===============================================================================
+*/
+
+static	unsigned	sv_benchseed;
+
+static float SV_BenchRandom (void)
+{
+	sv_benchseed = sv_benchseed * 1103515245 + 12345;
+	return ((sv_benchseed >> 8) & 0xffff) * (1.0/65536);
+}
+
+/*
+===============
+SV_RelinkArea
+
+Moves every linked edict into the area nodes or into the trees, without
+touching their abs boxes
+===============
+*/
+static void SV_RelinkArea (qboolean tree)
+{
+	static byte	linked[MAX_EDICTS];
+	edict_t		*ent;
+	int			e;
+
+	for (e=1 ; e<sv.num_edicts ; e++)
+	{
+		ent = EDICT_NUM(e);
+		linked[e] = ent->area.prev != NULL;
+		ent->area.prev = ent->area.next = NULL;
+	}
+
+	sv_usetree = tree;
+	SV_ClearArea ();
+
+	for (e=1 ; e<sv.num_edicts ; e++)
+		if (linked[e])
+			SV_LinkArea (EDICT_NUM(e));
+}
+
+/*
+===============
+SV_BenchTraces
+
+Runs count traces that start near random solid edicts and returns the
+seconds they took.  The same seed gives the same traces.
+===============
+*/
+static double SV_BenchTraces (int count, edict_t **solids, int numsolids, float *fractions, int *hits)
+{
+	static vec3_t	sizes[3][2] = {
+		{{0, 0, 0}, {0, 0, 0}},
+		{{-16, -16, -24}, {16, 16, 32}},
+		{{-32, -32, -24}, {32, 32, 64}}};
+	vec3_t	start, end;
+	edict_t	*ent;
+	trace_t	trace;
+	double	time;
+	int		i, j, s;
+
+	sv_benchseed = 1;
+	*fractions = 0;
+	*hits = 0;
+
+	time = Sys_FloatTime ();
+	for (i=0 ; i<count ; i++)
+	{
+		ent = solids[(int)(SV_BenchRandom () * numsolids)];
+		for (j=0 ; j<3 ; j++)
+		{
+			start[j] = ent->v.origin[j] + (SV_BenchRandom () - 0.5) * 128;
+			end[j] = start[j] + (SV_BenchRandom () - 0.5) * 1024;
+		}
+		s = i % 3;
+		trace = SV_Move (start, sizes[s][0], sizes[s][1], end, i % 5 ? MOVE_NORMAL : MOVE_MISSILE, NULL);
+		*fractions += trace.fraction;
+		if (trace.ent)
+			*hits += NUM_FOR_EDICT(trace.ent);
+	}
+	return Sys_FloatTime () - time;
+}
+
+/*
+===============
+SV_TraceBench_f
+
+tracebench [traces] [boxes]
+
+Times the same traces against the area nodes and the trees, after adding
+boxes small flying solid edicts to the map for a more crowded world
+===============
+*/
+void SV_TraceBench_f (void)
+{
+	static edict_t	*solids[MAX_EDICTS], *added[MAX_EDICTS];
+	edict_t		*ent;
+	int			count, numadded, numsolids, i, j, pass, hits[2];
+	float		fractions[2];
+	double		time[2];
+	qboolean	tree;
+
+	if (!sv.active)
+	{
+		Con_Printf ("Not running a server\n");
+		return;
+	}
+
+	count = Cmd_Argc () > 1 ? Q_atoi (Cmd_Argv (1)) : 100000;
+	numadded = Cmd_Argc () > 2 ? Q_atoi (Cmd_Argv (2)) : 0;
+	if (count < 1)
+		count = 1;
+	if (numadded > sv.max_edicts - sv.num_edicts)
+		numadded = sv.max_edicts - sv.num_edicts;
+
+	sv_benchseed = 7;
+	for (i=0 ; i<numadded ; i++)
+	{
+		ent = added[i] = ED_Alloc ();
+		ent->v.solid = SOLID_BBOX;
+		for (j=0 ; j<3 ; j++)
+		{
+			ent->v.origin[j] = sv.worldmodel->mins[j] + SV_BenchRandom () * (sv.worldmodel->maxs[j] - sv.worldmodel->mins[j]);
+			ent->v.velocity[j] = (SV_BenchRandom () - 0.5) * 1200;
+			ent->v.mins[j] = -4;
+			ent->v.maxs[j] = 4;
+		}
+		VectorSubtract (ent->v.maxs, ent->v.mins, ent->v.size);
+		SV_LinkEdict (ent, false);
+	}
+
+	numsolids = 0;
+	for (i=1 ; i<sv.num_edicts ; i++)
+	{
+		ent = EDICT_NUM(i);
+		if (!ent->free && ent->area.prev && ent->v.solid != SOLID_TRIGGER)
+			solids[numsolids++] = ent;
+	}
+	if (!numsolids)
+		solids[numsolids++] = sv.edicts;
+
+	tree = sv_usetree;
+	for (pass=0 ; pass<2 ; pass++)
+	{
+		SV_RelinkArea (pass);
+		time[pass] = SV_BenchTraces (count, solids, numsolids, &fractions[pass], &hits[pass]);
+	}
+	SV_RelinkArea (tree);
+
+	for (i=0 ; i<numadded ; i++)
+		ED_Free (added[i]);
+
+	Con_Printf ("%i traces, %i solid edicts\n", count, numsolids);
+	for (pass=0 ; pass<2 ; pass++)
+		Con_Printf ("%-10s %8.1f ms %10.0f traces/s  (check %.1f %i)\n",
+			pass ? "area tree" : "area node", time[pass] * 1000,
+			count / (time[pass] > 0 ? time[pass] : 1e-6),
+			fractions[pass], hits[pass]);
+}
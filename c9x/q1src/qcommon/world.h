@@ -56,12 +56,34 @@ void SV_LinkEdict (edict_t *ent, qboolean touch_triggers);
 // sets ent->v.absmin and ent->v.absmax
 // if touchtriggers, calls prog functions for the intersected triggers
 
+void SV_MarkEdictMoved (edict_t *ent);
+// call when an entity's origin, mins, maxs, or solid changes without a relink
+// until it is linked again, SV_RadiusEdicts returns it wherever it is
+
+int SV_RadiusEdicts (vec3_t org, float rad, edict_t **list);
+// fills list, sorted by edict number, with every edict that might have its
+// box center within rad of org; callers do the exact test
+
+void SV_EdictChanged (edict_t *ent);
+// call when a field a trace against ent reads changes without a relink;
+// SV_LinkEdict, SV_UnlinkEdict and SV_MarkEdictMoved do it themselves
+
+void SV_TraceBench_f (void);
+// times the same traces against the area nodes and the area trees
+
 int SV_PointContents (vec3_t p);
 int SV_TruePointContents (vec3_t p);
 // returns the CONTENTS_* value from the world at the given point.
 // does not check any entities at all
 // the non-true version remaps the water current contents to content_water
 
+void SV_BuildContentsGrid (void);
+// called when a map is spawned, after SV_ClearWorld
+// lays a grid of known contents over the world for the two above
+
+void SV_ContentsGrid_f (void);
+// reports the grid's size, build time and hit rate
+
 edict_t	*SV_TestEntityPosition (edict_t *ent);
 
 trace_t SV_Move (vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int type, edict_t *passedict);
@@ -76,3 +98,21 @@ trace_t SV_Move (vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int type, e
 // shouldn't be considered solid objects
 
 // passedict is explicitly excluded from clipping checks (normally NULL)
+
+#define	MAX_BATCH_TRACES	64
+
+void SV_MoveBatch (int count, vec3_t *starts, vec3_t mins, vec3_t maxs, vec3_t *ends, int type, edict_t *passedict, trace_t *traces);
+// the same as calling SV_Move for each start/end pair, but the moves walk
+// the world hull together until they split apart; entities are still
+// clipped one move at a time
+
+void SV_SpeculateMoves (int count, edict_t **ents, vec3_t *ends, int *types);
+// traces the move from each edict's origin to ends[i] on the worker threads
+// right away; SV_Move (origin, mins, maxs, end, type, ent) later returns
+// the stored trace if nothing it depends on has changed since
+
+void SV_EndSpeculation (void);
+// drops whatever SV_SpeculateMoves stored
+
+void SV_Speculation_f (void);
+// reports how many speculated moves were used
@@ -22,6 +22,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "quakedef.h"
 
 #define	DYNAMIC_SIZE	0xc000
+#define	SLAB_SIZE		0x8000		// -slabs, on top of the zone
 
 #define	ZONEID	0x1d4a11
 #define MINFRAGMENT	64
@@ -46,6 +47,205 @@ void Cache_FreeLow (int new_low_hunk);
 void Cache_FreeHigh (int new_high_hunk);
 
 
+/*
+==============================================================================
+
+						MEMORY ACCOUNTING
+
+Every hunk, cache and zone allocation is counted against an owner, keyed by
+the allocator and the name the caller already gives it: the hunk and cache
+names, which are mostly the model, sound or subsystem the memory is for.
+Zone blocks have no names and all go to "zone".  The table is static, as
+the first hunk allocations happen before there is anywhere else to put it.
+
+==============================================================================
+*/
+
+#define	MAX_MEMOWNERS	256
+
+typedef struct
+{
+	char	kind[8];		// hunk, high, cache or zone
+	char	name[16];
+	int		current, peak;
+	int		allocs, frees;
+} memowner_t;
+
+static memowner_t	mem_owners[MAX_MEMOWNERS];
+static int			mem_numowners;
+
+/*
+========================
+Mem_Owner
+
+Finds or adds an owner.  Once the table is full new names share the last
+entry.
+========================
+*/
+static memowner_t *Mem_Owner (char *kind, char *name, int namelen)
+{
+	unsigned	hash;
+	int			i, j;
+	memowner_t	*o;
+	char		key[16];
+
+	for (i = 0 ; i < namelen && i < sizeof(key)-1 && name[i] ; i++)
+		key[i] = name[i];
+	key[i] = 0;
+
+	hash = 0;
+	for (i = 0 ; kind[i] ; i++)
+		hash = hash * 31 + kind[i];
+	for (i = 0 ; key[i] ; i++)
+		hash = hash * 31 + key[i];
+
+	for (i = 0 ; i < MAX_MEMOWNERS-1 ; i++)
+	{
+		o = &mem_owners[(hash + i) % (MAX_MEMOWNERS-1)];
+		if (!o->kind[0])
+		{
+			if (mem_numowners == MAX_MEMOWNERS-1)
+				break;
+			mem_numowners++;
+			for (j = 0 ; kind[j] && j < sizeof(o->kind)-1 ; j++)
+				o->kind[j] = kind[j];
+			Q_strcpy (o->name, key);
+			return o;
+		}
+		if (!Q_strcmp (o->kind, kind) && !Q_strcmp (o->name, key))
+			return o;
+	}
+
+	o = &mem_owners[MAX_MEMOWNERS-1];
+	if (!o->kind[0])
+	{
+		Q_strcpy (o->kind, "all");
+		Q_strcpy (o->name, "(others)");
+	}
+	return o;
+}
+
+/*
+The server thread allocates under the host lock, but the main thread loads
+models and sounds into the cache while it draws without it, so the table
+has a lock of its own.  memstats and memdump only read it from commands,
+run with the host lock held on the main thread, where nothing else can be
+changing it.
+*/
+
+static void Mem_Alloced (char *kind, char *name, int namelen, int size)
+{
+	memowner_t	*o;
+
+	Sys_LockMem ();
+	o = Mem_Owner (kind, name, namelen);
+	o->allocs++;
+	o->current += size;
+	if (o->current > o->peak)
+		o->peak = o->current;
+	Sys_UnlockMem ();
+}
+
+static void Mem_Freed (char *kind, char *name, int namelen, int size)
+{
+	memowner_t	*o;
+
+	Sys_LockMem ();
+	o = Mem_Owner (kind, name, namelen);
+	o->frees++;
+	o->current -= size;
+	Sys_UnlockMem ();
+}
+
+static void Mem_Adjust (char *kind, char *name, int namelen, int delta)
+{
+	memowner_t	*o;
+
+	Sys_LockMem ();
+	o = Mem_Owner (kind, name, namelen);
+	o->current += delta;
+	if (o->current > o->peak)
+		o->peak = o->current;
+	Sys_UnlockMem ();
+}
+
+static int Mem_CompareOwners (const void *a, const void *b)
+{
+	return (*(memowner_t **)b)->current - (*(memowner_t **)a)->current;
+}
+
+/*
+========================
+Mem_Stats_f
+
+memstats [kind]
+Lists owners by current size, optionally only those of one allocator.
+========================
+*/
+void Mem_Stats_f (void)
+{
+	memowner_t	*sorted[MAX_MEMOWNERS];
+	int			i, n, current, peak;
+	char		*kind;
+
+	kind = Cmd_Argc () > 1 ? Cmd_Argv (1) : NULL;
+
+	for (i = n = 0 ; i < MAX_MEMOWNERS ; i++)
+		if (mem_owners[i].kind[0] && (!kind || !Q_strcmp (mem_owners[i].kind, kind)))
+			sorted[n++] = &mem_owners[i];
+	qsort (sorted, n, sizeof(sorted[0]), Mem_CompareOwners);
+
+	current = peak = 0;
+	Con_Printf ("kind  name              current      peak allocs  frees\n");
+	for (i = 0 ; i < n ; i++)
+	{
+		Con_Printf ("%-5s %-15s %9i %9i %6i %6i\n", sorted[i]->kind, sorted[i]->name,
+			sorted[i]->current, sorted[i]->peak, sorted[i]->allocs, sorted[i]->frees);
+		current += sorted[i]->current;
+		peak += sorted[i]->peak;
+	}
+	Con_Printf ("%i owners, %i bytes, %i at their peaks\n", n, current, peak);
+}
+
+/*
+========================
+Mem_Dump_f
+
+memdump [file]
+Writes every owner to a CSV file in the game directory.
+========================
+*/
+void Mem_Dump_f (void)
+{
+	char		name[MAX_OSPATH];
+	FILE		*f;
+	memowner_t	*o;
+	int			i;
+
+	if (Cmd_Argc () > 1 && strstr (Cmd_Argv (1), ".."))
+	{
+		Con_Printf ("Relative pathnames are not allowed.\n");
+		return;
+	}
+
+	snprintf (name, sizeof(name), "%s/%s", com_gamedir, Cmd_Argc () > 1 ? Cmd_Argv (1) : "memstats.csv");
+	f = fopen (name, "w");
+	if (!f)
+	{
+		Con_Printf ("Couldn't write %s\n", name);
+		return;
+	}
+
+	fprintf (f, "kind,name,current,peak,allocs,frees\n");
+	for (i = 0, o = mem_owners ; i < MAX_MEMOWNERS ; i++, o++)
+		if (o->kind[0])
+			fprintf (f, "%s,\"%s\",%i,%i,%i,%i\n", o->kind, o->name, o->current, o->peak, o->allocs, o->frees);
+
+	fclose (f);
+	Con_Printf ("Wrote %s\n", name);
+}
+
+
 /*
 ==============================================================================
 
@@ -58,11 +258,21 @@ The rover can be left pointing at a non-empty block
 
 The zone calls are pretty much only used for small strings and structures,
 all big things are allocated on the hunk.
+
+Blocks of up to SLAB_MAXSIZE bytes from Z_Malloc don't go to the zone at all,
+but to fixed size slots in pages of their own, so a string or an alias never
+ends up splitting the free space between two bigger blocks.  The pages are
+a hunk block of their own next to the zone, and the zone is only used for
+small blocks once every slab page is taken.
 ==============================================================================
 */
 
 memzone_t	*mainzone;
 
+qboolean	zone_checkheap;		// -zonecheck walks the heap on every Z_Malloc
+
+static int	zone_allocs, zone_frees;	// blocks taken from the zone itself
+
 void Z_ClearZone (memzone_t *zone, int size);
 
 
@@ -91,6 +301,249 @@ void Z_ClearZone (memzone_t *zone, int size)
 }
 
 
+/*
+==============================================================================
+
+						SLABS
+
+Each page of the slab arena holds slots of one size class while it has any
+in use, and goes back to the free pages once its last slot is freed, so the
+pages move to whichever classes are busy.  A page's slots are handed out in
+order until it has been filled once, after that from its free list.
+
+==============================================================================
+*/
+
+#define	SLAB_PAGESIZE	4096
+#define	SLAB_CLASSES	8
+#define	SLAB_MAXSIZE	256
+
+typedef struct slab_s
+{
+	struct slab_s	*next, *prev;	// in its class's partial list, or the free pages
+	byte		*freelist;		// freed slots, linked through their first bytes
+	short		sizeclass;		// -1 when the page is free
+	short		used;			// slots in use
+	short		carved;			// slots handed out at least once
+} slab_t;
+
+typedef struct
+{
+	int		size;
+	int		perslab;
+	slab_t	partial;			// pages with a free slot
+	int		slabs;
+	int		inuse, peak;
+	int		allocs, frees;
+} slabclass_t;
+
+static int	slab_sizes[SLAB_CLASSES] = {16, 32, 48, 64, 96, 128, 192, 256};
+static byte	slab_classfor[SLAB_MAXSIZE/16 + 1];	// (size + 15) / 16 to class
+
+static slabclass_t	slab_classes[SLAB_CLASSES];
+static byte		*slab_base;
+static int		slab_numpages;
+static slab_t	*slab_pages;
+static slab_t	*slab_freepages;
+static int		slab_fallbacks;		// small blocks sent to the zone, no free page
+
+/*
+========================
+Slab_Init
+========================
+*/
+static void Slab_Init (int size)
+{
+	int		i, c;
+
+	slab_numpages = size / SLAB_PAGESIZE;
+	slab_base = Hunk_AllocName (slab_numpages * SLAB_PAGESIZE, "slabs");
+	slab_pages = Hunk_AllocName (slab_numpages * sizeof(slab_t), "slabhdr");
+
+	slab_freepages = NULL;
+	for (i = slab_numpages-1 ; i >= 0 ; i--)
+	{
+		slab_pages[i].sizeclass = -1;
+		slab_pages[i].next = slab_freepages;
+		slab_freepages = &slab_pages[i];
+	}
+
+	for (c = 0, i = 0 ; i <= SLAB_MAXSIZE/16 ; i++)
+	{
+		while (slab_sizes[c] < i*16)
+			c++;
+		slab_classfor[i] = c;
+	}
+
+	for (c = 0 ; c < SLAB_CLASSES ; c++)
+	{
+		slab_classes[c].size = slab_sizes[c];
+		slab_classes[c].perslab = SLAB_PAGESIZE / slab_sizes[c];
+		slab_classes[c].partial.next = slab_classes[c].partial.prev = &slab_classes[c].partial;
+	}
+}
+
+/*
+========================
+Slab_Owns
+========================
+*/
+static qboolean Slab_Owns (void *ptr)
+{
+	return (byte *)ptr >= slab_base && (byte *)ptr < slab_base + slab_numpages * SLAB_PAGESIZE;
+}
+
+/*
+========================
+Slab_Alloc
+
+Returns NULL when there is no free page for a new slab.
+========================
+*/
+static void *Slab_Alloc (int size)
+{
+	slabclass_t	*cl;
+	slab_t		*s;
+	byte		*buf;
+
+	cl = &slab_classes[slab_classfor[(size + 15) >> 4]];
+	s = cl->partial.next;
+	if (s == &cl->partial)
+	{	// start a new slab
+		s = slab_freepages;
+		if (!s)
+		{
+			slab_fallbacks++;
+			return NULL;
+		}
+		slab_freepages = s->next;
+
+		s->sizeclass = cl - slab_classes;
+		s->used = s->carved = 0;
+		s->freelist = NULL;
+		s->next = cl->partial.next;
+		s->prev = &cl->partial;
+		s->next->prev = s;
+		cl->partial.next = s;
+		cl->slabs++;
+	}
+
+	if (s->freelist)
+	{
+		buf = s->freelist;
+		s->freelist = *(byte **)buf;
+	}
+	else
+		buf = slab_base + (s - slab_pages) * SLAB_PAGESIZE + s->carved++ * cl->size;
+
+	if (++s->used == cl->perslab)
+	{	// full, take it off the partial list
+		s->next->prev = s->prev;
+		s->prev->next = s->next;
+		s->next = s->prev = NULL;
+	}
+
+	cl->allocs++;
+	if (++cl->inuse > cl->peak)
+		cl->peak = cl->inuse;
+	Mem_Alloced ("zone", "slabs", 16, cl->size);
+
+	return buf;
+}
+
+/*
+========================
+Slab_Free
+========================
+*/
+static void Slab_Free (void *ptr)
+{
+	slabclass_t	*cl;
+	slab_t		*s;
+	int			ofs;
+	byte		*p;
+
+	ofs = (byte *)ptr - slab_base;
+	s = &slab_pages[ofs / SLAB_PAGESIZE];
+	if (s->sizeclass < 0)
+		Sys_Error ("Z_Free: freed a pointer in a free slab");
+	cl = &slab_classes[s->sizeclass];
+	ofs %= SLAB_PAGESIZE;
+	if (ofs % cl->size || ofs / cl->size >= s->carved)
+		Sys_Error ("Z_Free: freed a pointer inside a slab slot");
+
+	if (zone_checkheap)
+	{
+		for (p = s->freelist ; p ; p = *(byte **)p)
+			if (p == ptr)
+				Sys_Error ("Z_Free: freed a freed pointer");
+	}
+
+	if (s->used == cl->perslab)
+	{	// was full, back on the partial list
+		s->next = cl->partial.next;
+		s->prev = &cl->partial;
+		s->next->prev = s;
+		cl->partial.next = s;
+	}
+
+	*(byte **)ptr = s->freelist;
+	s->freelist = ptr;
+
+	cl->frees++;
+	cl->inuse--;
+	Mem_Freed ("zone", "slabs", 16, cl->size);
+
+	if (!--s->used)
+	{	// empty, give the page back for any class to use
+		s->next->prev = s->prev;
+		s->prev->next = s->next;
+		s->sizeclass = -1;
+		s->next = slab_freepages;
+		slab_freepages = s;
+		cl->slabs--;
+	}
+}
+
+/*
+========================
+Slab_Size
+
+The usable size of a slab slot.
+========================
+*/
+static int Slab_Size (void *ptr)
+{
+	return slab_classes[slab_pages[((byte *)ptr - slab_base) / SLAB_PAGESIZE].sizeclass].size;
+}
+
+/*
+========================
+Slab_Check
+========================
+*/
+static void Slab_Check (void)
+{
+	int			c, n;
+	slab_t		*s;
+
+	for (c = 0 ; c < SLAB_CLASSES ; c++)
+	{
+		n = 0;
+		for (s = slab_classes[c].partial.next ; s != &slab_classes[c].partial ; s = s->next)
+		{
+			if (s->sizeclass != c || s->next->prev != s)
+				Sys_Error ("Z_CheckHeap: bad slab list\n");
+			if (s->used <= 0 || s->used >= slab_classes[c].perslab)
+				Sys_Error ("Z_CheckHeap: bad slab count\n");
+			if (++n > slab_numpages)
+				Sys_Error ("Z_CheckHeap: slab list loops\n");
+		}
+	}
+}
+
+//============================================================================
+
 /*
 ========================
 Z_Free
@@ -103,6 +556,12 @@ void Z_Free (void *ptr)
 	if (!ptr)
 		Sys_Error ("Z_Free: NULL pointer");
 
+	if (Slab_Owns (ptr))
+	{
+		Slab_Free (ptr);
+		return;
+	}
+
 	block = (memblock_t *) ( (byte *)ptr - sizeof(memblock_t));
 	if (block->id != ZONEID)
 		Sys_Error ("Z_Free: freed a pointer without ZONEID");
@@ -110,6 +569,8 @@ void Z_Free (void *ptr)
 		Sys_Error ("Z_Free: freed a freed pointer");
 
 	block->tag = 0;		// mark as free
+	zone_frees++;
+	Mem_Freed ("zone", "zone", 16, block->size);
 	
 	other = block->prev;
 	if (!other->tag)
@@ -137,16 +598,30 @@ void Z_Free (void *ptr)
 /*
 ========================
 Z_Malloc
+
+The whole slot or block is cleared, not just size bytes, so Z_Realloc can
+grow into the slack without clearing it again
 ========================
 */
 void *Z_Malloc (int size)
 {
 	void	*buf;
 	
-Z_CheckHeap ();	// DEBUG
-	buf = Z_TagMalloc (size, 1);
+	if (zone_checkheap)
+		Z_CheckHeap ();
+
+	buf = NULL;
+	if (size <= SLAB_MAXSIZE)
+		buf = Slab_Alloc (size);
+	if (!buf)
+		buf = Z_TagMalloc (size, 1);
 	if (!buf)
 		Sys_Error ("Z_Malloc: failed on allocation of %i bytes",size);
+
+	if (Slab_Owns (buf))
+		size = Slab_Size (buf);
+	else
+		size = ((memblock_t *)((byte *)buf - sizeof(memblock_t)))->size - sizeof(memblock_t) - 4;
 	Q_memset (buf, 0, size);
 
 	return buf;
@@ -156,35 +631,46 @@ Z_CheckHeap ();	// DEBUG
 /*
 ========================
 Z_Realloc
+
+Grows in place when the block already has the room, otherwise moves.  Any
+new space is zero filled, as from Z_Malloc: a Z_Malloc block is cleared to
+its full size and a shrink clears what it gives up, so everything past the
+size last asked for is always zero.  That only holds for Z_Malloc blocks
+that are never written past the size asked for.
 ========================
 */
 void *Z_Realloc(void *ptr, int size)
 {
 	int old_size;
-	void *old_ptr;
+	void *new_ptr;
 	memblock_t *block;
 
 	if (!ptr)
 		return Z_Malloc (size);
 
-	block = (memblock_t *) ((byte *) ptr - sizeof (memblock_t));
-	if (block->id != ZONEID)
-		Sys_Error ("Z_Realloc: realloced a pointer without ZONEID");
-	if (block->tag == 0)
-		Sys_Error ("Z_Realloc: realloced a freed pointer");
+	if (Slab_Owns (ptr))
+		old_size = Slab_Size (ptr);
+	else
+	{
+		block = (memblock_t *) ((byte *) ptr - sizeof (memblock_t));
+		if (block->id != ZONEID)
+			Sys_Error ("Z_Realloc: realloced a pointer without ZONEID");
+		if (block->tag == 0)
+			Sys_Error ("Z_Realloc: realloced a freed pointer");
+		old_size = block->size - sizeof(memblock_t) - 4;
+	}
 
-	old_size = block->size;
-	old_ptr = ptr;
+	if (size <= old_size)
+	{
+		Q_memset ((byte *)ptr + size, 0, old_size - size);
+		return ptr;
+	}
 
+	new_ptr = Z_Malloc (size);
+	Q_memcpy (new_ptr, ptr, old_size);
 	Z_Free (ptr);
-	ptr = Z_TagMalloc (size, 1);
-	if (!ptr)
-		Sys_Error ("Z_Realloc: failed on allocation of %i bytes", size);
-
-	if (ptr != old_ptr)
-		memmove (ptr, old_ptr, min (old_size, size));
 
-	return ptr;
+	return new_ptr;
 }
 
 
@@ -236,6 +722,8 @@ void *Z_TagMalloc (int size, int tag)
 	}
 	
 	base->tag = tag;				// no longer a free block
+	zone_allocs++;
+	Mem_Alloced ("zone", "zone", 16, base->size);
 	
 	mainzone->rover = base->next;	// next allocation will start looking here
 	
@@ -296,6 +784,68 @@ void Z_CheckHeap (void)
 		if (!block->tag && !block->next->tag)
 			Sys_Error ("Z_CheckHeap: two consecutive free blocks\n");
 	}
+
+	Slab_Check ();
+}
+
+
+/*
+========================
+Z_Stats_f
+
+Slab use per size class, and how broken up the zone's free space is.
+Allocation rates are since the last zonestats.
+========================
+*/
+void Z_Stats_f (void)
+{
+	static double	lasttime;
+	static int		lastallocs[SLAB_CLASSES+1];
+	double			now, dt;
+	int				c, inuse, cap, freepages;
+	int				used, freebytes, freeblocks, largest;
+	slabclass_t		*cl;
+	slab_t			*s;
+	memblock_t		*block;
+
+	now = Sys_FloatTime ();
+	dt = lasttime ? now - lasttime : 0;
+	lasttime = now;
+
+	for (freepages = 0, s = slab_freepages ; s ; s = s->next)
+		freepages++;
+
+	Con_Printf ("size slabs   used/ cap  peak  allocs/s\n");
+	for (c = 0 ; c < SLAB_CLASSES ; c++)
+	{
+		cl = &slab_classes[c];
+		inuse = cl->inuse;
+		cap = cl->slabs * cl->perslab;
+		Con_Printf ("%4i %5i %6i/%4i %5i %9.1f\n", cl->size, cl->slabs, inuse, cap, cl->peak,
+			dt ? (cl->allocs - lastallocs[c]) / dt : 0);
+		lastallocs[c] = cl->allocs;
+	}
+	Con_Printf ("%i of %i slab pages free, %i small blocks sent to the zone\n",
+		freepages, slab_numpages, slab_fallbacks);
+
+	used = freebytes = freeblocks = largest = 0;
+	for (block = mainzone->blocklist.next ; block != &mainzone->blocklist ; block = block->next)
+	{
+		if (block->tag)
+			used += block->size;
+		else
+		{
+			freebytes += block->size;
+			freeblocks++;
+			if (block->size > largest)
+				largest = block->size;
+		}
+	}
+	Con_Printf ("zone: %i used, %i free in %i blocks, largest %i\n", used, freebytes, freeblocks, largest);
+	Con_Printf ("fragmentation %.1f%%, %.1f allocs/s, %i blocks live\n",
+		freebytes ? 100.0 * (freebytes - largest) / freebytes : 0.0,
+		dt ? (zone_allocs - lastallocs[SLAB_CLASSES]) / dt : 0, zone_allocs - zone_frees);
+	lastallocs[SLAB_CLASSES] = zone_allocs;
 }
 
 //============================================================================
@@ -459,6 +1009,7 @@ void *Hunk_AllocName (int size, char *name)
 	h->size = size;
 	h->sentinal = HUNK_SENTINAL;
 	Q_strncpy (h->name, name, 8);
+	Mem_Alloced ("hunk", h->name, 8, size);
 	
 	return (void *)(h+1);
 }
@@ -480,8 +1031,12 @@ int	Hunk_LowMark (void)
 
 void Hunk_FreeToLowMark (int mark)
 {
+	hunk_t	*h;
+
 	if (mark < 0 || mark > hunk_low_used)
 		Sys_Error ("Hunk_FreeToLowMark: bad mark %i", mark);
+	for (h = (hunk_t *)(hunk_base + mark) ; (byte *)h < hunk_base + hunk_low_used ; h = (hunk_t *)((byte *)h + h->size))
+		Mem_Freed ("hunk", h->name, 8, h->size);
 	memset (hunk_base + mark, 0, hunk_low_used - mark);
 	hunk_low_used = mark;
 }
@@ -499,6 +1054,8 @@ int	Hunk_HighMark (void)
 
 void Hunk_FreeToHighMark (int mark)
 {
+	hunk_t	*h;
+
 	if (hunk_tempactive)
 	{
 		hunk_tempactive = false;
@@ -506,6 +1063,8 @@ void Hunk_FreeToHighMark (int mark)
 	}
 	if (mark < 0 || mark > hunk_high_used)
 		Sys_Error ("Hunk_FreeToHighMark: bad mark %i", mark);
+	for (h = (hunk_t *)(hunk_base + hunk_size - hunk_high_used) ; (byte *)h < hunk_base + hunk_size - mark ; h = (hunk_t *)((byte *)h + h->size))
+		Mem_Freed ("high", h->name, 8, h->size);
 	memset (hunk_base + hunk_size - hunk_high_used, 0, hunk_high_used - mark);
 	hunk_high_used = mark;
 }
@@ -550,6 +1109,7 @@ void *Hunk_HighAllocName (int size, char *name)
 	h->size = size;
 	h->sentinal = HUNK_SENTINAL;
 	Q_strncpy (h->name, name, 8);
+	Mem_Alloced ("high", h->name, 8, size);
 
 	return (void *)(h+1);
 }
@@ -588,48 +1148,294 @@ void *Hunk_TempAlloc (int size)
 
 CACHE MEMORY
 
+The cache lives between the low and high hunk.  Its blocks are kept in
+address order, with the holes between them as free blocks of their own on
+one of CACHE_BINS free lists by power of two size, so finding room, freeing
+and evicting don't have to walk every block.  The space below the first
+block and above the last one is not in any list, as the hunk can grow into
+it or give it back at any time.
+
+Each allocation gets a new generation number in both the block and its
+cache_user_t, which catches stale users and tells a reload of evicted data
+apart from a first load.
+
 ===============================================================================
 */
 
 typedef struct cache_system_s
 {
 	int						size;		// including this header
-	cache_user_t			*user;
+	cache_user_t			*user;		// NULL for a free block
+	int						generation;
 	char					name[16];
 	struct cache_system_s	*prev, *next;
-	struct cache_system_s	*lru_prev, *lru_next;	// for LRU flushing	
+	struct cache_system_s	*lru_prev, *lru_next;	// for LRU flushing, or the free list
 } cache_system_t;
 
-cache_system_t *Cache_TryAlloc (int size, qboolean nobottom);
+#define	CACHE_BINS		32
+#define	CACHE_MINFREE	((int)(sizeof(cache_system_t) + 15) & ~15)
 
 cache_system_t	cache_head;
+cache_system_t	cache_bins[CACHE_BINS];	// free blocks of at least 1<<bin bytes
+unsigned		cache_binmask;			// bins with any blocks in them
+int				cache_generation;
+
+static struct
+{
+	int		hits, misses;
+	int		reloads;		// misses on data that had been cached before
+	int		allocs;
+	int		evictions;
+	int		moves;
+	double	bytesmoved;
+	int		flushes;
+} cache_stats;
+
+void Cache_UnlinkLRU (cache_system_t *cs);
+void Cache_MakeLRU (cache_system_t *cs);
+
+/*
+============
+Cache_Bin
+============
+*/
+static int Cache_Bin (int size)
+{
+	int		bin;
+
+	for (bin = 0 ; size >> (bin+1) ; bin++)
+		;
+	return bin;
+}
+
+/*
+============
+Cache_LinkFree
+============
+*/
+static void Cache_LinkFree (cache_system_t *cs)
+{
+	cache_system_t	*bin;
+
+	bin = &cache_bins[Cache_Bin (cs->size)];
+	cs->user = NULL;
+	cs->lru_next = bin->lru_next;
+	cs->lru_prev = bin;
+	bin->lru_next->lru_prev = cs;
+	bin->lru_next = cs;
+	cache_binmask |= 1u << (bin - cache_bins);
+}
+
+/*
+============
+Cache_UnlinkFree
+============
+*/
+static void Cache_UnlinkFree (cache_system_t *cs)
+{
+	int		bin;
+
+	cs->lru_next->lru_prev = cs->lru_prev;
+	cs->lru_prev->lru_next = cs->lru_next;
+	cs->lru_prev = cs->lru_next = NULL;
+
+	bin = Cache_Bin (cs->size);
+	if (cache_bins[bin].lru_next == &cache_bins[bin])
+		cache_binmask &= ~(1u << bin);
+}
+
+/*
+============
+Cache_Unlink
+
+Takes a block out of the address list
+============
+*/
+static void Cache_Unlink (cache_system_t *cs)
+{
+	cs->prev->next = cs->next;
+	cs->next->prev = cs->prev;
+	cs->next = cs->prev = NULL;
+}
+
+/*
+============
+Cache_Release
+
+Turns a block into free space, merging it with any free neighbours.  Space
+at either end of the cache just drops out of the list.
+============
+*/
+static void Cache_Release (cache_system_t *cs)
+{
+	cache_system_t	*other;
+
+	Cache_UnlinkLRU (cs);
+	cs->user = NULL;
+
+	other = cs->next;
+	if (other != &cache_head && !other->user)
+	{
+		Cache_UnlinkFree (other);
+		cs->size += other->size;
+		Cache_Unlink (other);
+	}
+
+	other = cs->prev;
+	if (other != &cache_head && !other->user)
+	{
+		Cache_UnlinkFree (other);
+		other->size += cs->size;
+		Cache_Unlink (cs);
+		cs = other;
+	}
+
+	if (cs->prev == &cache_head || cs->next == &cache_head)
+		Cache_Unlink (cs);
+	else
+		Cache_LinkFree (cs);
+}
+
+/*
+============
+Cache_Claim
+
+Sets up a new block of size bytes at mem, in the address list after prev
+============
+*/
+static cache_system_t *Cache_Claim (byte *mem, int size, cache_system_t *prev)
+{
+	cache_system_t	*new;
+
+	new = (cache_system_t *)mem;
+	memset (new, 0, sizeof(*new));
+	new->size = size;
+
+	new->prev = prev;
+	new->next = prev->next;
+	prev->next->prev = new;
+	prev->next = new;
+
+	return new;
+}
+
+/*
+============
+Cache_Fits
+============
+*/
+static qboolean Cache_Fits (byte *start, int size, byte *lo, byte *hi)
+{
+	return (!lo || start >= lo) && (!hi || start + size <= hi);
+}
+
+/*
+============
+Cache_TryAlloc
+
+Finds room for size bytes, which should already include the header and
+padding, starting no lower than lo and ending no higher than hi when they
+are set.  Free blocks are tried before the ends, first those in the bin
+the size falls in, for the closest fit, then the bigger bins in order.
+============
+*/
+cache_system_t *Cache_TryAlloc (int size, byte *lo, byte *hi)
+{
+	cache_system_t	*cs, *new;
+	byte			*start, *end;
+	unsigned		mask;
+	int				bin, pass, i;
+
+	bin = Cache_Bin (size);
+	for (pass = 0 ; pass < 2 ; pass++)
+	{
+		if (pass)
+			mask = cache_binmask & ~((2u << bin) - 1);
+		else
+			mask = cache_binmask & (1u << bin);
+
+		for ( ; mask ; mask &= mask - 1)
+		{
+			for (i = 0 ; !(mask & (1u << i)) ; i++)
+				;
+			for (cs = cache_bins[i].lru_next ; cs != &cache_bins[i] ; cs = cs->lru_next)
+			{
+				if (cs->size < size || !Cache_Fits ((byte *)cs, size, lo, hi))
+					continue;
+
+				Cache_UnlinkFree (cs);
+				if (cs->size - size >= CACHE_MINFREE)
+				{	// the rest stays free
+					new = Cache_Claim ((byte *)cs + size, cs->size - size, cs);
+					Cache_LinkFree (new);
+					cs->size = size;
+				}
+				memset (cs->name, 0, sizeof(cs->name));
+				Cache_MakeLRU (cs);
+				return cs;
+			}
+		}
+	}
+
+// above the last block
+	start = cache_head.prev != &cache_head ? (byte *)cache_head.prev + cache_head.prev->size : hunk_base + hunk_low_used;
+	end = hunk_base + hunk_size - hunk_high_used;
+	if (end - start >= size && Cache_Fits (start, size, lo, hi))
+	{
+		new = Cache_Claim (start, size, cache_head.prev);
+		Cache_MakeLRU (new);
+		return new;
+	}
+
+// below the first block, as high as it will go
+	if (cache_head.next != &cache_head)
+	{
+		start = hunk_base + hunk_low_used;
+		end = (byte *)cache_head.next;
+		if (end - start >= size && Cache_Fits (end - size, size, lo, hi))
+		{
+			new = Cache_Claim (end - size, size, &cache_head);
+			Cache_MakeLRU (new);
+			return new;
+		}
+	}
+
+	return NULL;		// couldn't allocate
+}
 
 /*
 ===========
 Cache_Move
+
+Moves a block into space between lo and hi, or throws it out if there is
+none.
 ===========
 */
-void Cache_Move ( cache_system_t *c)
+void Cache_Move (cache_system_t *c, byte *lo, byte *hi)
 {
 	cache_system_t		*new;
+	cache_user_t		*user;
 
-// we are clearing up space at the bottom, so only allocate it late
-	new = Cache_TryAlloc (c->size, true);
+	user = c->user;
+	new = Cache_TryAlloc (c->size, lo, hi);
 	if (new)
 	{
-//		Con_Printf ("cache_move ok\n");
-
-		Q_memcpy ( new+1, c+1, c->size - sizeof(cache_system_t) );
-		new->user = c->user;
+		Q_memcpy (new+1, c+1, c->size - sizeof(cache_system_t));
+		new->user = user;
+		new->generation = c->generation;
 		Q_memcpy (new->name, c->name, sizeof(new->name));
-		Cache_Free (c->user);
-		new->user->data = (void *)(new+1);
+		if (new->size != c->size)
+			Mem_Adjust ("cache", c->name, 16, new->size - c->size);
+		Cache_Release (c);
+		user->data = (void *)(new+1);
+
+		cache_stats.moves++;
+		cache_stats.bytesmoved += new->size;
 	}
 	else
 	{
-//		Con_Printf ("cache_move failed\n");
-
-		Cache_Free (c->user);		// tough luck...
+		Cache_Free (user);		// tough luck...
+		cache_stats.evictions++;
 	}
 }
 
@@ -651,7 +1457,7 @@ void Cache_FreeLow (int new_low_hunk)
 			return;		// nothing in cache at all
 		if ((byte *)c >= hunk_base + new_low_hunk)
 			return;		// there is space to grow the hunk
-		Cache_Move ( c );	// reclaim the space
+		Cache_Move (c, hunk_base + new_low_hunk, NULL);	// reclaim the space
 	}
 }
 
@@ -664,23 +1470,18 @@ Throw things out until the hunk can be expanded to the given point
 */
 void Cache_FreeHigh (int new_high_hunk)
 {
-	cache_system_t	*c, *prev;
+	cache_system_t	*c;
+	byte			*top;
 	
-	prev = NULL;
+	top = hunk_base + hunk_size - new_high_hunk;
 	while (1)
 	{
 		c = cache_head.prev;
 		if (c == &cache_head)
 			return;		// nothing in cache at all
-		if ( (byte *)c + c->size <= hunk_base + hunk_size - new_high_hunk)
+		if ( (byte *)c + c->size <= top)
 			return;		// there is space to grow the hunk
-		if (c == prev)
-			Cache_Free (c->user);	// didn't move out of the way
-		else
-		{
-			Cache_Move (c);	// try to move it
-			prev = c;
-		}
+		Cache_Move (c, hunk_base + hunk_low_used, top);	// try to move it
 	}
 }
 
@@ -706,86 +1507,6 @@ void Cache_MakeLRU (cache_system_t *cs)
 	cache_head.lru_next = cs;
 }
 
-/*
-============
-Cache_TryAlloc
-
-Looks for a free block of memory between the high and low hunk marks
-Size should already include the header and padding
-============
-*/
-cache_system_t *Cache_TryAlloc (int size, qboolean nobottom)
-{
-	cache_system_t	*cs, *new;
-	
-// is the cache completely empty?
-
-	if (!nobottom && cache_head.prev == &cache_head)
-	{
-		if (hunk_size - hunk_high_used - hunk_low_used < size)
-			Sys_Error ("Cache_TryAlloc: %i is greater then free hunk", size);
-
-		new = (cache_system_t *) (hunk_base + hunk_low_used);
-		memset (new, 0, sizeof(*new));
-		new->size = size;
-
-		cache_head.prev = cache_head.next = new;
-		new->prev = new->next = &cache_head;
-		
-		Cache_MakeLRU (new);
-		return new;
-	}
-	
-// search from the bottom up for space
-
-	new = (cache_system_t *) (hunk_base + hunk_low_used);
-	cs = cache_head.next;
-	
-	do
-	{
-		if (!nobottom || cs != cache_head.next)
-		{
-			if ( (byte *)cs - (byte *)new >= size)
-			{	// found space
-				memset (new, 0, sizeof(*new));
-				new->size = size;
-				
-				new->next = cs;
-				new->prev = cs->prev;
-				cs->prev->next = new;
-				cs->prev = new;
-				
-				Cache_MakeLRU (new);
-	
-				return new;
-			}
-		}
-
-	// continue looking		
-		new = (cache_system_t *)((byte *)cs + cs->size);
-		cs = cs->next;
-
-	} while (cs != &cache_head);
-	
-// try to allocate one at the very end
-	if ( hunk_base + hunk_size - hunk_high_used - (byte *)new >= size)
-	{
-		memset (new, 0, sizeof(*new));
-		new->size = size;
-		
-		new->next = &cache_head;
-		new->prev = cache_head.prev;
-		cache_head.prev->next = new;
-		cache_head.prev = new;
-		
-		Cache_MakeLRU (new);
-
-		return new;
-	}
-	
-	return NULL;		// couldn't allocate
-}
-
 /*
 ============
 Cache_Flush
@@ -797,6 +1518,7 @@ void Cache_Flush (void)
 {
 	while (cache_head.next != &cache_head)
 		Cache_Free ( cache_head.next->user );	// reclaim the space
+	cache_stats.flushes++;
 }
 
 
@@ -812,8 +1534,40 @@ void Cache_Print (void)
 
 	for (cd = cache_head.next ; cd != &cache_head ; cd = cd->next)
 	{
-		Con_Printf ("%8i : %s\n", cd->size, cd->name);
+		Con_Printf ("%8i : %s\n", cd->size, cd->user ? cd->name : "(free)");
+	}
+}
+
+/*
+============
+Cache_PrintReport
+============
+*/
+static void Cache_PrintReport (void (*print) (char *fmt, ...))
+{
+	cache_system_t	*cd;
+	int				blocks, used, holes, holebytes;
+
+	blocks = used = holes = holebytes = 0;
+	for (cd = cache_head.next ; cd != &cache_head ; cd = cd->next)
+	{
+		if (cd->user)
+		{
+			blocks++;
+			used += cd->size;
+		}
+		else
+		{
+			holes++;
+			holebytes += cd->size;
+		}
 	}
+
+	print ("%4.1f megabyte data cache\n", (hunk_size - hunk_high_used - hunk_low_used) / (float)(1024*1024) );
+	print ("%i blocks in %i KB, %i KB in %i holes\n", blocks, used / 1024, holebytes / 1024, holes);
+	print ("%i hits, %i misses, %i of them reloads\n", cache_stats.hits, cache_stats.misses, cache_stats.reloads);
+	print ("%i allocs, %i evictions, %i flushes\n", cache_stats.allocs, cache_stats.evictions, cache_stats.flushes);
+	print ("%i moves of %.0f KB\n", cache_stats.moves, cache_stats.bytesmoved / 1024);
 }
 
 /*
@@ -824,7 +1578,18 @@ Cache_Report
 */
 void Cache_Report (void)
 {
-	Con_DPrintf ("%4.1f megabyte data cache\n", (hunk_size - hunk_high_used - hunk_low_used) / (float)(1024*1024) );
+	Cache_PrintReport (Con_DPrintf);
+}
+
+/*
+============
+Cache_Report_f
+
+============
+*/
+void Cache_Report_f (void)
+{
+	Cache_PrintReport (Con_Printf);
 }
 
 /*
@@ -845,10 +1610,16 @@ Cache_Init
 */
 void Cache_Init (void)
 {
+	int		i;
+
 	cache_head.next = cache_head.prev = &cache_head;
 	cache_head.lru_next = cache_head.lru_prev = &cache_head;
+	for (i = 0 ; i < CACHE_BINS ; i++)
+		cache_bins[i].lru_next = cache_bins[i].lru_prev = &cache_bins[i];
+	cache_binmask = 0;
 
 	Cmd_AddCommand ("flush", Cache_Flush);
+	Cmd_AddCommand ("cachestats", Cache_Report_f);
 }
 
 /*
@@ -867,13 +1638,10 @@ void Cache_Free (cache_user_t *c)
 
 	cs = ((cache_system_t *)c->data) - 1;
 
-	cs->prev->next = cs->next;
-	cs->next->prev = cs->prev;
-	cs->next = cs->prev = NULL;
-
 	c->data = NULL;
 
-	Cache_UnlinkLRU (cs);
+	Mem_Freed ("cache", cs->name, 16, cs->size);
+	Cache_Release (cs);
 }
 
 
@@ -888,14 +1656,22 @@ void *Cache_Check (cache_user_t *c)
 	cache_system_t	*cs;
 
 	if (!c->data)
+	{
+		cache_stats.misses++;
+		if (c->generation)
+			cache_stats.reloads++;
 		return NULL;
+	}
 
 	cs = ((cache_system_t *)c->data) - 1;
+	if (cs->user != c || cs->generation != c->generation)
+		Sys_Error ("Cache_Check: stale cache user");
 
 // move to head of LRU
 	Cache_UnlinkLRU (cs);
 	Cache_MakeLRU (cs);
 	
+	cache_stats.hits++;
 	return c->data;
 }
 
@@ -916,16 +1692,21 @@ void *Cache_Alloc (cache_user_t *c, int size, char *name)
 		Sys_Error ("Cache_Alloc: size %i", size);
 
 	size = (size + sizeof(cache_system_t) + 15) & ~15;
+	if (size > hunk_size - hunk_high_used - hunk_low_used)
+		Sys_Error ("Cache_Alloc: %i is greater then free hunk", size);
 
 // find memory for it	
 	while (1)
 	{
-		cs = Cache_TryAlloc (size, false);
+		cs = Cache_TryAlloc (size, NULL, NULL);
 		if (cs)
 		{
 			strncpy (cs->name, name, sizeof(cs->name)-1);
 			c->data = (void *)(cs+1);
 			cs->user = c;
+			cs->generation = c->generation = ++cache_generation;
+			cache_stats.allocs++;
+			Mem_Alloced ("cache", cs->name, 16, cs->size);
 			break;
 		}
 	
@@ -934,9 +1715,10 @@ void *Cache_Alloc (cache_user_t *c, int size, char *name)
 			Sys_Error ("Cache_Alloc: out of memory");
 													// not enough memory at all
 		Cache_Free ( cache_head.lru_prev->user );
+		cache_stats.evictions++;
 	} 
 	
-	return Cache_Check (c);
+	return c->data;
 }
 
 //============================================================================
@@ -951,6 +1733,7 @@ void Memory_Init (void *buf, int size)
 {
 	int p;
 	int zonesize = DYNAMIC_SIZE;
+	int slabsize = SLAB_SIZE;
 
 	hunk_base = buf;
 	hunk_size = size;
@@ -966,7 +1749,21 @@ void Memory_Init (void *buf, int size)
 		else
 			Sys_Error ("Memory_Init: you must specify a size in KB after -zone");
 	}
+	p = COM_CheckParm ("-slabs");
+	if (p)
+	{
+		if (p < com_argc-1)
+			slabsize = Q_atoi (com_argv[p+1]) * 1024;
+		else
+			Sys_Error ("Memory_Init: you must specify a size in KB after -slabs");
+	}
 	mainzone = Hunk_AllocName (zonesize, "zone" );
 	Z_ClearZone (mainzone, zonesize);
+	Slab_Init (slabsize);
+
+	zone_checkheap = COM_CheckParm ("-zonecheck") != 0;
+	Cmd_AddCommand ("zonestats", Z_Stats_f);
+	Cmd_AddCommand ("memstats", Mem_Stats_f);
+	Cmd_AddCommand ("memdump", Mem_Dump_f);
 }
 
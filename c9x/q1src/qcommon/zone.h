@@ -36,8 +36,10 @@ server allocations when changing to a higher video mode.
 
 
 Z_??? Zone memory functions used for small, dynamic allocations like text
-strings from command input.  There is only about 48K for it, allocated at
-the very bottom of the hunk.
+strings from command input.  There is only about 48K for it (-zone), allocated
+at the very bottom of the hunk.  Blocks of 256 bytes or less go to slab pages
+in a separate 32K hunk block (-slabs) right after it, and only fall back to
+the first fit zone when those are all taken.
 
 Cache_??? Cache memory is for objects that can be dynamically loaded and
 can usefully stay persistant between levels.  The size of the cache
@@ -91,6 +93,10 @@ void *Z_TagMalloc (int size, int tag);
 void *Z_Realloc (void *ptr, int size);
 void Z_DumpHeap (void);
 void Z_CheckHeap (void);
+void Z_Stats_f (void);
+
+void Mem_Stats_f (void);		// hunk, cache and zone use by owner
+void Mem_Dump_f (void);			// the same as CSV
 int Z_FreeMemory (void);
 
 void *Hunk_Alloc (int size);		// returns 0 filled memory
@@ -111,6 +117,7 @@ void Hunk_Check (void);
 typedef struct cache_user_s
 {
 	void	*data;
+	int		generation;		// of the last allocation, 0 if never cached
 } cache_user_t;
 
 void Cache_Flush (void);
@@ -126,6 +133,7 @@ void *Cache_Alloc (cache_user_t *c, int size, char *name);
 // wasn't enough room.
 
 void Cache_Report (void);
+void Cache_Report_f (void);
 
 
 
@@ -26,6 +26,10 @@ typedef struct
 	struct client_s	*clients;		// [maxclients]
 	int			serverflags;		// episode completion information
 	qboolean	changelevel_issued;	// cleared when at SV_SpawnServer
+
+	int			num_client_entities;	// maxclientslimit*UPDATE_BACKUP*64
+	int			next_client_entities;	// next client_entity to use
+	entity_state_t	*client_entities;	// [num_client_entities]
 } server_static_t;
 
 //=============================================================================
@@ -75,6 +79,13 @@ typedef struct
 #define	NUM_PING_TIMES		16
 #define	NUM_SPAWN_PARMS		16
 
+typedef struct
+{
+	int				framenum;			// svc_packetentities frame number
+	int				num_entities;
+	int				first_entity;		// into the circular svs.client_entities[]
+} client_frame_t;
+
 typedef struct client_s
 {
 	qboolean		active;				// false = client is free
@@ -106,6 +117,11 @@ typedef struct client_s
 
 // client known data for deltas	
 	int				old_frags;
+
+	int				protocolext;		// PEXT_* bits agreed for this level
+	client_frame_t	frames[UPDATE_BACKUP];	// updates can be deltad from here
+	int				framenum;			// last svc_packetentities frame sent
+	int				ackframe;			// last frame the client has, 0 = none
 } client_t;
 
 
@@ -195,6 +211,37 @@ typedef struct client_s
 
 //============================================================================
 
+// binary savegames: a header followed by raw blocks, written and read in
+// native byte order.  String fields outside the progs string table are
+// stored as -1 - index into the snapshot's own string list, and entity
+// fields as edict numbers.
+#define	SNAPSHOT_IDENT		(('P'<<24)+('N'<<16)+('S'<<8)+'Q')
+#define	SNAPSHOT_IDENT_SWAPPED	(('Q'<<24)+('S'<<16)+('N'<<8)+'P')
+#define	SNAPSHOT_VERSION	1
+
+typedef struct
+{
+	int		ident;
+	int		version;
+	char	comment[SAVEGAME_COMMENT_LENGTH+1];
+	char	mapname[MAX_QPATH];
+	int		crc;				// of the progs that wrote it
+	int		entityfields;
+	int		numglobals;
+	int		num_edicts;
+	int		skill;
+	float	time;
+	float	spawn_parms[NUM_SPAWN_PARMS];
+	int		ofs_lightstyles;	// MAX_LIGHTSTYLES strings
+	int		ofs_globals;		// numglobals words
+	int		ofs_edicts;			// num_edicts records of a free flag + entityfields words
+	int		ofs_strings;		// numstrings strings
+	int		numstrings;
+	int		filelen;
+} snapshot_t;
+
+//============================================================================
+
 extern	cvar_t	teamplay;
 extern	cvar_t	skill;
 extern	cvar_t	deathmatch;
@@ -244,6 +291,12 @@ qboolean SV_CheckBottom (edict_t *ent);
 qboolean SV_movestep (edict_t *ent, vec3_t move, qboolean relink);
 
 void SV_WriteClientdataToMessage (edict_t *ent, sizebuf_t *msg);
+void SV_EntityStats_f (void);
+
+extern	int		fatpvs_lookups, fatpvs_hits;
+void SV_ClearFatPVSCache (void);
+byte *SV_FatPVS (vec3_t org);
+byte *SV_LeafPVS (struct mleaf_s *leaf);
 
 void SV_MoveToGoal (void);
 
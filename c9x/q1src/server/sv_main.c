@@ -20,6 +20,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 // sv_main.c -- server main program
 
 #include "quakedef.h"
+#include <stdint.h>
 
 server_t		sv;
 server_static_t	svs;
@@ -46,6 +47,11 @@ void SV_Init (void)
 	extern	cvar_t	sv_accelerate;
 	extern	cvar_t	sv_idealpitchscale;
 	extern	cvar_t	sv_aim;
+	extern	cvar_t	sv_areatree;
+	extern	cvar_t	sv_contentsgrid;
+	extern	cvar_t	sv_parallelphysics;
+	extern	cvar_t	sv_parallelcheck;
+	extern	cvar_t	sv_deltaentities;
 
 	Cvar_RegisterVariable (&sv_maxvelocity);
 	Cvar_RegisterVariable (&sv_gravity);
@@ -57,6 +63,16 @@ void SV_Init (void)
 	Cvar_RegisterVariable (&sv_idealpitchscale);
 	Cvar_RegisterVariable (&sv_aim);
 	Cvar_RegisterVariable (&sv_nostep);
+	Cvar_RegisterVariable (&sv_areatree);
+	Cvar_RegisterVariable (&sv_contentsgrid);
+	Cvar_RegisterVariable (&sv_parallelphysics);
+	Cvar_RegisterVariable (&sv_parallelcheck);
+	Cvar_RegisterVariable (&sv_deltaentities);
+
+	Cmd_AddCommand ("tracebench", SV_TraceBench_f);
+	Cmd_AddCommand ("contentsgrid", SV_ContentsGrid_f);
+	Cmd_AddCommand ("speculation", SV_Speculation_f);
+	Cmd_AddCommand ("entitystats", SV_EntityStats_f);
 
 	for (i=0 ; i<MAX_MODELS ; i++)
 		sprintf (localmodels[i], "*%i", i);
@@ -190,6 +206,7 @@ void SV_SendServerinfo (client_t *client)
 {
 	char			**s;
 	char			message[2048];
+	int				i;
 
 	MSG_WriteByte (&client->message, svc_print);
 	sprintf (message, "%c\nVERSION %4.2f SERVER (%i CRC)", 2, VERSION, pr_crc);
@@ -228,6 +245,13 @@ void SV_SendServerinfo (client_t *client)
 
 	client->sendsignon = true;
 	client->spawned = false;		// need prespawn, spawn, etc
+
+// extensions are asked for again after every serverinfo, and nothing
+// from the last level can be deltad from
+	client->protocolext = 0;
+	client->ackframe = 0;
+	for (i=0 ; i<UPDATE_BACKUP ; i++)
+		client->frames[i].framenum = -1;
 }
 
 /*
@@ -362,6 +386,21 @@ crosses a waterline.
 int		fatbytes;
 byte	fatpvs[MAX_MAP_LEAFS/8];
 
+/*
+=============
+SV_LeafPVS
+
+Mod_LeafPVS decompresses into a buffer the renderer uses too, and with
+sv_threaded the renderer may be drawing at the same time
+=============
+*/
+byte *SV_LeafPVS (mleaf_t *leaf)
+{
+	static uint64_t	row[MAX_MAP_LEAFS/64];	// whole words for SV_OrPVS
+
+	return Mod_LeafPVSInto (leaf, sv.worldmodel, (byte *)row);
+}
+
 void SV_AddToFatPVS (vec3_t org, mnode_t *node)
 {
 	int		i;
@@ -376,7 +415,7 @@ void SV_AddToFatPVS (vec3_t org, mnode_t *node)
 		{
 			if (node->contents != CONTENTS_SOLID)
 			{
-				pvs = Mod_LeafPVS ( (mleaf_t *)node, sv.worldmodel);
+				pvs = SV_LeafPVS ( (mleaf_t *)node);
 				for (i=0 ; i<fatbytes ; i++)
 					fatpvs[i] |= pvs[i];
 			}
@@ -397,25 +436,350 @@ void SV_AddToFatPVS (vec3_t org, mnode_t *node)
 	}
 }
 
+/*
+=============================================================================
+
+Clients standing in the same spot, or different spots touching the same
+leafs, end up with the same fat PVS, so the result is cached keyed on the
+set of leafs.  The leaf rows never change during a level, so entries stay
+good until SV_ClearFatPVSCache at the next map.
+
+A new entry ors the rows together 64 bits at a time, or 128 with SSE2 when
+the compiler targets it (x86-64, or -msse2 on x86).  The default -m32 build
+doesn't, and gets the 64 bit loop, which is two 32 bit ors a word there.
+
+=============================================================================
+*/
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define	FATPVS_SSE2
+#include <emmintrin.h>
+#endif
+
+#define	FATPVS_CACHE	32
+#define	FATPVS_LEAFS	32		// spots touching more leafs are not cached
+
+typedef struct
+{
+	int		numleafs;		// 0 = free
+	int		leafs[FATPVS_LEAFS];	// in SV_FatLeafs order
+	int		lastused;
+	uint64_t	pvs[MAX_MAP_LEAFS/64];
+} fatpvscache_t;
+
+static fatpvscache_t	fatpvs_cache[FATPVS_CACHE];
+static int		fatpvs_sequence;
+int				fatpvs_lookups, fatpvs_hits;
+
+static int		fat_numleafs;
+static int		fat_leafs[FATPVS_LEAFS];
+
+/*
+=============
+SV_FatLeafs
+
+Collects the non solid leafs within 8 units of org into fat_leafs, counting
+past FATPVS_LEAFS without storing.
+=============
+*/
+static void SV_FatLeafs (vec3_t org, mnode_t *node)
+{
+	mplane_t	*plane;
+	float	d;
+
+	while (1)
+	{
+		if (node->contents < 0)
+		{
+			if (node->contents != CONTENTS_SOLID)
+			{
+				if (fat_numleafs < FATPVS_LEAFS)
+					fat_leafs[fat_numleafs] = (mleaf_t *)node - sv.worldmodel->leafs;
+				fat_numleafs++;
+			}
+			return;
+		}
+	
+		plane = node->plane;
+		d = DotProduct (org, plane->normal) - plane->dist;
+		if (d > 8)
+			node = node->children[0];
+		else if (d < -8)
+			node = node->children[1];
+		else
+		{	// go down both
+			SV_FatLeafs (org, node->children[0]);
+			node = node->children[1];
+		}
+	}
+}
+
+/*
+=============
+SV_ClearFatPVSCache
+
+Called when a new world is loaded
+=============
+*/
+void SV_ClearFatPVSCache (void)
+{
+	int		i;
+
+	for (i=0 ; i<FATPVS_CACHE ; i++)
+		fatpvs_cache[i].numleafs = 0;
+	fatpvs_lookups = fatpvs_hits = 0;
+}
+
+/*
+=============
+SV_OrPVS
+
+Ors the first words 64 bit words of src into dst.  With SSE2 words is even;
+the rows are sized in 128 bit steps, so that never reads past one.
+=============
+*/
+static void SV_OrPVS (uint64_t *dst, uint64_t *src, int words)
+{
+	int		i;
+
+#ifdef FATPVS_SSE2
+	for (i=0 ; i<words ; i+=2)
+		_mm_storeu_si128 ((__m128i *)(dst + i), _mm_or_si128 (_mm_loadu_si128 ((__m128i *)(dst + i)), _mm_loadu_si128 ((__m128i *)(src + i))));
+#else
+	for (i=0 ; i<words ; i++)
+		dst[i] |= src[i];
+#endif
+}
+
 /*
 =============
 SV_FatPVS
 
 Calculates a PVS that is the inclusive or of all leafs within 8 pixels of the
-given point.
+given point.  The returned row stays valid until the next call.
 =============
 */
 byte *SV_FatPVS (vec3_t org)
 {
+	int				i;
+	int				words;
+	fatpvscache_t	*c, *oldest;
+
 	fatbytes = (sv.worldmodel->numleafs+31)>>3;
-	Q_memset (fatpvs, 0, fatbytes);
-	SV_AddToFatPVS (org, sv.worldmodel->nodes);
-	return fatpvs;
+
+// the walk goes through the tree in order, so the same set of leafs always
+// comes back in the same order
+	fat_numleafs = 0;
+	SV_FatLeafs (org, sv.worldmodel->nodes);
+	if (!fat_numleafs || fat_numleafs > FATPVS_LEAFS)
+	{	// in solid, or too many to key on, build it directly
+		Q_memset (fatpvs, 0, fatbytes);
+		SV_AddToFatPVS (org, sv.worldmodel->nodes);
+		return fatpvs;
+	}
+
+	fatpvs_lookups++;
+	fatpvs_sequence++;
+
+	oldest = fatpvs_cache;
+	for (i=0, c=fatpvs_cache ; i<FATPVS_CACHE ; i++, c++)
+	{
+		if (c->numleafs == fat_numleafs
+		&& !memcmp (c->leafs, fat_leafs, fat_numleafs*sizeof(int)))
+		{
+			fatpvs_hits++;
+			c->lastused = fatpvs_sequence;
+			return (byte *)c->pvs;
+		}
+		if (oldest->numleafs && (!c->numleafs || c->lastused < oldest->lastused))
+			oldest = c;
+	}
+
+// build it into the least recently used slot
+	c = oldest;
+	c->numleafs = fat_numleafs;
+	memcpy (c->leafs, fat_leafs, fat_numleafs*sizeof(int));
+	c->lastused = fatpvs_sequence;
+
+	words = (sv.worldmodel->numleafs + 63) >> 6;
+#ifdef FATPVS_SSE2
+	words = (words + 1) & ~1;
+#endif
+	Q_memset (c->pvs, 0, words*sizeof(uint64_t));
+	for (i=0 ; i<fat_numleafs ; i++)
+		SV_OrPVS (c->pvs, (uint64_t *)SV_LeafPVS (sv.worldmodel->leafs + fat_leafs[i]), words);
+
+	return (byte *)c->pvs;
 }
 
 //=============================================================================
 
 
+cvar_t	sv_deltaentities = {"sv_deltaentities","1"};	// offer svc_packetentities to clients
+
+int		sv_entityframes[2];		// baseline updates, packetentities
+int		sv_entitybytes[2];
+
+/*
+=============
+SV_EntityVisible
+
+The client's own entity is always sent, anything else needs a visible
+model touching a leaf in the PVS.
+=============
+*/
+static qboolean SV_EntityVisible (edict_t *clent, edict_t *ent, byte *pvs)
+{
+	int		i;
+
+#ifdef QUAKE2
+	// don't send if flagged for NODRAW and there are no lighting effects
+	if (ent->v.effects == EF_NODRAW)
+		return false;
+#endif
+
+	if (ent == clent)
+		return true;
+
+// ignore ents without visible models
+	if (!ent->v.modelindex || !PR_GetString(ent->v.model)[0])
+		return false;
+
+	for (i=0 ; i < ent->num_leafs ; i++)
+		if (pvs[ent->leafnums[i] >> 3] & (1 << (ent->leafnums[i]&7) ))
+			return true;
+
+	return false;		// not visible
+}
+
+/*
+=============
+SV_EntityDeltaBits
+
+Update bits needed to bring a client that has from up to date with ent
+=============
+*/
+static int SV_EntityDeltaBits (edict_t *ent, entity_state_t *from, int e)
+{
+	int		i;
+	int		bits;
+	float	miss;
+
+	bits = 0;
+	
+	for (i=0 ; i<3 ; i++)
+	{
+		miss = ent->v.origin[i] - from->origin[i];
+		if ( miss < -0.1 || miss > 0.1 )
+			bits |= U_ORIGIN1<<i;
+	}
+
+	if ( ent->v.angles[0] != from->angles[0] )
+		bits |= U_ANGLE1;
+		
+	if ( ent->v.angles[1] != from->angles[1] )
+		bits |= U_ANGLE2;
+		
+	if ( ent->v.angles[2] != from->angles[2] )
+		bits |= U_ANGLE3;
+		
+	if (ent->v.movetype == MOVETYPE_STEP)
+		bits |= U_NOLERP;	// don't mess up the step animation
+
+	if (from->colormap != ent->v.colormap)
+		bits |= U_COLORMAP;
+		
+	if (from->skin != ent->v.skin)
+		bits |= U_SKIN;
+		
+	if (from->frame != ent->v.frame)
+		bits |= U_FRAME;
+	
+	if (from->effects != ent->v.effects)
+		bits |= U_EFFECTS;
+	
+	if (from->modelindex != ent->v.modelindex)
+		bits |= U_MODEL;
+
+	if (e >= 256)
+		bits |= U_LONGENTITY;
+		
+	if (bits >= 256)
+		bits |= U_MOREBITS;
+
+	return bits;
+}
+
+/*
+=============
+SV_WriteEntityUpdate
+
+Writes the fields flagged in bits, and copies them into to if it is given so
+the server knows what the client ends up with.
+=============
+*/
+static void SV_WriteEntityUpdate (sizebuf_t *msg, edict_t *ent, int e, int bits, entity_state_t *to)
+{
+	MSG_WriteByte (msg,bits | U_SIGNAL);
+	
+	if (bits & U_MOREBITS)
+		MSG_WriteByte (msg, bits>>8);
+	if (bits & U_LONGENTITY)
+		MSG_WriteShort (msg,e);
+	else
+		MSG_WriteByte (msg,e);
+
+	if (bits & U_MODEL)
+		MSG_WriteByte (msg,	ent->v.modelindex);
+	if (bits & U_FRAME)
+		MSG_WriteByte (msg, ent->v.frame);
+	if (bits & U_COLORMAP)
+		MSG_WriteByte (msg, ent->v.colormap);
+	if (bits & U_SKIN)
+		MSG_WriteByte (msg, ent->v.skin);
+	if (bits & U_EFFECTS)
+		MSG_WriteByte (msg, ent->v.effects);
+	if (bits & U_ORIGIN1)
+		MSG_WriteCoord (msg, ent->v.origin[0]);		
+	if (bits & U_ANGLE1)
+		MSG_WriteAngle(msg, ent->v.angles[0]);
+	if (bits & U_ORIGIN2)
+		MSG_WriteCoord (msg, ent->v.origin[1]);
+	if (bits & U_ANGLE2)
+		MSG_WriteAngle(msg, ent->v.angles[1]);
+	if (bits & U_ORIGIN3)
+		MSG_WriteCoord (msg, ent->v.origin[2]);
+	if (bits & U_ANGLE3)
+		MSG_WriteAngle(msg, ent->v.angles[2]);
+
+	if (!to)
+		return;
+
+	to->number = e;
+	if (bits & U_MODEL)
+		to->modelindex = ent->v.modelindex;
+	if (bits & U_FRAME)
+		to->frame = ent->v.frame;
+	if (bits & U_COLORMAP)
+		to->colormap = ent->v.colormap;
+	if (bits & U_SKIN)
+		to->skin = ent->v.skin;
+	if (bits & U_EFFECTS)
+		to->effects = ent->v.effects;
+	if (bits & U_ORIGIN1)
+		to->origin[0] = ent->v.origin[0];
+	if (bits & U_ANGLE1)
+		to->angles[0] = ent->v.angles[0];
+	if (bits & U_ORIGIN2)
+		to->origin[1] = ent->v.origin[1];
+	if (bits & U_ANGLE2)
+		to->angles[1] = ent->v.angles[1];
+	if (bits & U_ORIGIN3)
+		to->origin[2] = ent->v.origin[2];
+	if (bits & U_ANGLE3)
+		to->angles[2] = ent->v.angles[2];
+}
+
 /*
 =============
 SV_WriteEntitiesToClient
@@ -424,126 +788,206 @@ SV_WriteEntitiesToClient
 */
 void SV_WriteEntitiesToClient (edict_t	*clent, sizebuf_t *msg)
 {
-	int		e, i;
-	int		bits;
+	int		e;
+	int		start;
 	byte	*pvs;
 	vec3_t	org;
-	float	miss;
 	edict_t	*ent;
 
 // find the client's PVS
 	VectorAdd (clent->v.origin, clent->v.view_ofs, org);
 	pvs = SV_FatPVS (org);
 
+	start = msg->cursize;
+
 // send over all entities (excpet the client) that touch the pvs
 	ent = NEXT_EDICT(sv.edicts);
 	for (e=1 ; e<sv.num_edicts ; e++, ent = NEXT_EDICT(ent))
 	{
-#ifdef QUAKE2
-		// don't send if flagged for NODRAW and there are no lighting effects
-		if (ent->v.effects == EF_NODRAW)
+		if (!SV_EntityVisible (clent, ent, pvs))
 			continue;
-#endif
-
-// ignore if not touching a PV leaf
-		if (ent != clent)	// clent is ALLWAYS sent
-		{
-// ignore ents without visible models
-			if (!ent->v.modelindex || !PR_GetString(ent->v.model)[0])
-				continue;
-
-			for (i=0 ; i < ent->num_leafs ; i++)
-				if (pvs[ent->leafnums[i] >> 3] & (1 << (ent->leafnums[i]&7) ))
-					break;
-				
-			if (i == ent->num_leafs)
-				continue;		// not visible
-		}
 
 		if (msg->maxsize - msg->cursize < 16)
 		{
 			Con_Printf ("packet overflow\n");
-			return;
+			break;
 		}
 
 // send an update
-		bits = 0;
-		
-		for (i=0 ; i<3 ; i++)
+		SV_WriteEntityUpdate (msg, ent, e, SV_EntityDeltaBits (ent, &ent->baseline, e), NULL);
+	}
+
+	sv_entityframes[0]++;
+	sv_entitybytes[0] += msg->cursize - start;
+}
+
+/*
+=============
+SV_WritePacketEntities
+
+Like SV_WriteEntitiesToClient, but for clients that asked for
+PEXT_DELTAENTITIES.  The visible entities are deltad against the last frame
+the client acknowledged instead of the baselines, so entities that have not
+changed since then cost nothing, and entities that left the frame are sent
+as U_REMOVE.  The state the client ends up with is saved in client->frames
+for later deltas.
+=============
+*/
+void SV_WritePacketEntities (client_t *client, sizebuf_t *msg)
+{
+	int				e, i;
+	int				start;
+	int				bits;
+	int				oldindex, oldnum;
+	byte			*pvs;
+	vec3_t			org;
+	edict_t			*clent, *ent;
+	client_frame_t	*frame, *oldframe;
+	entity_state_t	*oldent, *state;
+	int				numvisible;
+	edict_t			*visible[MAX_PACKET_ENTITIES];
+	qboolean		overflow;
+
+	clent = client->edict;
+
+// find the client's PVS
+	VectorAdd (clent->v.origin, clent->v.view_ofs, org);
+	pvs = SV_FatPVS (org);
+
+	numvisible = 0;
+	ent = NEXT_EDICT(sv.edicts);
+	for (e=1 ; e<sv.num_edicts && numvisible < MAX_PACKET_ENTITIES ; e++, ent = NEXT_EDICT(ent))
+		if (SV_EntityVisible (clent, ent, pvs))
+			visible[numvisible++] = ent;
+
+	client->framenum++;
+
+// the frame to delta from has to still be in both the client's and the
+// entity ring buffers
+	oldframe = NULL;
+	if (client->ackframe > 0 && client->framenum - client->ackframe < UPDATE_BACKUP)
+	{
+		oldframe = &client->frames[client->ackframe & UPDATE_MASK];
+		if (oldframe->framenum != client->ackframe
+		|| svs.next_client_entities - oldframe->first_entity > svs.num_client_entities - MAX_PACKET_ENTITIES)
+			oldframe = NULL;
+	}
+
+	frame = &client->frames[client->framenum & UPDATE_MASK];
+	frame->framenum = client->framenum;
+	frame->first_entity = svs.next_client_entities;
+	frame->num_entities = 0;
+
+	start = msg->cursize;
+
+	MSG_WriteByte (msg, svc_packetentities);
+	MSG_WriteLong (msg, client->framenum);
+	MSG_WriteByte (msg, oldframe ? client->framenum - client->ackframe : 0);
+
+	overflow = false;
+	oldindex = 0;
+	i = 0;
+	while (i < numvisible || (oldframe && oldindex < oldframe->num_entities))
+	{
+		if (oldframe && oldindex < oldframe->num_entities)
+		{
+			oldent = &svs.client_entities[(oldframe->first_entity+oldindex) % svs.num_client_entities];
+			oldnum = oldent->number;
+		}
+		else
 		{
-			miss = ent->v.origin[i] - ent->baseline.origin[i];
-			if ( miss < -0.1 || miss > 0.1 )
-				bits |= U_ORIGIN1<<i;
+			oldent = NULL;
+			oldnum = 99999;
 		}
 
-		if ( ent->v.angles[0] != ent->baseline.angles[0] )
-			bits |= U_ANGLE1;
-			
-		if ( ent->v.angles[1] != ent->baseline.angles[1] )
-			bits |= U_ANGLE2;
-			
-		if ( ent->v.angles[2] != ent->baseline.angles[2] )
-			bits |= U_ANGLE3;
-			
-		if (ent->v.movetype == MOVETYPE_STEP)
-			bits |= U_NOLERP;	// don't mess up the step animation
-	
-		if (ent->baseline.colormap != ent->v.colormap)
-			bits |= U_COLORMAP;
-			
-		if (ent->baseline.skin != ent->v.skin)
-			bits |= U_SKIN;
-			
-		if (ent->baseline.frame != ent->v.frame)
-			bits |= U_FRAME;
-		
-		if (ent->baseline.effects != ent->v.effects)
-			bits |= U_EFFECTS;
-		
-		if (ent->baseline.modelindex != ent->v.modelindex)
-			bits |= U_MODEL;
+		if (i < numvisible)
+		{
+			ent = visible[i];
+			e = NUM_FOR_EDICT(ent);
+		}
+		else
+		{
+			ent = NULL;
+			e = 99999;
+		}
 
-		if (e >= 256)
-			bits |= U_LONGENTITY;
-			
-		if (bits >= 256)
-			bits |= U_MOREBITS;
+		if (!overflow && msg->maxsize - msg->cursize < 32)
+		{
+			Con_Printf ("packet overflow\n");
+			overflow = true;
+		}
 
-	//
-	// write the message
-	//
-		MSG_WriteByte (msg,bits | U_SIGNAL);
-		
-		if (bits & U_MOREBITS)
-			MSG_WriteByte (msg, bits>>8);
-		if (bits & U_LONGENTITY)
-			MSG_WriteShort (msg,e);
+		state = &svs.client_entities[svs.next_client_entities % svs.num_client_entities];
+
+		if (e == oldnum)
+		{	// delta from the previous frame, nothing at all if unchanged
+			*state = *oldent;
+			bits = SV_EntityDeltaBits (ent, oldent, e);
+			if (!overflow && (bits & ~(U_MOREBITS|U_NOLERP|U_LONGENTITY)))
+				SV_WriteEntityUpdate (msg, ent, e, bits, state);
+			oldindex++;
+			i++;
+		}
+		else if (e < oldnum)
+		{	// new to this client, delta from the baseline
+			i++;
+			if (overflow)
+				continue;
+			*state = ent->baseline;
+			SV_WriteEntityUpdate (msg, ent, e, SV_EntityDeltaBits (ent, &ent->baseline, e), state);
+		}
 		else
-			MSG_WriteByte (msg,e);
-
-		if (bits & U_MODEL)
-			MSG_WriteByte (msg,	ent->v.modelindex);
-		if (bits & U_FRAME)
-			MSG_WriteByte (msg, ent->v.frame);
-		if (bits & U_COLORMAP)
-			MSG_WriteByte (msg, ent->v.colormap);
-		if (bits & U_SKIN)
-			MSG_WriteByte (msg, ent->v.skin);
-		if (bits & U_EFFECTS)
-			MSG_WriteByte (msg, ent->v.effects);
-		if (bits & U_ORIGIN1)
-			MSG_WriteCoord (msg, ent->v.origin[0]);		
-		if (bits & U_ANGLE1)
-			MSG_WriteAngle(msg, ent->v.angles[0]);
-		if (bits & U_ORIGIN2)
-			MSG_WriteCoord (msg, ent->v.origin[1]);
-		if (bits & U_ANGLE2)
-			MSG_WriteAngle(msg, ent->v.angles[1]);
-		if (bits & U_ORIGIN3)
-			MSG_WriteCoord (msg, ent->v.origin[2]);
-		if (bits & U_ANGLE3)
-			MSG_WriteAngle(msg, ent->v.angles[2]);
+		{	// gone from the client's view
+			oldindex++;
+			if (overflow)
+				*state = *oldent;	// still there as far as the client knows
+			else
+			{
+				bits = U_REMOVE | U_MOREBITS;
+				if (oldnum >= 256)
+					bits |= U_LONGENTITY;
+				MSG_WriteByte (msg, bits | U_SIGNAL);
+				MSG_WriteByte (msg, bits>>8);
+				if (bits & U_LONGENTITY)
+					MSG_WriteShort (msg, oldnum);
+				else
+					MSG_WriteByte (msg, oldnum);
+				continue;
+			}
+		}
+
+		svs.next_client_entities++;
+		frame->num_entities++;
+	}
+
+	MSG_WriteByte (msg, 0);
+
+	sv_entityframes[1]++;
+	sv_entitybytes[1] += msg->cursize - start;
+}
+
+/*
+=============
+SV_EntityStats_f
+
+Average bytes of entity updates per client frame since the last call
+=============
+*/
+void SV_EntityStats_f (void)
+{
+	int		i;
+	static char	*names[2] = {"baseline", "delta"};
+
+	for (i=0 ; i<2 ; i++)
+	{
+		if (!sv_entityframes[i])
+			continue;
+		Con_Printf ("%-8s: %i frames, %.1f bytes/frame\n", names[i],
+			sv_entityframes[i], (float)sv_entitybytes[i] / sv_entityframes[i]);
 	}
+
+	sv_entityframes[0] = sv_entityframes[1] = 0;
+	sv_entitybytes[0] = sv_entitybytes[1] = 0;
 }
 
 /*
@@ -730,7 +1174,10 @@ qboolean SV_SendClientDatagram (client_t *client)
 // add the client specific data to the datagram
 	SV_WriteClientdataToMessage (client->edict, &msg);
 
-	SV_WriteEntitiesToClient (client->edict, &msg);
+	if (client->protocolext & PEXT_DELTAENTITIES)
+		SV_WritePacketEntities (client, &msg);
+	else
+		SV_WriteEntitiesToClient (client->edict, &msg);
 
 // copy the server datagram if there is space
 	if (msg.cursize + sv.datagram.cursize < msg.maxsize)
@@ -879,6 +1326,8 @@ void SV_SendClientMessages (void)
 		}
 	}
 	
+// everything for every client goes out together
+	NET_Flush ();
 	
 // clear muzzle flashes
 	SV_CleanupEnts ();
@@ -1138,6 +1587,8 @@ void SV_SpawnServer (char *server)
 // clear world interaction links
 //
 	SV_ClearWorld ();
+	SV_BuildContentsGrid ();
+	SV_ClearFatPVSCache ();
 	
 	sv.sound_precache[0] = pr_strings;
 
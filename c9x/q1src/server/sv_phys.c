@@ -44,6 +44,7 @@ cvar_t	sv_stopspeed = {"sv_stopspeed","100"};
 cvar_t	sv_gravity = {"sv_gravity","800",false,true};
 cvar_t	sv_maxvelocity = {"sv_maxvelocity","2000"};
 cvar_t	sv_nostep = {"sv_nostep","0"};
+cvar_t	sv_parallelphysics = {"sv_parallelphysics","0"};	// 1 = trace ahead on the worker threads
 
 #ifdef QUAKE2
 static	vec3_t	vec_origin = {0.0, 0.0, 0.0};
@@ -105,6 +106,7 @@ void SV_CheckVelocity (edict_t *ent)
 		{
 			Con_Printf ("Got a NaN origin on %s\n", PR_GetString(ent->v.classname));
 			ent->v.origin[i] = 0;
+			SV_MarkEdictMoved (ent);
 		}
 		if (ent->v.velocity[i] > sv_maxvelocity.value)
 			ent->v.velocity[i] = sv_maxvelocity.value;
@@ -297,6 +299,7 @@ int SV_FlyMove (edict_t *ent, float time, trace_t *steptrace)
 //
 // run the impact function
 //
+		SV_MarkEdictMoved (ent);	// not relinked until the move is done
 		SV_Impact (ent, trace.ent);
 		if (ent->free)
 			break;		// removed by the impact function
@@ -364,28 +367,36 @@ int SV_FlyMove (edict_t *ent, float time, trace_t *steptrace)
 
 /*
 ============
-SV_AddGravity
+SV_EntGravity
 
 ============
 */
-void SV_AddGravity (edict_t *ent)
+float SV_EntGravity (edict_t *ent)
 {
-	float	ent_gravity;
-
 #ifdef QUAKE2
 	if (ent->v.gravity)
-		ent_gravity = ent->v.gravity;
-	else
-		ent_gravity = 1.0;
+		return ent->v.gravity;
 #else
 	eval_t	*val;
 
 	val = GetEdictFieldValue(ent, "gravity");
 	if (val && val->_float)
-		ent_gravity = val->_float;
-	else
-		ent_gravity = 1.0;
+		return val->_float;
 #endif
+	return 1.0;
+}
+
+/*
+============
+SV_AddGravity
+
+============
+*/
+void SV_AddGravity (edict_t *ent)
+{
+	float	ent_gravity;
+
+	ent_gravity = SV_EntGravity (ent);
 	ent->v.velocity[2] -= ent_gravity * sv_gravity.value * host_frametime;
 }
 
@@ -524,6 +535,7 @@ void SV_PushMove (edict_t *pusher, float movetime)
 			{	// corpse
 				check->v.mins[0] = check->v.mins[1] = 0;
 				VectorCopy (check->v.mins, check->v.maxs);
+				SV_MarkEdictMoved (check);
 				continue;
 			}
 			
@@ -657,6 +669,7 @@ void SV_PushRotate (edict_t *pusher, float movetime)
 			{	// corpse
 				check->v.mins[0] = check->v.mins[1] = 0;
 				VectorCopy (check->v.mins, check->v.maxs);
+				SV_MarkEdictMoved (check);
 				continue;
 			}
 			
@@ -1498,6 +1511,103 @@ void SV_Physics_Step (edict_t *ent)
 
 //============================================================================
 
+/*
+================
+SV_SpeculatePhysics
+
+Works out the first move SV_Physics_Toss or SV_Physics_Step is going to
+make this frame for each falling or flying edict that doesn't think first,
+the same way they will, and has SV_SpeculateMoves trace them all on the
+worker threads.  Whether a stored trace is still good when the edict's
+turn comes is up to SV_Move, so a wrong guess only costs its trace.
+================
+*/
+void SV_SpeculatePhysics (void)
+{
+	static edict_t	*ents[MAX_EDICTS];
+	static vec3_t	ends[MAX_EDICTS];
+	static int		types[MAX_EDICTS];
+	vec3_t		vel, move;
+	float		ent_gravity, time_left;
+	edict_t		*ent;
+	int			i, j, count;
+
+	count = 0;
+	for (i=svs.maxclients+1 ; i<sv.num_edicts ; i++)
+	{
+		ent = EDICT_NUM(i);
+		if (ent->free)
+			continue;
+
+		for (j=0 ; j<3 ; j++)
+			if (IS_NAN(ent->v.velocity[j]) || IS_NAN(ent->v.origin[j]))
+				break;
+		if (j < 3)
+			continue;		// SV_CheckVelocity will complain first
+		VectorCopy (ent->v.velocity, vel);
+
+		if (ent->v.movetype == MOVETYPE_STEP)
+		{
+		// SV_Physics_Step: gravity, bound, then SV_FlyMove
+			if ((int)ent->v.flags & (FL_ONGROUND | FL_FLY | FL_SWIM))
+				continue;
+			ent_gravity = SV_EntGravity (ent);
+			vel[2] -= ent_gravity * sv_gravity.value * host_frametime;
+		}
+		else if (ent->v.movetype == MOVETYPE_TOSS
+		|| ent->v.movetype == MOVETYPE_BOUNCE
+		|| ent->v.movetype == MOVETYPE_FLY
+		|| ent->v.movetype == MOVETYPE_FLYMISSILE)
+		{
+		// SV_Physics_Toss: think, bound, gravity, then SV_PushEntity
+			if (ent->v.nextthink > 0 && ent->v.nextthink <= sv.time + host_frametime)
+				continue;
+			if ((int)ent->v.flags & FL_ONGROUND)
+				continue;
+		}
+		else
+			continue;
+
+		for (j=0 ; j<3 ; j++)
+		{
+			if (vel[j] > sv_maxvelocity.value)
+				vel[j] = sv_maxvelocity.value;
+			else if (vel[j] < -sv_maxvelocity.value)
+				vel[j] = -sv_maxvelocity.value;
+		}
+
+		if (ent->v.movetype == MOVETYPE_STEP)
+		{
+			if (!vel[0] && !vel[1] && !vel[2])
+				continue;
+			time_left = host_frametime;
+			for (j=0 ; j<3 ; j++)
+				ends[count][j] = ent->v.origin[j] + time_left * vel[j];
+			types[count] = MOVE_NORMAL;
+		}
+		else
+		{
+			if (ent->v.movetype != MOVETYPE_FLY
+			&& ent->v.movetype != MOVETYPE_FLYMISSILE)
+			{
+				ent_gravity = SV_EntGravity (ent);
+				vel[2] -= ent_gravity * sv_gravity.value * host_frametime;
+			}
+			VectorScale (vel, host_frametime, move);
+			VectorAdd (ent->v.origin, move, ends[count]);
+			if (ent->v.movetype == MOVETYPE_FLYMISSILE)
+				types[count] = MOVE_MISSILE;
+			else if (ent->v.solid == SOLID_TRIGGER || ent->v.solid == SOLID_NOT)
+				types[count] = MOVE_NOMONSTERS;
+			else
+				types[count] = MOVE_NORMAL;
+		}
+		ents[count++] = ent;
+	}
+
+	SV_SpeculateMoves (count, ents, ends, types);
+}
+
 /*
 ================
 SV_Physics
@@ -1517,6 +1627,11 @@ void SV_Physics (void)
 
 //SV_CheckAllEnts ();
 
+#ifndef QUAKE2
+	if (sv_parallelphysics.value)
+		SV_SpeculatePhysics ();
+#endif
+
 //
 // treat each object in turn
 //
@@ -1557,6 +1672,8 @@ void SV_Physics (void)
 			Sys_Error ("SV_Physics: bad movetype %i", (int)ent->v.movetype);			
 	}
 	
+	SV_EndSpeculation ();
+
 	if (pr_global_struct->force_retouch)
 		pr_global_struct->force_retouch--;	
 
@@ -472,6 +472,28 @@ void SV_ReadClientMove (usercmd_t *move)
 #endif
 }
 
+/*
+===================
+SV_ReadAckFrame
+
+Acks can arrive late or out of order, only ever move forward to a frame
+that is still buffered.
+===================
+*/
+void SV_ReadAckFrame (void)
+{
+	int		frame;
+
+	frame = MSG_ReadLong ();
+	if (!(host_client->protocolext & PEXT_DELTAENTITIES))
+		return;
+	if (frame <= host_client->ackframe || frame > host_client->framenum)
+		return;
+	if (host_client->framenum - frame >= UPDATE_BACKUP)
+		return;
+	host_client->ackframe = frame;
+}
+
 /*
 ===================
 SV_ReadClientMessage
@@ -561,6 +583,8 @@ nextmsg:
 					ret = 1;
 				else if (Q_strncasecmp(s, "prespawn", 8) == 0)
 					ret = 1;
+				else if (Q_strncasecmp(s, "protocolext", 11) == 0)
+					ret = 1;
 				else if (Q_strncasecmp(s, "kick", 4) == 0)
 					ret = 1;
 				else if (Q_strncasecmp(s, "ping", 4) == 0)
@@ -584,6 +608,10 @@ nextmsg:
 			case clc_move:
 				SV_ReadClientMove (&host_client->cmd);
 				break;
+
+			case clc_ackframe:
+				SV_ReadAckFrame ();
+				break;
 			}
 		}
 	} while (ret == 1);
@@ -424,6 +424,7 @@ void LoadPCX (char *filename, byte **pic, byte **palette, int *width, int *heigh
 	pcx_t	*pcx;
 	int		x, y;
 	int		len;
+	int		xmax, ymax;
 	int		dataByte, runLength;
 	byte	*out, *pix;
 
@@ -433,7 +434,7 @@ void LoadPCX (char *filename, byte **pic, byte **palette, int *width, int *heigh
 	//
 	// load the file
 	//
-	len = ri.FS_LoadFile (filename, (void **)&raw);
+	len = ri.FS_ViewFile (filename, (void **)&raw);
 	if (!raw)
 	{
 		ri.Con_Printf (PRINT_DEVELOPER, "Bad pcx file %s\n", filename);
@@ -445,14 +446,9 @@ void LoadPCX (char *filename, byte **pic, byte **palette, int *width, int *heigh
 	//
 	pcx = (pcx_t *)raw;
 
-    pcx->xmin = LittleShort(pcx->xmin);
-    pcx->ymin = LittleShort(pcx->ymin);
-    pcx->xmax = LittleShort(pcx->xmax);
-    pcx->ymax = LittleShort(pcx->ymax);
-    pcx->hres = LittleShort(pcx->hres);
-    pcx->vres = LittleShort(pcx->vres);
-    pcx->bytes_per_line = LittleShort(pcx->bytes_per_line);
-    pcx->palette_type = LittleShort(pcx->palette_type);
+	// the file is a read only view, so nothing is swapped in place
+	xmax = LittleShort(pcx->xmax);
+	ymax = LittleShort(pcx->ymax);
 
 	raw = &pcx->data;
 
@@ -460,14 +456,14 @@ void LoadPCX (char *filename, byte **pic, byte **palette, int *width, int *heigh
 		|| pcx->version != 5
 		|| pcx->encoding != 1
 		|| pcx->bits_per_pixel != 8
-		|| pcx->xmax >= 640
-		|| pcx->ymax >= 480)
+		|| xmax >= 640
+		|| ymax >= 480)
 	{
 		ri.Con_Printf (PRINT_ALL, "Bad pcx file %s\n", filename);
 		return;
 	}
 
-	out = malloc ( (pcx->ymax+1) * (pcx->xmax+1) );
+	out = malloc ( (ymax+1) * (xmax+1) );
 
 	*pic = out;
 
@@ -480,13 +476,13 @@ void LoadPCX (char *filename, byte **pic, byte **palette, int *width, int *heigh
 	}
 
 	if (width)
-		*width = pcx->xmax+1;
+		*width = xmax+1;
 	if (height)
-		*height = pcx->ymax+1;
+		*height = ymax+1;
 
-	for (y=0 ; y<=pcx->ymax ; y++, pix += pcx->xmax+1)
+	for (y=0 ; y<=ymax ; y++, pix += xmax+1)
 	{
-		for (x=0 ; x<=pcx->xmax ; )
+		for (x=0 ; x<=xmax ; )
 		{
 			dataByte = *raw++;
 
@@ -1321,7 +1317,7 @@ image_t *GL_LoadWal (char *name)
 	int			width, height, ofs;
 	image_t		*image;
 
-	ri.FS_LoadFile (name, (void **)&mt);
+	ri.FS_ViewFile (name, (void **)&mt);
 	if (!mt)
 	{
 		ri.Con_Printf (PRINT_ALL, "GL_FindImage: can't load %s\n", name);
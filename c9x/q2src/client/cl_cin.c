@@ -96,7 +96,7 @@ void SCR_LoadPCX (char *filename, byte **pic, byte **palette, int *width, int *h
 		return;
 	}
 
-	out = Z_Malloc ( (pcx->ymax+1) * (pcx->xmax+1) );
+	out = Z_TagMalloc ( (pcx->ymax+1) * (pcx->xmax+1), TAG_CINEMATIC);
 
 	*pic = out;
 
@@ -104,7 +104,7 @@ void SCR_LoadPCX (char *filename, byte **pic, byte **palette, int *width, int *h
 
 	if (palette)
 	{
-		*palette = Z_Malloc(768);
+		*palette = Z_TagMalloc(768, TAG_CINEMATIC);
 		memcpy (*palette, (byte *)pcx + len - 768, 768);
 	}
 
@@ -252,7 +252,7 @@ void Huff1TableInit (void)
 	byte	counts[256];
 	int		numhnodes;
 
-	cin.hnodes1 = Z_Malloc (256*256*2*4);
+	cin.hnodes1 = Z_TagMalloc (256*256*2*4, TAG_CINEMATIC);
 	memset (cin.hnodes1, 0, 256*256*2*4);
 
 	for (prev=0 ; prev<256 ; prev++)
@@ -309,7 +309,7 @@ cblock_t Huff1Decompress (cblock_t in)
 	// get decompressed count
 	count = in.data[0] + (in.data[1]<<8) + (in.data[2]<<16) + (in.data[3]<<24);
 	input = in.data + 4;
-	out_p = out.data = Z_Malloc (count);
+	out_p = out.data = Z_TagMalloc (count, TAG_CINEMATIC);
 
 	// read bits
 
@@ -518,7 +518,7 @@ void Key_SetBinding (int keynum, char *binding)
 			
 // allocate memory for new binding
 	l = strlen (binding);	
-	new = Z_Malloc (l+1);
+	new = Z_TagMalloc (l+1, TAG_COMMANDS);
 	strcpy (new, binding);
 	new[l] = 0;
 	keybindings[keynum] = new;	
@@ -204,6 +204,7 @@ typedef struct
 	// a -1 return means the file does not exist
 	// NULL can be passed for buf to just determine existance
 	int		(*FS_LoadFile) (char *name, void **buf);
+	int		(*FS_ViewFile) (char *name, void **buf);	// buf is read only
 	void	(*FS_FreeFile) (void *buf);
 
 	// gamedir will be the current directory that generated
@@ -128,7 +128,7 @@ sfxcache_t *S_LoadSound (sfx_t *s)
 
 //	Com_Printf ("loading %s\n",namebuffer);
 
-	size = FS_LoadFile (namebuffer, (void **)&data);
+	size = FS_ViewFile (namebuffer, (void **)&data);
 
 	if (!data)
 	{
@@ -149,7 +149,7 @@ sfxcache_t *S_LoadSound (sfx_t *s)
 
 	len = len * info.width * info.channels;
 
-	sc = s->cache = Z_Malloc (len + sizeof(sfxcache_t));
+	sc = s->cache = Z_TagMalloc (len + sizeof(sfxcache_t), TAG_SOUND);
 	if (!sc)
 	{
 		FS_FreeFile (data);
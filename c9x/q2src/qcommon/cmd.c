@@ -120,7 +120,7 @@ void Cbuf_InsertText (char *text)
 	templen = cmd_text.cursize;
 	if (templen)
 	{
-		temp = Z_Malloc (templen);
+		temp = Z_TagMalloc (templen, TAG_COMMANDS);
 		memcpy (temp, cmd_text.data, templen);
 		SZ_Clear (&cmd_text);
 	}
@@ -311,7 +311,7 @@ qboolean Cbuf_AddLateCommands (void)
 	if (!s)
 		return false;
 		
-	text = Z_Malloc (s+1);
+	text = Z_TagMalloc (s+1, TAG_COMMANDS);
 	text[0] = 0;
 	for (i=1 ; i<argc ; i++)
 	{
@@ -321,7 +321,7 @@ qboolean Cbuf_AddLateCommands (void)
 	}
 	
 // pull out the commands
-	build = Z_Malloc (s+1);
+	build = Z_TagMalloc (s+1, TAG_COMMANDS);
 	build[0] = 0;
 	
 	for (i=0 ; i<s-1 ; i++)
@@ -388,7 +388,7 @@ void Cmd_Exec_f (void)
 	Com_Printf ("execing %s\n",Cmd_Argv(1));
 	
 	// the file doesn't have a trailing 0, so we need to copy it off
-	f2 = Z_Malloc(len+1);
+	f2 = Z_TagMalloc(len+1, TAG_COMMANDS);
 	memcpy (f2, f, len);
 	f2[len] = 0;
 
@@ -456,7 +456,7 @@ void Cmd_Alias_f (void)
 
 	if (!a)
 	{
-		a = Z_Malloc (sizeof(cmdalias_t));
+		a = Z_TagMalloc (sizeof(cmdalias_t), TAG_COMMANDS);
 		a->next = cmd_alias;
 		cmd_alias = a;
 	}
@@ -674,7 +674,7 @@ void Cmd_TokenizeString (char *text, qboolean macroExpand)
 
 		if (cmd_argc < MAX_STRING_TOKENS)
 		{
-			cmd_argv[cmd_argc] = Z_Malloc (strlen(com_token)+1);
+			cmd_argv[cmd_argc] = Z_TagMalloc (strlen(com_token)+1, TAG_COMMANDS);
 			strcpy (cmd_argv[cmd_argc], com_token);
 			cmd_argc++;
 		}
@@ -709,7 +709,7 @@ void	Cmd_AddCommand (char *cmd_name, xcommand_t function)
 		}
 	}
 
-	cmd = Z_Malloc (sizeof(cmd_function_t));
+	cmd = Z_TagMalloc (sizeof(cmd_function_t), TAG_COMMANDS);
 	cmd->name = cmd_name;
 	cmd->function = function;
 	cmd->next = cmd_functions;
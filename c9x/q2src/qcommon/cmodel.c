@@ -20,6 +20,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 // cmodel.c -- model loading
 
 #include "qcommon.h"
+#include <stdint.h>
 
 typedef struct
 {
@@ -588,7 +589,7 @@ cmodel_t *CM_LoadMap (char *name, qboolean clientload, unsigned *checksum)
 	//
 	// load the file
 	//
-	length = FS_LoadFile (name, (void **)&buf);
+	length = FS_ViewFile (name, (void **)&buf);
 	if (!buf)
 		Com_Error (ERR_DROP, "Couldn't load %s", name);
 
@@ -1569,16 +1570,17 @@ void CM_DecompressVis (byte *in, byte *out)
 	} while (out_p - out < row);
 }
 
-byte	pvsrow[MAX_MAP_LEAFS/8];
-byte	phsrow[MAX_MAP_LEAFS/8];
+// whole 64 bit words, so SV_FatPVS can or them a word at a time
+uint64_t	pvsrow[MAX_MAP_LEAFS/64];
+uint64_t	phsrow[MAX_MAP_LEAFS/64];
 
 byte	*CM_ClusterPVS (int cluster)
 {
 	if (cluster == -1)
 		memset (pvsrow, 0, (numclusters+7)>>3);
 	else
-		CM_DecompressVis (map_visibility + map_vis->bitofs[cluster][DVIS_PVS], pvsrow);
-	return pvsrow;
+		CM_DecompressVis (map_visibility + map_vis->bitofs[cluster][DVIS_PVS], (byte *)pvsrow);
+	return (byte *)pvsrow;
 }
 
 byte	*CM_ClusterPHS (int cluster)
@@ -1586,8 +1588,8 @@ byte	*CM_ClusterPHS (int cluster)
 	if (cluster == -1)
 		memset (phsrow, 0, (numclusters+7)>>3);
 	else
-		CM_DecompressVis (map_visibility + map_vis->bitofs[cluster][DVIS_PHS], phsrow);
-	return phsrow;
+		CM_DecompressVis (map_visibility + map_vis->bitofs[cluster][DVIS_PHS], (byte *)phsrow);
+	return (byte *)phsrow;
 }
 
 
@@ -1081,6 +1081,201 @@ void Info_Print (char *s)
 }
 
 
+/*
+==============================================================================
+
+						MEMORY ACCOUNTING
+
+Zone blocks are counted against their tag, which for the game dll tells
+apart what lives as long as the game from what goes with the level, and
+the renderer's model hunks against "models".  memstats lists the owners,
+memdump writes them to a CSV file.
+
+==============================================================================
+*/
+
+#define	MAX_MEMOWNERS	64
+
+typedef struct
+{
+	char	kind[8];		// zone or hunk
+	char	name[16];
+	int		current, peak;
+	int		allocs, frees;
+} memowner_t;
+
+static memowner_t	mem_owners[MAX_MEMOWNERS];
+
+/*
+========================
+Mem_Owner
+
+Finds or adds an owner.  Once the table is full new names share the last
+entry.
+========================
+*/
+static memowner_t *Mem_Owner (char *kind, char *name)
+{
+	memowner_t	*o;
+	int			i;
+
+	for (i = 0, o = mem_owners ; i < MAX_MEMOWNERS-1 ; i++, o++)
+	{
+		if (!o->kind[0])
+		{
+			strncpy (o->kind, kind, sizeof(o->kind)-1);
+			strncpy (o->name, name, sizeof(o->name)-1);
+			return o;
+		}
+		if (!strcmp (o->kind, kind) && !strcmp (o->name, name))
+			return o;
+	}
+
+	if (!o->kind[0])
+	{
+		strcpy (o->kind, "all");
+		strcpy (o->name, "(others)");
+	}
+	return o;
+}
+
+void Mem_Alloced (char *kind, char *name, int size)
+{
+	memowner_t	*o;
+
+	o = Mem_Owner (kind, name);
+	o->allocs++;
+	o->current += size;
+	if (o->current > o->peak)
+		o->peak = o->current;
+}
+
+void Mem_Freed (char *kind, char *name, int size)
+{
+	memowner_t	*o;
+
+	o = Mem_Owner (kind, name);
+	o->frees++;
+	o->current -= size;
+}
+
+void Mem_Adjust (char *kind, char *name, int delta)
+{
+	memowner_t	*o;
+
+	o = Mem_Owner (kind, name);
+	o->current += delta;
+	if (o->current > o->peak)
+		o->peak = o->current;
+}
+
+/*
+========================
+Mem_TagName
+========================
+*/
+static char *Mem_TagName (int tag)
+{
+	static char	name[16];
+
+	switch (tag)
+	{
+	case TAG_ENGINE:
+		return "engine";
+	case TAG_SOUND:
+		return "sound";
+	case TAG_CINEMATIC:
+		return "cinematic";
+	case TAG_FILES:
+		return "files";
+	case TAG_COMMANDS:
+		return "commands";
+	case TAG_SERVER:
+		return "server";
+	case 765:		// TAG_GAME in the game dll
+		return "game";
+	case 766:		// TAG_LEVEL
+		return "level";
+	}
+	Com_sprintf (name, sizeof(name), "tag %i", tag);
+	return name;
+}
+
+static int Mem_CompareOwners (const void *a, const void *b)
+{
+	return (*(memowner_t **)b)->current - (*(memowner_t **)a)->current;
+}
+
+/*
+========================
+Mem_Stats_f
+
+memstats [kind]
+========================
+*/
+void Mem_Stats_f (void)
+{
+	memowner_t	*sorted[MAX_MEMOWNERS];
+	int			i, n, current, peak;
+	char		*kind;
+
+	kind = Cmd_Argc () > 1 ? Cmd_Argv (1) : NULL;
+
+	for (i = n = 0 ; i < MAX_MEMOWNERS ; i++)
+		if (mem_owners[i].kind[0] && (!kind || !strcmp (mem_owners[i].kind, kind)))
+			sorted[n++] = &mem_owners[i];
+	qsort (sorted, n, sizeof(sorted[0]), Mem_CompareOwners);
+
+	current = peak = 0;
+	Com_Printf ("kind  name              current      peak allocs  frees\n");
+	for (i = 0 ; i < n ; i++)
+	{
+		Com_Printf ("%-5s %-15s %9i %9i %6i %6i\n", sorted[i]->kind, sorted[i]->name,
+			sorted[i]->current, sorted[i]->peak, sorted[i]->allocs, sorted[i]->frees);
+		current += sorted[i]->current;
+		peak += sorted[i]->peak;
+	}
+	Com_Printf ("%i owners, %i bytes, %i at their peaks\n", n, current, peak);
+}
+
+/*
+========================
+Mem_Dump_f
+
+memdump [file]
+Writes every owner to a CSV file in the game directory.
+========================
+*/
+void Mem_Dump_f (void)
+{
+	char		name[MAX_OSPATH];
+	FILE		*f;
+	memowner_t	*o;
+	int			i;
+
+	if (Cmd_Argc () > 1 && strstr (Cmd_Argv (1), ".."))
+	{
+		Com_Printf ("Relative pathnames are not allowed.\n");
+		return;
+	}
+
+	Com_sprintf (name, sizeof(name), "%s/%s", FS_Gamedir (), Cmd_Argc () > 1 ? Cmd_Argv (1) : "memstats.csv");
+	f = fopen (name, "w");
+	if (!f)
+	{
+		Com_Printf ("Couldn't write %s\n", name);
+		return;
+	}
+
+	fprintf (f, "kind,name,current,peak,allocs,frees\n");
+	for (i = 0, o = mem_owners ; i < MAX_MEMOWNERS ; i++, o++)
+		if (o->kind[0])
+			fprintf (f, "%s,\"%s\",%i,%i,%i,%i\n", o->kind, o->name, o->current, o->peak, o->allocs, o->frees);
+
+	fclose (f);
+	Com_Printf ("Wrote %s\n", name);
+}
+
 /*
 ==============================================================================
 
@@ -1124,6 +1319,7 @@ void Z_Free (void *ptr)
 
 	z_count--;
 	z_bytes -= z->size;
+	Mem_Freed ("zone", Mem_TagName (z->tag), z->size);
 	free (z);
 }
 
@@ -1174,6 +1370,7 @@ void *Z_TagMalloc (int size, int tag)
 	z->magic = Z_MAGIC;
 	z->tag = tag;
 	z->size = size;
+	Mem_Alloced ("zone", Mem_TagName (tag), size);
 
 	z->next = z_chain.next;
 	z->prev = &z_chain;
@@ -1190,7 +1387,7 @@ Z_Malloc
 */
 void *Z_Malloc (int size)
 {
-	return Z_TagMalloc (size, 0);
+	return Z_TagMalloc (size, TAG_ENGINE);
 }
 
 
@@ -1435,6 +1632,9 @@ void Qcommon_Init (int argc, char **argv)
 	// init commands and vars
 	//
     Cmd_AddCommand ("z_stats", Z_Stats_f);
+    Cmd_AddCommand ("hunkstats", Hunk_Stats_f);
+    Cmd_AddCommand ("memstats", Mem_Stats_f);
+    Cmd_AddCommand ("memdump", Mem_Dump_f);
     Cmd_AddCommand ("error", Com_Error_f);
 
 	host_speeds = Cvar_Get ("host_speeds", "0", 0);
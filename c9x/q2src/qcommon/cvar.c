@@ -156,7 +156,7 @@ cvar_t *Cvar_Get (char *var_name, char *var_value, int flags)
 		}
 	}
 
-	var = Z_Malloc (sizeof(*var));
+	var = Z_TagMalloc (sizeof(*var), TAG_COMMANDS);
 	var->name = CopyString (var_name);
 	var->string = CopyString (var_value);
 	var->modified = true;
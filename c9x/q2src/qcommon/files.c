@@ -44,10 +44,13 @@ QUAKE FILESYSTEM
 // in memory
 //
 
-typedef struct
+typedef struct packfile_s
 {
 	char	name[MAX_QPATH];
 	int		filepos, filelen;
+	int		complen;	// 0 unless the file is block compressed
+	struct packfile_s	*hashnext;	// in fs_packhash
+	struct pack_s	*pack;
 } packfile_t;
 
 typedef struct pack_s
@@ -56,12 +59,16 @@ typedef struct pack_s
 	FILE	*handle;
 	int		numfiles;
 	packfile_t	*files;
+	qboolean	compressed;	// a PAKZ pak
+	byte	*mapped;	// the whole pak, read only, for FS_ViewFile
+	int		maplen;
 } pack_t;
 
 char	fs_gamedir[MAX_OSPATH];
 cvar_t	*fs_basedir;
 cvar_t	*fs_cddir;
 cvar_t	*fs_gamedirvar;
+cvar_t	*fs_mmap;
 
 typedef struct filelink_s
 {
@@ -83,6 +90,46 @@ typedef struct searchpath_s
 searchpath_t	*fs_searchpaths;
 searchpath_t	*fs_base_searchpaths;	// without gamedirs
 
+/*
+Every pak directory goes into one hash as the pak is loaded, at the head of
+its chains, so the first match is in the pak nearest the front of the
+search path.  Files found in a pak are read through the pak's own handle
+with Sys_ReadAt instead of opening the pak again for each one.
+*/
+#define	FS_HASHSIZE		4096
+
+packfile_t	*fs_packhash[FS_HASHSIZE];
+
+// where FS_FindFile found a file
+typedef struct
+{
+	pack_t	*pack;		// NULL for a file in a directory
+	FILE	*file;		// the opened file when not in a pak
+	int		offset;
+	int		length;
+	int		complen;	// 0 unless the file is block compressed
+} fsfile_t;
+
+static struct
+{
+	int		lookups;
+	int		pakhits, dirhits, misses;
+	int		loads;
+	double	bytes;			// copied out of files
+	int		views;
+	double	viewbytes;		// handed out in place from mapped paks
+	int		unpacks;
+	double	packedbytes;	// compressed bytes unpacked
+} fs_stats;
+
+// the files loaded since the last "fs_bench clear", for fs_bench to replay
+#define	MAX_BENCH_FILES	4096
+
+static char		(*fs_benchfiles)[MAX_QPATH];
+static qboolean	*fs_benchviews;
+static int		fs_numbenchfiles;
+static qboolean	fs_benching;
+
 
 /*
 
@@ -115,6 +162,70 @@ int FS_filelength (FILE *f)
 }
 
 
+/*
+================
+FS_HashName
+================
+*/
+static int FS_HashName (char *name)
+{
+	unsigned	hash;
+	int			c;
+
+	hash = 0;
+	while (*name)
+	{
+		c = *name++;
+		if (c >= 'A' && c <= 'Z')
+			c += 'a' - 'A';
+		hash = hash * 31 + c;
+	}
+	return (hash ^ (hash >> 16)) & (FS_HASHSIZE-1);
+}
+
+/*
+================
+FS_HashPack
+
+Puts the files of a newly loaded pak ahead of everything already hashed
+================
+*/
+static void FS_HashPack (pack_t *pack)
+{
+	packfile_t	*pf;
+	int			i, h;
+
+	for (i=0, pf=pack->files ; i<pack->numfiles ; i++, pf++)
+	{
+		pf->pack = pack;
+		h = FS_HashName (pf->name);
+		pf->hashnext = fs_packhash[h];
+		fs_packhash[h] = pf;
+	}
+}
+
+/*
+================
+FS_UnhashPack
+================
+*/
+static void FS_UnhashPack (pack_t *pack)
+{
+	packfile_t	*pf, **prev;
+	int			i;
+
+	for (i=0 ; i<pack->numfiles ; i++)
+	{
+		for (prev = &fs_packhash[FS_HashName (pack->files[i].name)] ; (pf = *prev) ; prev = &pf->hashnext)
+			if (pf == &pack->files[i])
+			{
+				*prev = pf->hashnext;
+				break;
+			}
+	}
+}
+
+
 /*
 ============
 FS_CreatePath
@@ -193,25 +304,28 @@ int	Developer_searchpath (int who)
 
 /*
 ===========
-FS_FOpenFile
+FS_FindFile
 
 Finds the file in the search path.
-returns filesize and an open FILE *
-Used for streaming data out of either a pak file or
-a seperate file.
+Returns the filesize, with f telling where it is: a pak and an offset, or a
+file opened in a directory tree.
 ===========
 */
 int file_from_pak = 0;
 #ifndef NO_ADDONS
-int FS_FOpenFile (char *filename, FILE **file)
+static int FS_FindFile (char *filename, fsfile_t *f)
 {
 	searchpath_t	*search;
 	char			netpath[MAX_OSPATH];
-	pack_t			*pak;
-	int				i;
+	packfile_t		*pf;
 	filelink_t		*link;
 
 	file_from_pak = 0;
+	f->pack = NULL;
+	f->file = NULL;
+	f->offset = 0;
+	f->complen = 0;
+	fs_stats.lookups++;
 
 	// check for links first
 	for (link = fs_links ; link ; link=link->next)
@@ -219,38 +333,43 @@ int FS_FOpenFile (char *filename, FILE **file)
 		if (!strncmp (filename, link->from, link->fromlength))
 		{
 			Com_sprintf (netpath, sizeof(netpath), "%s%s",link->to, filename+link->fromlength);
-			*file = fopen (netpath, "rb");
-			if (*file)
+			f->file = fopen (netpath, "rb");
+			if (f->file)
 			{		
 				Com_DPrintf ("link file: %s\n",netpath);
-				return FS_filelength (*file);
+				fs_stats.dirhits++;
+				f->length = FS_filelength (f->file);
+				return f->length;
 			}
+			fs_stats.misses++;
 			return -1;
 		}
 	}
 
+	// the pak with the highest priority copy, if any
+	for (pf = fs_packhash[FS_HashName (filename)] ; pf ; pf = pf->hashnext)
+		if (!Q_strcasecmp (pf->name, filename))
+			break;
+
 //
-// search through the path, one element at a time
+// search through the path, one element at a time, as a directory ahead
+// of that pak still overrides it
 //
 	for (search = fs_searchpaths ; search ; search = search->next)
 	{
 	// is the element a pak file?
 		if (search->pack)
 		{
-		// look through all the pak file elements
-			pak = search->pack;
-			for (i=0 ; i<pak->numfiles ; i++)
-				if (!Q_strcasecmp (pak->files[i].name, filename))
-				{	// found it!
-					file_from_pak = 1;
-					Com_DPrintf ("PackFile: %s : %s\n",pak->filename, filename);
-				// open a new file on the pakfile
-					*file = fopen (pak->filename, "rb");
-					if (!*file)
-						Com_Error (ERR_FATAL, "Couldn't reopen %s", pak->filename);	
-					fseek (*file, pak->files[i].filepos, SEEK_SET);
-					return pak->files[i].filelen;
-				}
+			if (!pf || pf->pack != search->pack)
+				continue;
+			file_from_pak = 1;
+			Com_DPrintf ("PackFile: %s : %s\n",pf->pack->filename, filename);
+			f->pack = pf->pack;
+			f->offset = pf->filepos;
+			f->length = pf->filelen;
+			f->complen = pf->complen;
+			fs_stats.pakhits++;
+			return f->length;
 		}
 		else
 		{		
@@ -258,20 +377,22 @@ int FS_FOpenFile (char *filename, FILE **file)
 			
 			Com_sprintf (netpath, sizeof(netpath), "%s/%s",search->filename, filename);
 			
-			*file = fopen (netpath, "rb");
-			if (!*file)
+			f->file = fopen (netpath, "rb");
+			if (!f->file)
 				continue;
 			
 			Com_DPrintf ("FindFile: %s\n",netpath);
 
-			return FS_filelength (*file);
+			fs_stats.dirhits++;
+			f->length = FS_filelength (f->file);
+			return f->length;
 		}
 		
 	}
 	
 	Com_DPrintf ("FindFile: can't find %s\n", filename);
 	
-	*file = NULL;
+	fs_stats.misses++;
 	return -1;
 }
 
@@ -279,7 +400,7 @@ int FS_FOpenFile (char *filename, FILE **file)
 
 // this is just for demos to prevent add on hacking
 
-int FS_FOpenFile (char *filename, FILE **file)
+static int FS_FindFile (char *filename, fsfile_t *f)
 {
 	searchpath_t	*search;
 	char			netpath[MAX_OSPATH];
@@ -287,29 +408,31 @@ int FS_FOpenFile (char *filename, FILE **file)
 	int				i;
 
 	file_from_pak = 0;
+	f->pack = NULL;
+	f->file = NULL;
+	f->offset = 0;
+	f->complen = 0;
 
 	// get config from directory, everything else from pak
 	if (!strcmp(filename, "config.cfg") || !strncmp(filename, "players/", 8))
 	{
 		Com_sprintf (netpath, sizeof(netpath), "%s/%s",FS_Gamedir(), filename);
 		
-		*file = fopen (netpath, "rb");
-		if (!*file)
+		f->file = fopen (netpath, "rb");
+		if (!f->file)
 			return -1;
 		
 		Com_DPrintf ("FindFile: %s\n",netpath);
 
-		return FS_filelength (*file);
+		f->length = FS_filelength (f->file);
+		return f->length;
 	}
 
 	for (search = fs_searchpaths ; search ; search = search->next)
 		if (search->pack)
 			break;
 	if (!search)
-	{
-		*file = NULL;
 		return -1;
-	}
 
 	pak = search->pack;
 	for (i=0 ; i<pak->numfiles ; i++)
@@ -317,23 +440,341 @@ int FS_FOpenFile (char *filename, FILE **file)
 		{	// found it!
 			file_from_pak = 1;
 			Com_DPrintf ("PackFile: %s : %s\n",pak->filename, filename);
-		// open a new file on the pakfile
-			*file = fopen (pak->filename, "rb");
-			if (!*file)
-				Com_Error (ERR_FATAL, "Couldn't reopen %s", pak->filename);	
-			fseek (*file, pak->files[i].filepos, SEEK_SET);
-			return pak->files[i].filelen;
+			f->pack = pak;
+			f->offset = pak->files[i].filepos;
+			f->length = pak->files[i].filelen;
+			f->complen = pak->files[i].complen;
+			return f->length;
 		}
 	
 	Com_DPrintf ("FindFile: can't find %s\n", filename);
 	
-	*file = NULL;
 	return -1;
 }
 
 #endif
 
 
+/*
+=============================================================================
+
+COMPRESSED PAKS
+
+The blocks of a file in a PAKZ pak are unpacked on the worker threads once
+there are enough of them to be worth waking the workers for, which is
+anything of a quarter meg or more: maps, cinematics, big skies and the like.
+Streams from FS_FOpenFile unpack a window of blocks at a time the same way.
+
+=============================================================================
+*/
+
+#define	FS_JOBBLOCKS	4		// fewer than this are unpacked on the main thread
+#define	FS_STREAMBLOCKS	8		// unpacked at a time for a stream
+
+// what FS_UnpackBlock works from
+static struct
+{
+	int		*blockofs;		// the file's block table
+	byte	*src;			// the compressed data of block first
+	byte	*dest;			// where block first goes
+	int		first;
+	int		filelen;
+	qboolean	failed;
+} fs_unpack;
+
+static void FS_UnpackBlock (int index, int thread)
+{
+	int		block, rawlen, len;
+	byte	*in, *out;
+
+	block = fs_unpack.first + index;
+	rawlen = fs_unpack.filelen - block*PAKZ_BLOCKSIZE;
+	if (rawlen > PAKZ_BLOCKSIZE)
+		rawlen = PAKZ_BLOCKSIZE;
+	len = fs_unpack.blockofs[block+1] - fs_unpack.blockofs[block];
+	in = fs_unpack.src + fs_unpack.blockofs[block] - fs_unpack.blockofs[fs_unpack.first];
+	out = fs_unpack.dest + index*PAKZ_BLOCKSIZE;
+
+	if (len == rawlen)
+		memcpy (out, in, len);
+	else if (LZ_Decompress (in, len, out, rawlen) != rawlen)
+		fs_unpack.failed = true;
+}
+
+/*
+================
+FS_UnpackBlocks
+
+Unpacks count blocks from first on, returning false if any were damaged
+================
+*/
+static qboolean FS_UnpackBlocks (int *blockofs, byte *src, int first, int count, int filelen, byte *dest)
+{
+	int		i;
+
+	fs_unpack.blockofs = blockofs;
+	fs_unpack.src = src;
+	fs_unpack.dest = dest;
+	fs_unpack.first = first;
+	fs_unpack.filelen = filelen;
+	fs_unpack.failed = false;
+
+	if (count >= FS_JOBBLOCKS)
+		Sys_RunJobs (count, FS_UnpackBlock);
+	else
+		for (i=0 ; i<count ; i++)
+			FS_UnpackBlock (i, 0);
+
+	return !fs_unpack.failed;
+}
+
+/*
+================
+FS_LoadBlockTable
+
+Reads the block table of a compressed file and checks that every block
+lies inside the file and is no longer than it unpacks to
+================
+*/
+static int *FS_LoadBlockTable (fsfile_t *f, char *name, int *numblocks)
+{
+	int		*blockofs;
+	int		i, n, len, rawlen;
+
+	n = (f->length + PAKZ_BLOCKSIZE - 1) / PAKZ_BLOCKSIZE;
+	len = (n+1) * sizeof(int);
+	blockofs = Z_TagMalloc (len, TAG_FILES);
+	if (len > f->complen || Sys_ReadAt (f->pack->handle, f->offset, blockofs, len) != len)
+		Com_Error (ERR_FATAL, "%s has a damaged block table in %s", name, f->pack->filename);
+
+	for (i=0 ; i<=n ; i++)
+		blockofs[i] = LittleLong (blockofs[i]);
+	if (blockofs[0] != len || blockofs[n] > f->complen)
+		Com_Error (ERR_FATAL, "%s has a damaged block table in %s", name, f->pack->filename);
+	for (i=0 ; i<n ; i++)
+	{
+		rawlen = f->length - i*PAKZ_BLOCKSIZE;
+		if (rawlen > PAKZ_BLOCKSIZE)
+			rawlen = PAKZ_BLOCKSIZE;
+		len = blockofs[i+1] - blockofs[i];
+		if (len <= 0 || len > rawlen)
+			Com_Error (ERR_FATAL, "%s has a damaged block table in %s", name, f->pack->filename);
+	}
+
+	*numblocks = n;
+	return blockofs;
+}
+
+/*
+================
+FS_UnpackFile
+
+Unpacks all of a compressed file into dest, straight out of the mapping
+when the pak is mapped
+================
+*/
+static void FS_UnpackFile (fsfile_t *f, char *name, byte *dest)
+{
+	int		*blockofs;
+	int		numblocks, len;
+	byte	*src, *temp;
+	qboolean	ok;
+
+	blockofs = FS_LoadBlockTable (f, name, &numblocks);
+	len = blockofs[numblocks] - blockofs[0];
+
+	temp = NULL;
+	if (f->pack->mapped && f->offset >= 0 && f->offset + f->complen <= f->pack->maplen)
+		src = f->pack->mapped + f->offset + blockofs[0];
+	else
+	{
+		src = temp = Z_TagMalloc (len + 1, TAG_FILES);
+		if (Sys_ReadAt (f->pack->handle, f->offset + blockofs[0], temp, len) != len)
+			Com_Error (ERR_FATAL, "FS_LoadFile: couldn't read %s from %s", name, f->pack->filename);
+	}
+
+	ok = FS_UnpackBlocks (blockofs, src, 0, numblocks, f->length, dest);
+
+	if (temp)
+		Z_Free (temp);
+	Z_Free (blockofs);
+	if (!ok)
+		Com_Error (ERR_FATAL, "%s is damaged in %s", name, f->pack->filename);
+
+	fs_stats.unpacks++;
+	fs_stats.packedbytes += f->complen;
+}
+
+// a compressed file opened with FS_FOpenFile
+typedef struct
+{
+	char	name[MAX_QPATH];
+	FILE	*handle;		// its own, so a gamedir change can't pull the pak away
+	int		offset;
+	int		length;
+	int		*blockofs;
+	int		numblocks;
+	int		pos;
+	int		first, count;	// the blocks in window
+	byte	*window;
+	byte	*packed;		// window's blocks as they are in the pak
+} fsstream_t;
+
+/*
+================
+FS_StreamFill
+
+Unpacks the window of blocks starting with block
+================
+*/
+static qboolean FS_StreamFill (fsstream_t *s, int block)
+{
+	int		count, len;
+
+	count = s->numblocks - block;
+	if (count > FS_STREAMBLOCKS)
+		count = FS_STREAMBLOCKS;
+	len = s->blockofs[block+count] - s->blockofs[block];
+
+	s->first = block;
+	s->count = 0;
+	if (Sys_ReadAt (s->handle, s->offset + s->blockofs[block], s->packed, len) != len
+		|| !FS_UnpackBlocks (s->blockofs, s->packed, block, count, s->length, s->window))
+	{
+		Com_Printf ("FS_Read: %s is damaged\n", s->name);
+		return false;
+	}
+	s->count = count;
+
+	fs_stats.packedbytes += len;
+	return true;
+}
+
+static int FS_StreamRead (void *stream, char *buf, int len)
+{
+	fsstream_t	*s;
+	int			block, end, count, total;
+
+	s = (fsstream_t *)stream;
+	for (total = 0 ; total < len && s->pos < s->length ; total += count)
+	{
+		block = s->pos / PAKZ_BLOCKSIZE;
+		if (block < s->first || block >= s->first + s->count)
+			if (!FS_StreamFill (s, block))
+				return -1;
+
+		end = (s->first + s->count) * PAKZ_BLOCKSIZE;
+		if (end > s->length)
+			end = s->length;
+		count = end - s->pos;
+		if (count > len - total)
+			count = len - total;
+		memcpy (buf + total, s->window + s->pos - s->first*PAKZ_BLOCKSIZE, count);
+		s->pos += count;
+	}
+
+	return total;
+}
+
+static int FS_StreamSeek (void *stream, int offset, int whence)
+{
+	fsstream_t	*s;
+	int			pos;
+
+	s = (fsstream_t *)stream;
+	if (whence == SEEK_CUR)
+		pos = s->pos + offset;
+	else if (whence == SEEK_END)
+		pos = s->length + offset;
+	else
+		pos = offset;
+	if (pos < 0)
+		return -1;
+
+	s->pos = pos;
+	return pos;
+}
+
+static void FS_StreamClose (void *stream)
+{
+	fsstream_t	*s;
+
+	s = (fsstream_t *)stream;
+	fclose (s->handle);
+	Z_Free (s->blockofs);
+	Z_Free (s->window);
+	Z_Free (s->packed);
+	Z_Free (s);
+}
+
+/*
+================
+FS_OpenStream
+
+A FILE that unpacks a compressed file as it is read
+================
+*/
+static FILE *FS_OpenStream (fsfile_t *f, char *name)
+{
+	fsstream_t	*s;
+	FILE		*file;
+
+	s = Z_TagMalloc (sizeof(*s), TAG_FILES);
+	strncpy (s->name, name, sizeof(s->name)-1);
+	s->offset = f->offset;
+	s->length = f->length;
+	s->blockofs = FS_LoadBlockTable (f, name, &s->numblocks);
+	s->window = Z_TagMalloc (FS_STREAMBLOCKS * PAKZ_BLOCKSIZE, TAG_FILES);
+	s->packed = Z_TagMalloc (FS_STREAMBLOCKS * PAKZ_BLOCKSIZE, TAG_FILES);
+	s->handle = fopen (f->pack->filename, "rb");
+	if (!s->handle)
+		Com_Error (ERR_FATAL, "Couldn't reopen %s", f->pack->filename);
+
+	file = Sys_OpenStream (s, FS_StreamRead, FS_StreamSeek, FS_StreamClose);
+	if (!file)
+		Com_Error (ERR_FATAL, "Couldn't open a stream for %s", name);
+
+	fs_stats.unpacks++;
+	return file;
+}
+
+
+/*
+===========
+FS_FOpenFile
+
+Finds the file in the search path.
+returns filesize and an open FILE *
+Used for streaming data out of either a pak file or
+a seperate file.
+===========
+*/
+int FS_FOpenFile (char *filename, FILE **file)
+{
+	fsfile_t	f;
+
+	if (FS_FindFile (filename, &f) == -1)
+	{
+		*file = NULL;
+		return -1;
+	}
+
+	if (f.pack && f.complen)
+		*file = FS_OpenStream (&f, filename);
+	else if (f.pack)
+	{	// a stream needs a file position of its own
+		*file = fopen (f.pack->filename, "rb");
+		if (!*file)
+			Com_Error (ERR_FATAL, "Couldn't reopen %s", f.pack->filename);	
+		fseek (*file, f.offset, SEEK_SET);
+	}
+	else
+		*file = f.file;
+
+	return f.length;
+}
+
+
 /*
 =================
 FS_ReadFile
@@ -385,23 +826,23 @@ void FS_Read (void *buffer, int len, FILE *f)
 
 /*
 ============
-FS_LoadFile
+FS_GetFile
 
-Filename are reletive to the quake search path
-a null buffer will just return the file length without loading
+Loads the file, or with view set, hands back the file where it is when it
+is in a mapped pak
 ============
 */
-int FS_LoadFile (char *path, void **buffer)
+static int FS_GetFile (char *path, void **buffer, qboolean view)
 {
-	FILE	*h;
+	fsfile_t	f;
 	byte	*buf;
 	int		len;
 
 	buf = NULL;	// quiet compiler warning
 
 // look for it in the filesystem or pack files
-	len = FS_FOpenFile (path, &h);
-	if (!h)
+	len = FS_FindFile (path, &f);
+	if (len == -1)
 	{
 		if (buffer)
 			*buffer = NULL;
@@ -410,20 +851,81 @@ int FS_LoadFile (char *path, void **buffer)
 	
 	if (!buffer)
 	{
-		fclose (h);
+		if (f.file)
+			fclose (f.file);
+		return len;
+	}
+
+	if (!fs_benching && fs_numbenchfiles < MAX_BENCH_FILES)
+	{
+		if (!fs_benchfiles)
+		{
+			fs_benchfiles = Z_TagMalloc (MAX_BENCH_FILES * sizeof(*fs_benchfiles), TAG_FILES);
+			fs_benchviews = Z_TagMalloc (MAX_BENCH_FILES * sizeof(*fs_benchviews), TAG_FILES);
+		}
+		strncpy (fs_benchfiles[fs_numbenchfiles], path, MAX_QPATH-1);
+		fs_benchviews[fs_numbenchfiles] = view;
+		fs_numbenchfiles++;
+	}
+
+	if (view && f.pack && !f.complen && f.pack->mapped && len > 0 && f.offset >= 0 && f.offset + len <= f.pack->maplen)
+	{
+		*buffer = f.pack->mapped + f.offset;
+		fs_stats.views++;
+		fs_stats.viewbytes += len;
 		return len;
 	}
 
-	buf = Z_Malloc(len);
+	buf = Z_TagMalloc(len, TAG_FILES);
 	*buffer = buf;
 
-	FS_Read (buf, len, h);
+	if (f.pack && f.complen)
+		FS_UnpackFile (&f, path, buf);
+	else if (f.pack)
+	{	// straight from the pak's handle into the buffer
+		if (Sys_ReadAt (f.pack->handle, f.offset, buf, len) != len)
+			Com_Error (ERR_FATAL, "FS_LoadFile: couldn't read %s from %s", path, f.pack->filename);
+	}
+	else
+	{
+		FS_Read (buf, len, f.file);
+		fclose (f.file);
+	}
 
-	fclose (h);
+	fs_stats.loads++;
+	fs_stats.bytes += len;
 
 	return len;
 }
 
+/*
+============
+FS_LoadFile
+
+Filename are reletive to the quake search path
+a null buffer will just return the file length without loading
+============
+*/
+int FS_LoadFile (char *path, void **buffer)
+{
+	return FS_GetFile (path, buffer, false);
+}
+
+/*
+============
+FS_ViewFile
+
+Like FS_LoadFile, but a file in a mapped pak comes back as a pointer into
+the mapping instead of a copy, unless it is compressed.  The buffer is read only and only good until
+the next FS_SetGamedir, so it is for loaders that parse their file and let
+it go.  It is still released with FS_FreeFile.
+============
+*/
+int FS_ViewFile (char *path, void **buffer)
+{
+	return FS_GetFile (path, buffer, true);
+}
+
 
 /*
 =============
@@ -432,6 +934,14 @@ FS_FreeFile
 */
 void FS_FreeFile (void *buffer)
 {
+	searchpath_t	*s;
+
+	// views belong to their pak
+	for (s = fs_searchpaths ; s ; s = s->next)
+		if (s->pack && s->pack->mapped && (byte *)buffer >= s->pack->mapped
+			&& (byte *)buffer < s->pack->mapped + s->pack->maplen)
+			return;
+
 	Z_Free (buffer);
 }
 
@@ -442,7 +952,8 @@ FS_LoadPackFile
 Takes an explicit (not game tree related) path to a pak file.
 
 Loads the header and directory, adding the files at the beginning
-of the list so they override previous pack files.
+of the list so they override previous pack files.  The pak can be a
+stored one or a compressed PAKZ one.
 =================
 */
 pack_t *FS_LoadPackFile (char *packfile)
@@ -453,7 +964,10 @@ pack_t *FS_LoadPackFile (char *packfile)
 	int				numpackfiles;
 	pack_t			*pack;
 	FILE			*packhandle;
-	dpackfile_t		info[MAX_FILES_IN_PACK];
+	dpakzfile_t		dir[MAX_FILES_IN_PACK];		// room for either kind
+	dpackfile_t		*info;
+	dpakzfile_t		*zinfo;
+	qboolean		compressed;
 	unsigned		checksum;
 
 	packhandle = fopen(packfile, "rb");
@@ -461,43 +975,68 @@ pack_t *FS_LoadPackFile (char *packfile)
 		return NULL;
 
 	fread (&header, 1, sizeof(header), packhandle);
-	if (LittleLong(header.ident) != IDPAKHEADER)
+	compressed = LittleLong(header.ident) == IDPAKZHEADER;
+	if (!compressed && LittleLong(header.ident) != IDPAKHEADER)
 		Com_Error (ERR_FATAL, "%s is not a packfile", packfile);
 	header.dirofs = LittleLong (header.dirofs);
 	header.dirlen = LittleLong (header.dirlen);
 
-	numpackfiles = header.dirlen / sizeof(dpackfile_t);
+	if (compressed)
+		numpackfiles = header.dirlen / sizeof(dpakzfile_t);
+	else
+		numpackfiles = header.dirlen / sizeof(dpackfile_t);
 
-	if (numpackfiles > MAX_FILES_IN_PACK)
+	if (numpackfiles > MAX_FILES_IN_PACK || header.dirlen > sizeof(dir) || header.dirlen < 0)
 		Com_Error (ERR_FATAL, "%s has %i files", packfile, numpackfiles);
 
-	newfiles = Z_Malloc (numpackfiles * sizeof(packfile_t));
+	newfiles = Z_TagMalloc (numpackfiles * sizeof(packfile_t), TAG_FILES);
 
 	fseek (packhandle, header.dirofs, SEEK_SET);
-	fread (info, 1, header.dirlen, packhandle);
+	fread (dir, 1, header.dirlen, packhandle);
 
 // crc the directory to check for modifications
-	checksum = Com_BlockChecksum ((void *)info, header.dirlen);
+	checksum = Com_BlockChecksum ((void *)dir, header.dirlen);
 
 #ifdef NO_ADDONS
 	if (checksum != PAK0_CHECKSUM)
 		return NULL;
 #endif
 // parse the directory
+	info = (dpackfile_t *)dir;
+	zinfo = dir;
 	for (i=0 ; i<numpackfiles ; i++)
 	{
-		strcpy (newfiles[i].name, info[i].name);
-		newfiles[i].filepos = LittleLong(info[i].filepos);
-		newfiles[i].filelen = LittleLong(info[i].filelen);
+		if (compressed)
+		{
+			strcpy (newfiles[i].name, zinfo[i].name);
+			newfiles[i].filepos = LittleLong(zinfo[i].filepos);
+			newfiles[i].filelen = LittleLong(zinfo[i].filelen);
+			newfiles[i].complen = LittleLong(zinfo[i].complen);
+			if (newfiles[i].filelen < 0 || newfiles[i].complen < 0)
+				Com_Error (ERR_FATAL, "%s has a damaged directory", packfile);
+		}
+		else
+		{
+			strcpy (newfiles[i].name, info[i].name);
+			newfiles[i].filepos = LittleLong(info[i].filepos);
+			newfiles[i].filelen = LittleLong(info[i].filelen);
+		}
 	}
 
-	pack = Z_Malloc (sizeof (pack_t));
+	pack = Z_TagMalloc (sizeof (pack_t), TAG_FILES);
 	strcpy (pack->filename, packfile);
 	pack->handle = packhandle;
 	pack->numfiles = numpackfiles;
 	pack->files = newfiles;
+	pack->compressed = compressed;
+	FS_HashPack (pack);
+	if (fs_mmap->value)
+	{
+		pack->maplen = FS_filelength (packhandle);
+		pack->mapped = Sys_MapFile (packhandle, pack->maplen);
+	}
 	
-	Com_Printf ("Added packfile %s (%i files)\n", packfile, numpackfiles);
+	Com_Printf ("Added %spackfile %s (%i files)\n", compressed ? "compressed " : "", packfile, numpackfiles);
 	return pack;
 }
 
@@ -522,7 +1061,7 @@ void FS_AddGameDirectory (char *dir)
 	//
 	// add the directory to the search path
 	//
-	search = Z_Malloc (sizeof(searchpath_t));
+	search = Z_TagMalloc (sizeof(searchpath_t), TAG_FILES);
 	strcpy (search->filename, dir);
 	search->next = fs_searchpaths;
 	fs_searchpaths = search;
@@ -536,7 +1075,7 @@ void FS_AddGameDirectory (char *dir)
 		pak = FS_LoadPackFile (pakfile);
 		if (!pak)
 			continue;
-		search = Z_Malloc (sizeof(searchpath_t));
+		search = Z_TagMalloc (sizeof(searchpath_t), TAG_FILES);
 		search->pack = pak;
 		search->next = fs_searchpaths;
 		fs_searchpaths = search;		
@@ -603,6 +1142,9 @@ void FS_SetGamedir (char *dir)
 	{
 		if (fs_searchpaths->pack)
 		{
+			FS_UnhashPack (fs_searchpaths->pack);
+			if (fs_searchpaths->pack->mapped)
+				Sys_UnmapFile (fs_searchpaths->pack->mapped, fs_searchpaths->pack->maplen);
 			fclose (fs_searchpaths->pack->handle);
 			Z_Free (fs_searchpaths->pack->files);
 			Z_Free (fs_searchpaths->pack);
@@ -673,7 +1215,7 @@ void FS_Link_f (void)
 	}
 
 	// create a new link
-	l = Z_Malloc(sizeof(*l));
+	l = Z_TagMalloc(sizeof(*l), TAG_FILES);
 	l->next = fs_links;
 	fs_links = l;
 	l->from = CopyString(Cmd_Argv(1));
@@ -794,7 +1336,8 @@ void FS_Path_f (void)
 		if (s == fs_base_searchpaths)
 			Com_Printf ("----------\n");
 		if (s->pack)
-			Com_Printf ("%s (%i files)\n", s->pack->filename, s->pack->numfiles);
+			Com_Printf ("%s (%i files%s)\n", s->pack->filename, s->pack->numfiles,
+				s->pack->compressed ? ", compressed" : "");
 		else
 			Com_Printf ("%s\n", s->filename);
 	}
@@ -804,6 +1347,75 @@ void FS_Path_f (void)
 		Com_Printf ("%s : %s\n", l->from, l->to);
 }
 
+/*
+============
+FS_Bench_f
+
+fs_bench clear
+fs_bench [passes]
+
+Loads everything loaded since the last clear again, so clearing before a
+map change times that map's loading on its own
+============
+*/
+void FS_Bench_f (void)
+{
+	int		i, pass, passes;
+	int		start, time, best, total;
+	int		len, bytes;
+	void	*buf;
+
+	if (Cmd_Argc() > 1 && !strcmp (Cmd_Argv(1), "clear"))
+	{
+		fs_numbenchfiles = 0;
+		memset (&fs_stats, 0, sizeof(fs_stats));
+		return;
+	}
+
+	Com_Printf ("%i lookups: %i in paks, %i in directories, %i missed\n",
+		fs_stats.lookups, fs_stats.pakhits, fs_stats.dirhits, fs_stats.misses);
+	Com_Printf ("%i loads copied %i KB, %i views of %i KB\n", fs_stats.loads, (int)(fs_stats.bytes / 1024),
+		fs_stats.views, (int)(fs_stats.viewbytes / 1024));
+	if (fs_stats.unpacks)
+		Com_Printf ("%i unpacked from %i KB\n", fs_stats.unpacks, (int)(fs_stats.packedbytes / 1024));
+
+	if (!fs_numbenchfiles)
+	{
+		Com_Printf ("nothing loaded since fs_bench clear\n");
+		return;
+	}
+
+	passes = Cmd_Argc() > 1 ? atoi (Cmd_Argv(1)) : 1;
+	if (passes < 1)
+		passes = 1;
+
+	fs_benching = true;
+	best = 0x7fffffff;
+	total = bytes = 0;
+	for (pass = 0 ; pass < passes ; pass++)
+	{
+		bytes = 0;
+		start = Sys_Milliseconds ();
+		for (i=0 ; i<fs_numbenchfiles ; i++)
+		{
+			len = FS_GetFile (fs_benchfiles[i], &buf, fs_benchviews[i]);
+			if (!buf)
+				continue;
+			bytes += len;
+			FS_FreeFile (buf);
+		}
+		time = Sys_Milliseconds () - start;
+		total += time;
+		if (time < best)
+			best = time;
+	}
+	fs_benching = false;
+
+	Com_Printf ("%i files of %i KB: %.1f ms a pass, best %i ms, %.1f MB/s\n",
+		fs_numbenchfiles, bytes / 1024, (float)total / passes, best,
+		total ? bytes / (1024.0 * 1024.0) * passes / (total / 1000.0) : 0.0);
+}
+
 /*
 ================
 FS_NextPath
@@ -843,6 +1455,7 @@ void FS_InitFilesystem (void)
 	Cmd_AddCommand ("path", FS_Path_f);
 	Cmd_AddCommand ("link", FS_Link_f);
 	Cmd_AddCommand ("dir", FS_Dir_f );
+	Cmd_AddCommand ("fs_bench", FS_Bench_f);
 
 	//
 	// basedir <path>
@@ -856,6 +1469,12 @@ void FS_InitFilesystem (void)
 	// allows the game to run from outside the data tree
 	//
 	fs_cddir = Cvar_Get ("cddir", "", CVAR_NOSET);
+
+	//
+	// fs_mmap <0|1>
+	// with 0, paks are not mapped and FS_ViewFile copies like FS_LoadFile
+	//
+	fs_mmap = Cvar_Get ("fs_mmap", "1", CVAR_NOSET);
 	if (fs_cddir->string[0])
 		FS_AddGameDirectory (va("%s/"BASEDIRNAME, fs_cddir->string) );
 
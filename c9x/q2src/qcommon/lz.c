@@ -0,0 +1,237 @@
+/*
+Copyright (C) 1997-2001 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+/* lz.c */
+
+#include <string.h>
+
+#include "lz.h"
+
+/*
+Blocks are a run of sequences, each a token byte, literals, and a match:
+
+	token		high nibble literal count, low nibble match length - 4,
+				a nibble of 15 going on in bytes that add up until one isn't 255
+	literals
+	offset		two bytes, little endian, back from the current output
+	match length bytes
+
+The last sequence is literals only.  As in LZ4 the last 5 bytes are always
+literals and no match starts in the last 12, which is what lets a
+decompressor copy in words, so anything LZ_Compress writes reads with a
+stock LZ4 block decoder too.
+
+The compressor is a single pass over a hash of the next four bytes: fast
+enough for a pak tool, and decompression speed doesn't depend on it.
+*/
+
+#define	LZ_MINMATCH			4
+#define	LZ_LASTLITERALS		5
+#define	LZ_MFLIMIT			12
+#define	LZ_MAXOFFSET		65535
+
+#define	LZ_HASHBITS			14
+
+static unsigned LZ_Read32 (const unsigned char *p)
+{
+	return p[0] | (p[1]<<8) | (p[2]<<16) | ((unsigned)p[3]<<24);
+}
+
+static int LZ_Hash (const unsigned char *p)
+{
+	return (LZ_Read32 (p) * 2654435761u) >> (32 - LZ_HASHBITS);
+}
+
+// writes the extra bytes of a length whose nibble was 15
+static unsigned char *LZ_PutLength (unsigned char *op, int len)
+{
+	for ( ; len >= 255 ; len -= 255)
+		*op++ = 255;
+	*op++ = len;
+	return op;
+}
+
+/*
+================
+LZ_Compress
+================
+*/
+int LZ_Compress (const unsigned char *in, int inlen, unsigned char *out, int outmax)
+{
+	int						table[1<<LZ_HASHBITS];
+	const unsigned char		*ip, *anchor, *match;
+	const unsigned char		*iend, *mflimit, *matchlimit;
+	unsigned char			*op, *oend, *token;
+	int						h, ref, len, lit;
+
+	ip = anchor = in;
+	iend = in + inlen;
+	mflimit = iend - LZ_MFLIMIT;
+	matchlimit = iend - LZ_LASTLITERALS;
+	op = out;
+	oend = out + outmax;
+
+	memset (table, -1, sizeof(table));
+
+	// anything shorter is all literals
+	if (inlen > LZ_MFLIMIT)
+	{
+		while (ip < mflimit)
+		{
+			h = LZ_Hash (ip);
+			ref = table[h];
+			table[h] = ip - in;
+			if (ref < 0 || ip - in - ref > LZ_MAXOFFSET || LZ_Read32 (in + ref) != LZ_Read32 (ip))
+			{
+				ip++;
+				continue;
+			}
+
+			match = in + ref;
+			for (len = LZ_MINMATCH ; ip + len < matchlimit && ip[len] == match[len] ; len++)
+				;
+
+			lit = ip - anchor;
+			if (oend - op < 1 + lit + lit/255 + 1 + 2 + (len - LZ_MINMATCH)/255 + 1)
+				return 0;
+
+			token = op++;
+			if (lit >= 15)
+			{
+				*token = 15<<4;
+				op = LZ_PutLength (op, lit - 15);
+			}
+			else
+				*token = lit<<4;
+			memcpy (op, anchor, lit);
+			op += lit;
+
+			*op++ = (ip - match) & 255;
+			*op++ = (ip - match) >> 8;
+
+			if (len - LZ_MINMATCH >= 15)
+			{
+				*token |= 15;
+				op = LZ_PutLength (op, len - LZ_MINMATCH - 15);
+			}
+			else
+				*token |= len - LZ_MINMATCH;
+
+			ip += len;
+			anchor = ip;
+		}
+	}
+
+	// the last literals
+	lit = iend - anchor;
+	if (oend - op < 1 + lit + lit/255 + 1)
+		return 0;
+	if (lit >= 15)
+	{
+		*op++ = 15<<4;
+		op = LZ_PutLength (op, lit - 15);
+	}
+	else
+		*op++ = lit<<4;
+	memcpy (op, anchor, lit);
+	op += lit;
+
+	return op - out;
+}
+
+/*
+================
+LZ_Decompress
+================
+*/
+int LZ_Decompress (const unsigned char *in, int inlen, unsigned char *out, int outlen)
+{
+	const unsigned char		*ip, *iend, *match;
+	unsigned char			*op, *oend;
+	int						token, len, offset, c;
+
+	ip = in;
+	iend = in + inlen;
+	op = out;
+	oend = out + outlen;
+
+	while (ip < iend)
+	{
+		token = *ip++;
+
+		// literals
+		len = token >> 4;
+		if (len == 15)
+		{
+			do
+			{
+				if (ip >= iend || len > outlen)
+					return -1;
+				c = *ip++;
+				len += c;
+			} while (c == 255);
+		}
+		if (len > iend - ip || len > oend - op)
+			return -1;
+		memcpy (op, ip, len);
+		op += len;
+		ip += len;
+
+		if (ip == iend)
+			break;		// the last sequence has no match
+
+		// match
+		if (iend - ip < 2)
+			return -1;
+		offset = ip[0] | (ip[1]<<8);
+		ip += 2;
+		if (!offset || offset > op - out)
+			return -1;
+
+		len = token & 15;
+		if (len == 15)
+		{
+			do
+			{
+				if (ip >= iend || len > outlen)
+					return -1;
+				c = *ip++;
+				len += c;
+			} while (c == 255);
+		}
+		len += LZ_MINMATCH;
+		if (len > oend - op)
+			return -1;
+
+		// an overlapping match repeats the last offset bytes, and every
+		// copy doubles how much can be copied in one go
+		match = op - offset;
+		while (len > 0)
+		{
+			c = op - match;
+			if (c > len)
+				c = len;
+			memcpy (op, match, c);
+			op += c;
+			len -= c;
+		}
+	}
+
+	return op - out;
+}
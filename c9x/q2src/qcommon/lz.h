@@ -0,0 +1,14 @@
+/* lz.h */
+
+// the LZ4 block format, for the blocks of compressed paks.  lz.c only needs
+// the C library, so the pak tools build it as it is
+
+// the most LZ_Compress can turn len bytes into
+#define	LZ_BOUND(len)	((len) + (len)/255 + 16)
+
+int LZ_Compress (const unsigned char *in, int inlen, unsigned char *out, int outmax);
+// returns the compressed size, or 0 if it won't fit in outmax
+
+int LZ_Decompress (const unsigned char *in, int inlen, unsigned char *out, int outlen);
+// returns the decompressed size, or -1 if in is damaged or holds more than
+// outlen bytes.  Never reads or writes outside the buffers it is given
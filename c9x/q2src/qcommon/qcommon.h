@@ -165,6 +165,8 @@ void CRC_ProcessByte(unsigned short *crcvalue, byte data);
 unsigned short CRC_Value(unsigned short crcvalue);
 unsigned short CRC_Block (byte *start, int count);
 
+#include "../qcommon/lz.h"
+
 
 
 /*
@@ -706,6 +708,10 @@ int		FS_LoadFile (char *path, void **buffer);
 // a null buffer will just return the file length without loading
 // a -1 length is not present
 
+int		FS_ViewFile (char *path, void **buffer);
+// read only and in place when the file is in a mapped pak, until the next
+// gamedir change; still freed with FS_FreeFile
+
 void	FS_Read (void *buffer, int len, FILE *f);
 // properly handles partial reads
 
@@ -763,11 +769,28 @@ extern	int		time_after_game;
 extern	int		time_before_ref;
 extern	int		time_after_ref;
 
+// tags for the engine's own zone blocks, so memstats can tell who owns
+// them; the game dll uses 765 and 766
+#define	TAG_ENGINE		0			// anything else, from Z_Malloc
+#define	TAG_SOUND		1
+#define	TAG_CINEMATIC	2
+#define	TAG_FILES		3			// search paths, pak directories, streams
+#define	TAG_COMMANDS	4			// commands, aliases, cvars, bindings
+#define	TAG_SERVER		5
+
 void Z_Free (void *ptr);
 void *Z_Malloc (int size);			// returns 0 filled memory
 void *Z_TagMalloc (int size, int tag);
 void Z_FreeTags (int tag);
 
+void Hunk_Stats_f (void);			// reserved and committed bytes per hunk
+
+void Mem_Alloced (char *kind, char *name, int size);
+void Mem_Freed (char *kind, char *name, int size);
+void Mem_Adjust (char *kind, char *name, int delta);
+void Mem_Stats_f (void);			// zone and hunk use by owner
+void Mem_Dump_f (void);				// the same as CSV
+
 void Qcommon_Init (int argc, char **argv);
 void Qcommon_Frame (int msec);
 void Qcommon_Shutdown (void);
@@ -803,6 +826,22 @@ void	Sys_Quit (void);
 char	*Sys_GetClipboardData( void );
 void	Sys_CopyProtect (void);
 
+int		Sys_ReadAt (FILE *f, int offset, void *buffer, int len);
+// reads without moving f, so one handle can serve any number of readers
+void	*Sys_MapFile (FILE *f, int len);
+void	Sys_UnmapFile (void *base, int len);
+// read only; Sys_MapFile returns NULL when the file can't be mapped
+FILE	*Sys_OpenStream (void *stream, int (*read) (void *stream, char *buf, int len),
+			int (*seek) (void *stream, int offset, int whence), void (*close) (void *stream));
+// a FILE that reads through the callbacks, for files that are not stored
+// as they are read.  seek returns the new position or -1, and fclose calls
+// close.  Returns NULL if the platform can't do it
+
+int		Sys_NumWorkers (void);
+void	Sys_RunJobs (int count, void (*job) (int index, int thread));
+// calls job for every index from 0 to count-1 on the main thread and
+// Sys_NumWorkers () others, returning once they are all done
+
 /*
 ==============================================================
 
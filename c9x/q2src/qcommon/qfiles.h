@@ -48,6 +48,25 @@ typedef struct
 
 #define	MAX_FILES_IN_PACK	4096
 
+/*
+A compressed pak has the same header with its own ident, and a directory
+of dpakzfile_t.  A file with a complen of 0 is stored as it is, otherwise
+filepos has a table of numblocks+1 offsets, from filepos, to the
+PAKZ_BLOCKSIZE blocks the file is cut into, each compressed on its own
+(lz.c) so they can be unpacked in any order and on any thread.  A block
+that is as long as it would be unpacked is stored as it is.
+*/
+#define IDPAKZHEADER	(('Z'<<24)+('K'<<16)+('A'<<8)+'P')
+
+#define	PAKZ_BLOCKSIZE	0x10000
+
+typedef struct
+{
+	char	name[56];
+	int		filepos, filelen;
+	int		complen;	// of the table and the blocks, 0 if stored
+} dpakzfile_t;
+
 
 /*
 ========================================================================
@@ -196,6 +196,7 @@ extern	cvar_t		*sv_noreload;			// don't reload level state when reentering
 extern	cvar_t		*sv_airaccelerate;		// don't reload level state when reentering
 											// development tool
 extern	cvar_t		*sv_enforcetime;
+extern	cvar_t		*sv_areatree;			// bounding box trees instead of area nodes
 
 extern	client_t	*sv_client;
 extern	edict_t		*sv_player;
@@ -275,6 +276,9 @@ void SV_Status_f (void);
 void SV_WriteFrameToClient (client_t *client, sizebuf_t *msg);
 void SV_RecordDemoMessage (void);
 void SV_BuildClientFrame (client_t *client);
+void SV_ClearFatPVSCache (void);
+
+extern	int		fatpvs_lookups, fatpvs_hits;
 
 
 void SV_Error (char *error, ...);
@@ -318,6 +322,9 @@ int SV_AreaEdicts (vec3_t mins, vec3_t maxs, edict_t **list, int maxcount, int a
 // returns the number of pointers filled in
 // ??? does this always return the world?
 
+void SV_TraceBench_f (void);
+// times the same traces against the area nodes and the area trees
+
 //===================================================================
 
 //
@@ -746,6 +746,8 @@ void SV_Status_f (void)
 		return;
 	}
 	Com_Printf ("map              : %s\n", sv.name);
+	if (fatpvs_lookups)
+		Com_Printf ("fatpvs cache     : %i%% of %i\n", (int)(100.0*fatpvs_hits/fatpvs_lookups), fatpvs_lookups);
 
 	Com_Printf ("num score ping name            lastmsg address               qport \n");
 	Com_Printf ("--- ----- ---- --------------- ------- --------------------- ------\n");
@@ -1046,5 +1048,7 @@ void SV_InitOperatorCommands (void)
 	Cmd_AddCommand ("killserver", SV_KillServer_f);
 
 	Cmd_AddCommand ("sv", SV_ServerCommand_f);
+
+	Cmd_AddCommand ("tracebench", SV_TraceBench_f);
 }
 
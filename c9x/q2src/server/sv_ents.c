@@ -19,6 +19,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 */
 
 #include "server.h"
+#include <stdint.h>
 
 /*
 =============================================================================
@@ -462,7 +463,73 @@ Build a client frame structure
 =============================================================================
 */
 
-byte		fatpvs[65536/8];	// 32767 is MAX_MAP_LEAFS
+byte		*fatpvs;
+
+/*
+Clients whose view origins touch the same set of clusters get the same fat
+PVS, so rows are cached keyed on the sorted cluster list.  Cluster rows do
+not change while a map is loaded, so entries are kept until
+SV_ClearFatPVSCache at the next SV_SpawnServer.
+
+A new entry ors the rows together 64 bits at a time, or 128 with SSE2 when
+the compiler targets it (x86-64, or -msse2 on x86).  The default -m32 build
+doesn't, and gets the 64 bit loop, which is two 32 bit ors a word there.
+*/
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define	FATPVS_SSE2
+#include <emmintrin.h>
+#endif
+
+#define	FATPVS_CACHE	32
+#define	FATPVS_CLUSTERS	16		// more clusters than this are not cached
+
+typedef struct
+{
+	int		numclusters;	// 0 = free
+	int		clusters[FATPVS_CLUSTERS];
+	int		lastused;
+	uint64_t	pvs[MAX_MAP_LEAFS/64];
+} fatpvscache_t;
+
+static fatpvscache_t	fatpvs_cache[FATPVS_CACHE];
+static uint64_t	fatpvs_uncached[MAX_MAP_LEAFS/64];
+static int		fatpvs_sequence;
+int				fatpvs_lookups, fatpvs_hits;
+
+/*
+============
+SV_ClearFatPVSCache
+============
+*/
+void SV_ClearFatPVSCache (void)
+{
+	int		i;
+
+	for (i=0 ; i<FATPVS_CACHE ; i++)
+		fatpvs_cache[i].numclusters = 0;
+	fatpvs_lookups = fatpvs_hits = 0;
+}
+
+/*
+============
+SV_OrPVS
+
+Ors the first words 64 bit words of src into dst.  With SSE2 words is even;
+the rows are sized in 128 bit steps, so that never reads past one.
+============
+*/
+static void SV_OrPVS (uint64_t *dst, uint64_t *src, int words)
+{
+	int		i;
+
+#ifdef FATPVS_SSE2
+	for (i=0 ; i<words ; i+=2)
+		_mm_storeu_si128 ((__m128i *)(dst + i), _mm_or_si128 (_mm_loadu_si128 ((__m128i *)(dst + i)), _mm_loadu_si128 ((__m128i *)(src + i))));
+#else
+	for (i=0 ; i<words ; i++)
+		dst[i] |= src[i];
+#endif
+}
 
 /*
 ============
@@ -475,10 +542,13 @@ so we can't use a single PVS point
 void SV_FatPVS (vec3_t org)
 {
 	int		leafs[64];
-	int		i, j, count;
-	int		longs;
-	byte	*src;
+	int		clusters[64];
+	int		i, j, k, count, numclusters;
+	int		cluster;
+	int		words;
+	uint64_t	*dst;
 	vec3_t	mins, maxs;
+	fatpvscache_t	*c, *oldest;
 
 	for (i=0 ; i<3 ; i++)
 	{
@@ -489,25 +559,64 @@ void SV_FatPVS (vec3_t org)
 	count = CM_BoxLeafnums (mins, maxs, leafs, 64, NULL);
 	if (count < 1)
 		Com_Error (ERR_FATAL, "SV_FatPVS: count < 1");
-	longs = (CM_NumClusters()+31)>>5;
+	words = (CM_NumClusters() + 63) >> 6;
+#ifdef FATPVS_SSE2
+	words = (words + 1) & ~1;
+#endif
 
-	// convert leafs to clusters
+	// convert leafs to a sorted list of distinct clusters
+	numclusters = 0;
 	for (i=0 ; i<count ; i++)
-		leafs[i] = CM_LeafCluster(leafs[i]);
-
-	memcpy (fatpvs, CM_ClusterPVS(leafs[0]), longs<<2);
-	// or in all the other leaf bits
-	for (i=1 ; i<count ; i++)
 	{
-		for (j=0 ; j<i ; j++)
-			if (leafs[i] == leafs[j])
+		cluster = CM_LeafCluster(leafs[i]);
+		if (cluster == -1)
+			continue;		// contributes nothing
+		for (j=0 ; j<numclusters ; j++)
+			if (clusters[j] >= cluster)
 				break;
-		if (j != i)
+		if (j < numclusters && clusters[j] == cluster)
 			continue;		// already have the cluster we want
-		src = CM_ClusterPVS(leafs[i]);
-		for (j=0 ; j<longs ; j++)
-			((long *)fatpvs)[j] |= ((long *)src)[j];
+		for (k=numclusters ; k>j ; k--)
+			clusters[k] = clusters[k-1];
+		clusters[j] = cluster;
+		numclusters++;
 	}
+
+	dst = NULL;
+	if (numclusters && numclusters <= FATPVS_CLUSTERS)
+	{
+		fatpvs_lookups++;
+		fatpvs_sequence++;
+
+		oldest = fatpvs_cache;
+		for (i=0, c=fatpvs_cache ; i<FATPVS_CACHE ; i++, c++)
+		{
+			if (c->numclusters == numclusters
+			&& !memcmp (c->clusters, clusters, numclusters*sizeof(int)))
+			{
+				fatpvs_hits++;
+				c->lastused = fatpvs_sequence;
+				fatpvs = (byte *)c->pvs;
+				return;
+			}
+			if (oldest->numclusters && (!c->numclusters || c->lastused < oldest->lastused))
+				oldest = c;
+		}
+
+		c = oldest;
+		c->numclusters = numclusters;
+		memcpy (c->clusters, clusters, numclusters*sizeof(int));
+		c->lastused = fatpvs_sequence;
+		dst = c->pvs;
+	}
+	else
+		dst = fatpvs_uncached;
+
+	// or in all the cluster rows
+	memset (dst, 0, words*sizeof(uint64_t));
+	for (i=0 ; i<numclusters ; i++)
+		SV_OrPVS (dst, (uint64_t *)CM_ClusterPVS(clusters[i]), words);
+	fatpvs = (byte *)dst;
 }
 
 
@@ -239,6 +239,7 @@ void SV_SpawnServer (char *server, char *spawnpoint, server_state_t serverstate,
 	// clear physics interaction links
 	//
 	SV_ClearWorld ();
+	SV_ClearFatPVSCache ();
 	
 	for (i=1 ; i< CM_NumInlineModels() ; i++)
 	{
@@ -350,9 +351,9 @@ void SV_InitGame (void)
 	}
 
 	svs.spawncount = rand();
-	svs.clients = Z_Malloc (sizeof(client_t)*maxclients->value);
+	svs.clients = Z_TagMalloc (sizeof(client_t)*maxclients->value, TAG_SERVER);
 	svs.num_client_entities = maxclients->value*UPDATE_BACKUP*64;
-	svs.client_entities = Z_Malloc (sizeof(entity_state_t)*svs.num_client_entities);
+	svs.client_entities = Z_TagMalloc (sizeof(entity_state_t)*svs.num_client_entities, TAG_SERVER);
 
 	// init network stuff
 	NET_Config ( (maxclients->value > 1) );
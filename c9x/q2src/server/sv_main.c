@@ -28,6 +28,7 @@ cvar_t	*sv_paused;
 cvar_t	*sv_timedemo;
 
 cvar_t	*sv_enforcetime;
+cvar_t	*sv_areatree;			// read at map load
 
 cvar_t	*timeout;				// seconds without any message
 cvar_t	*zombietime;			// seconds to sink messages after disconnect
@@ -763,7 +764,10 @@ void SV_Frame (int msec)
 
 	// if server is not active, do nothing
 	if (!svs.initialized)
+	{
+		NET_Sleep (100);	// a dedicated server waits for console input
 		return;
+	}
 
     svs.realtime += msec;
 
@@ -963,6 +967,7 @@ void SV_Init (void)
 	sv_paused = Cvar_Get ("paused", "0", 0);
 	sv_timedemo = Cvar_Get ("timedemo", "0", 0);
 	sv_enforcetime = Cvar_Get ("sv_enforcetime", "0", 0);
+	sv_areatree = Cvar_Get ("sv_areatree", "0", 0);
 	allow_download = Cvar_Get ("allow_download", "0", CVAR_ARCHIVE);
 	allow_download_players  = Cvar_Get ("allow_download_players", "0", CVAR_ARCHIVE);
 	allow_download_models = Cvar_Get ("allow_download_models", "1", CVAR_ARCHIVE);
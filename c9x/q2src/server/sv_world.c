@@ -57,6 +57,31 @@ edict_t	**area_list;
 int		area_count, area_maxcount;
 int		area_type;
 
+// with sv_areatree set at map load the area nodes are left empty and
+// linked edicts go in bounding box trees instead, one per area type
+#define	AREA_MAXBOXES	(MAX_EDICTS*2)
+#define	AREA_MARGIN		8		// slack around every leaf box
+#define	AREA_PREDICT	1		// moves like the last one a leaf box also covers
+#define	AREA_HUGE		1e30	// leaf box for an edict with a broken abs box
+
+typedef struct
+{
+	vec3_t	mins, maxs;
+	int		parent;			// next free box when not in use
+	int		children[2];	// -1 on leaves
+	int		ent;			// edict number on leaves
+	int		height;			// 0 on leaves
+} areabox_t;
+
+static	qboolean	sv_usetree;
+static	areabox_t	sv_areaboxes[AREA_MAXBOXES];
+static	int			sv_freeareabox;
+static	int			sv_arearoot[2];				// AREA_SOLID-1, AREA_TRIGGER-1
+static	int			sv_entareabox[MAX_EDICTS];	// leaf, -1 = none
+static	byte		sv_entareatree[MAX_EDICTS];	// which root the leaf is under
+static	vec3_t		sv_entareaprev[MAX_EDICTS];	// absmin when last linked
+static	link_t		sv_treeedicts[2];			// ent->area hangs off these
+
 int SV_HullForEntity (edict_t *ent);
 
 
@@ -128,15 +153,46 @@ areanode_t *SV_CreateAreaNode (int depth, vec3_t mins, vec3_t maxs)
 
 /*
 ===============
-SV_ClearWorld
+SV_ClearArea
 
+Empties the area nodes and the bounding box trees
 ===============
 */
-void SV_ClearWorld (void)
+static void SV_ClearArea (void)
 {
+	int		i;
+
 	memset (sv_areanodes, 0, sizeof(sv_areanodes));
 	sv_numareanodes = 0;
 	SV_CreateAreaNode (0, sv.models[1]->mins, sv.models[1]->maxs);
+
+	for (i=0 ; i<AREA_MAXBOXES ; i++)
+	{
+		sv_areaboxes[i].parent = i+1;
+		sv_areaboxes[i].height = -1;
+	}
+	sv_areaboxes[AREA_MAXBOXES-1].parent = -1;
+	sv_freeareabox = 0;
+
+	for (i=0 ; i<2 ; i++)
+	{
+		sv_arearoot[i] = -1;
+		ClearLink (&sv_treeedicts[i]);
+	}
+	for (i=0 ; i<MAX_EDICTS ; i++)
+		sv_entareabox[i] = -1;
+}
+
+/*
+===============
+SV_ClearWorld
+
+===============
+*/
+void SV_ClearWorld (void)
+{
+	sv_usetree = sv_areatree->value != 0;
+	SV_ClearArea ();
 }
 
 
@@ -155,6 +211,410 @@ void SV_UnlinkEdict (edict_t *ent)
 }
 
 
+/*
+===============================================================================
+
+AREA TREES
+
+Each linked edict gets a leaf box: its abs box with AREA_MARGIN of slack,
+stretched along the move it made since it was last linked.  As long as a
+relink stays inside that box the tree is left alone.  A leaf that has to
+move is reinserted next to the sibling that grows the tree's surface area
+the least, and the boxes above it are refit and rebalanced.
+
+The box code from SV_AllocAreaBox through SV_LinkAreaBox is the same as
+in q1src/qcommon/world.c, apart from how the edict fields are reached,
+how errors are raised and what a leaf is stretched along.  A fix to one
+belongs in the other.
+
+===============================================================================
+*/
+
+/*
+===============
+SV_AllocAreaBox
+
+===============
+*/
+static int SV_AllocAreaBox (void)
+{
+	int			b;
+	areabox_t	*box;
+
+	b = sv_freeareabox;
+	if (b == -1)
+		Com_Error (ERR_DROP, "SV_AllocAreaBox: no free boxes");
+	box = &sv_areaboxes[b];
+	sv_freeareabox = box->parent;
+
+	box->parent = -1;
+	box->children[0] = box->children[1] = -1;
+	box->ent = 0;
+	box->height = 0;
+	return b;
+}
+
+/*
+===============
+SV_FreeAreaBox
+
+===============
+*/
+static void SV_FreeAreaBox (int b)
+{
+	sv_areaboxes[b].parent = sv_freeareabox;
+	sv_areaboxes[b].height = -1;
+	sv_freeareabox = b;
+}
+
+/*
+===============
+SV_AreaBoxCost
+
+Half the surface area of a box, in double so the huge boxes can't overflow
+===============
+*/
+static double SV_AreaBoxCost (vec3_t mins, vec3_t maxs)
+{
+	double	x, y, z;
+
+	x = maxs[0] - mins[0];
+	y = maxs[1] - mins[1];
+	z = maxs[2] - mins[2];
+	return x*y + y*z + z*x;
+}
+
+/*
+===============
+SV_UnionAreaBoxes
+
+===============
+*/
+static void SV_UnionAreaBoxes (areabox_t *a, areabox_t *b, vec3_t mins, vec3_t maxs)
+{
+	int		i;
+
+	for (i=0 ; i<3 ; i++)
+	{
+		mins[i] = a->mins[i] < b->mins[i] ? a->mins[i] : b->mins[i];
+		maxs[i] = a->maxs[i] > b->maxs[i] ? a->maxs[i] : b->maxs[i];
+	}
+}
+
+/*
+===============
+SV_RefitAreaBox
+
+Sets an inner box's bounds and height from its children
+===============
+*/
+static void SV_RefitAreaBox (int b)
+{
+	areabox_t	*box, *c0, *c1;
+
+	box = &sv_areaboxes[b];
+	c0 = &sv_areaboxes[box->children[0]];
+	c1 = &sv_areaboxes[box->children[1]];
+	SV_UnionAreaBoxes (c0, c1, box->mins, box->maxs);
+	box->height = 1 + (c0->height > c1->height ? c0->height : c1->height);
+}
+
+/*
+===============
+SV_BalanceAreaBox
+
+If one child of b is more than one level taller than the other, lifts it
+into b's place and returns it, otherwise returns b
+===============
+*/
+static int SV_BalanceAreaBox (int tree, int b)
+{
+	areabox_t	*box, *up, *p;
+	int			side, u, tall, shrt;
+
+	box = &sv_areaboxes[b];
+	if (box->height < 2)
+		return b;
+
+	if (sv_areaboxes[box->children[1]].height - sv_areaboxes[box->children[0]].height > 1)
+		side = 1;
+	else if (sv_areaboxes[box->children[0]].height - sv_areaboxes[box->children[1]].height > 1)
+		side = 0;
+	else
+		return b;
+
+	u = box->children[side];
+	up = &sv_areaboxes[u];
+
+// up takes b's place
+	up->parent = box->parent;
+	if (up->parent != -1)
+	{
+		p = &sv_areaboxes[up->parent];
+		p->children[p->children[0] == b ? 0 : 1] = u;
+	}
+	else
+		sv_arearoot[tree] = u;
+
+// b keeps the shorter of up's children, up keeps the taller one and b
+	if (sv_areaboxes[up->children[0]].height > sv_areaboxes[up->children[1]].height)
+	{
+		tall = up->children[0];
+		shrt = up->children[1];
+	}
+	else
+	{
+		tall = up->children[1];
+		shrt = up->children[0];
+	}
+	box->children[side] = shrt;
+	sv_areaboxes[shrt].parent = b;
+	up->children[0] = b;
+	up->children[1] = tall;
+	box->parent = u;
+
+	SV_RefitAreaBox (b);
+	SV_RefitAreaBox (u);
+	return u;
+}
+
+/*
+===============
+SV_FixAreaBoxes
+
+Refits and rebalances b and everything above it
+===============
+*/
+static void SV_FixAreaBoxes (int tree, int b)
+{
+	while (b != -1)
+	{
+		b = SV_BalanceAreaBox (tree, b);
+		SV_RefitAreaBox (b);
+		b = sv_areaboxes[b].parent;
+	}
+}
+
+/*
+===============
+SV_InsertAreaBox
+
+===============
+*/
+static void SV_InsertAreaBox (int tree, int leaf)
+{
+	areabox_t	*box, *child, *p;
+	vec3_t		mins, maxs;
+	double		area, cost, inherit, childcost[2];
+	int			b, i, np;
+
+	if (sv_arearoot[tree] == -1)
+	{
+		sv_arearoot[tree] = leaf;
+		sv_areaboxes[leaf].parent = -1;
+		return;
+	}
+
+// walk down to the sibling that costs the least surface area
+	b = sv_arearoot[tree];
+	while (sv_areaboxes[b].children[0] != -1)
+	{
+		box = &sv_areaboxes[b];
+		area = SV_AreaBoxCost (box->mins, box->maxs);
+		SV_UnionAreaBoxes (box, &sv_areaboxes[leaf], mins, maxs);
+		cost = 2 * SV_AreaBoxCost (mins, maxs);
+		inherit = cost - 2 * area;	// what every box below here grows by
+
+		for (i=0 ; i<2 ; i++)
+		{
+			child = &sv_areaboxes[box->children[i]];
+			SV_UnionAreaBoxes (child, &sv_areaboxes[leaf], mins, maxs);
+			childcost[i] = SV_AreaBoxCost (mins, maxs) + inherit;
+			if (child->children[0] != -1)
+				childcost[i] -= SV_AreaBoxCost (child->mins, child->maxs);
+		}
+
+		if (cost < childcost[0] && cost < childcost[1])
+			break;
+		b = box->children[childcost[1] < childcost[0]];
+	}
+
+// pair the leaf up with it under a new box
+	np = SV_AllocAreaBox ();
+	box = &sv_areaboxes[np];
+	box->parent = sv_areaboxes[b].parent;
+	box->children[0] = b;
+	box->children[1] = leaf;
+	SV_RefitAreaBox (np);
+
+	if (box->parent != -1)
+	{
+		p = &sv_areaboxes[box->parent];
+		p->children[p->children[0] == b ? 0 : 1] = np;
+	}
+	else
+		sv_arearoot[tree] = np;
+	sv_areaboxes[b].parent = np;
+	sv_areaboxes[leaf].parent = np;
+
+	SV_FixAreaBoxes (tree, np);
+}
+
+/*
+===============
+SV_RemoveAreaBox
+
+Takes a leaf out of its tree, freeing the box that held it and its sibling
+===============
+*/
+static void SV_RemoveAreaBox (int tree, int leaf)
+{
+	areabox_t	*p, *g;
+	int			parent, sibling;
+
+	if (sv_arearoot[tree] == leaf)
+	{
+		sv_arearoot[tree] = -1;
+		return;
+	}
+
+	parent = sv_areaboxes[leaf].parent;
+	p = &sv_areaboxes[parent];
+	sibling = p->children[p->children[0] == leaf ? 1 : 0];
+
+	if (p->parent != -1)
+	{
+		g = &sv_areaboxes[p->parent];
+		g->children[g->children[0] == parent ? 0 : 1] = sibling;
+		sv_areaboxes[sibling].parent = p->parent;
+		SV_FixAreaBoxes (tree, p->parent);
+	}
+	else
+	{
+		sv_arearoot[tree] = sibling;
+		sv_areaboxes[sibling].parent = -1;
+	}
+	SV_FreeAreaBox (parent);
+}
+
+/*
+===============
+SV_DropAreaBox
+
+Takes edict e out of the trees, if it is in one
+===============
+*/
+static void SV_DropAreaBox (int e)
+{
+	int		leaf;
+
+	leaf = sv_entareabox[e];
+	if (leaf == -1)
+		return;
+	SV_RemoveAreaBox (sv_entareatree[e], leaf);
+	SV_FreeAreaBox (leaf);
+	sv_entareabox[e] = -1;
+}
+
+/*
+===============
+SV_LinkAreaBox
+
+Puts a leaf box for ent in the tree for its solid type, or leaves the one
+it has if that still covers its abs box
+===============
+*/
+static void SV_LinkAreaBox (edict_t *ent)
+{
+	areabox_t	*box;
+	int			e, tree, leaf, i;
+	float		d;
+
+	e = NUM_FOR_EDICT(ent);
+	tree = ent->solid == SOLID_TRIGGER ? AREA_TRIGGERS-1 : AREA_SOLID-1;
+
+	leaf = sv_entareabox[e];
+	if (leaf != -1)
+	{
+		box = &sv_areaboxes[leaf];
+		for (i=0 ; i<3 ; i++)
+			if (!(ent->absmin[i] >= box->mins[i] && ent->absmax[i] <= box->maxs[i]))
+				break;
+		if (i != 3 || sv_entareatree[e] != tree)
+		{
+			SV_DropAreaBox (e);
+			leaf = -1;
+		}
+	}
+
+	if (leaf == -1)
+	{
+		leaf = SV_AllocAreaBox ();
+		box = &sv_areaboxes[leaf];
+		box->ent = e;
+		for (i=0 ; i<3 ; i++)
+		{
+			box->mins[i] = ent->absmin[i] - AREA_MARGIN;
+			box->maxs[i] = ent->absmax[i] + AREA_MARGIN;
+			d = (ent->absmin[i] - sv_entareaprev[e][i]) * AREA_PREDICT;
+			if (d < 0)
+				box->mins[i] += d;
+			else
+				box->maxs[i] += d;
+		// a box that isn't all numbers must still be found by everything
+			if (!(box->mins[i] > -AREA_HUGE && box->maxs[i] < AREA_HUGE))
+			{
+				box->mins[i] = -AREA_HUGE;
+				box->maxs[i] = AREA_HUGE;
+			}
+		}
+		SV_InsertAreaBox (tree, leaf);
+		sv_entareabox[e] = leaf;
+		sv_entareatree[e] = tree;
+	}
+	VectorCopy (ent->absmin, sv_entareaprev[e]);
+
+	InsertLinkBefore (&ent->area, &sv_treeedicts[tree]);
+}
+
+/*
+===============
+SV_LinkArea
+
+Links ent into the area nodes or trees by its abs box
+===============
+*/
+static void SV_LinkArea (edict_t *ent)
+{
+	areanode_t	*node;
+
+	if (sv_usetree)
+	{
+		SV_LinkAreaBox (ent);
+		return;
+	}
+
+	// find the first node that the ent's box crosses
+	node = sv_areanodes;
+	while (1)
+	{
+		if (node->axis == -1)
+			break;
+		if (ent->absmin[node->axis] > node->dist)
+			node = node->children[0];
+		else if (ent->absmax[node->axis] < node->dist)
+			node = node->children[1];
+		else
+			break;		// crosses the node
+	}
+	
+	// link it in	
+	if (ent->solid == SOLID_TRIGGER)
+		InsertLinkBefore (&ent->area, &node->trigger_edicts);
+	else
+		InsertLinkBefore (&ent->area, &node->solid_edicts);
+}
+
 /*
 ===============
 SV_LinkEdict
@@ -164,7 +624,6 @@ SV_LinkEdict
 #define MAX_TOTAL_ENT_LEAFS		128
 void SV_LinkEdict (edict_t *ent)
 {
-	areanode_t	*node;
 	int			leafs[MAX_TOTAL_ENT_LEAFS];
 	int			clusters[MAX_TOTAL_ENT_LEAFS];
 	int			num_leafs;
@@ -179,7 +638,10 @@ void SV_LinkEdict (edict_t *ent)
 		return;		// don't add the world
 
 	if (!ent->inuse)
+	{
+		SV_DropAreaBox (NUM_FOR_EDICT(ent));
 		return;
+	}
 
 	// set the size
 	VectorSubtract (ent->maxs, ent->mins, ent->size);
@@ -320,28 +782,12 @@ void SV_LinkEdict (edict_t *ent)
 	ent->linkcount++;
 
 	if (ent->solid == SOLID_NOT)
-		return;
-
-// find the first node that the ent's box crosses
-	node = sv_areanodes;
-	while (1)
 	{
-		if (node->axis == -1)
-			break;
-		if (ent->absmin[node->axis] > node->dist)
-			node = node->children[0];
-		else if (ent->absmax[node->axis] < node->dist)
-			node = node->children[1];
-		else
-			break;		// crosses the node
+		SV_DropAreaBox (NUM_FOR_EDICT(ent));
+		return;
 	}
-	
-	// link it in	
-	if (ent->solid == SOLID_TRIGGER)
-		InsertLinkBefore (&ent->area, &node->trigger_edicts);
-	else
-		InsertLinkBefore (&ent->area, &node->solid_edicts);
 
+	SV_LinkArea (ent);
 }
 
 
@@ -400,6 +846,80 @@ void SV_AreaEdicts_r (areanode_t *node)
 		SV_AreaEdicts_r ( node->children[1] );
 }
 
+/*
+====================
+SV_AreaTreeEdicts
+
+SV_AreaEdicts_r for a bounding box tree
+====================
+*/
+static void SV_AreaTreeEdicts (int tree)
+{
+	int			stack[AREA_MAXBOXES];
+	int			b, i, sp;
+	areabox_t	*box, *child;
+	edict_t		*check;
+
+	if (sv_arearoot[tree] == -1)
+		return;
+	box = &sv_areaboxes[sv_arearoot[tree]];
+	if (area_mins[0] > box->maxs[0]
+	|| area_mins[1] > box->maxs[1]
+	|| area_mins[2] > box->maxs[2]
+	|| area_maxs[0] < box->mins[0]
+	|| area_maxs[1] < box->mins[1]
+	|| area_maxs[2] < box->mins[2])
+		return;
+
+	// only boxes that touch go on the stack
+	sp = 0;
+	stack[sp++] = sv_arearoot[tree];
+	while (sp)
+	{
+		box = &sv_areaboxes[stack[--sp]];
+		if (box->children[0] == -1)
+		{
+			check = EDICT_NUM(box->ent);
+			if (!check->area.prev)
+				continue;		// unlinked, the box is kept for a relink
+			if (check->solid == SOLID_NOT)
+				continue;		// deactivated
+			if (check->absmin[0] > area_maxs[0]
+			|| check->absmin[1] > area_maxs[1]
+			|| check->absmin[2] > area_maxs[2]
+			|| check->absmax[0] < area_mins[0]
+			|| check->absmax[1] < area_mins[1]
+			|| check->absmax[2] < area_mins[2])
+				continue;		// not touching
+
+			if (area_count == area_maxcount)
+			{
+				Com_Printf ("SV_AreaEdicts: MAXCOUNT\n");
+				return;
+			}
+
+			area_list[area_count] = check;
+			area_count++;
+			continue;
+		}
+
+		// children[0] goes on top so the walk runs left to right
+		for (i=1 ; i>=0 ; i--)
+		{
+			b = box->children[i];
+			child = &sv_areaboxes[b];
+			if (area_mins[0] > child->maxs[0]
+			|| area_mins[1] > child->maxs[1]
+			|| area_mins[2] > child->maxs[2]
+			|| area_maxs[0] < child->mins[0]
+			|| area_maxs[1] < child->mins[1]
+			|| area_maxs[2] < child->mins[2])
+				continue;
+			stack[sp++] = b;
+		}
+	}
+}
+
 /*
 ================
 SV_AreaEdicts
@@ -415,7 +935,10 @@ int SV_AreaEdicts (vec3_t mins, vec3_t maxs, edict_t **list,
 	area_maxcount = maxcount;
 	area_type = areatype;
 
-	SV_AreaEdicts_r (sv_areanodes);
+	if (sv_usetree)
+		SV_AreaTreeEdicts (areatype == AREA_SOLID ? AREA_SOLID-1 : AREA_TRIGGERS-1);
+	else
+		SV_AreaEdicts_r (sv_areanodes);
 
 	return area_count;
 }
@@ -657,3 +1180,150 @@ trace_t SV_Trace (vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, edict_t *p
 	return clip.trace;
 }
 
+
+
+/*
+===============================================================================
+
+TRACE BENCHMARK
+
+===============================================================================
+*/
+
+static	unsigned	sv_benchseed;
+
+static float SV_BenchRandom (void)
+{
+	sv_benchseed = sv_benchseed * 1103515245 + 12345;
+	return ((sv_benchseed >> 8) & 0xffff) * (1.0/65536);
+}
+
+/*
+===============
+SV_RelinkArea
+
+Moves every linked edict into the area nodes or into the trees, without
+touching their abs boxes
+===============
+*/
+static void SV_RelinkArea (qboolean tree)
+{
+	static byte	linked[MAX_EDICTS];
+	edict_t		*ent;
+	int			e;
+
+	for (e=1 ; e<ge->num_edicts ; e++)
+	{
+		ent = EDICT_NUM(e);
+		linked[e] = ent->area.prev != NULL;
+		ent->area.prev = ent->area.next = NULL;
+	}
+
+	sv_usetree = tree;
+	SV_ClearArea ();
+
+	for (e=1 ; e<ge->num_edicts ; e++)
+	{
+		ent = EDICT_NUM(e);
+		if (linked[e])
+		{
+			VectorCopy (ent->absmin, sv_entareaprev[e]);
+			SV_LinkArea (ent);
+		}
+	}
+}
+
+/*
+===============
+SV_BenchTraces
+
+Runs count traces that start near random solid edicts and returns the
+milliseconds they took.  The same seed gives the same traces.
+===============
+*/
+static int SV_BenchTraces (int count, edict_t **solids, int numsolids, float *fractions, int *hits)
+{
+	static vec3_t	sizes[3][2] = {
+		{{0, 0, 0}, {0, 0, 0}},
+		{{-16, -16, -24}, {16, 16, 32}},
+		{{-32, -32, -24}, {32, 32, 64}}};
+	vec3_t	start, end;
+	edict_t	*ent;
+	trace_t	trace;
+	int		time;
+	int		i, j, s;
+
+	sv_benchseed = 1;
+	*fractions = 0;
+	*hits = 0;
+
+	time = Sys_Milliseconds ();
+	for (i=0 ; i<count ; i++)
+	{
+		ent = solids[(int)(SV_BenchRandom () * numsolids)];
+		for (j=0 ; j<3 ; j++)
+		{
+			start[j] = ent->s.origin[j] + (SV_BenchRandom () - 0.5) * 128;
+			end[j] = start[j] + (SV_BenchRandom () - 0.5) * 1024;
+		}
+		s = i % 3;
+		trace = SV_Trace (start, sizes[s][0], sizes[s][1], end, NULL, i % 5 ? MASK_PLAYERSOLID : MASK_SHOT);
+		*fractions += trace.fraction;
+		if (trace.ent)
+			*hits += NUM_FOR_EDICT(trace.ent);
+	}
+	return Sys_Milliseconds () - time;
+}
+
+/*
+===============
+SV_TraceBench_f
+
+tracebench [traces]
+
+Times the same traces against the area nodes and the trees
+===============
+*/
+void SV_TraceBench_f (void)
+{
+	static edict_t	*solids[MAX_EDICTS];
+	edict_t		*ent;
+	int			count, numsolids, i, pass, time[2], hits[2];
+	float		fractions[2];
+	qboolean	tree;
+
+	if (sv.state != ss_game)
+	{
+		Com_Printf ("No map loaded.\n");
+		return;
+	}
+
+	count = Cmd_Argc () > 1 ? atoi (Cmd_Argv (1)) : 100000;
+	if (count < 1)
+		count = 1;
+
+	numsolids = 0;
+	for (i=1 ; i<ge->num_edicts ; i++)
+	{
+		ent = EDICT_NUM(i);
+		if (ent->inuse && ent->area.prev && ent->solid != SOLID_TRIGGER)
+			solids[numsolids++] = ent;
+	}
+	if (!numsolids)
+		solids[numsolids++] = ge->edicts;
+
+	tree = sv_usetree;
+	for (pass=0 ; pass<2 ; pass++)
+	{
+		SV_RelinkArea (pass);
+		time[pass] = SV_BenchTraces (count, solids, numsolids, &fractions[pass], &hits[pass]);
+	}
+	SV_RelinkArea (tree);
+
+	Com_Printf ("%i traces, %i solid edicts\n", count, numsolids);
+	for (pass=0 ; pass<2 ; pass++)
+		Com_Printf ("%-10s %6i ms %10.0f traces/s  (check %.1f %i)\n",
+			pass ? "area tree" : "area node", time[pass],
+			count * 1000.0 / (time[pass] > 0 ? time[pass] : 1),
+			fractions[pass], hits[pass]);
+}
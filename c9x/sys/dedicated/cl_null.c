@@ -0,0 +1,307 @@
+/*
+Copyright (C) 1996-1997 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+// cl_null.c -- this file can stub out the entire client system
+// for pure dedicated servers
+
+#ifdef Q1
+#include "quakedef.h"
+
+client_static_t	cls;
+client_state_t	cl;
+
+cvar_t	cl_name = {"_cl_name", "player", true};
+cvar_t	cl_color = {"_cl_color", "0", true};
+
+qboolean	scr_disabled_for_loading;
+int			scr_copytop;
+float		scr_centertime_off;
+int			clearnotify;
+
+int			m_state;
+int			m_return_state;
+qboolean	m_return_onerror;
+char		m_return_reason[32];
+
+viddef_t	vid;
+unsigned short	d_8to16table[256];
+int			r_pixbytes = 1;
+vec3_t		r_origin, vpn, vright, vup;
+texture_t	*r_notexture_mip;
+
+void CL_Init (void)
+{
+}
+
+void CL_Disconnect (void)
+{
+}
+
+void CL_Disconnect_f (void)
+{
+}
+
+void CL_NextDemo (void)
+{
+}
+
+void CL_StopPlayback (void)
+{
+}
+
+void CL_EstablishConnection (char *host)
+{
+}
+
+void CL_SendCmd (void)
+{
+}
+
+int CL_ReadFromServer (void)
+{
+	return 0;
+}
+
+void CL_DecayLights (void)
+{
+}
+
+void Chase_Init (void)
+{
+}
+
+void SCR_Init (void)
+{
+}
+
+void SCR_UpdateScreen (void)
+{
+}
+
+void SCR_BeginLoadingPlaque (void)
+{
+}
+
+void SCR_EndLoadingPlaque (void)
+{
+}
+
+void Sbar_Init (void)
+{
+}
+
+void M_Init (void)
+{
+}
+
+void M_Keydown (int key)
+{
+}
+
+void M_ToggleMenu_f (void)
+{
+}
+
+void M_Menu_Main_f (void)
+{
+}
+
+void M_Menu_Quit_f (void)
+{
+}
+
+void Draw_Init (void)
+{
+}
+
+void Draw_Character (int x, int y, int num)
+{
+}
+
+void Draw_String (int x, int y, char *str)
+{
+}
+
+void Draw_ConsoleBackground (int lines)
+{
+}
+
+void Draw_BeginDisc (void)
+{
+}
+
+void Draw_EndDisc (void)
+{
+}
+
+void D_FlushCaches (void)
+{
+}
+
+void VID_Init (unsigned char *palette)
+{
+}
+
+void VID_Shutdown (void)
+{
+}
+
+void R_Init (void)
+{
+}
+
+void R_InitSky (texture_t *mt)
+{
+}
+
+/*
+==================
+R_InitTextures
+
+Brush models without a texture point at this, so the server needs it too.
+==================
+*/
+void R_InitTextures (void)
+{
+	r_notexture_mip = Hunk_AllocName (sizeof(texture_t) + 16*16+8*8+4*4+2*2, "notexture");
+
+	r_notexture_mip->width = r_notexture_mip->height = 16;
+	r_notexture_mip->offsets[0] = sizeof(texture_t);
+	r_notexture_mip->offsets[1] = r_notexture_mip->offsets[0] + 16*16;
+	r_notexture_mip->offsets[2] = r_notexture_mip->offsets[1] + 8*8;
+	r_notexture_mip->offsets[3] = r_notexture_mip->offsets[2] + 4*4;
+}
+
+void S_Init (void)
+{
+}
+
+void S_Shutdown (void)
+{
+}
+
+void S_Update (vec3_t origin, vec3_t forward, vec3_t right, vec3_t up)
+{
+}
+
+void S_LocalSound (char *sound)
+{
+}
+
+void IN_Init (void)
+{
+}
+
+void IN_Shutdown (void)
+{
+}
+
+void IN_Commands (void)
+{
+}
+
+/*
+==============================================================================
+
+VIEW
+
+Player movement rolls the view on the server as well, so V_CalcRoll and its
+cvars stay real.
+
+==============================================================================
+*/
+
+cvar_t	cl_rollspeed = {"cl_rollspeed", "200"};
+cvar_t	cl_rollangle = {"cl_rollangle", "2.0"};
+
+void V_Init (void)
+{
+	Cvar_RegisterVariable (&cl_rollspeed);
+	Cvar_RegisterVariable (&cl_rollangle);
+}
+
+float V_CalcRoll (vec3_t angles, vec3_t velocity)
+{
+	vec3_t	forward, right, up;
+	float	sign;
+	float	side;
+	float	value;
+
+	AngleVectors (angles, forward, right, up);
+	side = DotProduct (velocity, right);
+	sign = side < 0 ? -1 : 1;
+	side = fabs(side);
+
+	value = cl_rollangle.value;
+
+	if (side < cl_rollspeed.value)
+		side = side * value / cl_rollspeed.value;
+	else
+		side = value;
+
+	return side*sign;
+}
+
+#elif defined(Q2)
+#include "../qcommon/qcommon.h"
+
+void CL_Init (void)
+{
+}
+
+void CL_Drop (void)
+{
+}
+
+void CL_Shutdown (void)
+{
+}
+
+void CL_Frame (int msec)
+{
+}
+
+void Con_Print (char *text)
+{
+}
+
+void Cmd_ForwardToServer (void)
+{
+	char	*cmd;
+
+	cmd = Cmd_Argv(0);
+	Com_Printf ("Unknown command \"%s\"\n", cmd);
+}
+
+void SCR_DebugGraph (float value, int color)
+{
+}
+
+void SCR_BeginLoadingPlaque (void)
+{
+}
+
+void SCR_EndLoadingPlaque (void)
+{
+}
+
+void Key_Init (void)
+{
+}
+#endif
@@ -0,0 +1,645 @@
+/*
+Copyright (C) 1996-1997 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+// sys_ded.c -- system driver for the dedicated server build: stdin/stdout
+// console, no video, sound or input, and a main loop that sleeps in the
+// network layer until the next packet or server tic
+
+#define _GNU_SOURCE		// pread and usleep under --std=c9x
+
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/select.h>
+#include <dirent.h>
+#include <fnmatch.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <ctype.h>
+#include <errno.h>
+#include <unistd.h>
+#include <stdint.h>
+
+#ifdef Q1
+#include "quakedef.h"
+#elif defined(Q2)
+#include "../qcommon/qcommon.h"
+#include "game.h"
+#endif
+
+qboolean	stdin_active = true;
+
+#ifdef Q2
+unsigned	sys_frame_time;
+int			curtime;
+#endif
+
+/*
+===============================================================================
+
+FILE IO
+
+===============================================================================
+*/
+
+#define MAX_HANDLES		10
+FILE	*sys_handles[MAX_HANDLES];
+
+int findhandle (void)
+{
+	int		i;
+
+	for (i=1 ; i<MAX_HANDLES ; i++)
+		if (!sys_handles[i])
+			return i;
+	Sys_Error ("out of handles");
+	return -1;
+}
+
+/*
+================
+filelength
+================
+*/
+int filelength (FILE *f)
+{
+	int		pos;
+	int		end;
+
+	pos = ftell (f);
+	fseek (f, 0, SEEK_END);
+	end = ftell (f);
+	fseek (f, pos, SEEK_SET);
+
+	return end;
+}
+
+int Sys_FileOpenRead (char *path, int *hndl)
+{
+	FILE	*f;
+	int		i;
+
+	i = findhandle ();
+
+	f = fopen(path, "rb");
+	if (!f)
+	{
+		*hndl = -1;
+		return -1;
+	}
+	sys_handles[i] = f;
+	*hndl = i;
+
+	return filelength(f);
+}
+
+int Sys_FileOpenWrite (char *path)
+{
+	FILE	*f;
+	int		i;
+
+	i = findhandle ();
+
+	f = fopen(path, "wb");
+	if (!f)
+		Sys_Error ("Error opening %s: %s", path,strerror(errno));
+	sys_handles[i] = f;
+
+	return i;
+}
+
+void Sys_FileClose (int handle)
+{
+	fclose (sys_handles[handle]);
+	sys_handles[handle] = NULL;
+}
+
+void Sys_FileSeek (int handle, int position)
+{
+	fseek (sys_handles[handle], position, SEEK_SET);
+}
+
+int Sys_FileRead (int handle, void *dest, int count)
+{
+	return fread (dest, 1, count, sys_handles[handle]);
+}
+
+int Sys_FileReadAt (int handle, int position, void *dest, int count)
+{
+	return pread (fileno (sys_handles[handle]), dest, count, position);
+}
+
+byte *Sys_FileMap (int handle, int length)
+{
+	void	*base;
+
+	base = mmap (NULL, length, PROT_READ, MAP_SHARED, fileno (sys_handles[handle]), 0);
+	return base == MAP_FAILED ? NULL : base;
+}
+
+int Sys_FileWrite (int handle, void *data, int count)
+{
+	return fwrite (data, 1, count, sys_handles[handle]);
+}
+
+int Sys_FileTime (char *path)
+{
+	struct stat	buf;
+
+	if (stat (path, &buf) == -1)
+		return -1;
+
+	return buf.st_mtime;
+}
+
+void Sys_mkdir (char *path)
+{
+	mkdir (path, 0777);
+}
+
+/*
+===============================================================================
+
+SYSTEM IO
+
+===============================================================================
+*/
+
+void Sys_MakeCodeWriteable (unsigned long startaddr, unsigned long length)
+{
+}
+
+void Sys_HighFPPrecision (void)
+{
+}
+
+void Sys_LowFPPrecision (void)
+{
+}
+
+void Sys_SendKeyEvents (void)
+{
+#ifdef Q2
+	// grab frame time
+	sys_frame_time = Sys_Milliseconds ();
+#endif
+}
+
+void Sys_Printf (char *fmt, ...)
+{
+	va_list		argptr;
+
+	va_start (argptr,fmt);
+	vprintf (fmt,argptr);
+	va_end (argptr);
+	fflush (stdout);
+}
+
+void Sys_Error (char *error, ...)
+{
+	va_list		argptr;
+	char		string[1024];
+
+	va_start (argptr,error);
+	vsnprintf (string,sizeof(string),error,argptr);
+	va_end (argptr);
+	fprintf (stderr, "Error: %s\n", string);
+
+#ifdef Q1
+	Host_Shutdown ();
+#elif defined(Q2)
+	CL_Shutdown ();
+	Qcommon_Shutdown ();
+#endif
+	exit (1);
+}
+
+void Sys_Quit (void)
+{
+#ifdef Q1
+	Host_Shutdown ();
+#elif defined(Q2)
+	CL_Shutdown ();
+	Qcommon_Shutdown ();
+#endif
+	exit (0);
+}
+
+double Sys_FloatTime (void)
+{
+	struct timeval	tp;
+	static int		secbase;
+
+	gettimeofday (&tp, NULL);
+
+	if (!secbase)
+	{
+		secbase = tp.tv_sec;
+		return tp.tv_usec/1000000.0;
+	}
+
+	return (tp.tv_sec - secbase) + tp.tv_usec/1000000.0;
+}
+
+void Sys_Sleep (void)
+{
+	usleep (1000);
+}
+
+/*
+================
+Sys_ConsoleInput
+
+Returns one line typed on stdin, or NULL if none is waiting.  Never blocks.
+================
+*/
+char *Sys_ConsoleInput (void)
+{
+	static char	text[256];
+	int			len;
+	fd_set		fdset;
+	struct timeval	timeout;
+
+#ifdef Q1
+	if (cls.state != ca_dedicated)
+		return NULL;
+#elif defined(Q2)
+	if (!dedicated || !dedicated->value)
+		return NULL;
+#endif
+	if (!stdin_active)
+		return NULL;
+
+	FD_ZERO (&fdset);
+	FD_SET (0, &fdset); // stdin
+	timeout.tv_sec = 0;
+	timeout.tv_usec = 0;
+	if (select (1, &fdset, NULL, NULL, &timeout) == -1 || !FD_ISSET(0, &fdset))
+		return NULL;
+
+	len = read (0, text, sizeof(text));
+	if (len == 0)
+	{	// eof, stop watching a closed stdin
+		stdin_active = false;
+		return NULL;
+	}
+	if (len < 1)
+		return NULL;
+	text[len-1] = 0;	// rip off the /n and terminate
+
+	return text;
+}
+
+/*
+===============================================================================
+
+WORKER THREADS
+
+The same job model as the SDL driver, on posix threads and semaphores.
+
+===============================================================================
+*/
+
+#ifndef MAX_WORKERS
+#define MAX_WORKERS		15
+#endif
+
+static int		sys_numworkers = -1;
+static sem_t	sys_jobstart, sys_jobdone;
+static int		sys_jobnext;
+static int		sys_jobcount;
+static void		(*sys_job) (int index, int thread);
+
+static void Sys_TakeJobs (int thread)
+{
+	int		i;
+
+	while ((i = __sync_fetch_and_add (&sys_jobnext, 1)) < sys_jobcount)
+		sys_job (i, thread);
+}
+
+static void *Sys_WorkerThread (void *data)
+{
+	while (1)
+	{
+		while (sem_wait (&sys_jobstart) == -1)
+			;
+		Sys_TakeJobs ((int)(intptr_t)data);
+		sem_post (&sys_jobdone);
+	}
+	return NULL;
+}
+
+int Sys_NumWorkers (void)
+{
+	pthread_t	thread;
+	int			i;
+
+	if (sys_numworkers >= 0)
+		return sys_numworkers;
+
+	sys_numworkers = sysconf (_SC_NPROCESSORS_ONLN) - 1;
+	if (sys_numworkers > MAX_WORKERS)
+		sys_numworkers = MAX_WORKERS;
+	if (sys_numworkers <= 0)
+	{
+		sys_numworkers = 0;
+		return 0;
+	}
+
+	sem_init (&sys_jobstart, 0, 0);
+	sem_init (&sys_jobdone, 0, 0);
+	for (i=0 ; i<sys_numworkers ; i++)
+	{
+		if (pthread_create (&thread, NULL, Sys_WorkerThread, (void *)(intptr_t)(i+1)))
+			break;
+		pthread_detach (thread);
+	}
+	sys_numworkers = i;
+	return sys_numworkers;
+}
+
+void Sys_RunJobs (int count, void (*job) (int index, int thread))
+{
+	int		i, workers;
+
+	workers = Sys_NumWorkers ();
+	if (workers > count - 1)
+		workers = count - 1;	// the main thread takes one itself
+
+	sys_job = job;
+	sys_jobcount = count;
+	__sync_lock_test_and_set (&sys_jobnext, 0);
+
+	for (i=0 ; i<workers ; i++)
+		sem_post (&sys_jobstart);
+	Sys_TakeJobs (0);
+	for (i=0 ; i<workers ; i++)
+		while (sem_wait (&sys_jobdone) == -1)
+			;
+}
+
+static pthread_mutex_t	sys_hostlock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t	sys_memlock = PTHREAD_MUTEX_INITIALIZER;
+
+static void *Sys_RunThread (void *data)
+{
+	((void (*) (void))data) ();
+	return NULL;
+}
+
+qboolean Sys_StartThread (void (*func) (void))
+{
+	pthread_t	thread;
+
+	if (pthread_create (&thread, NULL, Sys_RunThread, (void *)func))
+		return false;
+	pthread_detach (thread);
+	return true;
+}
+
+void Sys_LockHost (void)
+{
+	pthread_mutex_lock (&sys_hostlock);
+}
+
+void Sys_UnlockHost (void)
+{
+	pthread_mutex_unlock (&sys_hostlock);
+}
+
+void Sys_LockMem (void)
+{
+	pthread_mutex_lock (&sys_memlock);
+}
+
+void Sys_UnlockMem (void)
+{
+	pthread_mutex_unlock (&sys_memlock);
+}
+
+#ifdef Q2
+/*
+===============================================================================
+
+QUAKE II SYSTEM
+
+===============================================================================
+*/
+
+
+void Sys_Init (void)
+{
+}
+
+void Sys_AppActivate (void)
+{
+}
+
+char *Sys_GetClipboardData (void)
+{
+	return NULL;
+}
+
+void Sys_ConsoleOutput (char *string)
+{
+	fputs (string, stdout);
+	fflush (stdout);
+}
+
+int Sys_Milliseconds (void)
+{
+	struct timeval	tp;
+	static int		secbase;
+
+	gettimeofday (&tp, NULL);
+
+	if (!secbase)
+	{
+		secbase = tp.tv_sec;
+		return tp.tv_usec/1000;
+	}
+
+	curtime = (tp.tv_sec - secbase)*1000 + tp.tv_usec/1000;
+
+	return curtime;
+}
+
+void Sys_Mkdir (char *path)
+{
+	mkdir (path, 0777);
+}
+
+char *strlwr (char *s)
+{
+	char	*p = s;
+
+	while (*s)
+	{
+		*s = tolower(*s);
+		s++;
+	}
+	return p;
+}
+
+void *Sys_GetGameAPI (void *parms)
+{
+	return GetGameAPI (parms);
+}
+
+//============================================
+
+static char	findbase[MAX_OSPATH];
+static char	findpath[MAX_OSPATH];
+static char	findpattern[MAX_OSPATH];
+static DIR	*fdir;
+
+static char *Sys_FindMatch (void)
+{
+	struct dirent	*d;
+
+	while ((d = readdir (fdir)) != NULL)
+	{
+		// . and .. never match
+		if (!strcmp (d->d_name, ".") || !strcmp (d->d_name, ".."))
+			continue;
+		if (*findpattern && fnmatch (findpattern, d->d_name, 0))
+			continue;
+		Com_sprintf (findpath, sizeof(findpath), "%s/%s", findbase, d->d_name);
+		return findpath;
+	}
+	return NULL;
+}
+
+char *Sys_FindFirst (char *path, unsigned musthave, unsigned canhave)
+{
+	char	*p;
+
+	if (fdir)
+		Sys_Error ("Sys_BeginFind without close");
+
+	strcpy (findbase, path);
+
+	if ((p = strrchr (findbase, '/')) != NULL)
+	{
+		*p = 0;
+		strcpy (findpattern, p + 1);
+	}
+	else
+		strcpy (findpattern, "*");
+
+	if (strcmp (findpattern, "*.*") == 0)
+		strcpy (findpattern, "*");
+
+	if ((fdir = opendir (findbase)) == NULL)
+		return NULL;
+	return Sys_FindMatch ();
+}
+
+char *Sys_FindNext (unsigned musthave, unsigned canhave)
+{
+	if (fdir == NULL)
+		return NULL;
+	return Sys_FindMatch ();
+}
+
+void Sys_FindClose (void)
+{
+	if (fdir != NULL)
+		closedir (fdir);
+	fdir = NULL;
+}
+
+#endif
+
+//=============================================================================
+
+#ifdef Q1
+int main (int argc, char **argv)
+{
+	static quakeparms_t	parms;
+	double		time, oldtime, newtime;
+	int			j;
+
+	COM_InitArgv (argc, argv);
+
+	parms.memsize = 8*1024*1024;
+	j = COM_CheckParm ("-mem");
+	if (j && j + 1 < com_argc)
+		parms.memsize = (int) (Q_atof(com_argv[j+1]) * 1024 * 1024);
+	parms.membase = malloc (parms.memsize);
+	if (!parms.membase)
+		Sys_Error ("Not enough memory free; check disk space\n");
+	parms.basedir = ".";
+
+	parms.argc = com_argc;
+	parms.argv = com_argv;
+
+	Host_Init (&parms);
+
+	oldtime = Sys_FloatTime () - sys_ticrate.value;
+	while (1)
+	{
+		newtime = Sys_FloatTime ();
+		time = newtime - oldtime;
+
+		if (time < sys_ticrate.value)
+		{	// not time to run a server only tic yet, wait in the network
+			// layer, which queues anything that arrives meanwhile
+			if (!NET_Sleep ((int)((sys_ticrate.value - time) * 1000) + 1))
+				Sys_Sleep ();
+			continue;
+		}
+		time = sys_ticrate.value;
+
+		if (newtime - oldtime > sys_ticrate.value*2)
+			oldtime = newtime;
+		else
+			oldtime += time;
+
+		Host_Frame (time);
+	}
+	return 0;
+}
+#elif defined(Q2)
+int main (int argc, char **argv)
+{
+	int		time, oldtime, newtime;
+
+	Qcommon_Init (argc, argv);
+
+	oldtime = Sys_Milliseconds ();
+	while (1)
+	{
+		// SV_Frame sleeps in NET_Sleep until the next server frame or
+		// packet, so this only waits out the clock granularity
+		do
+		{
+			newtime = Sys_Milliseconds ();
+			time = newtime - oldtime;
+			if (time < 1)
+				NET_Sleep (1);
+		} while (time < 1);
+		Qcommon_Frame (time);
+		oldtime = newtime;
+	}
+	return 0;
+}
+#endif
@@ -19,6 +19,11 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 */
 // sys_null.h -- null system driver to aid porting efforts
 
+#define _GNU_SOURCE		// pread under --std=c9x
+
+#include <unistd.h>
+#include <sys/mman.h>
+
 #include "quakedef.h"
 #include "errno.h"
 
@@ -112,6 +117,19 @@ int Sys_FileRead (int handle, void *dest, int count)
 	return fread (dest, 1, count, sys_handles[handle]);
 }
 
+int Sys_FileReadAt (int handle, int position, void *dest, int count)
+{
+	return pread (fileno (sys_handles[handle]), dest, count, position);
+}
+
+byte *Sys_FileMap (int handle, int length)
+{
+	void	*base;
+
+	base = mmap (NULL, length, PROT_READ, MAP_SHARED, fileno (sys_handles[handle]), 0);
+	return base == MAP_FAILED ? NULL : base;
+}
+
 int Sys_FileWrite (int handle, void *data, int count)
 {
 	return fwrite (data, 1, count, sys_handles[handle]);
@@ -198,6 +216,40 @@ void Sys_SendKeyEvents (void)
 {
 }
 
+int Sys_NumWorkers (void)
+{
+	return 0;
+}
+
+void Sys_RunJobs (int count, void (*job) (int index, int thread))
+{
+	int		i;
+
+	for (i=0 ; i<count ; i++)
+		job (i, 0);
+}
+
+qboolean Sys_StartThread (void (*func) (void))
+{
+	return false;
+}
+
+void Sys_LockHost (void)
+{
+}
+
+void Sys_UnlockHost (void)
+{
+}
+
+void Sys_LockMem (void)
+{
+}
+
+void Sys_UnlockMem (void)
+{
+}
+
 void Sys_HighFPPrecision (void)
 {
 }
@@ -521,19 +521,35 @@ void NET_Sleep(int msec)
 {
     struct timeval timeout;
 	fd_set	fdset;
+	int		maxfd;
 	extern cvar_t *dedicated;
 	extern qboolean stdin_active;
 
-	if (!ip_sockets[NS_SERVER] || (dedicated && !dedicated->value))
+	if (dedicated && !dedicated->value)
 		return; // we're not a server, just run full speed
 
 	FD_ZERO(&fdset);
-	// if (stdin_active)
-	// 	FD_SET(0, &fdset); // stdin is processed too
-	FD_SET(ip_sockets[NS_SERVER], &fdset); // network socket
+	maxfd = -1;
+#ifdef DEDICATED_ONLY
+	// the dedicated build has a console on stdin, and waits on it alone
+	// until a map opens the server socket
+	if (stdin_active)
+	{
+		FD_SET(0, &fdset); // stdin is processed too
+		maxfd = 0;
+	}
+#endif
+	if (ip_sockets[NS_SERVER])
+	{
+		FD_SET(ip_sockets[NS_SERVER], &fdset); // network socket
+		if (ip_sockets[NS_SERVER] > maxfd)
+			maxfd = ip_sockets[NS_SERVER];
+	}
+	if (maxfd == -1)
+		return; // we're not a server, just run full speed
 	timeout.tv_sec = msec/1000;
 	timeout.tv_usec = (msec%1000)*1000;
-	select(ip_sockets[NS_SERVER]+1, &fdset, NULL, NULL, &timeout);
+	select(maxfd+1, &fdset, NULL, NULL, &timeout);
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,319 @@
+/*
+Copyright (C) 1997-2001 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+// q_shlinux.c -- hunk memory and pak file access for the sdl and dedicated backends
+#ifdef Q2
+
+#define _GNU_SOURCE		// MAP_ANONYMOUS and fopencookie under --std=c9x
+
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "../qcommon/qcommon.h"
+
+/*
+===============================================================================
+
+HUNKS
+
+Hunk_Begin only reserves address space.  Pages are committed in
+HUNK_COMMIT sized steps as Hunk_Alloc reaches them, and Hunk_End gives back
+everything past the last one used, so a model that asks for 16 megs and
+fills 200k only ever costs 200k.  Fresh pages come from the kernel zero
+filled, as the old memset made them.
+
+Each hunk starts with a header ahead of the memory handed out, which keeps
+it on the list for hunkstats and tells Hunk_Free how much to unmap.
+
+===============================================================================
+*/
+
+#define	HUNK_COMMIT		0x10000
+#define	HUNK_HEADER		64		// keeps the data on a cacheline
+
+typedef struct hunkheader_s
+{
+	struct hunkheader_s	*prev, *next;
+	int			reserved;		// mapped, including the header
+	int			committed;		// readable and writable, including the header
+	int			used;
+	int			maxsize;
+} hunkheader_t;
+
+int		hunkcount;
+
+static hunkheader_t	hunk_list = {&hunk_list, &hunk_list};
+static hunkheader_t	*hunk;			// the one being filled
+static int			hunk_pagesize;
+
+static int Hunk_RoundPage (int size)
+{
+	return (size + hunk_pagesize - 1) & ~(hunk_pagesize - 1);
+}
+
+void *Hunk_Begin (int maxsize)
+{
+	byte	*base;
+	int		reserve;
+
+	if (!hunk_pagesize)
+		hunk_pagesize = sysconf (_SC_PAGESIZE);
+
+	// reserve a huge chunk of memory, but don't commit any yet
+	reserve = Hunk_RoundPage (maxsize + HUNK_HEADER);
+	base = mmap (NULL, reserve, PROT_NONE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+	if (base == MAP_FAILED)
+		Sys_Error ("Hunk_Begin: reserve of %i bytes failed", maxsize);
+	if (mprotect (base, hunk_pagesize, PROT_READ|PROT_WRITE))
+		Sys_Error ("Hunk_Begin: commit failed");
+
+	hunk = (hunkheader_t *)base;
+	hunk->reserved = reserve;
+	hunk->committed = hunk_pagesize;
+	hunk->used = 0;
+	hunk->maxsize = maxsize;
+	Mem_Alloced ("hunk", "models", hunk->committed);
+
+	hunk->next = hunk_list.next;
+	hunk->prev = &hunk_list;
+	hunk_list.next->prev = hunk;
+	hunk_list.next = hunk;
+
+	return (void *)(base + HUNK_HEADER);
+}
+
+void *Hunk_Alloc (int size)
+{
+	int		need, commit;
+
+	// round to cacheline
+	size = (size+31)&~31;
+
+	if (hunk->used + size > hunk->maxsize)
+		Sys_Error ("Hunk_Alloc overflow");
+	hunk->used += size;
+
+	// commit pages as needed
+	need = HUNK_HEADER + hunk->used;
+	if (need > hunk->committed)
+	{
+		commit = (need + HUNK_COMMIT - 1) & ~(HUNK_COMMIT - 1);
+		if (commit > hunk->reserved)
+			commit = hunk->reserved;
+		if (mprotect ((byte *)hunk + hunk->committed, commit - hunk->committed, PROT_READ|PROT_WRITE))
+			Sys_Error ("Hunk_Alloc: commit of %i bytes failed", commit - hunk->committed);
+		Mem_Adjust ("hunk", "models", commit - hunk->committed);
+		hunk->committed = commit;
+	}
+
+	return (void *)((byte *)hunk + HUNK_HEADER + hunk->used - size);
+}
+
+int Hunk_End (void)
+{
+	int		keep;
+
+	// free the remaining unused virtual memory
+	keep = Hunk_RoundPage (HUNK_HEADER + hunk->used);
+	if (keep < hunk->reserved)
+	{
+		munmap ((byte *)hunk + keep, hunk->reserved - keep);
+		hunk->reserved = keep;
+		if (hunk->committed > keep)
+		{
+			Mem_Adjust ("hunk", "models", keep - hunk->committed);
+			hunk->committed = keep;
+		}
+	}
+
+	hunkcount++;
+	return hunk->used;
+}
+
+void Hunk_Free (void *base)
+{
+	hunkheader_t	*h;
+
+	if (base)
+	{
+		h = (hunkheader_t *)((byte *)base - HUNK_HEADER);
+		h->prev->next = h->next;
+		h->next->prev = h->prev;
+		if (h == hunk)
+			hunk = NULL;
+		Mem_Freed ("hunk", "models", h->committed);
+		munmap (h, h->reserved);
+	}
+
+	hunkcount--;
+}
+
+/*
+================
+Hunk_Stats_f
+================
+*/
+void Hunk_Stats_f (void)
+{
+	hunkheader_t	*h;
+	int				count, reserved, committed, used;
+
+	count = reserved = committed = used = 0;
+	Com_Printf ("  reserved committed      used\n");
+	for (h = hunk_list.next ; h != &hunk_list ; h = h->next)
+	{
+		Com_Printf ("%10i %9i %9i\n", h->reserved, h->committed, h->used);
+		count++;
+		reserved += h->reserved;
+		committed += h->committed;
+		used += h->used;
+	}
+	Com_Printf ("%i hunks, %i reserved, %i committed, %i used\n", count, reserved, committed, used);
+}
+
+//===========================================================================
+
+/*
+================
+Sys_ReadAt
+
+Reads len bytes at offset without touching the stream's position.
+Returns the number of bytes read, which is only short at the end of the file.
+================
+*/
+int Sys_ReadAt (FILE *f, int offset, void *buffer, int len)
+{
+	byte	*buf;
+	int		r, total;
+
+	buf = (byte *)buffer;
+	for (total = 0 ; total < len ; total += r)
+	{
+		r = pread (fileno (f), buf + total, len - total, offset + total);
+		if (r <= 0)
+			break;
+	}
+	return total;
+}
+
+/*
+================
+Sys_MapFile
+================
+*/
+void *Sys_MapFile (FILE *f, int len)
+{
+	void	*base;
+
+	if (len <= 0)
+		return NULL;
+	base = mmap (NULL, len, PROT_READ, MAP_SHARED, fileno (f), 0);
+	return base == MAP_FAILED ? NULL : base;
+}
+
+/*
+================
+Sys_UnmapFile
+================
+*/
+void Sys_UnmapFile (void *base, int len)
+{
+	munmap (base, len);
+}
+
+/*
+===============================================================================
+
+STREAMS
+
+===============================================================================
+*/
+
+typedef struct
+{
+	void	*stream;
+	int		(*read) (void *stream, char *buf, int len);
+	int		(*seek) (void *stream, int offset, int whence);
+	void	(*close) (void *stream);
+} sysstream_t;
+
+static ssize_t Sys_StreamRead (void *cookie, char *buf, size_t size)
+{
+	sysstream_t	*s;
+
+	s = (sysstream_t *)cookie;
+	if (size > 0x40000000)
+		size = 0x40000000;
+	return s->read (s->stream, buf, (int)size);
+}
+
+static int Sys_StreamSeek (void *cookie, off64_t *offset, int whence)
+{
+	sysstream_t	*s;
+	int			pos;
+
+	s = (sysstream_t *)cookie;
+	pos = s->seek (s->stream, (int)*offset, whence);
+	if (pos < 0)
+		return -1;
+	*offset = pos;
+	return 0;
+}
+
+static int Sys_StreamClose (void *cookie)
+{
+	sysstream_t	*s;
+
+	s = (sysstream_t *)cookie;
+	s->close (s->stream);
+	free (s);
+	return 0;
+}
+
+/*
+================
+Sys_OpenStream
+================
+*/
+FILE *Sys_OpenStream (void *stream, int (*read) (void *stream, char *buf, int len),
+	int (*seek) (void *stream, int offset, int whence), void (*close) (void *stream))
+{
+	cookie_io_functions_t	io;
+	sysstream_t				*s;
+	FILE					*f;
+
+	s = malloc (sizeof(*s));
+	if (!s)
+		return NULL;
+	s->stream = stream;
+	s->read = read;
+	s->seek = seek;
+	s->close = close;
+
+	io.read = Sys_StreamRead;
+	io.write = NULL;
+	io.seek = Sys_StreamSeek;
+	io.close = Sys_StreamClose;
+	f = fopencookie (s, "rb", io);
+	if (!f)
+		free (s);
+	return f;
+}
+
+#endif
@@ -19,8 +19,12 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 */
 // sys_null.h -- null system driver to aid porting efforts
 
+#define _GNU_SOURCE // pread under --std=c9x
+
 #include <SDL2/SDL.h>
+#include <sys/mman.h>
 #include <sys/time.h>
+#include <unistd.h>
 
 #include "errno.h"
 #ifdef Q1
@@ -122,6 +126,19 @@ int Sys_FileRead(int handle, void *dest, int count)
     return fread(dest, 1, count, sys_handles[handle]);
 }
 
+int Sys_FileReadAt(int handle, int position, void *dest, int count)
+{
+    return pread(fileno(sys_handles[handle]), dest, count, position);
+}
+
+byte *Sys_FileMap(int handle, int length)
+{
+    void *base;
+
+    base = mmap(NULL, length, PROT_READ, MAP_SHARED, fileno(sys_handles[handle]), 0);
+    return base == MAP_FAILED ? NULL : base;
+}
+
 int Sys_FileWrite(int handle, void *data, int count)
 {
     return fwrite(data, 1, count, sys_handles[handle]);
@@ -207,6 +224,140 @@ double Sys_FloatTime(void)
 char *Sys_ConsoleInput(void) { return NULL; }
 
 void Sys_Sleep(void) { SDL_Delay(1); }
+
+/*
+===============================================================================
+
+WORKER THREADS
+
+The workers are started the first time they are asked for and then sleep
+on a semaphore.  Sys_RunJobs wakes all of them, and they and the main
+thread take job indexes off a shared counter until none are left.
+
+===============================================================================
+*/
+
+#ifndef MAX_WORKERS
+#define MAX_WORKERS 15
+#endif
+
+static int sys_numworkers = -1;
+static SDL_sem *sys_jobstart, *sys_jobdone;
+static SDL_atomic_t sys_jobnext;
+static int sys_jobcount;
+static void (*sys_job)(int index, int thread);
+
+static void Sys_TakeJobs(int thread)
+{
+    int i;
+
+    while ((i = SDL_AtomicAdd(&sys_jobnext, 1)) < sys_jobcount)
+        sys_job(i, thread);
+}
+
+static int Sys_WorkerThread(void *data)
+{
+    while (1)
+    {
+        SDL_SemWait(sys_jobstart);
+        Sys_TakeJobs((int)(intptr_t)data);
+        SDL_SemPost(sys_jobdone);
+    }
+    return 0;
+}
+
+int Sys_NumWorkers(void)
+{
+    int i;
+
+    if (sys_numworkers >= 0)
+        return sys_numworkers;
+
+    sys_numworkers = SDL_GetCPUCount() - 1;
+    if (sys_numworkers > MAX_WORKERS)
+        sys_numworkers = MAX_WORKERS;
+    if (sys_numworkers <= 0)
+    {
+        sys_numworkers = 0;
+        return 0;
+    }
+
+    sys_jobstart = SDL_CreateSemaphore(0);
+    sys_jobdone = SDL_CreateSemaphore(0);
+    for (i = 0; i < sys_numworkers; i++)
+    {
+        if (!SDL_CreateThread(Sys_WorkerThread, "worker",
+                              (void *)(intptr_t)(i + 1)))
+            break;
+    }
+    sys_numworkers = i;
+    return sys_numworkers;
+}
+
+void Sys_RunJobs(int count, void (*job)(int index, int thread))
+{
+    int i, workers;
+
+    workers = Sys_NumWorkers();
+    if (workers > count - 1)
+        workers = count - 1; // the main thread takes one itself
+
+    sys_job = job;
+    sys_jobcount = count;
+    SDL_AtomicSet(&sys_jobnext, 0);
+
+    for (i = 0; i < workers; i++)
+        SDL_SemPost(sys_jobstart);
+    Sys_TakeJobs(0);
+    for (i = 0; i < workers; i++)
+        SDL_SemWait(sys_jobdone);
+}
+
+static SDL_mutex *sys_hostlock;
+static SDL_mutex *sys_memlock;
+
+static int Sys_RunThread(void *data)
+{
+    ((void (*)(void))data)();
+    return 0;
+}
+
+qboolean Sys_StartThread(void (*func)(void))
+{
+    if (!sys_hostlock)
+        sys_hostlock = SDL_CreateMutex();
+    if (!sys_memlock)
+        sys_memlock = SDL_CreateMutex();
+    if (!sys_hostlock || !sys_memlock)
+        return false;
+    return SDL_CreateThread(Sys_RunThread, "server", (void *)func) != NULL;
+}
+
+// there is nothing to share until a thread has been started
+void Sys_LockHost(void)
+{
+    if (sys_hostlock)
+        SDL_LockMutex(sys_hostlock);
+}
+
+void Sys_UnlockHost(void)
+{
+    if (sys_hostlock)
+        SDL_UnlockMutex(sys_hostlock);
+}
+
+void Sys_LockMem(void)
+{
+    if (sys_memlock)
+        SDL_LockMutex(sys_memlock);
+}
+
+void Sys_UnlockMem(void)
+{
+    if (sys_memlock)
+        SDL_UnlockMutex(sys_memlock);
+}
+
 #ifdef Q2
 int mouse_oldbuttonstate = 0;
 
@@ -1117,80 +1268,6 @@ void Sys_FindClose(void)
 
 char *Sys_GetClipboardData(void) { return NULL; }
 #endif
-int hunkcount;
-
-byte *membase;
-int hunkmaxsize;
-int cursize;
-void *Hunk_Begin(int maxsize)
-{
-    // reserve a huge chunk of memory, but don't commit any yet
-    cursize = 0;
-    hunkmaxsize = maxsize;
-#if 0
-	membase = VirtualAlloc (NULL, maxsize, MEM_RESERVE, PAGE_NOACCESS);
-#else
-    membase = malloc(maxsize);
-    memset(membase, 0, maxsize);
-#endif
-    if (!membase)
-        Sys_Error("VirtualAlloc reserve failed");
-    return (void *)membase;
-}
-
-void *Hunk_Alloc(int size)
-{
-    void *buf;
-
-    // round to cacheline
-    size = (size + 31) & ~31;
-
-#if 0
-	// commit pages as needed
-//	buf = VirtualAlloc (membase+cursize, size, MEM_COMMIT, PAGE_READWRITE);
-	buf = VirtualAlloc (membase, cursize+size, MEM_COMMIT, PAGE_READWRITE);
-	if (!buf)
-	{
-		FormatMessage(FORMAT_MESSAGE_ALLOCATE_BUFFER | FORMAT_MESSAGE_FROM_SYSTEM, NULL, GetLastError(), MAKELANGID(LANG_NEUTRAL, SUBLANG_DEFAULT), (LPTSTR) &buf, 0, NULL);
-		Sys_Error ("VirtualAlloc commit failed.\n%s", buf);
-	}
-#endif
-    cursize += size;
-    if (cursize > hunkmaxsize)
-        Sys_Error("Hunk_Alloc overflow");
-
-    return (void *)(membase + cursize - size);
-}
-
-int Hunk_End(void)
-{
-
-    // free the remaining unused virtual memory
-#if 0
-	void	*buf;
-
-	// write protect it
-	buf = VirtualAlloc (membase, cursize, MEM_COMMIT, PAGE_READONLY);
-	if (!buf)
-		Sys_Error ("VirtualAlloc commit failed");
-#endif
-
-    hunkcount++;
-    // Com_Printf ("hunkcount: %i\n", hunkcount);
-    return cursize;
-}
-
-void Hunk_Free(void *base)
-{
-    if (base)
-#if 0
-		VirtualFree (base, 0, MEM_RELEASE);
-#else
-        free(base);
-#endif
-
-    hunkcount--;
-}
 
 void SNDDMA_BeginPainting(void) {}
 
@@ -0,0 +1,413 @@
+/*
+Copyright (C) 1997-2001 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+// pakz.c -- turns quake 2 paks into block compressed PAKZ paks and back,
+// and times reading them
+//
+// cc -O2 -I../../../c9x/q2src/qcommon -o pakz pakz.c ../../../c9x/q2src/qcommon/lz.c
+//
+// pakz <in.pak> <out.pak>		compress
+// pakz -x <in.pak> <out.pak>	uncompress back to a stored pak
+// pakz -test <pak> [passes]	unpack everything, checking it, and time it
+//
+// The format is described in q2src/qcommon/qfiles.h.  Every file is cut
+// into PAKZ_BLOCKSIZE blocks compressed on their own, and kept stored when
+// compressing doesn't make it smaller, as jpgs and the like won't.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <time.h>
+
+typedef unsigned char byte;
+
+#include "qfiles.h"
+#include "lz.h"
+
+// a pak of either kind, in memory
+typedef struct
+{
+	byte		*data;
+	int			len;
+	int			compressed;
+	int			numfiles;
+	dpakzfile_t	files[MAX_FILES_IN_PACK];	// complen 0 for a stored pak
+} pak_t;
+
+/*
+================
+Error
+================
+*/
+void Error (char *error, ...)
+{
+	va_list	argptr;
+
+	printf ("************ ERROR ************\n");
+
+	va_start (argptr, error);
+	vprintf (error, argptr);
+	va_end (argptr);
+	printf ("\n");
+	exit (1);
+}
+
+int LittleLong (int l)
+{
+	byte	*b;
+
+	b = (byte *)&l;
+	return b[0] + (b[1]<<8) + (b[2]<<16) + ((unsigned)b[3]<<24);
+}
+
+// file positions in a pak aren't aligned
+int GetLong (byte *p)
+{
+	return p[0] + (p[1]<<8) + (p[2]<<16) + ((unsigned)p[3]<<24);
+}
+
+void PutLong (byte *p, int l)
+{
+	p[0] = l;
+	p[1] = l>>8;
+	p[2] = l>>16;
+	p[3] = (unsigned)l>>24;
+}
+
+double Seconds (void)
+{
+	struct timespec	ts;
+
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/*
+================
+LoadFile
+================
+*/
+byte *LoadFile (char *filename, int *len)
+{
+	FILE	*f;
+	byte	*buf;
+
+	f = fopen (filename, "rb");
+	if (!f)
+		Error ("Couldn't open %s", filename);
+	fseek (f, 0, SEEK_END);
+	*len = ftell (f);
+	fseek (f, 0, SEEK_SET);
+	buf = malloc (*len + 1);
+	if (!buf || fread (buf, 1, *len, f) != *len)
+		Error ("Couldn't read %s", filename);
+	fclose (f);
+	return buf;
+}
+
+/*
+================
+LoadPak
+================
+*/
+void LoadPak (char *filename, pak_t *pak)
+{
+	dpackheader_t	*header;
+	dpackfile_t		*pf;
+	dpakzfile_t		*zf;
+	int				i, dirofs, dirlen, size;
+
+	pak->data = LoadFile (filename, &pak->len);
+	if (pak->len < sizeof(dpackheader_t))
+		Error ("%s is not a packfile", filename);
+	header = (dpackheader_t *)pak->data;
+	if (LittleLong (header->ident) == IDPAKHEADER)
+		pak->compressed = 0;
+	else if (LittleLong (header->ident) == IDPAKZHEADER)
+		pak->compressed = 1;
+	else
+		Error ("%s is not a packfile", filename);
+
+	dirofs = LittleLong (header->dirofs);
+	dirlen = LittleLong (header->dirlen);
+	size = pak->compressed ? sizeof(dpakzfile_t) : sizeof(dpackfile_t);
+	pak->numfiles = dirlen / size;
+	if (dirofs < 0 || dirlen < 0 || dirofs + dirlen > pak->len || pak->numfiles > MAX_FILES_IN_PACK)
+		Error ("%s has a bad directory", filename);
+
+	for (i=0 ; i<pak->numfiles ; i++)
+	{
+		zf = &pak->files[i];
+		if (pak->compressed)
+		{
+			memcpy (zf, pak->data + dirofs + i*size, size);
+			zf->complen = LittleLong (zf->complen);
+		}
+		else
+		{
+			pf = (dpackfile_t *)(pak->data + dirofs + i*size);
+			memcpy (zf->name, pf->name, sizeof(zf->name));
+			zf->filepos = pf->filepos;
+			zf->filelen = pf->filelen;
+			zf->complen = 0;
+		}
+		zf->name[sizeof(zf->name)-1] = 0;
+		zf->filepos = LittleLong (zf->filepos);
+		zf->filelen = LittleLong (zf->filelen);
+		if (zf->filepos < 0 || zf->filelen < 0 || zf->complen < 0
+			|| zf->filepos + (zf->complen ? zf->complen : zf->filelen) > pak->len)
+			Error ("%s: %s lies outside the pak", filename, zf->name);
+	}
+}
+
+/*
+================
+UnpackFile
+
+Unpacks the file at data into out, returning 0 if it is damaged
+================
+*/
+int UnpackFile (byte *data, dpakzfile_t *zf, byte *out)
+{
+	int		i, numblocks, start, end, rawlen;
+
+	if (!zf->complen)
+	{
+		memcpy (out, data, zf->filelen);
+		return 1;
+	}
+
+	numblocks = (zf->filelen + PAKZ_BLOCKSIZE - 1) / PAKZ_BLOCKSIZE;
+	if ((numblocks+1)*4 > zf->complen || GetLong (data) != (numblocks+1)*4)
+		return 0;
+	for (i=0 ; i<numblocks ; i++)
+	{
+		start = GetLong (data + i*4);
+		end = GetLong (data + i*4 + 4);
+		rawlen = zf->filelen - i*PAKZ_BLOCKSIZE;
+		if (rawlen > PAKZ_BLOCKSIZE)
+			rawlen = PAKZ_BLOCKSIZE;
+		if (end <= start || end - start > rawlen || end > zf->complen)
+			return 0;
+		if (end - start == rawlen)
+			memcpy (out + i*PAKZ_BLOCKSIZE, data + start, rawlen);
+		else if (LZ_Decompress (data + start, end - start, out + i*PAKZ_BLOCKSIZE, rawlen) != rawlen)
+			return 0;
+	}
+	return 1;
+}
+
+/*
+================
+PackFile
+
+Compresses in into out, returning the size of the table and blocks, or 0
+if the file is better off stored
+================
+*/
+int PackFile (byte *in, int len, byte *out)
+{
+	int		i, numblocks, ofs, rawlen, clen;
+	byte	*block;
+
+	numblocks = (len + PAKZ_BLOCKSIZE - 1) / PAKZ_BLOCKSIZE;
+	ofs = (numblocks+1)*4;
+	block = malloc (LZ_BOUND(PAKZ_BLOCKSIZE));
+
+	for (i=0 ; i<numblocks ; i++)
+	{
+		PutLong (out + i*4, ofs);
+		rawlen = len - i*PAKZ_BLOCKSIZE;
+		if (rawlen > PAKZ_BLOCKSIZE)
+			rawlen = PAKZ_BLOCKSIZE;
+		clen = LZ_Compress (in + i*PAKZ_BLOCKSIZE, rawlen, block, rawlen - 1);
+		if (clen)
+			memcpy (out + ofs, block, clen);
+		else
+		{	// stored
+			clen = rawlen;
+			memcpy (out + ofs, in + i*PAKZ_BLOCKSIZE, rawlen);
+		}
+		ofs += clen;
+	}
+	PutLong (out + numblocks*4, ofs);
+
+	free (block);
+	return ofs < len ? ofs : 0;
+}
+
+/*
+================
+WritePak
+================
+*/
+void WritePak (char *filename, pak_t *in, int compress)
+{
+	FILE			*f;
+	dpackheader_t	header;
+	dpakzfile_t		*zf, *out;
+	byte			*buf, *packed, *check;
+	int				i, pos, len, size, stored;
+
+	out = calloc (in->numfiles, sizeof(dpakzfile_t));
+	f = fopen (filename, "wb");
+	if (!f)
+		Error ("Couldn't open %s", filename);
+	memset (&header, 0, sizeof(header));
+	fwrite (&header, 1, sizeof(header), f);
+	pos = sizeof(header);
+
+	stored = 0;
+	for (i=0 ; i<in->numfiles ; i++)
+	{
+		zf = &in->files[i];
+		buf = malloc (zf->filelen + 1);
+		if (!UnpackFile (in->data + zf->filepos, zf, buf))
+			Error ("%s is damaged", zf->name);
+
+		memcpy (out[i].name, zf->name, sizeof(out[i].name));
+		out[i].filepos = pos;
+		out[i].filelen = zf->filelen;
+		out[i].complen = 0;
+		len = zf->filelen;
+		packed = NULL;
+		if (compress && len)
+		{
+			packed = malloc ((len/PAKZ_BLOCKSIZE + 2)*4 + len);
+			out[i].complen = PackFile (buf, len, packed);
+			if (out[i].complen)
+			{	// make sure it comes back
+				check = malloc (len);
+				if (!UnpackFile (packed, &out[i], check) || memcmp (check, buf, len))
+					Error ("%s didn't survive compression", zf->name);
+				free (check);
+				len = out[i].complen;
+			}
+			else
+				stored++;
+		}
+
+		if (fwrite (out[i].complen ? packed : buf, 1, len, f) != len)
+			Error ("Couldn't write %s", filename);
+		printf ("%56s : %8i %8i\n", out[i].name, out[i].filelen, len);
+		pos += len;
+		free (buf);
+		free (packed);
+	}
+
+	// the directory
+	size = compress ? sizeof(dpakzfile_t) : sizeof(dpackfile_t);
+	PutLong ((byte *)&header.ident, compress ? IDPAKZHEADER : IDPAKHEADER);
+	PutLong ((byte *)&header.dirofs, pos);
+	PutLong ((byte *)&header.dirlen, in->numfiles * size);
+	for (i=0 ; i<in->numfiles ; i++)
+	{
+		PutLong ((byte *)&out[i].filepos, out[i].filepos);
+		PutLong ((byte *)&out[i].filelen, out[i].filelen);
+		PutLong ((byte *)&out[i].complen, out[i].complen);
+		fwrite (&out[i], 1, size, f);		// a dpackfile_t is the front of a dpakzfile_t
+	}
+	fseek (f, 0, SEEK_SET);
+	fwrite (&header, 1, sizeof(header), f);
+	if (fclose (f))
+		Error ("Couldn't write %s", filename);
+
+	printf ("%i files, %i bytes in %i bytes", in->numfiles, in->len, pos + in->numfiles * size);
+	if (compress)
+		printf (", %i stored", stored);
+	printf ("\n");
+	free (out);
+}
+
+/*
+================
+TestPak
+
+Unpacks every file the way the engine does, a whole file at a time, and
+times it
+================
+*/
+void TestPak (char *filename, int passes)
+{
+	pak_t	*pak;
+	byte	*buf;
+	int		i, pass;
+	double	start, time, best, bytes, packed;
+
+	pak = malloc (sizeof(*pak));
+	LoadPak (filename, pak);
+
+	best = 1e9;
+	bytes = packed = 0;
+	for (pass=0 ; pass<passes ; pass++)
+	{
+		bytes = packed = 0;
+		start = Seconds ();
+		for (i=0 ; i<pak->numfiles ; i++)
+		{
+			buf = malloc (pak->files[i].filelen + 1);
+			if (!UnpackFile (pak->data + pak->files[i].filepos, &pak->files[i], buf))
+				Error ("%s is damaged", pak->files[i].name);
+			bytes += pak->files[i].filelen;
+			packed += pak->files[i].complen ? pak->files[i].complen : pak->files[i].filelen;
+			free (buf);
+		}
+		time = Seconds () - start;
+		if (time < best)
+			best = time;
+	}
+
+	printf ("%s: %i files, %.0f KB in %.0f KB (%.1f%%)\n", filename, pak->numfiles,
+		bytes / 1024, packed / 1024, bytes ? 100 * packed / bytes : 100);
+	printf ("best of %i: %.1f ms, %.1f MB/s\n", passes, best * 1000,
+		best > 0 ? bytes / (1024*1024) / best : 0);
+	free (pak->data);
+	free (pak);
+}
+
+int main (int argc, char **argv)
+{
+	pak_t	*pak;
+
+	if (argc >= 3 && !strcmp (argv[1], "-test"))
+	{
+		TestPak (argv[2], argc > 3 ? atoi (argv[3]) : 10);
+		return 0;
+	}
+
+	pak = malloc (sizeof(*pak));
+	if (argc == 4 && !strcmp (argv[1], "-x"))
+	{
+		LoadPak (argv[2], pak);
+		WritePak (argv[3], pak, 0);
+		return 0;
+	}
+	if (argc == 3)
+	{
+		LoadPak (argv[1], pak);
+		WritePak (argv[2], pak, 1);
+		return 0;
+	}
+
+	printf ("usage: pakz <in.pak> <out.pak>\n"
+			"       pakz -x <in.pak> <out.pak>\n"
+			"       pakz -test <pak> [passes]\n");
+	return 1;
+}